@@ -2,9 +2,27 @@
 #include "utils/AddInLogger.h"
 #include "security/AddInSandbox.h"
 #include "discovery/AddInDiscovery.h"
+#include "../core-engine/Performance/Profiler.h"
+#include "../core-engine/Performance/Metrics.h"
 #include <algorithm>
 #include <stdexcept>
 
+namespace {
+
+using excel::core_engine::performance::GetMetrics;
+
+excel::core_engine::performance::Histogram& CallLatency(const char* call) {
+    return GetMetrics().GetHistogram("excel_addin_call_duration_seconds", "Latency of calls into add-ins.",
+                                     std::string("call=\"") + call + "\"");
+}
+
+excel::core_engine::performance::Counter& CallErrors() {
+    static auto& counter = GetMetrics().GetCounter("excel_addin_call_errors_total", "Add-in calls that threw.");
+    return counter;
+}
+
+} // namespace
+
 AddInManager::AddInManager(IAddInHost* host, IExcelInterop* excelInterop)
     : m_host(host), m_excelInterop(excelInterop) {
     if (!m_host || !m_excelInterop) {
@@ -20,6 +38,8 @@ AddInManager::~AddInManager() {
 }
 
 bool AddInManager::LoadAddIn(const std::string& addInPath) {
+    EXCEL_PROFILE_SCOPE("AddInManager::LoadAddIn");
+
     try {
         // Use AddInDiscovery to locate and validate the add-in
         auto addInInfo = AddInDiscovery::DiscoverAddIn(addInPath);
@@ -110,23 +130,35 @@ void AddInManager::ShutdownAddIns() {
 }
 
 void AddInManager::OnCalculate() {
+    EXCEL_PROFILE_SCOPE("AddInManager::OnCalculate");
+    static auto& latency = CallLatency("calculate");
+
     for (const auto& addIn : m_addIns) {
         try {
+            EXCEL_PROFILE_SCOPE("IAddIn::OnCalculate");
+            excel::core_engine::performance::ScopedTimer timer(latency);
             addIn->OnCalculate();
         }
         catch (const std::exception& e) {
+            CallErrors().Increment();
             AddInLogger::Log(LogLevel::Error, "Exception during add-in calculation: " + std::string(e.what()));
         }
     }
 }
 
 void AddInManager::ExecuteCommand(const std::string& command) {
+    EXCEL_PROFILE_SCOPE("AddInManager::ExecuteCommand");
+    static auto& latency = CallLatency("command");
+
     for (const auto& addIn : m_addIns) {
         try {
+            EXCEL_PROFILE_SCOPE("IAddIn::OnCommand");
+            excel::core_engine::performance::ScopedTimer timer(latency);
             addIn->OnCommand(command);
             AddInLogger::Log(LogLevel::Info, "Executed command '" + command + "' for add-in: " + addIn->GetName());
         }
         catch (const std::exception& e) {
+            CallErrors().Increment();
             AddInLogger::Log(LogLevel::Error, "Exception during command execution: " + std::string(e.what()));
         }
     }
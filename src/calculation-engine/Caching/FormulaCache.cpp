@@ -1,69 +1,110 @@
 #include "FormulaCache.h"
-#include <chrono>
-#include <sstream>
+#include <algorithm>
+#include <mutex>
 
-FormulaCache::FormulaCache(std::shared_ptr<ICalculationChain> calculationChain)
-    : m_calculationChain(std::move(calculationChain)) {}
+namespace ExcelCalculationEngine {
 
-std::optional<CellValue> FormulaCache::GetCachedResult(const Cell& cell, const Workbook& workbook) {
-    std::string cacheKey = GenerateCacheKey(cell, workbook);
-    auto it = m_cache.find(cacheKey);
-    
-    if (it != m_cache.end()) {
-        const CacheEntry& entry = it->second;
-        auto now = std::chrono::steady_clock::now();
-        
-        // Check if the cache entry is still valid
-        if (now - entry.timestamp < std::chrono::seconds(CACHE_EXPIRATION_SECONDS)) {
-            return entry.result;
-        } else {
-            // Remove expired entry
-            m_cache.erase(it);
-        }
+FormulaCache::FormulaCache(std::size_t capacity)
+    : m_capacity(std::max<std::size_t>(capacity, 1)),
+      m_referenced(new std::atomic<std::uint8_t>[m_capacity]) {
+    for (std::size_t i = 0; i < m_capacity; ++i) {
+        m_referenced[i].store(0, std::memory_order_relaxed);
     }
-    
-    return std::nullopt;
+    m_slots.reserve(m_capacity);
 }
 
-void FormulaCache::CacheResult(const Cell& cell, const Workbook& workbook, const CellValue& result) {
-    std::string cacheKey = GenerateCacheKey(cell, workbook);
-    CacheEntry entry{result, std::chrono::steady_clock::now()};
-    m_cache[cacheKey] = entry;
-    
-    // Implement cache size management if needed
-    if (m_cache.size() > MAX_CACHE_SIZE) {
-        // Remove the oldest entry
-        auto oldest = m_cache.begin();
-        for (auto it = m_cache.begin(); it != m_cache.end(); ++it) {
-            if (it->second.timestamp < oldest->second.timestamp) {
-                oldest = it;
-            }
-        }
-        m_cache.erase(oldest);
+std::optional<FormulaCache::Value> FormulaCache::Get(std::string_view formula, const CellReference& cell) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_slots.find(GetKey(cell));
+    if (it == m_slots.end() || m_entries[it->second].formula != formula) {
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    m_referenced[it->second].store(1, std::memory_order_relaxed);
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return m_entries[it->second].value;
+}
+
+void FormulaCache::Set(std::string_view formula, const CellReference& cell, const Value& value) {
+    const CellKey key = GetKey(cell);
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_slots.find(key);
+    const std::uint32_t slot = it != m_slots.end() ? it->second : TakeSlot();
+    Entry& entry = m_entries[slot];
+    entry.key = key;
+    entry.formula.assign(formula.data(), formula.size());
+    entry.value = value;
+    m_referenced[slot].store(1, std::memory_order_relaxed);
+    if (it == m_slots.end()) {
+        m_slots.emplace(key, slot);
     }
 }
 
-void FormulaCache::InvalidateCache(const Cell& cell) {
-    // Since we don't have the workbook here, we need to invalidate all entries for this cell
-    // across all workbooks. This might be less efficient but ensures correctness.
-    for (auto it = m_cache.begin(); it != m_cache.end();) {
-        if (it->first.find(cell.GetAddress()) != std::string::npos) {
-            it = m_cache.erase(it);
-        } else {
-            ++it;
+std::uint32_t FormulaCache::TakeSlot() {
+    if (!m_freeSlots.empty()) {
+        const std::uint32_t slot = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        return slot;
+    }
+    if (m_entries.size() < m_capacity) {
+        m_entries.emplace_back();
+        return static_cast<std::uint32_t>(m_entries.size() - 1);
+    }
+    // Every slot is in use. Give each entry hit since the hand last passed a second chance.
+    for (;;) {
+        const std::uint32_t slot = static_cast<std::uint32_t>(m_hand);
+        m_hand = m_hand + 1 == m_capacity ? 0 : m_hand + 1;
+        if (m_referenced[slot].exchange(0, std::memory_order_relaxed) == 0) {
+            m_slots.erase(m_entries[slot].key);
+            ++m_evictions;
+            return slot;
         }
     }
-    
-    // Notify the calculation chain that this cell's dependencies need to be recalculated
-    m_calculationChain->InvalidateCell(cell);
+}
+
+void FormulaCache::Remove(CellKey key) {
+    auto it = m_slots.find(key);
+    if (it == m_slots.end()) {
+        return;
+    }
+    m_freeSlots.push_back(it->second);
+    m_slots.erase(it);
+    ++m_invalidations;
+}
+
+void FormulaCache::Invalidate(const CellReference& cell) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    Remove(GetKey(cell));
+}
+
+void FormulaCache::Invalidate(const std::vector<CellReference>& cells) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    for (const CellReference& cell : cells) {
+        Remove(GetKey(cell));
+    }
 }
 
 void FormulaCache::ClearCache() {
-    m_cache.clear();
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_invalidations += m_slots.size();
+    m_slots.clear();
+    m_entries.clear();
+    m_freeSlots.clear();
+    m_hand = 0;
+    for (std::size_t i = 0; i < m_capacity; ++i) {
+        m_referenced[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+FormulaCache::Statistics FormulaCache::GetStatistics() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    Statistics statistics;
+    statistics.hits = m_hits.load(std::memory_order_relaxed);
+    statistics.misses = m_misses.load(std::memory_order_relaxed);
+    statistics.evictions = m_evictions;
+    statistics.invalidations = m_invalidations;
+    statistics.entries = m_slots.size();
+    return statistics;
 }
 
-std::string FormulaCache::GenerateCacheKey(const Cell& cell, const Workbook& workbook) {
-    std::stringstream ss;
-    ss << workbook.GetId() << "_" << cell.GetWorksheet().GetName() << "_" << cell.GetAddress();
-    return ss.str();
-}
\ No newline at end of file
+} // namespace ExcelCalculationEngine
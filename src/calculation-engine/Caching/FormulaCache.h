@@ -1,46 +1,116 @@
 #ifndef FORMULA_CACHE_H
 #define FORMULA_CACHE_H
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include "../Interfaces/ICalculationChain.h"
-#include "../../core-engine/DataStructures/Cell.h"
-#include "../../core-engine/DataStructures/Workbook.h"
+#include <variant>
+#include <vector>
+#include "../Interfaces/GridReference.h"
 
 namespace ExcelCalculationEngine {
 
+/**
+ * @class FormulaCache
+ * @brief Fixed-capacity cache of formula results, keyed by cell.
+ *
+ * A cell's key is its coordinates packed into one integer, so a lookup
+ * hashes eight bytes and builds no string. Each entry remembers the formula
+ * it was computed for and only answers lookups for that same formula.
+ *
+ * When full, the CLOCK algorithm picks the victim: a hit only sets the
+ * entry's reference bit, and the hand clears bits as it sweeps until it
+ * finds an entry not used since its last pass. Hits therefore run under a
+ * shared lock and never reorder anything.
+ *
+ * Nothing expires on its own. Whoever changes a cell invalidates it and the
+ * dependents the calculation chain reports, each in O(1).
+ */
 class FormulaCache {
 public:
-    // Constructor
-    explicit FormulaCache(std::shared_ptr<ICalculationChain> calculationChain);
+    using Value = std::variant<double, std::string, bool>;
+    using CellKey = std::uint64_t;
 
-    // Retrieve cached result for a given cell
-    std::optional<CellValue> GetCachedResult(const Cell& cell, const Workbook& workbook) const;
+    struct Statistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::uint64_t evictions = 0;      ///< Entries dropped to make room.
+        std::uint64_t invalidations = 0;  ///< Entries dropped because their cell or a precedent changed.
+        std::size_t entries = 0;
+    };
+
+    static constexpr std::size_t DEFAULT_CAPACITY = 1 << 16;
+
+    explicit FormulaCache(std::size_t capacity = DEFAULT_CAPACITY);
+    FormulaCache(const FormulaCache&) = delete;
+    FormulaCache& operator=(const FormulaCache&) = delete;
 
-    // Cache result for a given cell
-    void CacheResult(const Cell& cell, const Workbook& workbook, const CellValue& result);
+    /**
+     * @brief Returns the result cached for @p cell, if it was computed for @p formula.
+     */
+    std::optional<Value> Get(std::string_view formula, const CellReference& cell) const;
 
-    // Invalidate cached result for a given cell
-    void InvalidateCache(const Cell& cell);
+    /**
+     * @brief Caches @p value as the result of @p formula at @p cell, evicting an entry if full.
+     */
+    void Set(std::string_view formula, const CellReference& cell, const Value& value);
+
+    /**
+     * @brief Drops whatever is cached for @p cell.
+     */
+    void Invalidate(const CellReference& cell);
+
+    /**
+     * @brief Drops every cell in @p cells under one lock, e.g. an edit and its dependents.
+     */
+    void Invalidate(const std::vector<CellReference>& cells);
 
-    // Clear all cached results
     void ClearCache();
 
-private:
-    // Generate a unique key for a cell
-    std::string GenerateKey(const Cell& cell, const Workbook& workbook) const;
+    Statistics GetStatistics() const;
 
-    struct CacheEntry {
-        CellValue value;
-        std::chrono::system_clock::time_point timestamp;
+    std::size_t GetCapacity() const noexcept { return m_capacity; }
+
+    /**
+     * @brief The integer a cell is cached under; distinct for every cell inside the grid.
+     */
+    static CellKey GetKey(const CellReference& cell) noexcept {
+        return (static_cast<CellKey>(cell.sheet) << 36) |
+               (static_cast<CellKey>(static_cast<std::uint32_t>(cell.row)) << 15) |
+               static_cast<CellKey>(static_cast<std::uint32_t>(cell.column));
+    }
+
+private:
+    struct Entry {
+        CellKey key = 0;
+        std::string formula;
+        Value value;
     };
 
-    std::unordered_map<std::string, CacheEntry> m_cache;
-    std::shared_ptr<ICalculationChain> m_calculationChain;
+    /// Requires the exclusive lock.
+    void Remove(CellKey key);
+    std::uint32_t TakeSlot();
+
+    const std::size_t m_capacity;
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<CellKey, std::uint32_t> m_slots; ///< Key to index in m_entries.
+    std::vector<Entry> m_entries;                        ///< Grows up to m_capacity, then slots are reused.
+    std::unique_ptr<std::atomic<std::uint8_t>[]> m_referenced; ///< CLOCK bits, set by hits under the shared lock.
+    std::vector<std::uint32_t> m_freeSlots;              ///< Slots emptied by invalidation.
+    std::size_t m_hand = 0;
+
+    mutable std::atomic<std::uint64_t> m_hits{0};
+    mutable std::atomic<std::uint64_t> m_misses{0};
+    std::uint64_t m_evictions = 0;
+    std::uint64_t m_invalidations = 0;
 };
 
 } // namespace ExcelCalculationEngine
 
-#endif // FORMULA_CACHE_H
\ No newline at end of file
+#endif // FORMULA_CACHE_H
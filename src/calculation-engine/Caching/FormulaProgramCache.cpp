@@ -0,0 +1,53 @@
+#include "FormulaProgramCache.h"
+#include "../FormulaParser/FormulaCompiler.h"
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+
+namespace ExcelCalculationEngine {
+
+FormulaBinding FormulaProgramCache::Bind(std::string_view formula, const CellReference& anchor) {
+    FormulaCompiler compiler(formula, anchor);
+    if (auto program = Find(compiler.GetShape())) {
+        return {std::move(program), anchor};
+    }
+
+    // Compile outside the lock; if another thread wins the race its program is kept.
+    std::shared_ptr<const FormulaProgram> program = compiler.Compile();
+    m_compileCount.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    auto& entry = m_programs[compiler.GetShape()];
+    if (auto existing = entry.lock()) {
+        return {std::move(existing), anchor};
+    }
+    entry = program;
+
+    // Sweeping only when the map has doubled keeps it amortized O(1) per compile
+    if (m_programs.size() >= m_sweepThreshold) {
+        for (auto it = m_programs.begin(); it != m_programs.end();) {
+            it = it->second.expired() ? m_programs.erase(it) : std::next(it);
+        }
+        m_sweepThreshold = std::max(MIN_SWEEP_THRESHOLD, m_programs.size() * 2);
+    }
+    return {std::move(program), anchor};
+}
+
+std::shared_ptr<const FormulaProgram> FormulaProgramCache::Find(const std::string& shape) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_programs.find(shape);
+    return it != m_programs.end() ? it->second.lock() : nullptr;
+}
+
+std::size_t FormulaProgramCache::GetShapeCount() const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    return static_cast<std::size_t>(std::count_if(m_programs.begin(), m_programs.end(),
+        [](const auto& entry) { return !entry.second.expired(); }));
+}
+
+void FormulaProgramCache::Clear() {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_programs.clear();
+    m_sweepThreshold = MIN_SWEEP_THRESHOLD;
+}
+
+} // namespace ExcelCalculationEngine
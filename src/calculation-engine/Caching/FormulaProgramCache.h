@@ -0,0 +1,65 @@
+#ifndef FORMULA_PROGRAM_CACHE_H
+#define FORMULA_PROGRAM_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "../FormulaParser/FormulaProgram.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class FormulaProgramCache
+ * @brief Interns compiled formula programs by their relative R1C1 shape.
+ *
+ * A formula filled down a column has one shape, so it is compiled once no
+ * matter how many cells use it. The cache only observes its programs: the
+ * bindings own them, so a shape is freed with the last cell that uses it and
+ * its expired entry is swept on a later compile. Lookups take a shared lock;
+ * only compiling a shape takes the exclusive one.
+ */
+class FormulaProgramCache {
+public:
+    FormulaProgramCache() = default;
+    FormulaProgramCache(const FormulaProgramCache&) = delete;
+    FormulaProgramCache& operator=(const FormulaProgramCache&) = delete;
+
+    /**
+     * @brief Returns the binding for a formula entered at a cell, compiling its shape if it is new.
+     * @throws CalculationException if the formula is malformed.
+     */
+    FormulaBinding Bind(std::string_view formula, const CellReference& anchor);
+
+    /**
+     * @brief Returns the program for a shape key, or nullptr if no live binding uses it.
+     */
+    std::shared_ptr<const FormulaProgram> Find(const std::string& shape) const;
+
+    /**
+     * @brief Number of shapes still bound to at least one cell.
+     */
+    std::size_t GetShapeCount() const;
+
+    /**
+     * @brief Number of compilations performed; equals GetShapeCount() unless two threads raced on a new shape.
+     */
+    std::size_t GetCompileCount() const noexcept { return m_compileCount.load(std::memory_order_relaxed); }
+
+    void Clear();
+
+private:
+    mutable std::shared_mutex m_mutex;
+    std::unordered_map<std::string, std::weak_ptr<const FormulaProgram>> m_programs;
+    std::size_t m_sweepThreshold = MIN_SWEEP_THRESHOLD; ///< Entry count at which expired shapes are swept.
+    std::atomic<std::size_t> m_compileCount{0};
+
+    static constexpr std::size_t MIN_SWEEP_THRESHOLD = 64;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FORMULA_PROGRAM_CACHE_H
@@ -2,8 +2,12 @@
 #include "DependencyGraph.h"
 #include "src/core-engine/DataStructures/Cell.h"
 #include "src/calculation-engine/ErrorHandling/CalculationErrors.h"
+#include "src/calculation-engine/Multithreading/ParallelCalculation.h"
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <stdexcept>
+#include <utility>
 
 CalculationChain::CalculationChain() : m_dependencyGraph(std::make_unique<DependencyGraph>()) {}
 
@@ -13,12 +17,32 @@ void CalculationChain::AddCell(const std::shared_ptr<Cell>& cell) {
     if (!cell) {
         throw std::invalid_argument("Cannot add null cell to calculation chain");
     }
+    if (m_nodes.count(cell.get()) != 0) {
+        return;
+    }
+
+    // Give the cell a node in the dependency graph
+    const NodeId node = m_dependencyGraph->AddNode();
+    m_nodes.emplace(cell.get(), node);
+    if (node >= m_nodeCells.size()) {
+        m_nodeCells.resize(node + 1);
+    }
+    m_nodeCells[node] = cell;
+    SetNodeEntry(node, UINT32_MAX);
+}
 
-    // Add the cell to the calculation chain
-    m_cells.push_back(cell);
+void CalculationChain::AddCell(const std::shared_ptr<Cell>& cell, const CellReference& position) {
+    AddCell(cell);
+    const NodeId node = GetNode(cell);
+    if (m_nodeEntries[node] != UINT32_MAX) {
+        return;
+    }
+    SetNodeEntry(node, m_positions.Insert(RangeReference{position.sheet, position.row, position.column, position.row, position.column}, node));
 
-    // Update the dependency graph with the new cell
-    m_dependencyGraph->AddCell(cell);
+    // Existing ranges over this position now read it. The cell has no dependents yet, so this cannot close a cycle.
+    m_ranges.ForEachContaining(position, [this, node](NodeId rangeNode, RangeEntryId) {
+        m_dependencyGraph->AddDependency(rangeNode, node);
+    });
 }
 
 void CalculationChain::RemoveCell(const std::shared_ptr<Cell>& cell) {
@@ -26,35 +50,182 @@ void CalculationChain::RemoveCell(const std::shared_ptr<Cell>& cell) {
         throw std::invalid_argument("Cannot remove null cell from calculation chain");
     }
 
-    // Remove the cell from the calculation chain
-    auto it = std::find(m_cells.begin(), m_cells.end(), cell);
-    if (it != m_cells.end()) {
-        m_cells.erase(it);
+    auto it = m_nodes.find(cell.get());
+    if (it == m_nodes.end()) {
+        return;
     }
 
-    // Update the dependency graph to remove the cell and its dependencies
-    m_dependencyGraph->RemoveCell(cell);
+    // Drop the node and every edge touching it, then any ranges only it was reading
+    const NodeId node = it->second;
+    const std::vector<NodeId> precedents = m_dependencyGraph->GetPrecedents(node);
+    if (m_nodeEntries[node] != UINT32_MAX) {
+        m_positions.Remove(m_nodeEntries[node]);
+        m_nodeEntries[node] = UINT32_MAX;
+    }
+    m_dependencyGraph->RemoveNode(node);
+    m_nodeCells[node].reset();
+    m_nodes.erase(it);
+    m_dynamicPrecedents.erase(node);
+    for (NodeId precedent : precedents) {
+        if (IsRangeNode(precedent)) {
+            ReleaseRangeNode(precedent);
+        }
+    }
 }
 
 void CalculationChain::UpdateDependencies(const std::shared_ptr<Cell>& cell, const std::vector<std::shared_ptr<Cell>>& dependencies) {
+    UpdateDependencies(cell, dependencies, {});
+}
+
+void CalculationChain::UpdateDependencies(const std::shared_ptr<Cell>& cell, const std::vector<std::shared_ptr<Cell>>& dependencies,
+                                          const std::vector<RangeReference>& ranges) {
     if (!cell) {
         throw std::invalid_argument("Cannot update dependencies for null cell");
     }
 
-    // Update the dependencies for the given cell in the dependency graph
-    m_dependencyGraph->UpdateDependencies(cell, dependencies);
+    const NodeId node = GetNode(cell);
+    std::vector<NodeId> precedents;
+    precedents.reserve(dependencies.size() + ranges.size());
+    for (const auto& dependency : dependencies) {
+        precedents.push_back(GetNode(dependency));
+    }
+    const std::vector<NodeId> previous = m_dependencyGraph->GetPrecedents(node);
 
-    // Check for circular dependencies
-    if (m_dependencyGraph->HasCircularDependency(cell)) {
-        throw CalculationError("Circular dependency detected", CalculationErrorType::CircularReference);
+    try {
+        for (const auto& range : ranges) {
+            precedents.push_back(AcquireRangeNode(range));
+        }
+        // Throws CalculationException (CIRCULAR_REFERENCE) and leaves the old edges in place on a cycle
+        m_dependencyGraph->UpdateDependencies(node, precedents);
+    } catch (...) {
+        for (NodeId precedent : precedents) {
+            if (IsRangeNode(precedent)) {
+                ReleaseRangeNode(precedent);
+            }
+        }
+        throw;
     }
 
-    // Recalculate the calculation order if necessary
-    RecalculateOrder();
+    // A new formula resolves its own references the next time it runs
+    m_dynamicPrecedents.erase(node);
+    for (NodeId precedent : previous) {
+        if (IsRangeNode(precedent)) {
+            ReleaseRangeNode(precedent);
+        }
+    }
+    // New edges may have moved nodes; an interrupted pass must re-sort before resuming
+    if (!m_pendingNodes.empty()) {
+        m_reorderPending = true;
+    }
+}
+
+bool CalculationChain::SetDynamicDependencies(const std::shared_ptr<Cell>& cell, const std::vector<RangeReference>& ranges) {
+    if (!cell) {
+        throw std::invalid_argument("Cannot record dependencies for null cell");
+    }
+
+    const NodeId node = GetNode(cell);
+    auto found = m_dynamicPrecedents.find(node);
+    const std::vector<NodeId> previous = found != m_dynamicPrecedents.end() ? found->second : std::vector<NodeId>();
+    auto wasRecorded = [&previous](NodeId precedent) {
+        return std::binary_search(previous.begin(), previous.end(), precedent);
+    };
+
+    // The static precedents are whatever the last recording did not add
+    std::vector<NodeId> precedents = m_dependencyGraph->GetPrecedents(node);
+    precedents.erase(std::remove_if(precedents.begin(), precedents.end(), wasRecorded), precedents.end());
+    const std::size_t staticCount = precedents.size();
+
+    std::vector<NodeId> recorded;
+    try {
+        for (const auto& range : ranges) {
+            const NodeId rangeNode = AcquireRangeNode(range);
+            if (std::find(precedents.begin(), precedents.end(), rangeNode) == precedents.end()) {
+                precedents.push_back(rangeNode);
+            }
+        }
+        recorded.assign(precedents.begin() + staticCount, precedents.end());
+        std::sort(recorded.begin(), recorded.end());
+        // The usual case: the cell read the same cells as last time
+        if (recorded == previous) {
+            return false;
+        }
+        m_dependencyGraph->UpdateDependencies(node, precedents);
+    } catch (...) {
+        for (auto it = precedents.begin() + staticCount; it != precedents.end(); ++it) {
+            ReleaseRangeNode(*it);
+        }
+        throw;
+    }
+
+    bool stale = false;
+    for (NodeId rangeNode : recorded) {
+        if (!wasRecorded(rangeNode)) {
+            m_dependencyGraph->ForEachPrecedent(rangeNode, [this, &stale](NodeId precedent) {
+                stale = stale || m_nodeCells[precedent]->IsDirty();
+            });
+        }
+    }
+    for (NodeId rangeNode : previous) {
+        if (!std::binary_search(recorded.begin(), recorded.end(), rangeNode)) {
+            ReleaseRangeNode(rangeNode);
+        }
+    }
+    if (recorded.empty()) {
+        m_dynamicPrecedents.erase(node);
+    } else {
+        m_dynamicPrecedents[node] = std::move(recorded);
+    }
+
+    if (!m_pendingNodes.empty()) {
+        m_reorderPending = true;
+    }
+    if (stale) {
+        m_rescheduledNodes.push_back(node);
+    }
+    return stale;
+}
+
+void CalculationChain::BeginBulkLoad() {
+    m_dependencyGraph->BeginBulkLoad();
+}
+
+std::vector<std::vector<std::shared_ptr<Cell>>> CalculationChain::EndBulkLoad() {
+    std::vector<std::vector<std::shared_ptr<Cell>>> loops;
+    for (const std::vector<NodeId>& component : m_dependencyGraph->EndBulkLoad()) {
+        // A range in a loop is read and reads cells of it; only the cells are calculated
+        std::vector<std::shared_ptr<Cell>> cells;
+        for (NodeId node : component) {
+            if (!IsRangeNode(node)) {
+                cells.push_back(m_nodeCells[node]);
+            }
+        }
+        loops.push_back(std::move(cells));
+    }
+    if (!m_pendingNodes.empty()) {
+        m_reorderPending = true;
+    }
+    return loops;
+}
+
+void CalculationChain::SetCellCalculator(CellCalculator calculator) {
+    m_cellCalculator = std::move(calculator);
+}
+
+void CalculationChain::SetLoopCalculator(LoopCalculator calculator) {
+    m_loopCalculator = std::move(calculator);
 }
 
 std::vector<std::shared_ptr<Cell>> CalculationChain::GetCalculationOrder() const {
-    return m_calculationOrder;
+    // The graph keeps the order up to date on every edge change; this only reads it
+    std::vector<std::shared_ptr<Cell>> order;
+    order.reserve(m_nodes.size());
+    m_dependencyGraph->ForEachInOrder([this, &order](NodeId node) {
+        if (!IsRangeNode(node)) {
+            order.push_back(m_nodeCells[node]);
+        }
+    });
+    return order;
 }
 
 void CalculationChain::InvalidateCell(const std::shared_ptr<Cell>& cell) {
@@ -63,42 +234,481 @@ void CalculationChain::InvalidateCell(const std::shared_ptr<Cell>& cell) {
     }
 
     // Mark the cell as dirty (needing recalculation)
+    const NodeId node = GetNode(cell);
     cell->SetDirty(true);
+    RaiseNodeState(node, NodeState::STALE);
+    m_dirtyNodes.push_back(node);
 
     // Propagate the invalidation to all dependent cells
-    auto dependentCells = m_dependencyGraph->GetDependentCells(cell);
-    for (const auto& dependentCell : dependentCells) {
-        InvalidateCell(dependentCell);
+    MarkDependentsDirty({node});
+}
+
+void CalculationChain::InvalidateCells(const std::vector<std::shared_ptr<Cell>>& cells) {
+    std::vector<NodeId> roots;
+    roots.reserve(cells.size());
+    for (const auto& cell : cells) {
+        if (!cell) {
+            throw std::invalid_argument("Cannot invalidate null cell");
+        }
+        roots.push_back(GetNode(cell));
     }
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        cells[i]->SetDirty(true);
+        RaiseNodeState(roots[i], NodeState::STALE);
+    }
+    m_dirtyNodes.insert(m_dirtyNodes.end(), roots.begin(), roots.end());
+    MarkDependentsDirty(std::move(roots));
 }
 
-void CalculationChain::RecalculateChain() {
-    // Identify all dirty cells
-    std::vector<std::shared_ptr<Cell>> dirtyCells;
-    for (const auto& cell : m_cells) {
-        if (cell->IsDirty()) {
-            dirtyCells.push_back(cell);
+void CalculationChain::InvalidateDependents(const std::vector<std::shared_ptr<Cell>>& cells) {
+    std::vector<NodeId> roots;
+    std::vector<std::uint8_t> wasDirty;
+    roots.reserve(cells.size());
+    wasDirty.reserve(cells.size());
+    for (const auto& cell : cells) {
+        if (!cell) {
+            throw std::invalid_argument("Cannot invalidate null cell");
         }
+        roots.push_back(GetNode(cell));
+        wasDirty.push_back(cell->IsDirty());
+    }
+    MarkDependentsDirty(roots);
+    for (NodeId root : roots) {
+        MarkDependentsStale(root);
+    }
+    // The cells may read each other, as a loop does; their values are current
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        if (!wasDirty[i]) {
+            cells[i]->SetDirty(false);
+            m_nodeStates[roots[i]] = NodeState::CLEAN;
+        }
+    }
+}
+
+void CalculationChain::SetVolatile(const std::shared_ptr<Cell>& cell, bool isVolatile) {
+    if (!cell) {
+        throw std::invalid_argument("Cannot mark null cell as volatile");
+    }
+    m_dependencyGraph->SetVolatile(GetNode(cell), isVolatile);
+}
+
+void CalculationChain::InvalidateVolatileCells() {
+    const std::vector<NodeId>& volatileNodes = m_dependencyGraph->GetVolatileNodes();
+    if (volatileNodes.empty()) {
+        return;
+    }
+    for (NodeId node : volatileNodes) {
+        m_nodeCells[node]->SetDirty(true);
+        RaiseNodeState(node, NodeState::STALE);
+    }
+    m_dirtyNodes.insert(m_dirtyNodes.end(), volatileNodes.begin(), volatileNodes.end());
+    MarkDependentsDirty(volatileNodes);
+}
+
+void CalculationChain::InvalidateCell(const CellReference& position) {
+    InvalidateCells({position});
+}
+
+void CalculationChain::InvalidateCells(const std::vector<CellReference>& positions) {
+    // The formula at each position, if any, and every range covering it
+    std::vector<NodeId> roots;
+    for (const CellReference& position : positions) {
+        m_positions.ForEachContaining(position, [&roots](NodeId node, RangeEntryId) { roots.push_back(node); });
+        m_ranges.ForEachContaining(position, [&roots](NodeId node, RangeEntryId) { roots.push_back(node); });
+    }
+    MarkDependentsDirty(roots);
+    // The value at the position is what changed, so whatever reads it directly must run
+    for (NodeId root : roots) {
+        MarkDependentsStale(root);
     }
+}
+
+void CalculationChain::RecalculateChain() {
+    RecalculateChain(std::chrono::steady_clock::duration::max(), CancellationToken());
+}
 
-    // Perform a topological sort to determine the correct calculation order
-    m_calculationOrder = m_dependencyGraph->TopologicalSort(dirtyCells);
+bool CalculationChain::RecalculateChain(std::chrono::steady_clock::duration timeSlice,
+                                        const CancellationToken& cancellation) {
+    const auto start = std::chrono::steady_clock::now();
+    if (m_pendingCursor == m_pendingNodes.size()) {
+        InvalidateVolatileCells();
+    }
+    // Only dirty cells are sorted, not the whole chain
+    PreparePendingNodes();
+    const bool timed = timeSlice < std::chrono::steady_clock::time_point::max() - start;
+    const auto deadline = timed ? start + timeSlice : std::chrono::steady_clock::time_point::max();
 
-    // Recalculate dirty cells in the determined order
-    for (const auto& cell : m_calculationOrder) {
-        if (cell->IsDirty()) {
-            try {
-                cell->Recalculate();
-            } catch (const CalculationError& e) {
-                // Handle calculation errors (e.g., log the error, set cell to error state)
-                cell->SetErrorState(e.what());
+    // One clock read per cell: the time since the previous one is this cell's cost
+    auto tick = std::chrono::steady_clock::now();
+    bool ranThisSlice = false;
+    while (m_pendingCursor < m_pendingNodes.size()) {
+        if (cancellation.IsCancelled()) {
+            return false;
+        }
+        const NodeId node = m_pendingNodes[m_pendingCursor];
+        if (!m_dependencyGraph->IsNode(node)) {
+            ++m_pendingCursor;
+            continue;
+        }
+        if (IsRangeNode(node)) {
+            // A range changes when a cell inside it did
+            ++m_pendingCursor;
+            if (m_nodeStates[node] == NodeState::STALE) {
+                MarkDependentsStale(node);
             }
+            m_nodeStates[node] = NodeState::CLEAN;
+            continue;
+        }
+        // Cells removed since they were invalidated leave a reused slot behind
+        const std::shared_ptr<Cell>& cell = m_nodeCells[node];
+        if (!cell->IsDirty() || m_nodeStates[node] == NodeState::CHECK) {
+            // Nothing it reads came out different: early cutoff
+            ++m_pendingCursor;
             cell->SetDirty(false);
+            m_nodeStates[node] = NodeState::CLEAN;
+            continue;
+        }
+        // A cell known to take longer than what is left waits for the next slice, unless nothing has run yet
+        if (timed && ranThisSlice &&
+            tick + std::chrono::nanoseconds(static_cast<std::int64_t>(m_dependencyGraph->GetCost(node))) > deadline) {
+            return false;
+        }
+        ++m_pendingCursor;
+        m_nodeStates[node] = NodeState::CLEAN;
+        const std::uint32_t loop = m_dependencyGraph->GetCircularComponent(node);
+        if (loop != ExcelCalculationEngine::NO_COMPONENT) {
+            // The whole loop, whose other cells are cleaned and then skipped; its cost is charged here
+            RecalculateLoop(loop);
+        } else if (RecalculateCell(*cell)) {
+            MarkDependentsStale(node);
+        }
+        const auto done = std::chrono::steady_clock::now();
+        m_dependencyGraph->RecordCost(node, static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(done - tick).count()));
+        tick = done;
+        ranThisSlice = true;
+        if (!m_rescheduledNodes.empty()) {
+            // It read a cell the order had not reached yet; both now sit in the right order
+            PreparePendingNodes();
+            tick = std::chrono::steady_clock::now();
+        }
+        if (timed && tick >= deadline) {
+            return !HasPendingWork();
         }
     }
+    m_pendingNodes.clear();
+    m_pendingCursor = 0;
+    return !HasPendingWork();
 }
 
-void CalculationChain::RecalculateOrder() {
-    // Perform a topological sort on all cells to determine the new calculation order
-    m_calculationOrder = m_dependencyGraph->TopologicalSort(m_cells);
+void CalculationChain::RecalculateChain(ParallelCalculation& parallel) {
+    if (m_dependencyGraph->HasCircularComponents()) {
+        // A loop runs as one unit, which the scheduler's per-node dependency counts cannot express
+        RecalculateChain();
+        return;
+    }
+    InvalidateVolatileCells();
+    RescheduleOutOfOrderCells();
+    // Includes whatever an interrupted time-sliced pass left behind
+    std::vector<NodeId> dirtyNodes(m_pendingNodes.begin() + m_pendingCursor, m_pendingNodes.end());
+    m_pendingNodes.clear();
+    m_pendingCursor = 0;
+    dirtyNodes.insert(dirtyNodes.end(), m_dirtyNodes.begin(), m_dirtyNodes.end());
+    m_dirtyNodes.clear();
+    // Range nodes stay in: a dirty cell may depend on another only through a range
+    dirtyNodes.erase(std::remove_if(dirtyNodes.begin(), dirtyNodes.end(), [this](NodeId node) {
+        return !m_dependencyGraph->IsNode(node) || (!IsRangeNode(node) && !m_nodeCells[node]->IsDirty());
+    }), dirtyNodes.end());
+    NextVisitMark(); // grows m_nodeStates, which workers must not do
+
+    // Workers cannot safely flag each other's dependents, so a node that is
+    // only being checked looks at its precedents instead. Each precedent in
+    // the set has finished, and published its state, before this node starts.
+    parallel.Recalculate(*m_dependencyGraph, dirtyNodes, [this](NodeId node) {
+        NodeState& state = m_nodeStates[node];
+        bool run = state != NodeState::CHECK;
+        if (!run) {
+            m_dependencyGraph->ForEachPrecedent(node, [this, &run](NodeId precedent) {
+                run = run || m_nodeStates[precedent] == NodeState::CHANGED;
+            });
+        }
+        if (IsRangeNode(node)) {
+            state = run ? NodeState::CHANGED : NodeState::CLEAN;
+            return;
+        }
+        Cell& cell = *m_nodeCells[node];
+        if (!run) {
+            cell.SetDirty(false);
+            state = NodeState::CLEAN;
+            return;
+        }
+        const auto start = std::chrono::steady_clock::now();
+        const bool changed = RecalculateCell(cell);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        m_dependencyGraph->RecordCost(node, static_cast<float>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        state = changed ? NodeState::CHANGED : NodeState::CLEAN;
+    });
+    for (NodeId node : dirtyNodes) {
+        if (m_nodeStates[node] == NodeState::CHANGED) {
+            m_nodeStates[node] = NodeState::CLEAN;
+        }
+    }
+}
+
+NodeId CalculationChain::AcquireRangeNode(const RangeReference& range) {
+    auto it = m_rangeNodes.find(range);
+    if (it != m_rangeNodes.end()) {
+        return it->second;
+    }
+
+    const NodeId node = m_dependencyGraph->AddNode();
+    if (node >= m_nodeCells.size()) {
+        m_nodeCells.resize(node + 1);
+    }
+    SetNodeEntry(node, m_ranges.Insert(range, node));
+    m_rangeNodes.emplace(range, node);
+
+    // The range reads the formula cells inside it; constants need no edge
+    m_positions.ForEachIntersecting(range, [this, node](NodeId cellNode, RangeEntryId) {
+        m_dependencyGraph->AddDependency(node, cellNode);
+    });
+    return node;
+}
+
+void CalculationChain::ReleaseRangeNode(NodeId node) {
+    if (!m_dependencyGraph->IsNode(node)) {
+        return;
+    }
+    bool used = false;
+    m_dependencyGraph->ForEachDependent(node, [&used](NodeId) { used = true; });
+    if (used) {
+        return;
+    }
+    m_rangeNodes.erase(m_ranges.GetRange(m_nodeEntries[node]));
+    m_ranges.Remove(m_nodeEntries[node]);
+    m_nodeEntries[node] = UINT32_MAX;
+    m_dependencyGraph->RemoveNode(node);
+}
+
+void CalculationChain::SetPriorityRegion(const RangeReference& region) {
+    m_priorityRegion = region;
+    m_reorderPending = true;
+}
+
+void CalculationChain::ClearPriorityRegion() {
+    m_priorityRegion.reset();
+    m_reorderPending = true;
+}
+
+void CalculationChain::RescheduleOutOfOrderCells() {
+    std::vector<NodeId> nodes;
+    nodes.swap(m_rescheduledNodes);
+    nodes.erase(std::remove_if(nodes.begin(), nodes.end(), [this](NodeId node) {
+        return !m_dependencyGraph->IsNode(node) || IsRangeNode(node);
+    }), nodes.end());
+    for (NodeId node : nodes) {
+        m_nodeCells[node]->SetDirty(true);
+        RaiseNodeState(node, NodeState::STALE);
+    }
+    m_dirtyNodes.insert(m_dirtyNodes.end(), nodes.begin(), nodes.end());
+    MarkDependentsDirty(std::move(nodes));
+}
+
+void CalculationChain::PreparePendingNodes() {
+    RescheduleOutOfOrderCells();
+    if (m_dirtyNodes.empty() && !m_reorderPending) {
+        return;
+    }
+    const bool newPass = m_pendingNodes.empty();
+    m_pendingNodes.erase(m_pendingNodes.begin(), m_pendingNodes.begin() + m_pendingCursor);
+    m_pendingCursor = 0;
+    m_pendingNodes.insert(m_pendingNodes.end(), m_dirtyNodes.begin(), m_dirtyNodes.end());
+    m_dirtyNodes.clear();
+    m_reorderPending = false;
+
+    // Drop removed nodes and repeats
+    const std::uint32_t pendingMark = NextVisitMark();
+    m_pendingNodes.erase(std::remove_if(m_pendingNodes.begin(), m_pendingNodes.end(), [this, pendingMark](NodeId node) {
+        if (!m_dependencyGraph->IsNode(node) || m_visitMarks[node] == pendingMark) {
+            return true;
+        }
+        m_visitMarks[node] = pendingMark;
+        return false;
+    }), m_pendingNodes.end());
+
+    auto inOrder = [this](NodeId a, NodeId b) { return m_dependencyGraph->GetOrder(a) < m_dependencyGraph->GetOrder(b); };
+
+    // A stable model dirties the same cells each time, and unless edits moved them the last order still holds
+    const bool sameAsLastPass = newPass && m_lastPass.size() == m_pendingNodes.size() &&
+        std::all_of(m_lastPass.begin(), m_lastPass.end(), [this, pendingMark](NodeId node) {
+            return m_dependencyGraph->IsNode(node) && m_visitMarks[node] == pendingMark;
+        }) &&
+        std::is_sorted(m_lastPass.begin(), m_lastPass.end(), inOrder);
+    if (sameAsLastPass) {
+        m_pendingNodes.assign(m_lastPass.begin(), m_lastPass.end());
+    } else {
+        std::sort(m_pendingNodes.begin(), m_pendingNodes.end(), inOrder);
+        if (newPass) {
+            m_lastPass.assign(m_pendingNodes.begin(), m_pendingNodes.end());
+        }
+    }
+    if (!m_priorityRegion) {
+        return;
+    }
+
+    // The region's pending cells and, transitively, the pending nodes they read.
+    // A clean node reads nothing dirty, so the search stops there.
+    const std::uint32_t priorityMark = NextVisitMark();
+    std::vector<NodeId> stack;
+    auto visit = [this, pendingMark, priorityMark, &stack](NodeId node) {
+        if (m_visitMarks[node] == pendingMark) {
+            m_visitMarks[node] = priorityMark;
+            stack.push_back(node);
+        }
+    };
+    m_positions.ForEachIntersecting(*m_priorityRegion, [&visit](NodeId node, RangeEntryId) { visit(node); });
+    while (!stack.empty()) {
+        const NodeId node = stack.back();
+        stack.pop_back();
+        m_dependencyGraph->ForEachPrecedent(node, visit);
+    }
+    // Both halves stay in calculation order, and nothing in the first reads the second
+    std::stable_partition(m_pendingNodes.begin(), m_pendingNodes.end(),
+                          [this, priorityMark](NodeId node) { return m_visitMarks[node] == priorityMark; });
+}
+
+bool CalculationChain::RecalculateCell(Cell& cell) {
+    const auto previous = cell.GetValue();
+    bool changed = true;
+    try {
+        if (m_cellCalculator) {
+            m_cellCalculator(cell);
+        } else {
+            cell.Recalculate();
+        }
+        changed = !(cell.GetValue() == previous);
+    } catch (const CalculationError& e) {
+        // Handle calculation errors (e.g., log the error, set cell to error state)
+        cell.SetErrorState(e.what());
+    }
+    cell.SetDirty(false);
+    return changed;
+}
+
+void CalculationChain::RecalculateLoop(std::uint32_t loop) {
+    std::vector<NodeId> nodes;
+    std::vector<Cell*> cells;
+    std::vector<std::variant<std::string, double, bool>> previous;
+    for (NodeId node : m_dependencyGraph->GetCircularComponents()[loop]) {
+        m_nodeStates[node] = NodeState::CLEAN;
+        if (!IsRangeNode(node)) {
+            nodes.push_back(node);
+            cells.push_back(m_nodeCells[node].get());
+            previous.push_back(cells.back()->GetValue());
+        }
+    }
+    try {
+        if (m_loopCalculator) {
+            m_loopCalculator(cells);
+        } else {
+            for (Cell* cell : cells) {
+                if (m_cellCalculator) {
+                    m_cellCalculator(*cell);
+                } else {
+                    cell->Recalculate();
+                }
+            }
+        }
+    } catch (const CalculationError& e) {
+        for (Cell* cell : cells) {
+            cell->SetErrorState(e.what());
+        }
+    }
+
+    // Cells and ranges of the loop are done; readers outside it, also through a range of the loop, may need to run
+    auto markOutside = [this, loop](NodeId node) {
+        m_dependencyGraph->ForEachDependent(node, [this, loop](NodeId dependent) {
+            if (m_dependencyGraph->GetCircularComponent(dependent) != loop) {
+                RaiseNodeState(dependent, NodeState::STALE);
+            }
+        });
+    };
+    for (std::size_t i = 0; i < cells.size(); ++i) {
+        cells[i]->SetDirty(false);
+        if (cells[i]->GetValue() == previous[i]) {
+            continue;
+        }
+        markOutside(nodes[i]);
+        m_dependencyGraph->ForEachDependent(nodes[i], [this, loop, &markOutside](NodeId dependent) {
+            if (IsRangeNode(dependent) && m_dependencyGraph->GetCircularComponent(dependent) == loop) {
+                markOutside(dependent);
+            }
+        });
+    }
+}
+
+void CalculationChain::MarkDependentsStale(NodeId node) {
+    m_dependencyGraph->ForEachDependent(node, [this](NodeId dependent) { RaiseNodeState(dependent, NodeState::STALE); });
+}
+
+void CalculationChain::RaiseNodeState(NodeId node, NodeState state) {
+    if (node >= m_nodeStates.size()) {
+        m_nodeStates.resize(m_dependencyGraph->GetNodeCapacity(), NodeState::CLEAN);
+    }
+    if (m_nodeStates[node] != NodeState::STALE) {
+        m_nodeStates[node] = state;
+    }
+}
+
+void CalculationChain::SetNodeEntry(NodeId node, RangeEntryId entry) {
+    if (node >= m_nodeEntries.size()) {
+        m_nodeEntries.resize(node + 1, UINT32_MAX);
+    }
+    m_nodeEntries[node] = entry;
+}
+
+std::uint32_t CalculationChain::NextVisitMark() {
+    if (m_visitMarks.size() < m_dependencyGraph->GetNodeCapacity()) {
+        m_visitMarks.resize(m_dependencyGraph->GetNodeCapacity(), 0);
+    }
+    if (m_nodeStates.size() < m_dependencyGraph->GetNodeCapacity()) {
+        m_nodeStates.resize(m_dependencyGraph->GetNodeCapacity(), NodeState::CLEAN);
+    }
+    if (++m_visitEpoch == 0) {
+        std::fill(m_visitMarks.begin(), m_visitMarks.end(), 0);
+        m_visitEpoch = 1;
+    }
+    return m_visitEpoch;
+}
+
+void CalculationChain::MarkDependentsDirty(std::vector<NodeId> roots) {
+    // Epoch marks instead of a fresh visited array, so the cost is the cells reached, not the chain size
+    const std::uint32_t mark = NextVisitMark();
+    for (NodeId root : roots) {
+        m_visitMarks[root] = mark;
+    }
+
+    // Iterative, so long reference chains cannot overflow the stack
+    while (!roots.empty()) {
+        const NodeId node = roots.back();
+        roots.pop_back();
+        m_dependencyGraph->ForEachDependent(node, [this, mark, &roots](NodeId dependent) {
+            if (m_visitMarks[dependent] != mark) {
+                m_visitMarks[dependent] = mark;
+                if (!IsRangeNode(dependent)) {
+                    m_nodeCells[dependent]->SetDirty(true);
+                }
+                RaiseNodeState(dependent, NodeState::CHECK);
+                m_dirtyNodes.push_back(dependent);
+                roots.push_back(dependent);
+            }
+        });
+    }
+}
+
+NodeId CalculationChain::GetNode(const std::shared_ptr<Cell>& cell) const {
+    auto it = m_nodes.find(cell.get());
+    if (it == m_nodes.end()) {
+        throw std::invalid_argument("Cell is not in the calculation chain");
+    }
+    return it->second;
 }
\ No newline at end of file
@@ -1,25 +1,64 @@
 #ifndef CALCULATION_CHAIN_H
 #define CALCULATION_CHAIN_H
 
+#include <chrono>
+#include <functional>
 #include <memory>
+#include <optional>
 #include <vector>
-#include <unordered_set>
+#include <unordered_map>
 #include "../Interfaces/ICalculationChain.h"
 #include "../CalculationChain/DependencyGraph.h"
+#include "../CalculationChain/CancellationToken.h"
+#include "../CalculationChain/RangeIndex.h"
 #include "../../core-engine/DataStructures/Cell.h"
 #include "../FormulaParser/FormulaParser.h"
 
+namespace ExcelCalculationEngine {
+class ParallelCalculation;
+}
+
 namespace Excel::CalculationEngine {
 
+using ExcelCalculationEngine::CancellationToken;
+using ExcelCalculationEngine::CellReference;
+using ExcelCalculationEngine::DependencyGraph;
+using ExcelCalculationEngine::NodeId;
+using ExcelCalculationEngine::ParallelCalculation;
+using ExcelCalculationEngine::RangeEntryId;
+using ExcelCalculationEngine::RangeIndex;
+using ExcelCalculationEngine::RangeReference;
+
 /**
  * @class CalculationChain
  * @brief Implements the ICalculationChain interface and manages the calculation chain for Excel.
  * 
  * This class is responsible for managing the order of cell calculations and dependencies
  * for efficient recalculation of formulas in a spreadsheet.
+ *
+ * Invalidation marks the whole transitive closure dirty, but only the cells
+ * invalidated directly are sure to need work. The rest are recalculated only
+ * if something they read actually came out different (early cutoff), so an
+ * edit that a MIN, a lookup or a threshold absorbs stops there. The cells
+ * skipped are still cleaned.
+ *
+ * Loops kept by a bulk load (see BeginBulkLoad()) are calculated as a
+ * whole when the first of their dirty cells comes up, and only their
+ * readers outside the loop are then checked against the new values.
  */
 class CalculationChain : public ICalculationChain {
 public:
+    /**
+     * @brief Computes a cell's new value and stores it on the cell, in place of Cell::Recalculate().
+     */
+    using CellCalculator = std::function<void(Cell& cell)>;
+
+    /**
+     * @brief Computes the new values of the cells of one loop together, e.g.
+     * by iteration, and stores each on its cell.
+     */
+    using LoopCalculator = std::function<void(const std::vector<Cell*>& cells)>;
+
     CalculationChain();
     ~CalculationChain() override;
 
@@ -29,6 +68,12 @@ public:
      */
     void AddCell(const std::shared_ptr<Cell>& cell) override;
 
+    /**
+     * @brief Adds a formula cell at a known grid position, so that range
+     * references covering the position pick it up as a precedent.
+     */
+    void AddCell(const std::shared_ptr<Cell>& cell, const CellReference& position);
+
     /**
      * @brief Removes a cell from the calculation chain.
      * @param cell The cell to be removed.
@@ -42,6 +87,62 @@ public:
      */
     void UpdateDependencies(const std::shared_ptr<Cell>& cell, const std::vector<std::shared_ptr<Cell>>& dependencies) override;
 
+    /**
+     * @brief Updates the dependencies for a given cell, including whole ranges.
+     *
+     * Each distinct range is a single node, however many cells it covers; it
+     * only gets edges to the positioned formula cells inside it. Edits to
+     * other cells reach it through InvalidateCell(const CellReference&).
+     */
+    void UpdateDependencies(const std::shared_ptr<Cell>& cell, const std::vector<std::shared_ptr<Cell>>& dependencies,
+                            const std::vector<RangeReference>& ranges);
+
+    /**
+     * @brief Records the references @p cell resolved while it ran (see
+     * FormulaVM::GetDynamicReferences()), replacing the previous recording.
+     * Its static precedents stay as they are.
+     *
+     * This is how OFFSET and INDIRECT avoid being volatile: the cell gets
+     * edges to what it actually read, so only edits there invalidate it. If a
+     * newly recorded precedent had not been calculated yet, the cell read a
+     * stale value and is rescheduled to run again after it. Call it from
+     * Cell::Recalculate() under the sequential RecalculateChain() overloads.
+     * UpdateDependencies() discards the recording.
+     *
+     * @return True if the cell was rescheduled.
+     * @throws CalculationException (CIRCULAR_REFERENCE) if a reference closes a cycle; nothing is recorded then.
+     */
+    bool SetDynamicDependencies(const std::shared_ptr<Cell>& cell, const std::vector<RangeReference>& ranges);
+
+    /**
+     * @brief Adds and links cells without checking for cycles or keeping the
+     * calculation order until EndBulkLoad(), e.g. while a workbook opens.
+     * Calls that would throw CIRCULAR_REFERENCE link the edges instead.
+     */
+    void BeginBulkLoad();
+
+    /**
+     * @brief Orders everything added since BeginBulkLoad() in one pass (see
+     * DependencyGraph::EndBulkLoad()) and returns the cells of each loop, in
+     * calculation order. Loops stay in the chain; until they are broken,
+     * edits are checked for new cycles by a full search.
+     */
+    std::vector<std::vector<std::shared_ptr<Cell>>> EndBulkLoad();
+
+    /**
+     * @brief Routes every recalculation through @p calculator, e.g. the
+     * engine's compiled programs; an empty one restores Cell::Recalculate().
+     * The early cutoff still compares Cell::GetValue() before and after.
+     * The parallel RecalculateChain() calls it from several threads at once.
+     */
+    void SetCellCalculator(CellCalculator calculator);
+
+    /**
+     * @brief Routes the recalculation of each loop through @p calculator. Without
+     * one, each cell of the loop is recalculated once, in calculation order.
+     */
+    void SetLoopCalculator(LoopCalculator calculator);
+
     /**
      * @brief Retrieves the current calculation order.
      * @return A vector of cells in the current calculation order.
@@ -54,26 +155,181 @@ public:
      */
     void InvalidateCell(const std::shared_ptr<Cell>& cell) override;
 
+    /**
+     * @brief InvalidateCell(cell) for many cells, walking their dependents once for all of them.
+     */
+    void InvalidateCells(const std::vector<std::shared_ptr<Cell>>& cells);
+
+    /**
+     * @brief Marks what reads @p cells as needing recalculation, but not the
+     * cells themselves, whose new values were set outside RecalculateChain()
+     * (see CalculationEngine::HandleCircularReference()). A cell already dirty stays dirty.
+     */
+    void InvalidateDependents(const std::vector<std::shared_ptr<Cell>>& cells);
+
+    /**
+     * @brief Marks everything that reads @p position as needing recalculation,
+     * e.g. after a constant there was edited. Ranges are found by a stabbing query.
+     */
+    void InvalidateCell(const CellReference& position);
+
+    /**
+     * @brief InvalidateCell(position) for a batch of edits. The dependents are
+     * walked once for all of them, so cells downstream of many edited
+     * positions are visited once rather than once per edit.
+     */
+    void InvalidateCells(const std::vector<CellReference>& positions);
+
+    /**
+     * @brief Marks a cell whose formula calls a volatile function (see
+     * FormulaProgram::IsVolatile()). Every recalculation starts by
+     * invalidating the volatile cells, so they and whatever reads them are
+     * recomputed and nothing else is.
+     */
+    void SetVolatile(const std::shared_ptr<Cell>& cell, bool isVolatile);
+
+    /**
+     * @brief Marks the volatile cells and their transitive dependents dirty.
+     * Called at the start of each recalculation.
+     */
+    void InvalidateVolatileCells();
+
     /**
      * @brief Recalculates all dirty cells in the calculation chain.
      */
     void RecalculateChain() override;
 
+    /**
+     * @brief Recalculates dirty cells for about @p timeSlice, then returns so
+     * the caller can handle input. The next call resumes where this one
+     * stopped, picking up anything invalidated in between.
+     *
+     * The token is checked before each cell and the clock after each, so a
+     * slice overruns by at most one cell. A cell whose measured cost (see
+     * DependencyGraph::GetCost()) would not fit waits for the next slice.
+     * Cells in the priority region run first, together with the dirty cells they read. Volatile cells are
+     * invalidated when a new pass starts, not when one resumes.
+     *
+     * @return True once nothing is left dirty; false if time ran out or the calculation was cancelled.
+     */
+    bool RecalculateChain(std::chrono::steady_clock::duration timeSlice, const CancellationToken& cancellation);
+
+    /**
+     * @brief Recalculates all dirty cells on @p parallel's workers. Each cell
+     * starts once the dirty cells it reads are done, so Cell::Recalculate()
+     * must be safe to call concurrently for cells that do not depend on each other.
+     */
+    void RecalculateChain(ParallelCalculation& parallel);
+
+    /**
+     * @brief Sets the area to calculate first, typically the visible viewport.
+     * Only positioned cells (see AddCell(cell, position)) can fall inside it.
+     */
+    void SetPriorityRegion(const RangeReference& region);
+
+    void ClearPriorityRegion();
+
+    /**
+     * @brief True while a time-sliced recalculation has work left or cells are dirty.
+     */
+    bool HasPendingWork() const {
+        return m_pendingCursor < m_pendingNodes.size() || !m_dirtyNodes.empty() || !m_rescheduledNodes.empty();
+    }
+
 private:
-    std::unique_ptr<DependencyGraph> dependencyGraph_;
-    std::vector<std::shared_ptr<Cell>> calculationOrder_;
-    std::unordered_set<std::shared_ptr<Cell>> dirtyNodes_;
+    std::unique_ptr<DependencyGraph> m_dependencyGraph;
+    std::unordered_map<const Cell*, NodeId> m_nodes;     ///< Looked up once per call, never per edge.
+    std::vector<std::shared_ptr<Cell>> m_nodeCells;      ///< Indexed by NodeId; null for range nodes and free ids.
+    std::vector<RangeEntryId> m_nodeEntries;             ///< Indexed by NodeId; entry in m_ranges or m_positions.
+    std::unordered_map<RangeReference, NodeId> m_rangeNodes;
+    std::unordered_map<NodeId, std::vector<NodeId>> m_dynamicPrecedents; ///< Sorted range nodes from SetDynamicDependencies(); never static precedents too.
+    std::vector<NodeId> m_rescheduledNodes; ///< Read an uncalculated precedent; dirtied again once their Recalculate() returns.
+    RangeIndex m_ranges;    ///< Rectangle of each range node.
+    RangeIndex m_positions; ///< One-cell rectangle of each positioned formula cell.
+    std::vector<NodeId> m_dirtyNodes;    ///< Invalidated since the last RecalculateChain(), range nodes included; may repeat.
+    std::vector<NodeId> m_pendingNodes;  ///< Current recalculation in run order; m_pendingCursor is the next to run.
+    std::size_t m_pendingCursor = 0;
+    std::vector<NodeId> m_lastPass;      ///< The last new pass in calculation order, reused while the same cells get dirty.
+    bool m_reorderPending = false;       ///< Edges or the priority region changed since m_pendingNodes was sorted.
+    std::optional<RangeReference> m_priorityRegion;
+    CellCalculator m_cellCalculator;
+    LoopCalculator m_loopCalculator;
+    std::vector<std::uint32_t> m_visitMarks;
+    std::uint32_t m_visitEpoch = 0;
+
+    /// How sure the chain is that a dirty node needs recalculating.
+    enum class NodeState : std::uint8_t {
+        CLEAN,   ///< Not invalidated, or already handled this pass.
+        CHECK,   ///< Dirty only because something upstream was invalidated.
+        STALE,   ///< Invalidated directly, or a precedent changed value: must run.
+        CHANGED, ///< Parallel pass only: ran and came out different.
+    };
+    std::vector<NodeState> m_nodeStates; ///< Indexed by NodeId, grown with m_visitMarks.
 
     /**
-     * @brief Updates the calculation order based on the current dependency graph.
+     * @brief The node of a cell in the chain.
+     * @throws std::invalid_argument if the cell was never added.
      */
-    void UpdateCalculationOrder();
+    NodeId GetNode(const std::shared_ptr<Cell>& cell) const;
+
+    bool IsRangeNode(NodeId node) const { return !m_nodeCells[node]; }
+
+    /**
+     * @brief The node for @p range, created and linked to the formula cells inside it on first use.
+     */
+    NodeId AcquireRangeNode(const RangeReference& range);
+
+    /**
+     * @brief Drops a range node once no formula reads it any more.
+     */
+    void ReleaseRangeNode(NodeId node);
+
+    void SetNodeEntry(NodeId node, RangeEntryId entry);
 
     /**
-     * @brief Marks dependent cells as dirty recursively.
-     * @param cell The cell whose dependents need to be marked as dirty.
+     * @brief Recalculates one cell, recording a calculation error on the cell itself.
+     * @return False only if its value came out exactly as before.
      */
-    void MarkDependentsDirty(const std::shared_ptr<Cell>& cell);
+    bool RecalculateCell(Cell& cell);
+
+    /**
+     * @brief Recalculates the cells of circular component @p loop together,
+     * then flags the readers outside the loop of each cell that changed.
+     */
+    void RecalculateLoop(std::uint32_t loop);
+
+    /**
+     * @brief Flags @p node's direct dependents to run, after it changed value.
+     */
+    void MarkDependentsStale(NodeId node);
+
+    /**
+     * @brief Sets @p node to @p state, unless it is already STALE.
+     */
+    void RaiseNodeState(NodeId node, NodeState state);
+
+    /**
+     * @brief A fresh value for m_visitMarks, which is grown to the graph size.
+     */
+    std::uint32_t NextVisitMark();
+
+    /**
+     * @brief Marks m_rescheduledNodes and their dependents dirty.
+     */
+    void RescheduleOutOfOrderCells();
+
+    /**
+     * @brief Folds newly dirty nodes into m_pendingNodes and restores run
+     * order: calculation order, with the priority region and its dirty precedents first.
+     * A new pass over the same cells as the last one, still in order, skips the sort.
+     */
+    void PreparePendingNodes();
+
+    /**
+     * @brief Marks every transitive dependent of @p roots dirty, to be checked (see NodeState).
+     */
+    void MarkDependentsDirty(std::vector<NodeId> roots);
+
 };
 
 } // namespace Excel::CalculationEngine
@@ -0,0 +1,26 @@
+#ifndef CANCELLATION_TOKEN_H
+#define CANCELLATION_TOKEN_H
+
+#include <atomic>
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class CancellationToken
+ * @brief Flag another thread sets to stop a long-running calculation at the next cell boundary.
+ *
+ * Cancel() may be called from any thread; the calculation only polls it.
+ */
+class CancellationToken {
+public:
+    void Cancel() noexcept { m_cancelled.store(true, std::memory_order_relaxed); }
+    void Reset() noexcept { m_cancelled.store(false, std::memory_order_relaxed); }
+    bool IsCancelled() const noexcept { return m_cancelled.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> m_cancelled{false};
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // CANCELLATION_TOKEN_H
@@ -1,132 +1,627 @@
 #include "DependencyGraph.h"
-#include "src/core-engine/DataStructures/Cell.h"
-#include "src/core-engine/DataStructures/Range.h"
+#include "StronglyConnectedComponents.h"
 #include "src/calculation-engine/ErrorHandling/CalculationErrors.h"
+#include "src/core-engine/Performance/Profiler.h"
+#include "src/core-engine/Performance/Metrics.h"
 #include <algorithm>
-#include <queue>
+#include <stdexcept>
 
-DependencyGraph::DependencyGraph() : dependencies_(), reverseDependencies_() {}
+namespace ExcelCalculationEngine {
 
-void DependencyGraph::AddDependency(const CellID& dependent, const CellID& dependsOn) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    dependencies_[dependent].insert(dependsOn);
-    reverseDependencies_[dependsOn].insert(dependent);
+namespace {
 
-    if (HasCircularDependency(dependent)) {
-        // Remove the dependency we just added
-        dependencies_[dependent].erase(dependsOn);
-        reverseDependencies_[dependsOn].erase(dependent);
-        throw CalculationError(ErrorType::CircularReference, "Circular dependency detected");
+using Excel::CalculationEngine::CalculationErrorCode;
+using Excel::CalculationEngine::CalculationException;
+
+// Overlays smaller than this are never worth a rebuild.
+constexpr std::size_t MIN_PENDING_EDITS_BEFORE_COMPACTION = 4096;
+// Otherwise compact once pending edits exceed live edges / this.
+constexpr std::size_t PENDING_EDIT_RATIO = 8;
+
+// Order labels live in [0, MAX_LABEL]. Appended nodes are LABEL_SPACING apart, and a
+// relabel widens its run until every node gets at least MIN_LABEL_GAP.
+constexpr std::uint64_t MAX_LABEL = std::uint64_t{1} << 62;
+constexpr std::uint64_t LABEL_SPACING = std::uint64_t{1} << 24;
+constexpr std::uint64_t MIN_LABEL_GAP = 256;
+
+excel::core_engine::performance::Gauge& EdgeCountGauge() {
+    static auto& gauge = excel::core_engine::performance::GetMetrics().GetGauge(
+        "excel_dependency_graph_edges", "Precedent/dependent edges across all dependency graphs.");
+    return gauge;
+}
+
+} // namespace
+
+DependencyGraph::DependencyGraph() = default;
+
+DependencyGraph::~DependencyGraph() {
+    EdgeCountGauge().Add(-static_cast<std::int64_t>(m_edgeCount));
+}
+
+NodeId* DependencyGraph::Adjacency::FindCompacted(NodeId source, NodeId target) {
+    return const_cast<NodeId*>(static_cast<const Adjacency*>(this)->FindCompacted(source, target));
+}
+
+const NodeId* DependencyGraph::Adjacency::FindCompacted(NodeId source, NodeId target) const {
+    if (static_cast<std::size_t>(source) + 1 >= offsets.size()) {
+        return nullptr;
     }
+    // Rows are sorted by node id; the tombstone bit is ignored when comparing.
+    const NodeId* first = targets.data() + offsets[source];
+    const NodeId* last = targets.data() + offsets[source + 1];
+    const NodeId* found = std::lower_bound(first, last, target, [](NodeId entry, NodeId value) {
+        return (entry & ~REMOVED_EDGE) < value;
+    });
+    return found != last && (*found & ~REMOVED_EDGE) == target ? found : nullptr;
 }
 
-void DependencyGraph::RemoveDependency(const CellID& dependent, const CellID& dependsOn) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto depIt = dependencies_.find(dependent);
-    if (depIt != dependencies_.end()) {
-        depIt->second.erase(dependsOn);
-        if (depIt->second.empty()) {
-            dependencies_.erase(depIt);
+NodeId DependencyGraph::AddNode() {
+    NodeId node;
+    if (!m_freeNodes.empty()) {
+        node = m_freeNodes.back();
+        m_freeNodes.pop_back();
+        m_live[node] = 1;
+        m_costs[node] = 0.0f;
+    } else {
+        if (m_live.size() >= REMOVED_EDGE) {
+            throw std::length_error("Dependency graph node limit reached");
         }
+        node = static_cast<NodeId>(m_live.size());
+        m_live.push_back(1);
+        m_label.push_back(0);
+        m_nextInOrder.push_back(INVALID_NODE);
+        m_previousInOrder.push_back(INVALID_NODE);
+        m_costs.push_back(0.0f);
+    }
+    // A node without edges can go anywhere; the end needs no shuffling.
+    LinkInOrder(node, m_lastInOrder, INVALID_NODE);
+    Relabel(node, node, 1);
+    return node;
+}
+
+void DependencyGraph::RemoveNode(NodeId node) {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::RemoveNode");
+    CheckNode(node);
+    for (NodeId precedent : GetPrecedents(node)) {
+        Unlink(node, precedent);
+    }
+    for (NodeId dependent : GetDependents(node)) {
+        Unlink(dependent, node);
     }
+    SetVolatile(node, false);
+    if (GetCircularComponent(node) != NO_COMPONENT) {
+        std::vector<NodeId>& members = m_circularComponents[m_componentOf[node]];
+        members.erase(std::find(members.begin(), members.end(), node));
+        m_componentOf[node] = NO_COMPONENT;
+    }
+    m_live[node] = 0;
+    m_freeNodes.push_back(node);
+    UnlinkFromOrder(node);
+    CompactIfNeeded();
+}
 
-    auto revDepIt = reverseDependencies_.find(dependsOn);
-    if (revDepIt != reverseDependencies_.end()) {
-        revDepIt->second.erase(dependent);
-        if (revDepIt->second.empty()) {
-            reverseDependencies_.erase(revDepIt);
+bool DependencyGraph::AddDependency(NodeId dependent, NodeId precedent) {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::AddDependency");
+    CheckNode(dependent);
+    CheckNode(precedent);
+    if (HasDependency(dependent, precedent)) {
+        return false;
+    }
+    if (m_bulkLoading) {
+        return Link(dependent, precedent);
+    }
+    if (m_hasCircularComponents) {
+        // Reorder() assumes an acyclic order, so search the graph itself
+        const std::uint32_t readers = MarkTransitiveDependents(dependent);
+        if (m_visitMarks[precedent] == readers) {
+            throw CalculationException(CalculationErrorCode::CIRCULAR_REFERENCE, "Circular dependency detected");
         }
+        Link(dependent, precedent);
+        // No new loop, so the components stay as they are; only an edge against the order moves any
+        if (m_label[precedent] > m_label[dependent]) {
+            RebuildOrder();
+        }
+        CompactIfNeeded();
+        return true;
     }
+    Reorder(dependent, precedent);
+    Link(dependent, precedent);
+    CompactIfNeeded();
+    return true;
+}
+
+bool DependencyGraph::RemoveDependency(NodeId dependent, NodeId precedent) {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::RemoveDependency");
+    CheckNode(dependent);
+    CheckNode(precedent);
+    const bool removed = Unlink(dependent, precedent);
+    CompactIfNeeded();
+    return removed;
 }
 
-std::vector<CellID> DependencyGraph::GetDependents(const CellID& cell) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto it = reverseDependencies_.find(cell);
-    if (it != reverseDependencies_.end()) {
-        return std::vector<CellID>(it->second.begin(), it->second.end());
+bool DependencyGraph::HasDependency(NodeId dependent, NodeId precedent) const {
+    // Precedent rows are short (a formula's references), so this side is searched.
+    if (const NodeId* entry = m_precedents.FindCompacted(dependent, precedent)) {
+        return (*entry & REMOVED_EDGE) == 0;
+    }
+    auto it = m_precedents.overlay.find(dependent);
+    return it != m_precedents.overlay.end() &&
+           std::find(it->second.begin(), it->second.end(), precedent) != it->second.end();
+}
+
+void DependencyGraph::UpdateDependencies(NodeId dependent, const std::vector<NodeId>& precedents) {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::UpdateDependencies");
+    CheckNode(dependent);
+    if (m_hasCircularComponents && !m_bulkLoading) {
+        UpdateDependenciesAroundLoops(dependent, precedents);
+        return;
+    }
+    const std::vector<NodeId> previous = GetPrecedents(dependent);
+    for (NodeId precedent : previous) {
+        Unlink(dependent, precedent);
+    }
+    if (m_bulkLoading) {
+        for (NodeId precedent : precedents) {
+            CheckNode(precedent);
+            Link(dependent, precedent);
+        }
+        return;
+    }
+
+    std::vector<NodeId> added;
+    added.reserve(precedents.size());
+    try {
+        for (NodeId precedent : precedents) {
+            CheckNode(precedent);
+            if (HasDependency(dependent, precedent)) {
+                continue;
+            }
+            Reorder(dependent, precedent);
+            Link(dependent, precedent);
+            added.push_back(precedent);
+        }
+    } catch (...) {
+        for (NodeId precedent : added) {
+            Unlink(dependent, precedent);
+        }
+        // The previous set was acyclic, so this cannot throw; it only repairs
+        // the order if the failed inserts moved nodes around.
+        for (NodeId precedent : previous) {
+            Reorder(dependent, precedent);
+            Link(dependent, precedent);
+        }
+        throw;
     }
-    return std::vector<CellID>();
+    CompactIfNeeded();
 }
 
-std::vector<CellID> DependencyGraph::GetDependencies(const CellID& cell) const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    auto it = dependencies_.find(cell);
-    if (it != dependencies_.end()) {
-        return std::vector<CellID>(it->second.begin(), it->second.end());
+void DependencyGraph::UpdateDependenciesAroundLoops(NodeId dependent, const std::vector<NodeId>& precedents) {
+    const std::uint32_t readers = MarkTransitiveDependents(dependent);
+    for (NodeId precedent : precedents) {
+        CheckNode(precedent);
+        if (m_visitMarks[precedent] == readers) {
+            throw CalculationException(CalculationErrorCode::CIRCULAR_REFERENCE, "Circular dependency detected");
+        }
+    }
+    for (NodeId precedent : GetPrecedents(dependent)) {
+        Unlink(dependent, precedent);
     }
-    return std::vector<CellID>();
+    for (NodeId precedent : precedents) {
+        Link(dependent, precedent);
+    }
+    // The dropped edges may have broken a loop, possibly the last one
+    RebuildOrder();
+    CompactIfNeeded();
 }
 
-void DependencyGraph::UpdateDependencies(const CellID& cell, const std::vector<CellID>& newDependencies) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    // Remove old dependencies
-    auto oldDeps = GetDependencies(cell);
-    for (const auto& oldDep : oldDeps) {
-        RemoveDependency(cell, oldDep);
+void DependencyGraph::SetVolatile(NodeId node, bool isVolatile) {
+    CheckNode(node);
+    if (isVolatile == IsVolatile(node)) {
+        return;
     }
+    if (isVolatile) {
+        if (m_volatileSlots.size() < m_live.size()) {
+            m_volatileSlots.resize(m_live.size(), INVALID_NODE);
+        }
+        m_volatileSlots[node] = static_cast<NodeId>(m_volatileNodes.size());
+        m_volatileNodes.push_back(node);
+        return;
+    }
+    const NodeId slot = m_volatileSlots[node];
+    m_volatileNodes[slot] = m_volatileNodes.back();
+    m_volatileSlots[m_volatileNodes[slot]] = slot;
+    m_volatileNodes.pop_back();
+    m_volatileSlots[node] = INVALID_NODE;
+}
+
+std::vector<NodeId> DependencyGraph::GetPrecedents(NodeId node) const {
+    std::vector<NodeId> result;
+    ForEachPrecedent(node, [&result](NodeId precedent) { result.push_back(precedent); });
+    return result;
+}
+
+std::vector<NodeId> DependencyGraph::GetDependents(NodeId node) const {
+    std::vector<NodeId> result;
+    ForEachDependent(node, [&result](NodeId dependent) { result.push_back(dependent); });
+    return result;
+}
+
+std::vector<NodeId> DependencyGraph::GetTopologicalOrder() const {
+    std::vector<NodeId> order;
+    order.reserve(GetNodeCount());
+    ForEachInOrder([&order](NodeId node) { order.push_back(node); });
+    return order;
+}
+
+void DependencyGraph::BeginBulkLoad() {
+    m_bulkLoading = true;
+}
+
+std::vector<std::vector<NodeId>> DependencyGraph::EndBulkLoad() {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::EndBulkLoad");
+    m_bulkLoading = false;
+    Compact();
+    return RebuildOrder();
+}
 
-    // Add new dependencies
-    for (const auto& newDep : newDependencies) {
-        try {
-            AddDependency(cell, newDep);
-        } catch (const CalculationError& e) {
-            // Rollback changes if a circular dependency is detected
-            for (const auto& addedDep : newDependencies) {
-                if (addedDep == newDep) break;
-                RemoveDependency(cell, addedDep);
+std::vector<std::vector<NodeId>> DependencyGraph::RebuildOrder() {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::RebuildOrder");
+    // Relink every node in component order; members of a component stay adjacent.
+    std::vector<std::vector<NodeId>> circular;
+    std::vector<NodeId> order;
+    order.reserve(GetNodeCount());
+    ForEachComponent([this, &circular, &order](const NodeId* first, const NodeId* last) {
+        order.insert(order.end(), first, last);
+        if (IsCircular(first, last)) {
+            circular.emplace_back(first, last);
+        }
+    });
+    m_firstInOrder = INVALID_NODE;
+    m_lastInOrder = INVALID_NODE;
+    for (NodeId node : order) {
+        LinkInOrder(node, m_lastInOrder, INVALID_NODE);
+    }
+    if (!order.empty()) {
+        Relabel(m_firstInOrder, m_lastInOrder, order.size());
+    }
+    m_hasCircularComponents = !circular.empty();
+    m_componentOf.clear();
+    if (m_hasCircularComponents) {
+        m_componentOf.resize(m_live.size(), NO_COMPONENT);
+        for (std::uint32_t component = 0; component < circular.size(); ++component) {
+            for (NodeId node : circular[component]) {
+                m_componentOf[node] = component;
             }
-            throw; // Re-throw the exception
         }
     }
+    m_circularComponents = circular;
+    return circular;
 }
 
-bool DependencyGraph::HasCircularDependency(const CellID& startCell) const {
-    std::unordered_set<CellID> visited;
-    std::queue<CellID> toVisit;
-    toVisit.push(startCell);
+std::vector<std::vector<NodeId>> DependencyGraph::FindCircularComponents() const {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::FindCircularComponents");
+    std::vector<std::vector<NodeId>> circular;
+    ForEachComponent([this, &circular](const NodeId* first, const NodeId* last) {
+        if (IsCircular(first, last)) {
+            circular.emplace_back(first, last);
+        }
+    });
+    return circular;
+}
 
-    while (!toVisit.empty()) {
-        CellID current = toVisit.front();
-        toVisit.pop();
+template <typename OnComponent>
+void DependencyGraph::ForEachComponent(OnComponent&& onComponent) const {
+    ForEachStronglyConnectedComponent<NodeId>(
+        m_live.size(), [this](NodeId node) { return IsNode(node); },
+        [this](NodeId node, auto&& visit) { ForEachPrecedent(node, visit); }, onComponent);
+}
 
-        if (current == startCell && !toVisit.empty()) {
-            return true; // We've come back to the start cell
+bool DependencyGraph::IsCircular(const NodeId* first, const NodeId* last) const {
+    return last - first > 1 || HasDependency(*first, *first);
+}
+
+void DependencyGraph::Compact() {
+    EXCEL_PROFILE_SCOPE("DependencyGraph::Compact");
+    const std::size_t nodeCount = m_live.size();
+    for (Adjacency* adjacency : {&m_precedents, &m_dependents}) {
+        const std::size_t compactedRows = adjacency->offsets.empty() ? 0 : adjacency->offsets.size() - 1;
+
+        // Row sizes: live CSR entries by a linear scan, overlay rows by one pass over the map.
+        std::vector<std::size_t> offsets(nodeCount + 1, 0);
+        for (std::size_t node = 0; node < compactedRows; ++node) {
+            std::size_t count = 0;
+            for (std::size_t i = adjacency->offsets[node], end = adjacency->offsets[node + 1]; i < end; ++i) {
+                count += (adjacency->targets[i] & REMOVED_EDGE) == 0;
+            }
+            offsets[node + 1] = count;
+        }
+        for (const auto& row : adjacency->overlay) {
+            offsets[row.first + 1] += row.second.size();
+        }
+        for (std::size_t node = 0; node < nodeCount; ++node) {
+            offsets[node + 1] += offsets[node];
         }
 
-        if (visited.find(current) != visited.end()) {
-            continue; // Skip already visited cells
+        std::vector<NodeId> targets(offsets[nodeCount]);
+        std::vector<std::size_t> ends(offsets.begin(), offsets.end() - 1);
+        for (std::size_t node = 0; node < compactedRows; ++node) {
+            for (std::size_t i = adjacency->offsets[node], end = adjacency->offsets[node + 1]; i < end; ++i) {
+                if ((adjacency->targets[i] & REMOVED_EDGE) == 0) {
+                    targets[ends[node]++] = adjacency->targets[i];
+                }
+            }
+        }
+        // The compacted part of a row is already sorted; only rows with overlay edges are re-sorted.
+        for (const auto& row : adjacency->overlay) {
+            NodeId* first = targets.data() + offsets[row.first];
+            std::copy(row.second.begin(), row.second.end(), targets.data() + ends[row.first]);
+            std::sort(first, targets.data() + offsets[row.first + 1]);
         }
 
-        visited.insert(current);
+        adjacency->offsets = std::move(offsets);
+        adjacency->targets = std::move(targets);
+        adjacency->overlay.clear();
+    }
+    m_overlayCount = 0;
+    m_tombstoneCount = 0;
+}
 
-        auto depIt = dependencies_.find(current);
-        if (depIt != dependencies_.end()) {
-            for (const auto& dep : depIt->second) {
-                toVisit.push(dep);
+void DependencyGraph::Clear() {
+    EdgeCountGauge().Add(-static_cast<std::int64_t>(m_edgeCount));
+    m_precedents = Adjacency();
+    m_dependents = Adjacency();
+    m_live.clear();
+    m_freeNodes.clear();
+    m_edgeCount = 0;
+    m_overlayCount = 0;
+    m_tombstoneCount = 0;
+    m_bulkLoading = false;
+    m_hasCircularComponents = false;
+    m_circularComponents.clear();
+    m_componentOf.clear();
+    m_volatileNodes.clear();
+    m_volatileSlots.clear();
+    m_label.clear();
+    m_nextInOrder.clear();
+    m_previousInOrder.clear();
+    m_costs.clear();
+    m_firstInOrder = INVALID_NODE;
+    m_lastInOrder = INVALID_NODE;
+    m_visitMarks.clear();
+    m_visitEpoch = 0;
+}
+
+bool DependencyGraph::Link(NodeId dependent, NodeId precedent) {
+    // Both directions are compacted together, so an edge is either a
+    // tombstone in both CSR arrays or absent from both.
+    NodeId* forward = m_precedents.FindCompacted(dependent, precedent);
+    if (forward != nullptr) {
+        if ((*forward & REMOVED_EDGE) == 0) {
+            return false;
+        }
+        *forward = precedent;
+        *m_dependents.FindCompacted(precedent, dependent) = dependent;
+        --m_tombstoneCount;
+    } else {
+        std::vector<NodeId>& row = m_precedents.overlay[dependent];
+        if (std::find(row.begin(), row.end(), precedent) != row.end()) {
+            return false;
+        }
+        row.push_back(precedent);
+        m_dependents.overlay[precedent].push_back(dependent);
+        ++m_overlayCount;
+    }
+    ++m_edgeCount;
+    EdgeCountGauge().Add(1);
+    return true;
+}
+
+bool DependencyGraph::Unlink(NodeId dependent, NodeId precedent) {
+    NodeId* forward = m_precedents.FindCompacted(dependent, precedent);
+    if (forward != nullptr) {
+        if ((*forward & REMOVED_EDGE) != 0) {
+            return false;
+        }
+        *forward |= REMOVED_EDGE;
+        *m_dependents.FindCompacted(precedent, dependent) |= REMOVED_EDGE;
+        ++m_tombstoneCount;
+    } else {
+        auto eraseFrom = [](Adjacency& adjacency, NodeId source, NodeId target) {
+            auto it = adjacency.overlay.find(source);
+            if (it == adjacency.overlay.end()) {
+                return false;
             }
+            std::vector<NodeId>& row = it->second;
+            auto entry = std::find(row.begin(), row.end(), target);
+            if (entry == row.end()) {
+                return false;
+            }
+            *entry = row.back();
+            row.pop_back();
+            if (row.empty()) {
+                adjacency.overlay.erase(it);
+            }
+            return true;
+        };
+        if (!eraseFrom(m_precedents, dependent, precedent)) {
+            return false;
         }
+        eraseFrom(m_dependents, precedent, dependent);
+        --m_overlayCount;
+    }
+    --m_edgeCount;
+    EdgeCountGauge().Add(-1);
+    return true;
+}
+
+void DependencyGraph::Reorder(NodeId dependent, NodeId precedent) {
+    if (dependent == precedent) {
+        throw CalculationException(CalculationErrorCode::CIRCULAR_REFERENCE, "Circular dependency detected");
+    }
+    const std::uint64_t lower = m_label[dependent];
+    const std::uint64_t upper = m_label[precedent];
+    if (upper < lower) {
+        return; // The order already agrees with the new edge.
     }
 
-    return false;
+    const std::uint32_t forwardMark = NextVisitMarks();
+    const std::uint32_t backwardMark = forwardMark + 1;
+
+    // Forward: nodes that read the dependent and sit before the precedent.
+    // Backward: nodes the precedent reads that sit after the dependent.
+    // A node both searches reach, or either endpoint reached from the other
+    // side, means the precedent already depends on the dependent.
+    m_forward.clear();
+    m_backward.clear();
+    m_forwardStack.assign(1, dependent);
+    m_backwardStack.assign(1, precedent);
+    m_visitMarks[dependent] = forwardMark;
+    m_visitMarks[precedent] = backwardMark;
+    bool cycle = false;
+    for (;;) {
+        if (m_forwardStack.empty()) {
+            // Everything downstream of the dependent, up to the precedent, moves just after the precedent.
+            MoveInOrder(m_forward, precedent, m_nextInOrder[precedent]);
+            return;
+        }
+        if (m_backwardStack.empty()) {
+            // Everything upstream of the precedent, back to the dependent, moves just before the dependent.
+            MoveInOrder(m_backward, m_previousInOrder[dependent], dependent);
+            return;
+        }
+
+        NodeId node = m_forwardStack.back();
+        m_forwardStack.pop_back();
+        m_forward.push_back(node);
+        ForEachDependent(node, [this, upper, forwardMark, backwardMark, &cycle](NodeId next) {
+            if (m_visitMarks[next] == backwardMark) {
+                cycle = true;
+            } else if (m_label[next] < upper && m_visitMarks[next] != forwardMark) {
+                m_visitMarks[next] = forwardMark;
+                m_forwardStack.push_back(next);
+            }
+        });
+
+        node = m_backwardStack.back();
+        m_backwardStack.pop_back();
+        m_backward.push_back(node);
+        ForEachPrecedent(node, [this, lower, forwardMark, backwardMark, &cycle](NodeId next) {
+            if (m_visitMarks[next] == forwardMark) {
+                cycle = true;
+            } else if (m_label[next] > lower && m_visitMarks[next] != backwardMark) {
+                m_visitMarks[next] = backwardMark;
+                m_backwardStack.push_back(next);
+            }
+        });
+
+        if (cycle) {
+            throw CalculationException(CalculationErrorCode::CIRCULAR_REFERENCE, "Circular dependency detected");
+        }
+    }
 }
 
-void DependencyGraph::Clear() {
-    std::lock_guard<std::mutex> lock(mutex_);
-    dependencies_.clear();
-    reverseDependencies_.clear();
+std::uint32_t DependencyGraph::NextVisitMarks() {
+    if (m_visitMarks.size() < m_live.size()) {
+        m_visitMarks.resize(m_live.size(), 0);
+    }
+    m_visitEpoch += 2;
+    if (m_visitEpoch < 2) {
+        std::fill(m_visitMarks.begin(), m_visitMarks.end(), 0);
+        m_visitEpoch = 2;
+    }
+    return m_visitEpoch;
+}
+
+std::uint32_t DependencyGraph::MarkTransitiveDependents(NodeId node) {
+    const std::uint32_t mark = NextVisitMarks();
+    m_visitMarks[node] = mark;
+    m_forwardStack.assign(1, node);
+    while (!m_forwardStack.empty()) {
+        const NodeId next = m_forwardStack.back();
+        m_forwardStack.pop_back();
+        ForEachDependent(next, [this, mark](NodeId dependent) {
+            if (m_visitMarks[dependent] != mark) {
+                m_visitMarks[dependent] = mark;
+                m_forwardStack.push_back(dependent);
+            }
+        });
+    }
+    return mark;
 }
 
-size_t DependencyGraph::Size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return dependencies_.size();
+void DependencyGraph::MoveInOrder(std::vector<NodeId>& nodes, NodeId left, NodeId right) {
+    std::sort(nodes.begin(), nodes.end(), [this](NodeId a, NodeId b) { return m_label[a] < m_label[b]; });
+    for (NodeId node : nodes) {
+        UnlinkFromOrder(node);
+    }
+    for (NodeId node : nodes) {
+        LinkInOrder(node, left, right);
+        left = node;
+    }
+    Relabel(nodes.front(), nodes.back(), nodes.size());
+}
+
+void DependencyGraph::LinkInOrder(NodeId node, NodeId left, NodeId right) {
+    m_previousInOrder[node] = left;
+    m_nextInOrder[node] = right;
+    (left == INVALID_NODE ? m_firstInOrder : m_nextInOrder[left]) = node;
+    (right == INVALID_NODE ? m_lastInOrder : m_previousInOrder[right]) = node;
+}
+
+void DependencyGraph::UnlinkFromOrder(NodeId node) {
+    const NodeId left = m_previousInOrder[node];
+    const NodeId right = m_nextInOrder[node];
+    (left == INVALID_NODE ? m_firstInOrder : m_nextInOrder[left]) = right;
+    (right == INVALID_NODE ? m_lastInOrder : m_previousInOrder[right]) = left;
+}
+
+void DependencyGraph::Relabel(NodeId first, NodeId last, std::size_t count) {
+    for (;;) {
+        const NodeId before = m_previousInOrder[first];
+        const NodeId after = m_nextInOrder[last];
+        const std::uint64_t low = before == INVALID_NODE ? 0 : m_label[before];
+        const std::uint64_t high = after == INVALID_NODE ? MAX_LABEL : m_label[after];
+        // At the tail, keep the usual spacing rather than spreading over all remaining labels.
+        const std::uint64_t step = std::min<std::uint64_t>((high - low) / (count + 1), LABEL_SPACING);
+        if (step >= MIN_LABEL_GAP || (before == INVALID_NODE && after == INVALID_NODE)) {
+            std::uint64_t label = low;
+            for (NodeId node = first;; node = m_nextInOrder[node]) {
+                label += step;
+                m_label[node] = label;
+                if (node == last) {
+                    break;
+                }
+            }
+            return;
+        }
+        // Too tight: double the run on both sides and spread it over the wider gap.
+        for (std::size_t grow = count; grow > 0; --grow) {
+            if (m_previousInOrder[first] != INVALID_NODE) {
+                first = m_previousInOrder[first];
+                ++count;
+            }
+            if (m_nextInOrder[last] != INVALID_NODE) {
+                last = m_nextInOrder[last];
+                ++count;
+            }
+        }
+    }
+}
+
+void DependencyGraph::CompactIfNeeded() {
+    if (m_bulkLoading) {
+        return; // EndBulkLoad() compacts once.
+    }
+    const std::size_t pending = GetPendingEditCount();
+    if (pending > MIN_PENDING_EDITS_BEFORE_COMPACTION && pending > m_edgeCount / PENDING_EDIT_RATIO) {
+        Compact();
+    }
+}
+
+void DependencyGraph::CheckNode(NodeId node) const {
+    if (!IsNode(node)) {
+        throw std::out_of_range("Unknown dependency graph node");
+    }
 }
 
-bool DependencyGraph::IsEmpty() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return dependencies_.empty();
-}
\ No newline at end of file
+} // namespace ExcelCalculationEngine
@@ -1,88 +1,350 @@
 #ifndef DEPENDENCY_GRAPH_H
 #define DEPENDENCY_GRAPH_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <unordered_map>
 #include <vector>
-#include <memory>
-#include <string>
 
-// Forward declarations
-class Cell;
-class Range;
-class ICalculationChain;
+namespace ExcelCalculationEngine {
 
-// Alias for CellID
-using CellID = std::string;
+/**
+ * @brief Dense node index. Callers map their own keys (cells, ranges) to nodes
+ * once; the graph itself never hashes or compares anything but integers.
+ */
+using NodeId = std::uint32_t;
+
+constexpr NodeId INVALID_NODE = UINT32_MAX;
+
+/// DependencyGraph::GetCircularComponent() of a node in no loop.
+constexpr std::uint32_t NO_COMPONENT = UINT32_MAX;
 
 /**
  * @class DependencyGraph
- * @brief Represents the dependency graph for cell calculations in Excel.
- * 
- * This class manages the dependencies between cells in a spreadsheet,
- * enabling efficient recalculation of formulas.
+ * @brief Precedent/dependent edges between formula nodes.
+ *
+ * Both directions are stored in compressed sparse row form: one offsets array
+ * indexed by node and one contiguous array of 4-byte targets, sorted within
+ * each row. Edits do not rebuild the arrays. A removed edge is tombstoned in
+ * place and an added edge goes into a small per-node overlay; once the
+ * overlay and tombstones pass an eighth of the live edges, Compact() merges
+ * them back. A compacted graph costs 8 bytes per edge plus 16 bytes per node.
+ *
+ * An edge "dependent -> precedent" means the dependent's formula reads the
+ * precedent. Adding an edge that would close a cycle throws.
+ *
+ * The graph also keeps a topological order, updated per edge. Nodes sit in
+ * a linked list carrying gapped 64-bit labels (an order-maintenance list),
+ * so comparing two positions is one integer compare and a run of nodes can
+ * be moved without renumbering the rest. An insert that already agrees
+ * with the order costs nothing. Otherwise, as in Pearce-Kelly, only nodes
+ * positioned between the two endpoints are searched: forward from the
+ * dependent and backward from the precedent, in lockstep. Whichever search
+ * finishes first has its nodes moved across the other endpoint, so the
+ * cost follows the smaller side of the affected region. The same search is
+ * the cycle check. Removing an edge never invalidates the order.
+ *
+ * Nodes can be flagged volatile (formulas calling NOW, RAND and the like).
+ * The graph only keeps the set; callers seed each recalc from it. It also
+ * keeps a smoothed evaluation cost per node, which schedulers read.
+ *
+ * Loading a workbook goes through BeginBulkLoad()/EndBulkLoad() instead:
+ * edges are linked unchecked and a single iterative Tarjan pass then finds
+ * the strongly connected components, rebuilds the order from them and
+ * returns the circular ones. Those edges stay in the graph so iterative
+ * calculation can work on each component; the order keeps each one
+ * contiguous. While any remain, the incremental order cannot be trusted to
+ * find cycles, so edits fall back to a full search: an added edge is checked
+ * against everything that reads its dependent, and UpdateDependencies()
+ * rebuilds the order with Tarjan again, O(nodes + edges) per call. The first
+ * rebuild that finds no loop left switches back to incremental updates.
+ *
+ * Not thread-safe for writes, except that RecordCost() may run concurrently
+ * for different nodes. Concurrent const access is safe.
  */
 class DependencyGraph {
 public:
+    DependencyGraph();
+    ~DependencyGraph();
+
+    DependencyGraph(const DependencyGraph&) = delete;
+    DependencyGraph& operator=(const DependencyGraph&) = delete;
+
     /**
-     * @brief Default constructor
+     * @brief Allocates a node with no edges. Ids of removed nodes are reused.
      */
-    DependencyGraph() = default;
+    NodeId AddNode();
 
     /**
-     * @brief Adds a dependency between two cells.
-     * @param dependent The cell that depends on another cell
-     * @param dependsOn The cell that is depended upon
+     * @brief Drops a node and every edge touching it.
      */
-    void AddDependency(const CellID& dependent, const CellID& dependsOn);
+    void RemoveNode(NodeId node);
+
+    bool IsNode(NodeId node) const noexcept {
+        return node < m_live.size() && m_live[node] != 0;
+    }
 
     /**
-     * @brief Removes a dependency between two cells.
-     * @param dependent The cell that no longer depends on another cell
-     * @param dependsOn The cell that is no longer depended upon
+     * @brief One past the largest id ever allocated; the size for arrays indexed by NodeId.
      */
-    void RemoveDependency(const CellID& dependent, const CellID& dependsOn);
+    std::size_t GetNodeCapacity() const noexcept { return m_live.size(); }
+
+    std::size_t GetNodeCount() const noexcept { return m_live.size() - m_freeNodes.size(); }
+    std::size_t GetEdgeCount() const noexcept { return m_edgeCount; }
+    bool IsEmpty() const noexcept { return GetNodeCount() == 0; }
 
     /**
-     * @brief Retrieves all cells that depend on the given cell.
-     * @param cell The cell to find dependents for
-     * @return A vector of CellIDs that depend on the given cell
+     * @brief Adds the edge. Returns false if it was already present.
+     * @throws CalculationException (CIRCULAR_REFERENCE) if @p precedent already depends on @p dependent.
      */
-    std::vector<CellID> GetDependents(const CellID& cell) const;
+    bool AddDependency(NodeId dependent, NodeId precedent);
 
     /**
-     * @brief Retrieves all cells that the given cell depends on.
-     * @param cell The cell to find dependencies for
-     * @return A vector of CellIDs that the given cell depends on
+     * @brief Removes the edge. Returns false if it was not present.
      */
-    std::vector<CellID> GetDependencies(const CellID& cell) const;
+    bool RemoveDependency(NodeId dependent, NodeId precedent);
+
+    bool HasDependency(NodeId dependent, NodeId precedent) const;
 
     /**
-     * @brief Updates the dependencies for a given cell.
-     * @param cell The cell to update dependencies for
-     * @param newDependencies A vector of new dependencies for the cell
+     * @brief Replaces all precedents of @p dependent. On a cycle the old
+     * precedents are restored before the exception propagates.
      */
-    void UpdateDependencies(const CellID& cell, const std::vector<CellID>& newDependencies);
+    void UpdateDependencies(NodeId dependent, const std::vector<NodeId>& precedents);
 
-private:
-    // Map of cell dependencies (cell -> cells it depends on)
-    std::unordered_map<CellID, std::vector<CellID>> dependencies_;
+    /**
+     * @brief Calls visit(precedent) for each node @p node reads. No allocation.
+     */
+    template <typename Visit>
+    void ForEachPrecedent(NodeId node, Visit&& visit) const {
+        m_precedents.ForEach(node, visit);
+    }
+
+    /**
+     * @brief Calls visit(dependent) for each node that reads @p node. No allocation.
+     */
+    template <typename Visit>
+    void ForEachDependent(NodeId node, Visit&& visit) const {
+        m_dependents.ForEach(node, visit);
+    }
+
+    std::vector<NodeId> GetPrecedents(NodeId node) const;
+    std::vector<NodeId> GetDependents(NodeId node) const;
+
+    /**
+     * @brief Adds @p node to or removes it from the volatile set. Removing the node also removes it from the set.
+     */
+    void SetVolatile(NodeId node, bool isVolatile);
+
+    bool IsVolatile(NodeId node) const noexcept {
+        return node < m_volatileSlots.size() && m_volatileSlots[node] != INVALID_NODE;
+    }
+
+    /**
+     * @brief Folds one measured evaluation of @p node into its cost estimate
+     * (an exponential moving average, weight COST_SMOOTHING on the new sample).
+     * Touches only that node's entry, so workers may record different nodes at once.
+     */
+    void RecordCost(NodeId node, float nanoseconds) noexcept {
+        float& cost = m_costs[node];
+        cost = cost == 0.0f ? nanoseconds : cost + (nanoseconds - cost) * COST_SMOOTHING;
+    }
+
+    /**
+     * @brief Estimated nanoseconds to evaluate @p node; 0 until first measured.
+     */
+    float GetCost(NodeId node) const noexcept { return m_costs[node]; }
+
+    static constexpr float COST_SMOOTHING = 0.25f;
 
-    // Map of reverse dependencies (cell -> cells that depend on it)
-    std::unordered_map<CellID, std::vector<CellID>> reverseDependencies_;
+    /**
+     * @brief Every volatile node, in no particular order.
+     */
+    const std::vector<NodeId>& GetVolatileNodes() const noexcept { return m_volatileNodes; }
+
+    /**
+     * @brief Position of @p node in the maintained order. Precedents always
+     * compare lower than their dependents; values are sparse and change as
+     * edges are added.
+     */
+    std::uint64_t GetOrder(NodeId node) const noexcept { return m_label[node]; }
 
     /**
-     * @brief Helper function to add a single dependency
-     * @param dependent The cell that depends on another cell
-     * @param dependsOn The cell that is depended upon
+     * @brief Calls visit(node) for every live node, precedents before dependents.
      */
-    void AddSingleDependency(const CellID& dependent, const CellID& dependsOn);
+    template <typename Visit>
+    void ForEachInOrder(Visit&& visit) const {
+        for (NodeId node = m_firstInOrder; node != INVALID_NODE; node = m_nextInOrder[node]) {
+            visit(node);
+        }
+    }
+
+    /**
+     * @brief Every live node, precedents before dependents. Reads the maintained order; nothing is sorted.
+     */
+    std::vector<NodeId> GetTopologicalOrder() const;
+
+    /**
+     * @brief Stops checking and ordering added edges until EndBulkLoad(). Nothing is compacted in between.
+     */
+    void BeginBulkLoad();
+
+    /**
+     * @brief Compacts, rebuilds the order with one Tarjan pass and returns the
+     * circular components (see FindCircularComponents()).
+     */
+    std::vector<std::vector<NodeId>> EndBulkLoad();
+
+    bool IsBulkLoading() const noexcept { return m_bulkLoading; }
 
     /**
-     * @brief Helper function to remove a single dependency
-     * @param dependent The cell that no longer depends on another cell
-     * @param dependsOn The cell that is no longer depended upon
+     * @brief True if the last bulk load or order rebuild found a loop. Cleared
+     * by the next rebuild that finds none, not by the edit that broke the loop.
      */
-    void RemoveSingleDependency(const CellID& dependent, const CellID& dependsOn);
+    bool HasCircularComponents() const noexcept { return m_hasCircularComponents; }
+
+    /**
+     * @brief The loops found by the last bulk load or order rebuild, in
+     * calculation order. Removed nodes drop out of them; a loop broken since
+     * stays listed until the next rebuild.
+     */
+    const std::vector<std::vector<NodeId>>& GetCircularComponents() const noexcept { return m_circularComponents; }
+
+    /**
+     * @brief Index of @p node's loop in GetCircularComponents(), or NO_COMPONENT.
+     */
+    std::uint32_t GetCircularComponent(NodeId node) const noexcept {
+        return node < m_componentOf.size() ? m_componentOf[node] : NO_COMPONENT;
+    }
+
+    /**
+     * @brief Strongly connected components that form a cycle: two or more
+     * nodes, or one node reading itself. Listed in calculation order. O(nodes + edges).
+     */
+    std::vector<std::vector<NodeId>> FindCircularComponents() const;
+
+    /**
+     * @brief Folds the overlay and tombstones into fresh CSR arrays. Called
+     * automatically; exposed for bulk loads that want to compact once at the end.
+     */
+    void Compact();
+
+    /**
+     * @brief Edits not yet compacted: overlay edges plus tombstones.
+     */
+    std::size_t GetPendingEditCount() const noexcept { return m_overlayCount + m_tombstoneCount; }
+
+    void Clear();
+
+private:
+    /// Marks a tombstoned CSR entry. Node ids stay below this bit.
+    static constexpr NodeId REMOVED_EDGE = 1u << 31;
+
+    /**
+     * @brief One direction of the graph: CSR rows plus the overlay of edges added since the last compaction.
+     */
+    struct Adjacency {
+        std::vector<std::size_t> offsets; ///< Row i is targets[offsets[i], offsets[i + 1]); empty before the first compaction.
+        std::vector<NodeId> targets;
+        std::unordered_map<NodeId, std::vector<NodeId>> overlay;
+
+        template <typename Visit>
+        void ForEach(NodeId source, Visit&& visit) const {
+            if (static_cast<std::size_t>(source) + 1 < offsets.size()) {
+                for (std::size_t i = offsets[source], end = offsets[source + 1]; i < end; ++i) {
+                    if ((targets[i] & REMOVED_EDGE) == 0) {
+                        visit(targets[i]);
+                    }
+                }
+            }
+            if (!overlay.empty()) {
+                auto it = overlay.find(source);
+                if (it != overlay.end()) {
+                    for (NodeId target : it->second) {
+                        visit(target);
+                    }
+                }
+            }
+        }
+
+        /// Position of @p target in the CSR row, live or tombstoned, or nullptr.
+        NodeId* FindCompacted(NodeId source, NodeId target);
+        const NodeId* FindCompacted(NodeId source, NodeId target) const;
+    };
+
+    /// Inserts both directions; the order must already place @p precedent first. Returns false if present.
+    bool Link(NodeId dependent, NodeId precedent);
+    bool Unlink(NodeId dependent, NodeId precedent);
+
+    /**
+     * @brief Moves part of the affected region so that @p precedent comes
+     * before @p dependent. Throws, leaving the order untouched, if
+     * @p precedent already depends on @p dependent.
+     */
+    void Reorder(NodeId dependent, NodeId precedent);
+
+    /// Relinks @p nodes, in their current relative order, between @p left and @p right.
+    void MoveInOrder(std::vector<NodeId>& nodes, NodeId left, NodeId right);
+    void LinkInOrder(NodeId node, NodeId left, NodeId right);
+    void UnlinkFromOrder(NodeId node);
+
+    /// Gives the run [first, last] of @p count nodes fresh labels, widening it while the gap is too tight.
+    void Relabel(NodeId first, NodeId last, std::size_t count);
+
+    /// UpdateDependencies() while loops are loaded; leaves the old edges in place on a new cycle.
+    void UpdateDependenciesAroundLoops(NodeId dependent, const std::vector<NodeId>& precedents);
+
+    /// Relinks every node in component order with one Tarjan pass; returns the circular components.
+    std::vector<std::vector<NodeId>> RebuildOrder();
+
+    /// Two fresh marks for m_visitMarks, the returned one and the one after it.
+    std::uint32_t NextVisitMarks();
+
+    /// Marks @p node and everything that reads it, directly or not; returns the mark.
+    std::uint32_t MarkTransitiveDependents(NodeId node);
+
+    /// Runs Tarjan over the precedent edges, calling onComponent(first, last) in calculation order.
+    template <typename OnComponent>
+    void ForEachComponent(OnComponent&& onComponent) const;
+
+    bool IsCircular(const NodeId* first, const NodeId* last) const;
+
+    void CompactIfNeeded();
+    void CheckNode(NodeId node) const;
+
+    Adjacency m_precedents; ///< dependent -> the nodes it reads
+    Adjacency m_dependents; ///< precedent -> the nodes that read it
+    std::vector<std::uint8_t> m_live;
+    std::vector<NodeId> m_freeNodes;
+    std::size_t m_edgeCount = 0;
+    std::size_t m_overlayCount = 0;   ///< Edges held in the overlays (each counted once).
+    std::size_t m_tombstoneCount = 0; ///< Tombstoned edges (each counted once).
+    bool m_bulkLoading = false;
+    bool m_hasCircularComponents = false; ///< The order holds loops; see HasCircularComponents().
+    std::vector<std::vector<NodeId>> m_circularComponents;
+    std::vector<std::uint32_t> m_componentOf; ///< Indexed by NodeId; empty when there are no loops.
+
+    std::vector<NodeId> m_volatileNodes;
+    std::vector<NodeId> m_volatileSlots; ///< Indexed by NodeId: position in m_volatileNodes, or INVALID_NODE. Grown on first use.
+
+    // Order-maintenance list, indexed by NodeId.
+    std::vector<std::uint64_t> m_label;
+    std::vector<NodeId> m_nextInOrder;
+    std::vector<NodeId> m_previousInOrder;
+    std::vector<float> m_costs; ///< Indexed by NodeId; sized with the nodes so RecordCost() never reallocates.
+    NodeId m_firstInOrder = INVALID_NODE;
+    NodeId m_lastInOrder = INVALID_NODE;
+
+    // Scratch for Reorder() and MarkTransitiveDependents(), kept to avoid allocating per inserted edge.
+    std::vector<std::uint32_t> m_visitMarks;
+    std::uint32_t m_visitEpoch = 0;
+    std::vector<NodeId> m_forwardStack;
+    std::vector<NodeId> m_backwardStack;
+    std::vector<NodeId> m_forward;
+    std::vector<NodeId> m_backward;
 };
 
-#endif // DEPENDENCY_GRAPH_H
\ No newline at end of file
+} // namespace ExcelCalculationEngine
+
+#endif // DEPENDENCY_GRAPH_H
@@ -0,0 +1,147 @@
+#include "RangeIndex.h"
+#include "src/core-engine/Performance/Profiler.h"
+#include <cmath>
+#include <stdexcept>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+// Overlays smaller than this are scanned rather than rebuilt.
+constexpr std::size_t MIN_PENDING_EDITS_BEFORE_REBUILD = 256;
+// Otherwise rebuild once pending edits exceed live entries / this.
+constexpr std::size_t PENDING_EDIT_RATIO = 8;
+
+std::int64_t CenterRow(const RangeReference& range) {
+    return static_cast<std::int64_t>(range.firstRow) + range.lastRow;
+}
+
+std::int64_t CenterColumn(const RangeReference& range) {
+    return static_cast<std::int64_t>(range.firstColumn) + range.lastColumn;
+}
+
+} // namespace
+
+RangeEntryId RangeIndex::Insert(const RangeReference& range, NodeId node) {
+    if (range.firstRow > range.lastRow || range.firstColumn > range.lastColumn) {
+        throw std::invalid_argument("Range bounds are not normalized");
+    }
+    RangeEntryId entry;
+    if (!m_freeEntries.empty()) {
+        entry = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    } else {
+        if (m_entries.size() >= UINT32_MAX) {
+            throw std::length_error("Range index entry limit reached");
+        }
+        entry = static_cast<RangeEntryId>(m_entries.size());
+        m_entries.emplace_back();
+    }
+    m_entries[entry] = Entry{range, node, true, false};
+    m_overlay.push_back(entry);
+    RebuildIfNeeded();
+    return entry;
+}
+
+void RangeIndex::Remove(RangeEntryId entry) {
+    if (entry >= m_entries.size() || !m_entries[entry].live) {
+        throw std::out_of_range("Unknown range index entry");
+    }
+    m_entries[entry].live = false;
+    if (m_entries[entry].inTree) {
+        // Still referenced by a leaf, so the id cannot be handed out until the tree is rebuilt.
+        m_tombstones.push_back(entry);
+    } else {
+        auto it = std::find(m_overlay.begin(), m_overlay.end(), entry);
+        *it = m_overlay.back();
+        m_overlay.pop_back();
+        m_freeEntries.push_back(entry);
+    }
+    RebuildIfNeeded();
+}
+
+void RangeIndex::Rebuild() {
+    EXCEL_PROFILE_SCOPE("RangeIndex::Rebuild");
+    std::vector<std::vector<RangeEntryId>> bySheet;
+    for (RangeEntryId entry = 0; entry < m_entries.size(); ++entry) {
+        Entry& current = m_entries[entry];
+        if (!current.live) {
+            continue;
+        }
+        if (current.range.sheet >= bySheet.size()) {
+            bySheet.resize(current.range.sheet + 1);
+        }
+        bySheet[current.range.sheet].push_back(entry);
+        current.inTree = true;
+    }
+
+    m_trees.assign(bySheet.size(), Tree());
+    for (std::size_t sheet = 0; sheet < bySheet.size(); ++sheet) {
+        std::vector<RangeEntryId>& leaves = bySheet[sheet];
+        if (leaves.empty()) {
+            continue;
+        }
+
+        // Sort-tile-recursive packing: vertical slabs by column, then rows within each slab.
+        const std::size_t leafNodes = (leaves.size() + FANOUT - 1) / FANOUT;
+        const std::size_t slabs = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leafNodes))));
+        const std::size_t slabSize = slabs * FANOUT;
+        std::sort(leaves.begin(), leaves.end(), [this](RangeEntryId a, RangeEntryId b) {
+            return CenterColumn(m_entries[a].range) < CenterColumn(m_entries[b].range);
+        });
+        for (std::size_t first = 0; first < leaves.size(); first += slabSize) {
+            const std::size_t last = std::min(first + slabSize, leaves.size());
+            std::sort(leaves.begin() + first, leaves.begin() + last, [this](RangeEntryId a, RangeEntryId b) {
+                return CenterRow(m_entries[a].range) < CenterRow(m_entries[b].range);
+            });
+        }
+
+        Tree& tree = m_trees[sheet];
+        std::vector<Box> boxes;
+        boxes.reserve(leaves.size());
+        for (RangeEntryId entry : leaves) {
+            const RangeReference& range = m_entries[entry].range;
+            boxes.push_back(Box{range.firstRow, range.firstColumn, range.lastRow, range.lastColumn});
+        }
+        tree.leaves = std::move(leaves);
+        tree.levels.push_back(std::move(boxes));
+
+        while (tree.levels.back().size() > 1) {
+            const std::vector<Box>& children = tree.levels.back();
+            std::vector<Box> parents;
+            parents.reserve((children.size() + FANOUT - 1) / FANOUT);
+            for (std::size_t first = 0; first < children.size(); first += FANOUT) {
+                Box box = children[first];
+                for (std::size_t child = first + 1; child < std::min(first + FANOUT, children.size()); ++child) {
+                    box.firstRow = std::min(box.firstRow, children[child].firstRow);
+                    box.firstColumn = std::min(box.firstColumn, children[child].firstColumn);
+                    box.lastRow = std::max(box.lastRow, children[child].lastRow);
+                    box.lastColumn = std::max(box.lastColumn, children[child].lastColumn);
+                }
+                parents.push_back(box);
+            }
+            tree.levels.push_back(std::move(parents));
+        }
+    }
+
+    m_overlay.clear();
+    m_freeEntries.insert(m_freeEntries.end(), m_tombstones.begin(), m_tombstones.end());
+    m_tombstones.clear();
+}
+
+void RangeIndex::Clear() {
+    m_entries.clear();
+    m_freeEntries.clear();
+    m_tombstones.clear();
+    m_overlay.clear();
+    m_trees.clear();
+}
+
+void RangeIndex::RebuildIfNeeded() {
+    const std::size_t pending = m_overlay.size() + m_tombstones.size();
+    if (pending > MIN_PENDING_EDITS_BEFORE_REBUILD && pending > GetCount() / PENDING_EDIT_RATIO) {
+        Rebuild();
+    }
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,155 @@
+#ifndef RANGE_INDEX_H
+#define RANGE_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "../Interfaces/GridReference.h"
+#include "DependencyGraph.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @brief Handle for one rectangle in a RangeIndex; stays valid until Remove().
+ */
+using RangeEntryId = std::uint32_t;
+
+/**
+ * @class RangeIndex
+ * @brief Rectangles tagged with graph nodes, answering "which rectangles contain this cell".
+ *
+ * Each sheet has a static packed R-tree built by sort-tile-recursive
+ * loading, with 16 children per node. Edits follow DependencyGraph: a
+ * removed rectangle is tombstoned, a new one is scanned linearly from a
+ * small overlay, and once pending edits pass an eighth of the live entries
+ * the trees are rebuilt. A query visits O(log n + matches) tree nodes.
+ *
+ * Not thread-safe for writes. Concurrent const access is safe.
+ */
+class RangeIndex {
+public:
+    RangeEntryId Insert(const RangeReference& range, NodeId node);
+    void Remove(RangeEntryId entry);
+
+    const RangeReference& GetRange(RangeEntryId entry) const noexcept { return m_entries[entry].range; }
+    NodeId GetNode(RangeEntryId entry) const noexcept { return m_entries[entry].node; }
+
+    std::size_t GetCount() const noexcept { return m_entries.size() - m_freeEntries.size() - m_tombstones.size(); }
+
+    /**
+     * @brief Calls visit(node, entry) for every rectangle containing @p cell.
+     */
+    template <typename Visit>
+    void ForEachContaining(const CellReference& cell, Visit&& visit) const {
+        ForEachIntersecting(RangeReference{cell.sheet, cell.row, cell.column, cell.row, cell.column}, visit);
+    }
+
+    /**
+     * @brief Calls visit(node, entry) for every rectangle overlapping @p area.
+     */
+    template <typename Visit>
+    void ForEachIntersecting(const RangeReference& area, Visit&& visit) const {
+        for (RangeEntryId entry : m_overlay) {
+            if (Intersects(m_entries[entry].range, area)) {
+                visit(m_entries[entry].node, entry);
+            }
+        }
+        if (area.sheet >= m_trees.size() || m_trees[area.sheet].levels.empty()) {
+            return;
+        }
+        const Tree& tree = m_trees[area.sheet];
+        // Internal nodes only; leaves are tested in place. Each level adds at most FANOUT - 1 frames.
+        struct Frame {
+            std::uint32_t level;
+            std::uint32_t index;
+        };
+        Frame stack[MAX_LEVELS * FANOUT];
+        std::size_t depth = 0;
+        stack[depth++] = Frame{static_cast<std::uint32_t>(tree.levels.size() - 1), 0};
+        while (depth > 0) {
+            const Frame frame = stack[--depth];
+            if (!Intersects(tree.levels[frame.level][frame.index], area)) {
+                continue;
+            }
+            if (frame.level == 0) {
+                // A single-entry tree is just its leaf.
+                VisitLeaf(tree, frame.index, area, visit);
+                continue;
+            }
+            const std::size_t first = static_cast<std::size_t>(frame.index) * FANOUT;
+            const std::size_t last = std::min(first + FANOUT, tree.levels[frame.level - 1].size());
+            for (std::size_t child = last; child-- > first;) {
+                if (frame.level == 1) {
+                    VisitLeaf(tree, child, area, visit);
+                } else {
+                    stack[depth++] = Frame{frame.level - 1, static_cast<std::uint32_t>(child)};
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Rebuilds the trees now. Called automatically; useful once after a bulk load.
+     */
+    void Rebuild();
+
+    void Clear();
+
+private:
+    static constexpr std::size_t FANOUT = 16;
+    static constexpr std::size_t MAX_LEVELS = 9; ///< 16^8 leaves exceeds any RangeEntryId.
+
+    struct Box {
+        std::int32_t firstRow;
+        std::int32_t firstColumn;
+        std::int32_t lastRow;
+        std::int32_t lastColumn;
+    };
+
+    struct Entry {
+        RangeReference range;
+        NodeId node;
+        bool live;
+        bool inTree; ///< False while the entry is only in the overlay.
+    };
+
+    /**
+     * @brief Packed tree of one sheet. levels[0] holds the leaf boxes, one per
+     * entry in leaves; box i of level k covers boxes [i * FANOUT, (i + 1) * FANOUT) of level k - 1.
+     */
+    struct Tree {
+        std::vector<RangeEntryId> leaves;
+        std::vector<std::vector<Box>> levels;
+    };
+
+    template <typename Bounds>
+    static bool Intersects(const Bounds& box, const RangeReference& area) noexcept {
+        return box.firstRow <= area.lastRow && area.firstRow <= box.lastRow &&
+               box.firstColumn <= area.lastColumn && area.firstColumn <= box.lastColumn;
+    }
+
+    static bool Intersects(const RangeReference& range, const RangeReference& area) noexcept {
+        return range.sheet == area.sheet && Intersects<RangeReference>(range, area);
+    }
+
+    template <typename Visit>
+    void VisitLeaf(const Tree& tree, std::size_t index, const RangeReference& area, Visit& visit) const {
+        const RangeEntryId entry = tree.leaves[index];
+        if (m_entries[entry].live && Intersects(tree.levels[0][index], area)) {
+            visit(m_entries[entry].node, entry);
+        }
+    }
+
+    void RebuildIfNeeded();
+
+    std::vector<Entry> m_entries;
+    std::vector<RangeEntryId> m_freeEntries;
+    std::vector<RangeEntryId> m_tombstones; ///< Removed but still in a tree; reusable after Rebuild().
+    std::vector<RangeEntryId> m_overlay;
+    std::vector<Tree> m_trees; ///< Indexed by sheet.
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // RANGE_INDEX_H
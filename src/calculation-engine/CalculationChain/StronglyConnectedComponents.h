@@ -0,0 +1,88 @@
+#ifndef STRONGLY_CONNECTED_COMPONENTS_H
+#define STRONGLY_CONNECTED_COMPONENTS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @brief Tarjan's strongly connected components over nodes [0, nodeCount), without recursion.
+ *
+ * @p isNode(node) filters out unused ids. @p forEachSuccessor(node, visit)
+ * calls visit(successor) for each edge leaving node. @p onComponent(first, last)
+ * receives the members of one component as a contiguous array.
+ *
+ * A component is reported only after every component it can reach, so when
+ * successors are precedents the components come out in calculation order.
+ * The DFS keeps its own stacks: a chain of a million cells costs heap, not
+ * call stack. O(nodes + edges) time.
+ */
+template <typename Node, typename IsNode, typename ForEachSuccessor, typename OnComponent>
+void ForEachStronglyConnectedComponent(std::size_t nodeCount, IsNode&& isNode,
+                                       ForEachSuccessor&& forEachSuccessor, OnComponent&& onComponent) {
+    constexpr std::uint32_t UNVISITED = 0;
+    std::vector<std::uint32_t> index(nodeCount, UNVISITED); ///< DFS preorder number, starting at 1.
+    std::vector<std::uint32_t> lowLink(nodeCount, 0);
+    std::vector<std::uint8_t> onStack(nodeCount, 0);
+    std::vector<Node> componentStack;
+
+    // One frame per node on the DFS path. A frame's successors sit in
+    // pending[firstPending, pending.size()) and are consumed from the back.
+    struct Frame {
+        Node node;
+        std::size_t firstPending;
+    };
+    std::vector<Frame> path;
+    std::vector<Node> pending;
+    std::uint32_t nextIndex = 1;
+
+    auto enter = [&](Node node) {
+        index[node] = lowLink[node] = nextIndex++;
+        onStack[node] = 1;
+        componentStack.push_back(node);
+        path.push_back(Frame{node, pending.size()});
+        forEachSuccessor(node, [&pending](Node successor) { pending.push_back(successor); });
+    };
+
+    for (std::size_t root = 0; root < nodeCount; ++root) {
+        if (!isNode(static_cast<Node>(root)) || index[root] != UNVISITED) {
+            continue;
+        }
+        enter(static_cast<Node>(root));
+        while (!path.empty()) {
+            const Frame frame = path.back();
+            if (pending.size() > frame.firstPending) {
+                const Node successor = pending.back();
+                pending.pop_back();
+                if (index[successor] == UNVISITED) {
+                    enter(successor);
+                } else if (onStack[successor]) {
+                    lowLink[frame.node] = std::min(lowLink[frame.node], index[successor]);
+                }
+                continue;
+            }
+
+            path.pop_back();
+            if (!path.empty()) {
+                const Node parent = path.back().node;
+                lowLink[parent] = std::min(lowLink[parent], lowLink[frame.node]);
+            }
+            if (lowLink[frame.node] == index[frame.node]) {
+                const std::size_t first =
+                    std::find(componentStack.rbegin(), componentStack.rend(), frame.node).base() - 1 - componentStack.begin();
+                for (std::size_t i = first; i < componentStack.size(); ++i) {
+                    onStack[componentStack[i]] = 0;
+                }
+                onComponent(componentStack.data() + first, componentStack.data() + componentStack.size());
+                componentStack.resize(first);
+            }
+        }
+    }
+}
+
+} // namespace ExcelCalculationEngine
+
+#endif // STRONGLY_CONNECTED_COMPONENTS_H
@@ -1,202 +1,551 @@
 #include "CalculationEngine.h"
 #include "ErrorHandling/CalculationErrors.h"
+#include "Evaluation/FormulaVM.h"
+#include "FormulaParser/FormulaCompiler.h"
+#include "../core-engine/Performance/Profiler.h"
+#include "../core-engine/Performance/Metrics.h"
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <stdexcept>
 #include <thread>
+#include <unordered_map>
+#include <utility>
 
-const int MAX_ITERATION_COUNT = 1000;
+namespace {
+
+using excel::core_engine::performance::Counter;
+using excel::core_engine::performance::Histogram;
+using excel::core_engine::performance::GetMetrics;
+
+struct CalculationMetrics {
+    Counter& cellsEvaluated;
+    Counter& recalcs;
+    Counter& cacheHits;
+    Counter& cacheMisses;
+    Histogram& recalcDuration;
+};
+
+CalculationMetrics& Metrics() {
+    static CalculationMetrics metrics = [] {
+        CalculationMetrics m{
+            GetMetrics().GetCounter("excel_calc_cells_evaluated_total", "Formulas evaluated (cache misses that ran the evaluator)."),
+            GetMetrics().GetCounter("excel_calc_recalcs_total", "Recalculations triggered by cell updates."),
+            GetMetrics().GetCounter("excel_formula_cache_hits_total", "Formula cache lookups that returned a cached value."),
+            GetMetrics().GetCounter("excel_formula_cache_misses_total", "Formula cache lookups that had to evaluate."),
+            GetMetrics().GetHistogram("excel_calc_recalc_duration_seconds", "Time to recalculate the dependents of an updated cell.")};
+        Counter* hits = &m.cacheHits;
+        Counter* misses = &m.cacheMisses;
+        GetMetrics().RegisterComputedGauge("excel_formula_cache_hit_ratio", "Formula cache hits / lookups since start.",
+            [hits, misses] {
+                const double h = static_cast<double>(hits->Value());
+                const double total = h + static_cast<double>(misses->Value());
+                return total > 0.0 ? h / total : 0.0;
+            });
+        return m;
+    }();
+    return metrics;
+}
+
+// A value as typed into a cell: a number, TRUE or FALSE, or else text
+std::variant<double, std::string, bool> ParseCellInput(const std::string& text) {
+    if (text == "TRUE" || text == "FALSE") {
+        return text == "TRUE";
+    }
+    if (!text.empty()) {
+        char* end = nullptr;
+        const double number = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() + text.size() && std::isfinite(number)) {
+            return number;
+        }
+    }
+    return text;
+}
+
+} // namespace
 
 CalculationEngine::CalculationEngine(
-    std::shared_ptr<IFormulaParser> parser,
     std::shared_ptr<IFunctionLibrary> functionLibrary,
-    std::shared_ptr<ICalculationChain> calculationChain)
-    : m_formulaParser(std::move(parser)),
-      m_functionLibrary(std::move(functionLibrary)),
+    std::shared_ptr<CalculationChain> calculationChain)
+    : m_functionLibrary(std::move(functionLibrary)),
       m_calculationChain(std::move(calculationChain)),
       m_cache(std::make_unique<FormulaCache>()),
-      m_arrayFormulaHandler(std::make_unique<ArrayFormulaHandler>()),
-      m_dynamicArrayHandler(std::make_unique<DynamicArrayHandler>()),
       m_calculationOptimizer(std::make_unique<CalculationOptimizer>()),
-      m_parallelCalculation(std::make_unique<ParallelCalculation>()) {
+      m_parallelCalculation(std::make_unique<ParallelCalculation>()),
+      m_programCache(std::make_unique<FormulaProgramCache>()),
+      m_cellValues(std::make_shared<ExcelCalculationEngine::CellValueStore>()) {
+    m_calculationChain->SetCellCalculator([this](Cell& cell) { RecalculateChainCell(cell); });
+    m_calculationChain->SetLoopCalculator([this](const std::vector<Cell*>& cells) { RecalculateChainLoop(cells); });
+}
+
+CalculationEngine::~CalculationEngine() {
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    m_calculationChain->SetCellCalculator(nullptr);
+    m_calculationChain->SetLoopCalculator(nullptr);
 }
 
 std::variant<double, std::string, bool> CalculationEngine::Calculate(const std::string& formula, const CellReference& cellRef) {
+    EXCEL_PROFILE_SCOPE("CalculationEngine::Calculate");
     try {
-        // Check cache first
-        if (auto cachedResult = m_cache->Get(formula, cellRef)) {
-            return *cachedResult;
-        }
+        // Not cached: the formula is not in the chain, so nothing would invalidate the result
+        Metrics().cellsEvaluated.Increment();
 
-        // Parse the formula
-        auto parsedFormula = m_formulaParser->Parse(formula);
+        // Only the shape key is derived here; the program is compiled once per shape.
+        return EvaluateProgram(m_programCache->Bind(formula, cellRef));
+    } catch (const CalculationError& e) {
+        // Handle calculation errors
+        return e.what();
+    } catch (const std::exception& e) {
+        // Handle other exceptions
+        return std::string("Error: ") + e.what();
+    }
+}
 
-        // Check if it's an array formula
-        if (m_arrayFormulaHandler->IsArrayFormula(parsedFormula)) {
-            return m_arrayFormulaHandler->EvaluateArrayFormula(parsedFormula, cellRef, *this);
+std::variant<double, std::string, bool> CalculationEngine::Calculate(const CellReference& cellRef) {
+    EXCEL_PROFILE_SCOPE("CalculationEngine::Calculate");
+    // A copy, so a concurrent SetCellFormula or ClearCellFormula cannot free the program mid-run
+    FormulaBinding binding;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_formulas.find(cellRef);
+        if (it == m_formulas.end()) {
+            return GetCellValue(cellRef);
         }
-
-        // Check if it's a dynamic array formula
-        if (m_dynamicArrayHandler->IsDynamicArrayFormula(parsedFormula)) {
-            return m_dynamicArrayHandler->EvaluateDynamicArrayFormula(parsedFormula, cellRef, *this);
+        binding = it->second;
+    }
+    try {
+        if (auto cachedResult = m_cache->Get(binding.program->GetShape(), cellRef)) {
+            Metrics().cacheHits.Increment();
+            return *cachedResult;
         }
+        Metrics().cacheMisses.Increment();
+        Metrics().cellsEvaluated.Increment();
 
-        // Calculate the result
-        auto result = CalculateInternal(parsedFormula, cellRef);
-
-        // Cache the result
-        m_cache->Set(formula, cellRef, result);
-
+        auto result = EvaluateProgram(binding);
+        m_cache->Set(binding.program->GetShape(), cellRef, result);
         return result;
     } catch (const CalculationError& e) {
-        // Handle calculation errors
         return e.what();
     } catch (const std::exception& e) {
-        // Handle other exceptions
         return std::string("Error: ") + e.what();
     }
 }
 
+void CalculationEngine::SetCellFormula(const CellReference& cellRef, const std::string& formula) {
+    FormulaBinding binding = m_programCache->Bind(formula, cellRef);
+    // Every reference is a range precedent, so edits to constants reach the cell by position
+    const std::vector<RangeReference> precedents = ResolvePrecedents(binding);
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    const bool added = m_chainCells.count(cellRef) == 0;
+    const std::shared_ptr<Cell> cell = AcquireChainCell(cellRef);
+    try {
+        try {
+            m_calculationChain->UpdateDependencies(cell, {}, precedents);
+        } catch (const ::Excel::CalculationEngine::CalculationException& e) {
+            if (e.getCalculationErrorCode() != ::Excel::CalculationEngine::CalculationErrorCode::CIRCULAR_REFERENCE) {
+                throw;
+            }
+            // Kept as a loop, which the chain calculates by iteration (see RecalculateChainLoop())
+            m_calculationChain->BeginBulkLoad();
+            try {
+                m_calculationChain->UpdateDependencies(cell, {}, precedents);
+            } catch (...) {
+                m_calculationChain->EndBulkLoad();
+                throw;
+            }
+            m_calculationChain->EndBulkLoad();
+        }
+    } catch (...) {
+        if (added) {
+            RemoveChainCell(cellRef);
+        }
+        throw;
+    }
+    m_calculationChain->SetVolatile(cell, binding.program->IsVolatile());
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_formulas[cellRef] = std::move(binding);
+        m_cache->Invalidate(cellRef);
+    }
+    m_calculationChain->InvalidateCell(cell);
+}
+
+void CalculationEngine::LoadFormulas(const std::vector<std::pair<CellReference, std::string>>& formulas) {
+    EXCEL_PROFILE_SCOPE("CalculationEngine::LoadFormulas");
+    // All compiled before the chain is touched
+    std::vector<FormulaBinding> bindings;
+    bindings.reserve(formulas.size());
+    for (const auto& formula : formulas) {
+        bindings.push_back(m_programCache->Bind(formula.second, formula.first));
+    }
+
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    std::vector<std::shared_ptr<Cell>> cells;
+    cells.reserve(bindings.size());
+    m_calculationChain->BeginBulkLoad();
+    try {
+        for (const FormulaBinding& binding : bindings) {
+            cells.push_back(AcquireChainCell(binding.anchor));
+            m_calculationChain->UpdateDependencies(cells.back(), {}, ResolvePrecedents(binding));
+            m_calculationChain->SetVolatile(cells.back(), binding.program->IsVolatile());
+        }
+    } catch (...) {
+        m_calculationChain->EndBulkLoad();
+        throw;
+    }
+    m_calculationChain->EndBulkLoad();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (FormulaBinding& binding : bindings) {
+            m_cache->Invalidate(binding.anchor);
+            m_formulas[binding.anchor] = std::move(binding);
+        }
+    }
+    m_calculationChain->InvalidateCells(cells);
+}
+
+void CalculationEngine::ClearCellFormula(const CellReference& cellRef) {
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    RemoveChainCell(cellRef);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_formulas.erase(cellRef);
+        m_cache->Invalidate(cellRef);
+    }
+    // Whatever reads the cell now sees it empty
+    m_calculationChain->InvalidateCell(cellRef);
+}
+
+std::size_t CalculationEngine::GetFormulaShapeCount() const {
+    return m_programCache->GetShapeCount();
+}
+
 void CalculationEngine::UpdateCell(const CellReference& cellRef, const std::variant<double, std::string, bool>& value) {
-    // Update the cell value
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_batchDepth > 0) {
+            m_batchUpdates.push_back(CellUpdate{cellRef, value});
+            return;
+        }
+    }
+    ApplyUpdates({CellUpdate{cellRef, value}});
+}
+
+void CalculationEngine::ApplyUpdates(const std::vector<CellUpdate>& updates) {
+    EXCEL_PROFILE_SCOPE("CalculationEngine::ApplyUpdates");
+    if (updates.empty()) {
+        return;
+    }
+    Metrics().recalcs.Increment();
+    excel::core_engine::performance::ScopedTimer recalcTimer(Metrics().recalcDuration);
+
+    // The last write to each cell wins
+    std::unordered_map<CellReference, std::size_t> lastWrite;
+    std::vector<CellReference> written;
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+        auto inserted = lastWrite.emplace(updates[i].cell, i);
+        if (inserted.second) {
+            written.push_back(updates[i].cell);
+        } else {
+            inserted.first->second = i;
+        }
+    }
+
+    // Update the cell values
     // (Assuming there's a method to update the cell value in the underlying data structure)
-    UpdateCellValue(cellRef, value);
+    for (const CellReference& cell : written) {
+        UpdateCellValue(cell, updates[lastWrite[cell]].value);
+    }
+    m_cache->Invalidate(written);
 
-    // Invalidate cache for this cell and its dependents
-    m_cache->Invalidate(cellRef);
+    // One pass for the whole batch: each dependent runs once, in calculation
+    // order, and only if something it reads came out different
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    m_calculationChain->InvalidateCells(written);
+    m_calculationChain->RecalculateChain();
+}
 
-    // Trigger recalculation of dependent cells
-    auto dependentCells = m_calculationChain->GetDependentCells(cellRef);
-    for (const auto& depCell : dependentCells) {
-        Calculate(GetCellFormula(depCell), depCell);
+double CalculationEngine::CalculateFormula(const std::string& formula,
+                                           const std::unordered_map<std::string, double>& variables) {
+    if (!variables.empty()) {
+        throw std::invalid_argument("Formula variables are not supported; formulas read cells by reference");
+    }
+    // Evaluated as if entered in A1, but neither stored nor cached there
+    Metrics().cellsEvaluated.Increment();
+    const auto result = EvaluateProgram(m_programCache->Bind(formula, CellReference{}));
+    if (const double* number = std::get_if<double>(&result)) {
+        return *number;
+    }
+    if (const bool* boolean = std::get_if<bool>(&result)) {
+        return *boolean ? 1.0 : 0.0;
     }
+    // Errors such as #DIV/0! come back as text
+    throw CalculationError(std::get<std::string>(result));
 }
 
-void CalculationEngine::HandleCircularReference(const std::vector<CellReference>& circularCells) {
-    // Implement iterative calculation for circular references
-    std::vector<std::variant<double, std::string, bool>> previousValues;
-    std::vector<std::variant<double, std::string, bool>> currentValues;
+void CalculationEngine::UpdateCell(const std::string& cellReference, const std::string& newValue) {
+    UpdateCell(ParseCellReference(cellReference), ParseCellInput(newValue));
+}
 
-    // Initialize previous values
-    for (const auto& cell : circularCells) {
-        previousValues.push_back(GetCellValue(cell));
+void CalculationEngine::UpdateCells(const std::vector<std::pair<std::string, std::string>>& updates) {
+    std::vector<CellUpdate> parsed;
+    parsed.reserve(updates.size());
+    for (const auto& update : updates) {
+        parsed.push_back(CellUpdate{ParseCellReference(update.first), ParseCellInput(update.second)});
     }
+    BeginBatch();
+    for (const CellUpdate& update : parsed) {
+        UpdateCell(update.cell, update.value);
+    }
+    CommitBatch();
+}
 
-    for (int iteration = 0; iteration < MAX_ITERATION_COUNT; ++iteration) {
-        currentValues.clear();
+void CalculationEngine::RecalculateWorksheet() {
+    // Formulas may read other sheets, so the whole workbook is brought up to date
+    RecalculateAll();
+}
 
-        // Calculate new values
-        for (const auto& cell : circularCells) {
-            currentValues.push_back(Calculate(GetCellFormula(cell), cell));
+void CalculationEngine::RecalculateAll() {
+    EXCEL_PROFILE_SCOPE("CalculationEngine::RecalculateAll");
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    for (const auto& entry : m_chainCells) {
+        m_calculationChain->InvalidateCell(entry.second);
+    }
+    m_calculationChain->RecalculateChain();
+}
+
+double CalculationEngine::GetCellValue(const std::string& cellReference) {
+    // As Excel's N(): TRUE is 1 and text is 0
+    const auto value = GetCellValue(ParseCellReference(cellReference));
+    if (const double* number = std::get_if<double>(&value)) {
+        return *number;
+    }
+    if (const bool* boolean = std::get_if<bool>(&value)) {
+        return *boolean ? 1.0 : 0.0;
+    }
+    return 0.0;
+}
+
+CellReference CalculationEngine::ParseCellReference(const std::string& text) const {
+    std::string sheetName;
+    ExcelCalculationEngine::ReferenceOperand reference;
+    if (!ExcelCalculationEngine::FormulaCompiler::ParseReference(text, sheetName, reference) || reference.isRange) {
+        throw std::invalid_argument("Not a cell reference: " + text);
+    }
+    CellReference cell{0, reference.first.row, reference.first.column};
+    if (!sheetName.empty()) {
+        const auto sheet = m_cellValues->FindSheet(sheetName);
+        if (!sheet) {
+            throw std::invalid_argument("No sheet named " + sheetName);
         }
+        cell.sheet = *sheet;
+    }
+    return cell;
+}
 
-        // Check for convergence
-        if (ValuesConverged(previousValues, currentValues)) {
-            // Update cell values and return
-            for (size_t i = 0; i < circularCells.size(); ++i) {
-                UpdateCellValue(circularCells[i], currentValues[i]);
-            }
+void CalculationEngine::BeginBatch() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_batchDepth;
+}
+
+void CalculationEngine::CommitBatch() {
+    std::vector<CellUpdate> updates;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_batchDepth == 0) {
+            throw std::logic_error("CommitBatch without BeginBatch");
+        }
+        if (--m_batchDepth > 0) {
             return;
         }
+        updates.swap(m_batchUpdates);
+    }
+    ApplyUpdates(updates);
+}
+
+void CalculationEngine::HandleCircularReference(const std::vector<CellReference>& circularCells) {
+    EXCEL_PROFILE_SCOPE("CalculationEngine::HandleCircularReference");
+    std::lock_guard<std::mutex> chainLock(m_chainMutex);
+    // The bound programs run directly; constants in the list have nothing to iterate
+    std::vector<FormulaBinding> bindings;
+    IterationSettings settings;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        bindings.reserve(circularCells.size());
+        for (const auto& cell : circularCells) {
+            auto it = m_formulas.find(cell);
+            if (it != m_formulas.end()) {
+                bindings.push_back(it->second);
+            }
+        }
+        settings = m_iterationSettings;
+    }
+
+    // Each loop is iterated on its own, in place, and independent loops in parallel
+    const auto result = ExcelCalculationEngine::IterativeCalculation::Calculate(
+        bindings, *m_cellValues, m_functionLibrary.get(), settings, m_parallelCalculation.get());
+    if (!result.converged) {
+        throw CalculationError("Circular reference did not converge after " + std::to_string(settings.maxIterations) + " iterations");
+    }
+    std::vector<std::shared_ptr<Cell>> cells;
+    cells.reserve(bindings.size());
+    for (std::size_t i = 0; i < bindings.size(); ++i) {
+        auto it = m_chainCells.find(bindings[i].anchor);
+        Cell* cell = it != m_chainCells.end() ? it->second.get() : nullptr;
+        StoreResult(bindings[i], result.values[i].ToVariant(), cell);
+        if (cell) {
+            cells.push_back(it->second);
+        }
+    }
+    // The loop's values are final; what reads them from outside is recalculated against them
+    m_calculationChain->InvalidateDependents(cells);
+    m_calculationChain->RecalculateChain();
+}
 
-        previousValues = currentValues;
+void CalculationEngine::SetIterationSettings(const IterationSettings& settings) {
+    if (settings.maxIterations < 1 || !(settings.maxChange >= 0.0)) {
+        throw std::invalid_argument("Iteration needs at least one iteration and a non-negative maximum change");
     }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_iterationSettings = settings;
+}
 
-    // If we reach here, we've hit the maximum iteration count without convergence
-    throw CalculationError("Circular reference did not converge after " + std::to_string(MAX_ITERATION_COUNT) + " iterations");
+IterationSettings CalculationEngine::GetIterationSettings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_iterationSettings;
 }
 
 void CalculationEngine::OptimizeCalculation() {
     m_calculationOptimizer->Optimize(m_calculationChain);
 }
 
-std::variant<double, std::string, bool> CalculationEngine::CalculateInternal(const ParsedFormula& formula, const CellReference& cellRef) {
-    // Implement the core calculation logic here
-    // This is a simplified example and should be expanded based on the actual formula structure
-    switch (formula.type) {
-        case FormulaType::Literal:
-            return formula.value;
-        case FormulaType::CellReference:
-            return GetCellValue(formula.cellRef);
-        case FormulaType::Function:
-            return EvaluateFunction(formula.functionName, formula.arguments, cellRef);
-        case FormulaType::Operator:
-            return EvaluateOperator(formula.operatorType, formula.leftOperand, formula.rightOperand, cellRef);
-        default:
-            throw CalculationError("Unknown formula type");
+std::variant<double, std::string, bool> CalculationEngine::EvaluateProgram(const FormulaBinding& binding) {
+    // Errors such as #DIV/0! come back as values and surface as their text.
+    return ExcelCalculationEngine::FormulaVM::ForCurrentThread()
+        .Execute(*binding.program, binding.anchor, *m_cellValues, m_functionLibrary.get())
+        .ToVariant();
+}
+
+std::vector<RangeReference> CalculationEngine::ResolvePrecedents(const FormulaBinding& binding) const {
+    const ExcelCalculationEngine::FormulaProgram& program = *binding.program;
+    std::vector<RangeReference> ranges;
+    ranges.reserve(program.GetReferences().size());
+    for (const auto& reference : program.GetReferences()) {
+        std::uint32_t sheet = binding.anchor.sheet;
+        if (reference.sheetName >= 0) {
+            // A sheet that does not exist yet reads as #REF! and has nothing to depend on
+            const auto found = m_cellValues->FindSheet(program.GetString(static_cast<std::uint32_t>(reference.sheetName)));
+            if (!found) {
+                continue;
+            }
+            sheet = *found;
+        }
+        const CellReference first = reference.first.Resolve(binding.anchor);
+        const CellReference last = reference.last.Resolve(binding.anchor);
+        ranges.push_back(RangeReference{sheet, std::min(first.row, last.row), std::min(first.column, last.column),
+                                        std::max(first.row, last.row), std::max(first.column, last.column)});
     }
+    return ranges;
 }
 
-std::variant<double, std::string, bool> CalculationEngine::EvaluateFunction(
-    const std::string& functionName,
-    const std::vector<ParsedFormula>& arguments,
-    const CellReference& cellRef) {
-    // Evaluate function arguments
-    std::vector<std::variant<double, std::string, bool>> evaluatedArgs;
-    for (const auto& arg : arguments) {
-        evaluatedArgs.push_back(CalculateInternal(arg, cellRef));
+void CalculationEngine::RemoveChainCell(const CellReference& cellRef) {
+    auto it = m_chainCells.find(cellRef);
+    if (it != m_chainCells.end()) {
+        m_calculationChain->RemoveCell(it->second);
+        m_chainPositions.erase(it->second.get());
+        m_chainCells.erase(it);
     }
+}
 
-    // Call the function from the function library
-    return m_functionLibrary->ExecuteFunction(functionName, evaluatedArgs);
+std::shared_ptr<Cell> CalculationEngine::AcquireChainCell(const CellReference& cellRef) {
+    std::shared_ptr<Cell>& cell = m_chainCells[cellRef];
+    if (!cell) {
+        cell = std::make_shared<Cell>();
+        m_chainPositions.emplace(cell.get(), cellRef);
+        m_calculationChain->AddCell(cell, cellRef);
+    }
+    return cell;
 }
 
-std::variant<double, std::string, bool> CalculationEngine::EvaluateOperator(
-    OperatorType op,
-    const ParsedFormula& left,
-    const ParsedFormula& right,
-    const CellReference& cellRef) {
-    auto leftValue = CalculateInternal(left, cellRef);
-    auto rightValue = CalculateInternal(right, cellRef);
+void CalculationEngine::RecalculateChainCell(Cell& cell) {
+    auto position = m_chainPositions.find(&cell);
+    if (position == m_chainPositions.end()) {
+        return;
+    }
+    FormulaBinding binding;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_formulas.find(position->second);
+        if (it == m_formulas.end()) {
+            return;
+        }
+        binding = it->second;
+    }
+    Metrics().cellsEvaluated.Increment();
+    // Something the cell reads changed, so the cached result is replaced, never read
+    const auto result = EvaluateProgram(binding);
+    if (binding.program->HasDynamicReferences()) {
+        // What OFFSET and INDIRECT read this time; a precedent not calculated yet reschedules the cell
+        try {
+            m_calculationChain->SetDynamicDependencies(
+                m_chainCells[position->second], ExcelCalculationEngine::FormulaVM::ForCurrentThread().GetDynamicReferences());
+        } catch (const ::Excel::CalculationEngine::CalculationException& e) {
+            cell.SetErrorState(e.what());
+            return;
+        }
+    }
+    StoreResult(binding, result, &cell);
+}
 
-    // Implement operator evaluation logic here
-    // This is a simplified example and should be expanded to handle all operator types and data types
-    if (std::holds_alternative<double>(leftValue) && std::holds_alternative<double>(rightValue)) {
-        double l = std::get<double>(leftValue);
-        double r = std::get<double>(rightValue);
-        switch (op) {
-            case OperatorType::Add: return l + r;
-            case OperatorType::Subtract: return l - r;
-            case OperatorType::Multiply: return l * r;
-            case OperatorType::Divide:
-                if (r == 0) throw CalculationError("Division by zero");
-                return l / r;
-            // Add other operators as needed
-            default: throw CalculationError("Unsupported operator");
+void CalculationEngine::RecalculateChainLoop(const std::vector<Cell*>& cells) {
+    std::vector<FormulaBinding> bindings;
+    std::vector<Cell*> formulaCells;
+    IterationSettings settings;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Cell* cell : cells) {
+            auto position = m_chainPositions.find(cell);
+            if (position == m_chainPositions.end()) {
+                continue;
+            }
+            auto it = m_formulas.find(position->second);
+            if (it != m_formulas.end()) {
+                bindings.push_back(it->second);
+                formulaCells.push_back(cell);
+            }
         }
+        settings = m_iterationSettings;
+    }
+    Metrics().cellsEvaluated.Increment(bindings.size());
+    // As Excel does, the last sweep's values stand when the loop has not converged
+    const auto result = ExcelCalculationEngine::IterativeCalculation::Calculate(
+        bindings, *m_cellValues, m_functionLibrary.get(), settings);
+    for (std::size_t i = 0; i < bindings.size(); ++i) {
+        StoreResult(bindings[i], result.values[i].ToVariant(), formulaCells[i]);
     }
-    // Add handling for other data type combinations and operators
+}
 
-    throw CalculationError("Invalid operand types for operator");
+void CalculationEngine::StoreResult(const FormulaBinding& binding, const std::variant<double, std::string, bool>& value,
+                                    Cell* cell) {
+    m_cache->Set(binding.program->GetShape(), binding.anchor, value);
+    UpdateCellValue(binding.anchor, value);
+    if (cell) {
+        cell->SetValue(std::visit([](const auto& v) -> std::variant<std::string, double, bool> { return v; }, value));
+    }
 }
 
-// Helper functions (these should be implemented elsewhere, e.g., in a CellManager class)
 void CalculationEngine::UpdateCellValue(const CellReference& cellRef, const std::variant<double, std::string, bool>& value) {
-    // Implementation to update the cell value in the underlying data structure
+    m_cellValues->Set(cellRef, ExcelCalculationEngine::FormulaValue::FromVariant(value));
 }
 
 std::variant<double, std::string, bool> CalculationEngine::GetCellValue(const CellReference& cellRef) {
-    // Implementation to get the cell value from the underlying data structure
-    return 0.0; // Placeholder
-}
-
-std::string CalculationEngine::GetCellFormula(const CellReference& cellRef) {
-    // Implementation to get the cell formula from the underlying data structure
-    return ""; // Placeholder
+    return m_cellValues->GetCellValue(cellRef).ToVariant();
 }
 
-bool CalculationEngine::ValuesConverged(
-    const std::vector<std::variant<double, std::string, bool>>& prev,
-    const std::vector<std::variant<double, std::string, bool>>& current) {
-    // Implement convergence check logic
-    // This is a simple example and may need to be more sophisticated in practice
-    if (prev.size() != current.size()) return false;
-
-    for (size_t i = 0; i < prev.size(); ++i) {
-        if (prev[i].index() != current[i].index()) return false;
-        if (std::holds_alternative<double>(prev[i])) {
-            if (std::abs(std::get<double>(prev[i]) - std::get<double>(current[i])) > 1e-6) return false;
-        } else if (prev[i] != current[i]) {
-            return false;
-        }
-    }
-    return true;
+void CalculationEngine::SetCellValueSource(std::shared_ptr<ExcelCalculationEngine::ICellValueSource> source) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cellValues->SetBase(std::move(source));
+    m_cache->ClearCache();
 }
\ No newline at end of file
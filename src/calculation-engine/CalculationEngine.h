@@ -5,53 +5,183 @@
 #include <string>
 #include <variant>
 #include <mutex>
-#include "Interfaces/IFormulaParser.h"
+#include <unordered_map>
+#include <vector>
+#include "Interfaces/GridReference.h"
 #include "Interfaces/IFunctionLibrary.h"
 #include "Interfaces/ICalculationChain.h"
+#include "Interfaces/ICellValueSource.h"
 #include "ErrorHandling/CalculationErrors.h"
-#include "FormulaParser/FormulaParser.h"
+#include "FormulaParser/FormulaProgram.h"
 #include "CalculationChain/CalculationChain.h"
-#include "ArrayFormulas/ArrayFormulaHandler.h"
-#include "DynamicArrays/DynamicArrayHandler.h"
 #include "Optimization/CalculationOptimizer.h"
 #include "Caching/FormulaCache.h"
+#include "Caching/FormulaProgramCache.h"
+#include "Evaluation/CellValueStore.h"
+#include "Evaluation/IterativeCalculation.h"
 #include "Multithreading/ParallelCalculation.h"
+#include "../core-engine/Interfaces/ICalculationEngine.h"
 
 namespace Microsoft::Excel::CalculationEngine {
 
-class CalculationEngine {
+using ExcelCalculationEngine::CellReference;
+using ExcelCalculationEngine::FormulaBinding;
+using ExcelCalculationEngine::RangeReference;
+using CalculationChain = ::Excel::CalculationEngine::CalculationChain;
+using ExcelCalculationEngine::FormulaCache;
+using ExcelCalculationEngine::FormulaProgramCache;
+using ExcelCalculationEngine::IterationSettings;
+using ExcelCalculationEngine::ParallelCalculation;
+
+/**
+ * @brief One cell write for CalculationEngine::ApplyUpdates().
+ */
+struct CellUpdate {
+    CellReference cell;
+    std::variant<double, std::string, bool> value;
+};
+
+class CalculationEngine : public ICalculationEngine {
 public:
-    // Constructor
-    CalculationEngine(std::shared_ptr<IFormulaParser> parser,
-                      std::shared_ptr<IFunctionLibrary> library,
-                      std::shared_ptr<ICalculationChain> chain);
+    /**
+     * @brief Constructor. The engine recalculates the chain's cells through its
+     * compiled programs (see CalculationChain::SetCellCalculator()) until it is destroyed.
+     */
+    CalculationEngine(std::shared_ptr<IFunctionLibrary> library,
+                      std::shared_ptr<CalculationChain> chain);
 
     // Destructor
-    ~CalculationEngine() = default;
+    ~CalculationEngine();
 
     // Deleted copy constructor and assignment operator
     CalculationEngine(const CalculationEngine&) = delete;
     CalculationEngine& operator=(const CalculationEngine&) = delete;
 
-    // Calculate the result of a given formula for a specific cell
+    /**
+     * @brief Evaluates a formula as if it were entered in @p cell, without storing it.
+     *
+     * Evaluated on every call: a formula outside the calculation chain has
+     * nothing that would invalidate a cached result.
+     */
     std::variant<double, std::string, bool> Calculate(const std::string& formula, const CellReference& cell);
 
-    // Update a cell's value and trigger recalculation of dependent cells
+    /**
+     * @brief Evaluates the formula stored in a cell through its compiled program.
+     *
+     * Never parses: the program was bound when the formula was set.
+     */
+    std::variant<double, std::string, bool> Calculate(const CellReference& cell);
+
+    /**
+     * @brief Stores a formula for a cell, compiling its R1C1 shape only if no other cell shares it.
+     *
+     * The cell joins the calculation chain with the ranges it reads as
+     * precedents and is calculated by the next recalculation. A formula that
+     * calls NOW, TODAY or RAND makes the cell volatile, so every recalculation runs it.
+     * A formula that closes a loop is kept too; recalculation iterates the
+     * loop within the iteration settings (see SetIterationSettings()).
+     */
+    void SetCellFormula(const CellReference& cell, const std::string& formula);
+
+    /**
+     * @brief Stores many formulas at once, e.g. when a workbook opens.
+     *
+     * The chain links them without a cycle check per reference and orders
+     * them in one pass at the end (see CalculationChain::BeginBulkLoad()).
+     * Each is calculated by the next recalculation. Loops among them are
+     * kept, and later edits are checked for new loops by a full search.
+     * @throws if a formula does not compile; nothing is stored then.
+     */
+    void LoadFormulas(const std::vector<std::pair<CellReference, std::string>>& formulas);
+
+    // Remove the formula stored for a cell
+    void ClearCellFormula(const CellReference& cell);
+
+    // Number of distinct compiled formula shapes
+    std::size_t GetFormulaShapeCount() const;
+
+    /**
+     * @brief Writes a cell's value and recalculates what reads it through the
+     * calculation chain, which stops wherever a recalculated value comes out unchanged.
+     */
     void UpdateCell(const CellReference& cell, const std::variant<double, std::string, bool>& value);
 
+    /**
+     * @brief Writes every value, then recalculates once.
+     *
+     * Repeated writes to a cell keep the last value. The written cells are
+     * invalidated in the calculation chain together and recalculated in one
+     * RecalculateChain(), so each dependent runs at most once, in calculation
+     * order. A burst of ticks therefore costs one cascade instead of one per tick.
+     */
+    void ApplyUpdates(const std::vector<CellUpdate>& updates);
+
+    // ICalculationEngine, for the core engine: references are A1 text such as
+    // "B2" or "Sheet2!B2", and values are text as typed ("12.5", "TRUE", "abc")
+    double CalculateFormula(const std::string& formula, const std::unordered_map<std::string, double>& variables) override;
+    void UpdateCell(const std::string& cellReference, const std::string& newValue) override;
+
+    /**
+     * @brief Writes the whole batch inside BeginBatch()/CommitBatch(), so the
+     * dependents are recalculated in one ApplyUpdates() rather than once per cell.
+     * @throws std::invalid_argument before anything is written if a reference does not parse.
+     */
+    void UpdateCells(const std::vector<std::pair<std::string, std::string>>& updates) override;
+
+    void RecalculateWorksheet() override;
+    double GetCellValue(const std::string& cellReference) override;
+
+    /**
+     * @brief Holds back UpdateCell() calls until the matching CommitBatch(),
+     * which applies them with ApplyUpdates(). Batches nest; only the outermost commit applies.
+     */
+    void BeginBatch();
+
+    void CommitBatch();
+
     // Recalculate all formulas in the workbook
     void RecalculateAll();
 
+    /**
+     * @brief Calculates cells that read each other in loops by iteration, within the
+     * workbook's iteration settings (see IterativeCalculation), then recalculates
+     * the formulas outside the loops that read them.
+     * @throws CalculationError if a loop has not converged after the maximum number
+     * of iterations; nothing is written then.
+     */
+    void HandleCircularReference(const std::vector<CellReference>& circularCells);
+
+    /**
+     * @brief The workbook's maximum iterations and maximum change for circular references.
+     * @throws std::invalid_argument if fewer than one iteration or a negative change is asked for.
+     */
+    void SetIterationSettings(const IterationSettings& settings);
+
+    IterationSettings GetIterationSettings() const;
+
+    /**
+     * @brief Attaches the grid that compiled formulas read referenced cells from.
+     * Values the engine writes itself are read first; without a grid there is
+     * only Sheet1, holding just those values.
+     */
+    void SetCellValueSource(std::shared_ptr<ExcelCalculationEngine::ICellValueSource> source);
+
 private:
-    std::shared_ptr<IFormulaParser> m_formulaParser;
     std::shared_ptr<IFunctionLibrary> m_functionLibrary;
-    std::shared_ptr<ICalculationChain> m_calculationChain;
-    std::unique_ptr<ArrayFormulaHandler> m_arrayFormulaHandler;
-    std::unique_ptr<DynamicArrayHandler> m_dynamicArrayHandler;
+    std::shared_ptr<CalculationChain> m_calculationChain;
+    std::unique_ptr<FormulaCache> m_cache;
     std::unique_ptr<CalculationOptimizer> m_calculationOptimizer;
-    std::unique_ptr<FormulaCache> m_formulaCache;
     std::unique_ptr<ParallelCalculation> m_parallelCalculation;
-    std::mutex m_mutex;
+    std::unique_ptr<FormulaProgramCache> m_programCache;
+    std::unordered_map<CellReference, FormulaBinding> m_formulas;
+    std::shared_ptr<ExcelCalculationEngine::CellValueStore> m_cellValues; ///< What formulas read; see SetCellValueSource().
+    mutable std::mutex m_mutex;
+    IterationSettings m_iterationSettings;  ///< Guarded by m_mutex.
+    int m_batchDepth = 0;                   ///< Guarded by m_mutex.
+    std::vector<CellUpdate> m_batchUpdates; ///< Guarded by m_mutex.
+    std::mutex m_chainMutex;                ///< Serializes use of m_calculationChain; taken before m_mutex.
+    std::unordered_map<CellReference, std::shared_ptr<Cell>> m_chainCells; ///< Formula cells in the chain. Guarded by m_chainMutex.
+    std::unordered_map<const Cell*, CellReference> m_chainPositions;      ///< Guarded by m_chainMutex.
 
     // Helper methods
     void InitializeComponents();
@@ -59,6 +189,37 @@ private:
     void HandleCalculationErrors(const CalculationError& error);
     void OptimizeCalculation();
     void UpdateDependentCells(const CellReference& cell);
+    std::variant<double, std::string, bool> EvaluateProgram(const FormulaBinding& binding);
+    std::vector<RangeReference> ResolvePrecedents(const FormulaBinding& binding) const;
+
+    /**
+     * @brief The cell's node in the chain, added at its position on first use. Needs m_chainMutex.
+     */
+    std::shared_ptr<Cell> AcquireChainCell(const CellReference& cell);
+
+    // Takes the cell's node out of the chain, if it has one. Needs m_chainMutex.
+    void RemoveChainCell(const CellReference& cell);
+    CellReference ParseCellReference(const std::string& text) const;
+    std::variant<double, std::string, bool> GetCellValue(const CellReference& cell);
+    void UpdateCellValue(const CellReference& cell, const std::variant<double, std::string, bool>& value);
+
+    /**
+     * @brief The chain's CellCalculator: runs the cell's program, bypassing the
+     * cache, and stores the result on the cell and in the cache. The references
+     * OFFSET and INDIRECT resolved become the cell's dynamic dependencies.
+     * Called inside RecalculateChain(), so m_chainMutex is already held.
+     */
+    void RecalculateChainCell(Cell& cell);
+
+    /**
+     * @brief The chain's LoopCalculator: iterates the loop's programs together
+     * (see IterativeCalculation) and stores each result as RecalculateChainCell() does.
+     * Called inside RecalculateChain(), so m_chainMutex is already held.
+     */
+    void RecalculateChainLoop(const std::vector<Cell*>& cells);
+
+    // Writes a formula's result to the cache, the values formulas read and its chain cell if given
+    void StoreResult(const FormulaBinding& binding, const std::variant<double, std::string, bool>& value, Cell* cell);
 };
 
 } // namespace Microsoft::Excel::CalculationEngine
@@ -0,0 +1,52 @@
+#include "CellValueStore.h"
+#include <mutex>
+#include <utility>
+
+namespace ExcelCalculationEngine {
+
+CellValueStore::CellValueStore(std::shared_ptr<const ICellValueSource> base) : m_base(std::move(base)) {}
+
+void CellValueStore::SetBase(std::shared_ptr<const ICellValueSource> base) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_base = std::move(base);
+}
+
+void CellValueStore::Set(const CellReference& cell, FormulaValue value) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_values[cell] = std::move(value);
+}
+
+FormulaValue CellValueStore::GetCellValue(const CellReference& cell) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_values.find(cell);
+    if (it != m_values.end()) {
+        return it->second;
+    }
+    return m_base ? m_base->GetCellValue(cell) : FormulaValue();
+}
+
+bool CellValueStore::TryGetNumber(const CellReference& cell, double& number) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    auto it = m_values.find(cell);
+    if (it == m_values.end()) {
+        return m_base && m_base->TryGetNumber(cell, number);
+    }
+    if (!it->second.IsNumber()) {
+        return false;
+    }
+    number = it->second.GetNumber();
+    return true;
+}
+
+std::optional<std::uint32_t> CellValueStore::FindSheet(const std::string& name) const {
+    std::shared_lock<std::shared_mutex> lock(m_mutex);
+    if (m_base) {
+        return m_base->FindSheet(name);
+    }
+    if (name == "Sheet1") {
+        return 0u;
+    }
+    return std::nullopt;
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,48 @@
+#ifndef CELL_VALUE_STORE_H
+#define CELL_VALUE_STORE_H
+
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "FormulaValue.h"
+#include "../Interfaces/ICellValueSource.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class CellValueStore
+ * @brief The values the calculation engine has written, over an optional base source.
+ *
+ * Formula results and typed-in values land here, so later formulas read
+ * them; cells never written fall through to the base, which is usually the
+ * workbook model. Without a base there is a single sheet, Sheet1, and
+ * unwritten cells are empty.
+ *
+ * Reads take a shared lock, so recalculation threads only wait on writers.
+ */
+class CellValueStore : public ICellValueSource {
+public:
+    explicit CellValueStore(std::shared_ptr<const ICellValueSource> base = nullptr);
+
+    /**
+     * @brief Replaces the source of unwritten cells and sheet names.
+     */
+    void SetBase(std::shared_ptr<const ICellValueSource> base);
+
+    void Set(const CellReference& cell, FormulaValue value);
+
+    FormulaValue GetCellValue(const CellReference& cell) const override;
+    bool TryGetNumber(const CellReference& cell, double& number) const override;
+    std::optional<std::uint32_t> FindSheet(const std::string& name) const override;
+
+private:
+    mutable std::shared_mutex m_mutex;
+    std::shared_ptr<const ICellValueSource> m_base;
+    std::unordered_map<CellReference, FormulaValue> m_values;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // CELL_VALUE_STORE_H
@@ -0,0 +1,547 @@
+#include "FormulaVM.h"
+#include "../FormulaParser/FormulaCompiler.h"
+#include "../FunctionLibrary/FunctionRegistry.h"
+#include <algorithm>
+#include <cmath>
+#include <exception>
+
+// GCC and Clang support labels as values, which lets every handler jump
+// straight to the next one instead of going back through a single switch.
+#if !defined(EXCEL_VM_COMPUTED_GOTO)
+#if defined(__GNUC__) || defined(__clang__)
+#define EXCEL_VM_COMPUTED_GOTO 1
+#else
+#define EXCEL_VM_COMPUTED_GOTO 0
+#endif
+#endif
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+bool FindSheet(const FormulaProgram& program, const ReferenceOperand& reference, const ICellValueSource& cells,
+               std::uint32_t& sheet) {
+    const auto found = cells.FindSheet(program.GetString(static_cast<std::uint32_t>(reference.sheetName)));
+    if (found) {
+        sheet = *found;
+    }
+    return found.has_value();
+}
+
+// Resolves a compiled reference for one anchor; false means #REF!. Small
+// enough to inline into the load handlers; only sheet names go out of line.
+inline bool Resolve(const FormulaProgram& program, const ReferenceOperand& reference, const CellReference& anchor,
+                    const ICellValueSource& cells, RangeReference& range) {
+    const CellReference first = reference.first.Resolve(anchor);
+    const CellReference last = reference.last.Resolve(anchor);
+    range.sheet = anchor.sheet;
+    if (reference.sheetName >= 0 && !FindSheet(program, reference, cells, range.sheet)) {
+        return false;
+    }
+    range.firstRow = std::min(first.row, last.row);
+    range.lastRow = std::max(first.row, last.row);
+    range.firstColumn = std::min(first.column, last.column);
+    range.lastColumn = std::max(first.column, last.column);
+    return range.firstRow >= 0 && range.firstColumn >= 0 && range.lastRow < MAX_ROWS &&
+           range.lastColumn < MAX_COLUMNS;
+}
+
+// Resolve() for LoadCell, whose operand is always a single cell: one corner, nothing to normalize.
+inline bool ResolveCell(const FormulaProgram& program, const ReferenceOperand& reference, const CellReference& anchor,
+                        const ICellValueSource& cells, CellReference& cell) {
+    cell = reference.first.Resolve(anchor);
+    if (reference.sheetName >= 0 && !FindSheet(program, reference, cells, cell.sheet)) {
+        return false;
+    }
+    return cell.row >= 0 && cell.column >= 0 && cell.row < MAX_ROWS && cell.column < MAX_COLUMNS;
+}
+
+} // namespace
+
+FormulaVM& FormulaVM::ForCurrentThread() {
+    thread_local FormulaVM vm;
+    return vm;
+}
+
+FormulaVM::Slot FormulaVM::ToSlot(FormulaValue value) {
+    switch (value.GetType()) {
+        case ValueType::Number:
+            return NumberSlot(value.GetNumber());
+        case ValueType::Boolean:
+            return Slot{SlotKind::Boolean, FormulaError::Value, value.GetBoolean(), 0, 0.0};
+        case ValueType::Error:
+            return ErrorSlot(value.GetError());
+        case ValueType::Text:
+            m_texts.push_back(std::move(value));
+            return Slot{SlotKind::Text, FormulaError::Value, false, static_cast<std::uint32_t>(m_texts.size() - 1), 0.0};
+        case ValueType::Empty:
+            break;
+    }
+    return Slot{SlotKind::Empty, FormulaError::Value, false, 0, 0.0};
+}
+
+FormulaValue FormulaVM::ToValue(const Slot& slot) const {
+    switch (slot.kind) {
+        case SlotKind::Number: return FormulaValue::Number(slot.number);
+        case SlotKind::Boolean: return FormulaValue::Boolean(slot.boolean);
+        case SlotKind::Error: return FormulaValue::Error(slot.error);
+        case SlotKind::Text: return m_texts[slot.index];
+        case SlotKind::Range: {
+            if (IsArea(slot)) {
+                return FormulaValue::Error(FormulaError::Value);
+            }
+            const RangeReference& range = m_ranges[slot.index];
+            return m_cells->GetCellValue(CellReference{range.sheet, range.firstRow, range.firstColumn});
+        }
+        case SlotKind::Empty: break;
+    }
+    return FormulaValue();
+}
+
+bool FormulaVM::IsArea(const Slot& slot) const noexcept {
+    if (slot.kind != SlotKind::Range) {
+        return false;
+    }
+    const RangeReference& range = m_ranges[slot.index];
+    return range.GetRowCount() != 1 || range.GetColumnCount() != 1;
+}
+
+// A one-cell reference used as a value reads the cell; larger ranges are left for the caller to reject.
+void FormulaVM::Dereference(Slot& slot) {
+    if (slot.kind == SlotKind::Range && !IsArea(slot)) {
+        slot = ToSlot(ToValue(slot));
+    }
+}
+
+bool FormulaVM::ToNumber(const Slot& slot, double& number, FormulaError& error) const {
+    switch (slot.kind) {
+        case SlotKind::Number:
+            number = slot.number;
+            return true;
+        case SlotKind::Text:
+            return CoerceToNumber(m_texts[slot.index], number, error);
+        default:
+            return CoerceToNumber(ToValue(slot), number, error);
+    }
+}
+
+std::string FormulaVM::ToText(const Slot& slot) const {
+    return slot.kind == SlotKind::Text ? m_texts[slot.index].GetText() : CoerceToText(ToValue(slot));
+}
+
+// Same ordering as CompareValues, without building values for two numbers.
+int FormulaVM::Compare(const Slot& left, const Slot& right) const {
+    if (left.kind == SlotKind::Number && right.kind == SlotKind::Number) {
+        return left.number < right.number ? -1 : (left.number > right.number ? 1 : 0);
+    }
+    return CompareValues(ToValue(left), ToValue(right));
+}
+
+// Operands that are not both numbers: coerce, or produce the first error.
+void FormulaVM::ArithmeticSlow(Slot& left, const Slot& right, Opcode op) const {
+    double a;
+    double b;
+    FormulaError error = FormulaError::Value;
+    if (!ToNumber(left, a, error) || !ToNumber(right, b, error)) {
+        left = ErrorSlot(error);
+        return;
+    }
+    left = NumberSlot(a);
+    switch (op) {
+        case Opcode::Add: left.number = a + b; break;
+        case Opcode::Subtract: left.number = a - b; break;
+        case Opcode::Multiply: left.number = a * b; break;
+        case Opcode::Divide:
+            if (b == 0.0) {
+                left = ErrorSlot(FormulaError::DivideByZero);
+                return;
+            }
+            left.number = a / b;
+            break;
+        default:
+            if (a == 0.0 && b == 0.0) {
+                left = ErrorSlot(FormulaError::Number);
+                return;
+            }
+            left.number = std::pow(a, b);
+            break;
+    }
+    if (!std::isfinite(left.number)) {
+        left = ErrorSlot(FormulaError::Number);
+    }
+}
+
+void FormulaVM::Comparison(Slot& left, Slot right, Opcode op) {
+    Dereference(left);
+    Dereference(right);
+    if (left.kind == SlotKind::Error || right.kind == SlotKind::Error) {
+        left = ErrorSlot(left.kind == SlotKind::Error ? left.error : right.error);
+        return;
+    }
+    if (left.kind == SlotKind::Range || right.kind == SlotKind::Range) {
+        left = ErrorSlot(FormulaError::Value);
+        return;
+    }
+    const int order = Compare(left, right);
+    bool result = false;
+    switch (op) {
+        case Opcode::Equal: result = order == 0; break;
+        case Opcode::NotEqual: result = order != 0; break;
+        case Opcode::Less: result = order < 0; break;
+        case Opcode::LessEqual: result = order <= 0; break;
+        case Opcode::Greater: result = order > 0; break;
+        default: result = order >= 0; break;
+    }
+    left = Slot{SlotKind::Boolean, FormulaError::Value, result, 0, 0.0};
+}
+
+FormulaValue FormulaVM::Execute(const FormulaProgram& program, const CellReference& anchor,
+                                const ICellValueSource& cells, IFunctionLibrary* functions) {
+    const std::size_t depth = static_cast<std::size_t>(program.GetMaxStackDepth()) + 1;
+    if (m_stack.size() < depth) {
+        m_stack.resize(depth);
+    }
+    m_texts.clear();
+    m_ranges.clear();
+    m_dynamicReferences.clear();
+    m_cells = &cells;
+
+    Slot* sp = m_stack.data(); // one past the top of the stack
+    const Instruction* pc = program.GetCode().data();
+    const Instruction* ip = pc;
+
+// Both-number arithmetic stays inline; everything else goes to ArithmeticSlow.
+#define VM_ARITHMETIC(opcode, expression)                                   \
+    do {                                                                    \
+        --sp;                                                               \
+        Slot& left = sp[-1];                                                \
+        if (left.kind == SlotKind::Number && sp->kind == SlotKind::Number) { \
+            const double a = left.number;                                   \
+            const double b = sp->number;                                    \
+            left.number = (expression);                                     \
+        } else {                                                            \
+            ArithmeticSlow(left, *sp, opcode);                              \
+        }                                                                   \
+    } while (0)
+
+#if EXCEL_VM_COMPUTED_GOTO
+    // Must list every Opcode in declaration order.
+    static const void* const DISPATCH[] = {
+        &&op_PushConstant, &&op_LoadCell, &&op_LoadRange, &&op_Negate, &&op_Percent,
+        &&op_Add, &&op_Subtract, &&op_Multiply, &&op_Divide, &&op_Power, &&op_Concatenate,
+        &&op_Equal, &&op_NotEqual, &&op_Less, &&op_LessEqual, &&op_Greater, &&op_GreaterEqual,
+        &&op_CallFunction, &&op_CallExternal, &&op_Return
+    };
+    static_assert(sizeof(DISPATCH) / sizeof(DISPATCH[0]) == static_cast<std::size_t>(Opcode::Return) + 1,
+                  "Dispatch table out of sync with Opcode");
+#define VM_NEXT()                                         \
+    do {                                                  \
+        ip = pc++;                                        \
+        goto *DISPATCH[static_cast<std::size_t>(ip->op)]; \
+    } while (0)
+#define VM_CASE(name) case Opcode::name: op_##name
+    VM_NEXT();
+#else
+#define VM_NEXT() goto dispatch
+#define VM_CASE(name) case Opcode::name
+dispatch:
+    ip = pc++;
+#endif
+
+    switch (ip->op) {
+        VM_CASE(PushConstant): {
+            const FormulaValue& constant = program.GetConstant(ip->operand);
+            *sp++ = constant.IsNumber() ? NumberSlot(constant.GetNumber()) : ToSlot(constant);
+            VM_NEXT();
+        }
+        VM_CASE(LoadCell): {
+            CellReference position;
+            if (ResolveCell(program, program.GetReference(ip->operand), anchor, cells, position)) {
+                double number;
+                if (cells.TryGetNumber(position, number)) {
+                    *sp++ = NumberSlot(number);
+                } else {
+                    FormulaValue value = cells.GetCellValue(position);
+                    *sp++ = value.IsNumber() ? NumberSlot(value.GetNumber()) : ToSlot(std::move(value));
+                }
+            } else {
+                *sp++ = ErrorSlot(FormulaError::Reference);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(LoadRange): {
+            RangeReference range;
+            if (Resolve(program, program.GetReference(ip->operand), anchor, cells, range)) {
+                m_ranges.push_back(range);
+                *sp++ = Slot{SlotKind::Range, FormulaError::Value, false,
+                             static_cast<std::uint32_t>(m_ranges.size() - 1), 0.0};
+            } else {
+                *sp++ = ErrorSlot(FormulaError::Reference);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(Negate): {
+            Slot& top = sp[-1];
+            double number;
+            FormulaError error = FormulaError::Value;
+            top = ToNumber(top, number, error) ? NumberSlot(-number) : ErrorSlot(error);
+            VM_NEXT();
+        }
+        VM_CASE(Percent): {
+            Slot& top = sp[-1];
+            double number;
+            FormulaError error = FormulaError::Value;
+            top = ToNumber(top, number, error) ? NumberSlot(number / 100.0) : ErrorSlot(error);
+            VM_NEXT();
+        }
+        VM_CASE(Add): {
+            VM_ARITHMETIC(Opcode::Add, a + b);
+            if (!std::isfinite(sp[-1].number)) sp[-1] = ErrorSlot(FormulaError::Number);
+            VM_NEXT();
+        }
+        VM_CASE(Subtract): {
+            VM_ARITHMETIC(Opcode::Subtract, a - b);
+            if (!std::isfinite(sp[-1].number)) sp[-1] = ErrorSlot(FormulaError::Number);
+            VM_NEXT();
+        }
+        VM_CASE(Multiply): {
+            VM_ARITHMETIC(Opcode::Multiply, a * b);
+            if (!std::isfinite(sp[-1].number)) sp[-1] = ErrorSlot(FormulaError::Number);
+            VM_NEXT();
+        }
+        VM_CASE(Divide): {
+            // A zero divisor is left to ArithmeticSlow so it becomes #DIV/0!.
+            --sp;
+            Slot& left = sp[-1];
+            if (left.kind == SlotKind::Number && sp->kind == SlotKind::Number && sp->number != 0.0) {
+                left.number /= sp->number;
+                if (!std::isfinite(left.number)) left = ErrorSlot(FormulaError::Number);
+            } else {
+                ArithmeticSlow(left, *sp, Opcode::Divide);
+            }
+            VM_NEXT();
+        }
+        VM_CASE(Power): {
+            --sp;
+            ArithmeticSlow(sp[-1], *sp, Opcode::Power);
+            VM_NEXT();
+        }
+        VM_CASE(Concatenate): {
+            --sp;
+            Slot& left = sp[-1];
+            Dereference(left);
+            Dereference(*sp);
+            if (left.kind == SlotKind::Error || sp->kind == SlotKind::Error) {
+                left = ErrorSlot(left.kind == SlotKind::Error ? left.error : sp->error);
+            } else if (left.kind == SlotKind::Range || sp->kind == SlotKind::Range) {
+                left = ErrorSlot(FormulaError::Value);
+            } else {
+                left = ToSlot(FormulaValue::Text(ToText(left) + ToText(*sp)));
+            }
+            VM_NEXT();
+        }
+        VM_CASE(Equal): {
+            --sp;
+            Comparison(sp[-1], *sp, Opcode::Equal);
+            VM_NEXT();
+        }
+        VM_CASE(NotEqual): {
+            --sp;
+            Comparison(sp[-1], *sp, Opcode::NotEqual);
+            VM_NEXT();
+        }
+        VM_CASE(Less): {
+            --sp;
+            Comparison(sp[-1], *sp, Opcode::Less);
+            VM_NEXT();
+        }
+        VM_CASE(LessEqual): {
+            --sp;
+            Comparison(sp[-1], *sp, Opcode::LessEqual);
+            VM_NEXT();
+        }
+        VM_CASE(Greater): {
+            --sp;
+            Comparison(sp[-1], *sp, Opcode::Greater);
+            VM_NEXT();
+        }
+        VM_CASE(GreaterEqual): {
+            --sp;
+            Comparison(sp[-1], *sp, Opcode::GreaterEqual);
+            VM_NEXT();
+        }
+        VM_CASE(CallFunction): {
+            sp -= ip->argumentCount;
+            *sp = CallFunction(*ip, sp, anchor, cells);
+            ++sp;
+            VM_NEXT();
+        }
+        VM_CASE(CallExternal): {
+            sp -= ip->argumentCount;
+            *sp = CallExternal(program, *ip, sp, cells, functions);
+            ++sp;
+            VM_NEXT();
+        }
+        VM_CASE(Return): {
+            break;
+        }
+    }
+
+#undef VM_ARITHMETIC
+#undef VM_NEXT
+#undef VM_CASE
+
+    // A bare single-cell range such as =A1:A1 yields that cell; anything larger needs a function.
+    return ToValue(sp[-1]);
+}
+
+FormulaVM::Slot FormulaVM::CallFunction(const Instruction& instruction, const Slot* arguments,
+                                        const CellReference& anchor, const ICellValueSource& cells) {
+    const FunctionInfo& function = FunctionRegistry::Get(static_cast<FunctionId>(instruction.operand));
+    if (function.ReturnsReference()) {
+        return CallReferenceFunction(instruction, arguments, anchor, cells);
+    }
+    const bool acceptsErrors = function.AcceptsErrors();
+
+    // Ranges are handed over as bounds; the function reads only what it needs.
+    m_functionArguments.resize(instruction.argumentCount);
+    for (std::uint32_t i = 0; i < instruction.argumentCount; ++i) {
+        const Slot& argument = arguments[i];
+        if (argument.kind == SlotKind::Error && !acceptsErrors) {
+            return argument;
+        }
+        FunctionArgument& target = m_functionArguments[i];
+        target.isRange = argument.kind == SlotKind::Range;
+        if (target.isRange) {
+            target.range = m_ranges[argument.index];
+            target.value = FormulaValue();
+        } else {
+            target.value = ToValue(argument);
+        }
+    }
+    return ToSlot(function.implementation(
+        FunctionArguments(m_functionArguments.data(), instruction.argumentCount, cells)));
+}
+
+FormulaVM::Slot FormulaVM::CallReferenceFunction(const Instruction& instruction, const Slot* arguments,
+                                                 const CellReference& anchor, const ICellValueSource& cells) {
+    for (std::uint32_t i = 0; i < instruction.argumentCount; ++i) {
+        if (arguments[i].kind == SlotKind::Error) {
+            return arguments[i];
+        }
+    }
+    RangeReference range;
+    FormulaError error = FormulaError::Reference;
+    const bool resolved = static_cast<FunctionId>(instruction.operand) == FunctionId::Offset
+        ? Offset(arguments, instruction.argumentCount, range, error)
+        : Indirect(arguments, instruction.argumentCount, anchor, cells, range, error);
+    if (!resolved) {
+        return ErrorSlot(error);
+    }
+    // Recorded so the calculation chain can add the edge the compiler could not see.
+    m_dynamicReferences.push_back(range);
+    m_ranges.push_back(range);
+    return Slot{SlotKind::Range, FormulaError::Value, false, static_cast<std::uint32_t>(m_ranges.size() - 1), 0.0};
+}
+
+// OFFSET(reference, rows, columns, [height], [width]); height and width default to the reference's.
+bool FormulaVM::Offset(const Slot* arguments, std::uint32_t count, RangeReference& range, FormulaError& error) const {
+    if (arguments[0].kind != SlotKind::Range) {
+        error = FormulaError::Value;
+        return false;
+    }
+    const RangeReference& base = m_ranges[arguments[0].index];
+    double shape[4] = {0.0, 0.0, static_cast<double>(base.GetRowCount()), static_cast<double>(base.GetColumnCount())};
+    for (std::uint32_t i = 1; i < count; ++i) {
+        if (!ToNumber(arguments[i], shape[i - 1], error)) {
+            return false;
+        }
+        shape[i - 1] = std::trunc(shape[i - 1]);
+    }
+    const double firstRow = base.firstRow + shape[0];
+    const double firstColumn = base.firstColumn + shape[1];
+    const double lastRow = firstRow + shape[2] - 1.0;
+    const double lastColumn = firstColumn + shape[3] - 1.0;
+    if (shape[2] < 1.0 || shape[3] < 1.0 || firstRow < 0.0 || firstColumn < 0.0 || lastRow >= MAX_ROWS ||
+        lastColumn >= MAX_COLUMNS) {
+        error = FormulaError::Reference;
+        return false;
+    }
+    range = RangeReference{base.sheet, static_cast<std::int32_t>(firstRow), static_cast<std::int32_t>(firstColumn),
+                           static_cast<std::int32_t>(lastRow), static_cast<std::int32_t>(lastColumn)};
+    return true;
+}
+
+// INDIRECT(text, [a1]). Only A1-style text is understood; R1C1 text (a1 = FALSE) is #REF!.
+bool FormulaVM::Indirect(const Slot* arguments, std::uint32_t count, const CellReference& anchor,
+                         const ICellValueSource& cells, RangeReference& range, FormulaError& error) const {
+    double a1 = 1.0;
+    if (count > 1 && !ToNumber(arguments[1], a1, error)) {
+        return false;
+    }
+    std::string sheetName;
+    ReferenceOperand reference;
+    error = FormulaError::Reference;
+    if (a1 == 0.0 || !FormulaCompiler::ParseReference(ToText(arguments[0]), sheetName, reference)) {
+        return false;
+    }
+    range.sheet = anchor.sheet;
+    if (!sheetName.empty()) {
+        const auto sheet = cells.FindSheet(sheetName);
+        if (!sheet) {
+            return false;
+        }
+        range.sheet = *sheet;
+    }
+    range.firstRow = std::min(reference.first.row, reference.last.row);
+    range.lastRow = std::max(reference.first.row, reference.last.row);
+    range.firstColumn = std::min(reference.first.column, reference.last.column);
+    range.lastColumn = std::max(reference.first.column, reference.last.column);
+    return true;
+}
+
+FormulaVM::Slot FormulaVM::CallExternal(const FormulaProgram& program, const Instruction& instruction,
+                                        const Slot* arguments, const ICellValueSource& cells,
+                                        IFunctionLibrary* functions) {
+    const std::string& name = program.GetString(instruction.operand);
+    if (!functions || !functions->IsFunctionSupported(name)) {
+        return ErrorSlot(FormulaError::Name);
+    }
+
+    // IFunctionLibrary takes flat variants, so ranges are expanded here and
+    // any error argument short-circuits the call.
+    m_arguments.clear();
+    for (std::uint32_t i = 0; i < instruction.argumentCount; ++i) {
+        const Slot& argument = arguments[i];
+        if (argument.kind == SlotKind::Error) {
+            return argument;
+        }
+        if (argument.kind != SlotKind::Range) {
+            if (argument.kind != SlotKind::Empty) {
+                m_arguments.push_back(ToValue(argument).ToVariant());
+            }
+            continue;
+        }
+        FormulaError error = FormulaError::Value;
+        const bool complete = ForEachCell(cells, m_ranges[argument.index],
+            [this, &error](std::int32_t, std::int32_t, const FormulaValue& value) {
+                if (value.IsError()) {
+                    error = value.GetError();
+                    return false;
+                }
+                m_arguments.push_back(value.ToVariant());
+                return true;
+            });
+        if (!complete) {
+            return ErrorSlot(error);
+        }
+    }
+
+    try {
+        return ToSlot(FormulaValue::FromVariant(functions->ExecuteFunction(name, m_arguments)));
+    } catch (const std::exception&) {
+        return ErrorSlot(FormulaError::Value);
+    }
+}
+
+} // namespace ExcelCalculationEngine
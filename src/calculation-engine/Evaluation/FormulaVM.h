@@ -0,0 +1,102 @@
+#ifndef FORMULA_VM_H
+#define FORMULA_VM_H
+
+#include <string>
+#include <variant>
+#include <vector>
+#include "FormulaValue.h"
+#include "../FormulaParser/FormulaProgram.h"
+#include "../Interfaces/ICellValueSource.h"
+#include "../Interfaces/IFunctionLibrary.h"
+#include "../FunctionLibrary/FunctionArguments.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class FormulaVM
+ * @brief Stack interpreter for FormulaProgram bytecode.
+ *
+ * The value stack holds 16-byte trivially copyable slots; text and range
+ * payloads live in side tables that are cleared per run. Both are kept
+ * between runs, so steady-state evaluation of arithmetic formulas does not
+ * allocate. A VM is not thread-safe; use one per thread (see ForCurrentThread()).
+ *
+ * Errors such as #DIV/0! or #REF! are ordinary FormulaValues that propagate
+ * through operators and function calls; Execute() does not throw for them.
+ *
+ * OFFSET and INDIRECT produce references while running. A one-cell
+ * reference used as a value reads that cell, as in Excel.
+ */
+class FormulaVM {
+public:
+    FormulaVM() = default;
+    FormulaVM(const FormulaVM&) = delete;
+    FormulaVM& operator=(const FormulaVM&) = delete;
+
+    /**
+     * @brief Runs a program for one cell.
+     * @param program Compiled, shared program.
+     * @param anchor The cell being evaluated; relative references resolve against it.
+     * @param cells Source of referenced cell values.
+     * @param functions Library for functions the registry does not know; such calls evaluate to #NAME? when null.
+     */
+    FormulaValue Execute(const FormulaProgram& program, const CellReference& anchor,
+                         const ICellValueSource& cells, IFunctionLibrary* functions);
+
+    /**
+     * @brief The calling thread's VM.
+     */
+    static FormulaVM& ForCurrentThread();
+
+    /**
+     * @brief The references OFFSET and INDIRECT resolved during the last Execute(),
+     * in evaluation order and possibly repeated. These are the precedents the
+     * program's own reference list cannot show; see CalculationChain::SetDynamicDependencies().
+     */
+    const std::vector<RangeReference>& GetDynamicReferences() const noexcept { return m_dynamicReferences; }
+
+private:
+    enum class SlotKind : std::uint8_t { Empty, Number, Boolean, Text, Error, Range };
+
+    struct Slot {
+        SlotKind kind;
+        FormulaError error;
+        bool boolean;
+        std::uint32_t index; ///< Into m_texts for Text, m_ranges for Range.
+        double number;
+    };
+
+    static Slot NumberSlot(double number) noexcept { return Slot{SlotKind::Number, FormulaError::Value, false, 0, number}; }
+    static Slot ErrorSlot(FormulaError error) noexcept { return Slot{SlotKind::Error, error, false, 0, 0.0}; }
+
+    Slot ToSlot(FormulaValue value);
+    FormulaValue ToValue(const Slot& slot) const;
+    bool IsArea(const Slot& slot) const noexcept;
+    void Dereference(Slot& slot);
+    bool ToNumber(const Slot& slot, double& number, FormulaError& error) const;
+    std::string ToText(const Slot& slot) const;
+    int Compare(const Slot& left, const Slot& right) const;
+    void ArithmeticSlow(Slot& left, const Slot& right, Opcode op) const;
+    void Comparison(Slot& left, Slot right, Opcode op);
+    Slot CallFunction(const Instruction& instruction, const Slot* arguments, const CellReference& anchor,
+                      const ICellValueSource& cells);
+    Slot CallReferenceFunction(const Instruction& instruction, const Slot* arguments, const CellReference& anchor,
+                               const ICellValueSource& cells);
+    bool Offset(const Slot* arguments, std::uint32_t count, RangeReference& range, FormulaError& error) const;
+    bool Indirect(const Slot* arguments, std::uint32_t count, const CellReference& anchor,
+                  const ICellValueSource& cells, RangeReference& range, FormulaError& error) const;
+    Slot CallExternal(const FormulaProgram& program, const Instruction& instruction,
+                      const Slot* arguments, const ICellValueSource& cells, IFunctionLibrary* functions);
+
+    std::vector<Slot> m_stack;
+    std::vector<FormulaValue> m_texts;
+    std::vector<RangeReference> m_ranges;
+    std::vector<RangeReference> m_dynamicReferences;
+    const ICellValueSource* m_cells = nullptr; ///< Source of the current run, for one-cell references used as values.
+    std::vector<FunctionArgument> m_functionArguments;
+    std::vector<std::variant<double, std::string, bool>> m_arguments;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FORMULA_VM_H
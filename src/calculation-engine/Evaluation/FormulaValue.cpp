@@ -0,0 +1,181 @@
+#include "FormulaValue.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+struct ErrorName {
+    FormulaError error;
+    const char* text;
+};
+
+constexpr ErrorName ERROR_NAMES[] = {
+    {FormulaError::Null, "#NULL!"},
+    {FormulaError::DivideByZero, "#DIV/0!"},
+    {FormulaError::Value, "#VALUE!"},
+    {FormulaError::Reference, "#REF!"},
+    {FormulaError::Name, "#NAME?"},
+    {FormulaError::Number, "#NUM!"},
+    {FormulaError::NotAvailable, "#N/A"},
+    {FormulaError::GettingData, "#GETTING_DATA"},
+};
+
+} // namespace
+
+const char* GetErrorText(FormulaError error) noexcept {
+    for (const auto& name : ERROR_NAMES) {
+        if (name.error == error) {
+            return name.text;
+        }
+    }
+    return "#VALUE!";
+}
+
+std::optional<FormulaError> ParseErrorText(std::string_view text) noexcept {
+    if (text.empty() || text.front() != '#') {
+        return std::nullopt;
+    }
+    for (const auto& name : ERROR_NAMES) {
+        if (text == name.text) {
+            return name.error;
+        }
+    }
+    return std::nullopt;
+}
+
+const std::string& FormulaValue::GetText() const noexcept {
+    static const std::string EMPTY;
+    return m_text ? *m_text : EMPTY;
+}
+
+FormulaValue FormulaValue::FromVariant(const std::variant<double, std::string, bool>& value) {
+    if (const double* number = std::get_if<double>(&value)) {
+        return Number(*number);
+    }
+    if (const bool* flag = std::get_if<bool>(&value)) {
+        return Boolean(*flag);
+    }
+    const std::string& text = std::get<std::string>(value);
+    if (auto error = ParseErrorText(text)) {
+        return Error(*error);
+    }
+    return Text(text);
+}
+
+std::variant<double, std::string, bool> FormulaValue::ToVariant() const {
+    switch (m_type) {
+        case ValueType::Number: return m_number;
+        case ValueType::Boolean: return m_boolean;
+        case ValueType::Text: return GetText();
+        case ValueType::Error: return std::string(GetErrorText(m_error));
+        case ValueType::Empty: break;
+    }
+    return 0.0;
+}
+
+bool operator==(const FormulaValue& a, const FormulaValue& b) noexcept {
+    if (a.m_type != b.m_type) {
+        return false;
+    }
+    switch (a.m_type) {
+        case ValueType::Empty: return true;
+        case ValueType::Number: return a.m_number == b.m_number;
+        case ValueType::Boolean: return a.m_boolean == b.m_boolean;
+        case ValueType::Error: return a.m_error == b.m_error;
+        case ValueType::Text: return a.m_text == b.m_text || a.GetText() == b.GetText();
+    }
+    return false;
+}
+
+bool CoerceToNumber(const FormulaValue& value, double& number, FormulaError& error) noexcept {
+    switch (value.GetType()) {
+        case ValueType::Number:
+            number = value.GetNumber();
+            return true;
+        case ValueType::Boolean:
+            number = value.GetBoolean() ? 1.0 : 0.0;
+            return true;
+        case ValueType::Empty:
+            number = 0.0;
+            return true;
+        case ValueType::Error:
+            error = value.GetError();
+            return false;
+        case ValueType::Text: {
+            const std::string& text = value.GetText();
+            const char* begin = text.data();
+            const char* end = text.data() + text.size();
+            while (begin < end && std::isspace(static_cast<unsigned char>(*begin))) ++begin;
+            while (end > begin && std::isspace(static_cast<unsigned char>(end[-1]))) --end;
+            const auto result = std::from_chars(begin, end, number);
+            if (begin != end && result.ec == std::errc() && result.ptr == end) {
+                return true;
+            }
+            break;
+        }
+    }
+    error = FormulaError::Value;
+    return false;
+}
+
+std::string CoerceToText(const FormulaValue& value) {
+    switch (value.GetType()) {
+        case ValueType::Text:
+            return value.GetText();
+        case ValueType::Boolean:
+            return value.GetBoolean() ? "TRUE" : "FALSE";
+        case ValueType::Error:
+            return GetErrorText(value.GetError());
+        case ValueType::Number: {
+            char buffer[32];
+            const int length = std::snprintf(buffer, sizeof(buffer), "%.15g", value.GetNumber());
+            return std::string(buffer, static_cast<std::size_t>(std::max(length, 0)));
+        }
+        case ValueType::Empty:
+            break;
+    }
+    return std::string();
+}
+
+int CompareValues(const FormulaValue& left, const FormulaValue& right) noexcept {
+    auto rank = [](ValueType type) {
+        return type == ValueType::Text ? 1 : (type == ValueType::Boolean ? 2 : 0);
+    };
+    const ValueType leftType = left.IsEmpty() ? right.GetType() : left.GetType();
+    const ValueType rightType = right.IsEmpty() ? leftType : right.GetType();
+    if (leftType != rightType) {
+        return rank(leftType) < rank(rightType) ? -1 : 1;
+    }
+    switch (leftType) {
+        case ValueType::Text: {
+            // GetText() of an Empty value is "".
+            const std::string& a = left.GetText();
+            const std::string& b = right.GetText();
+            const std::size_t length = std::min(a.size(), b.size());
+            for (std::size_t i = 0; i < length; ++i) {
+                const int x = std::tolower(static_cast<unsigned char>(a[i]));
+                const int y = std::tolower(static_cast<unsigned char>(b[i]));
+                if (x != y) {
+                    return x < y ? -1 : 1;
+                }
+            }
+            return a.size() < b.size() ? -1 : (a.size() > b.size() ? 1 : 0);
+        }
+        case ValueType::Boolean:
+            return static_cast<int>(!left.IsEmpty() && left.GetBoolean()) -
+                   static_cast<int>(!right.IsEmpty() && right.GetBoolean());
+        case ValueType::Number: {
+            const double a = left.IsEmpty() ? 0.0 : left.GetNumber();
+            const double b = right.IsEmpty() ? 0.0 : right.GetNumber();
+            return a < b ? -1 : (a > b ? 1 : 0);
+        }
+        default:
+            return 0;
+    }
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,125 @@
+#ifndef FORMULA_VALUE_H
+#define FORMULA_VALUE_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace ExcelCalculationEngine {
+
+enum class ValueType : std::uint8_t {
+    Empty,
+    Number,
+    Boolean,
+    Text,
+    Error
+};
+
+/**
+ * @brief Excel error values. They are ordinary results, not exceptions.
+ */
+enum class FormulaError : std::uint8_t {
+    Null,         ///< #NULL!
+    DivideByZero, ///< #DIV/0!
+    Value,        ///< #VALUE!
+    Reference,    ///< #REF!
+    Name,         ///< #NAME?
+    Number,       ///< #NUM!
+    NotAvailable, ///< #N/A
+    GettingData   ///< #GETTING_DATA
+};
+
+const char* GetErrorText(FormulaError error) noexcept;
+std::optional<FormulaError> ParseErrorText(std::string_view text) noexcept;
+
+/**
+ * @class FormulaValue
+ * @brief Result of evaluating a formula or reading a cell.
+ *
+ * Numbers, booleans and errors live inline; text is shared and
+ * immutable so copying a value never copies characters. Operator== is exact
+ * (no tolerance) and is what decides whether a recalculated value changed.
+ */
+class FormulaValue {
+public:
+    FormulaValue() noexcept : m_type(ValueType::Empty), m_number(0.0) {}
+
+    static FormulaValue Number(double value) noexcept {
+        FormulaValue result(ValueType::Number);
+        result.m_number = value;
+        return result;
+    }
+    static FormulaValue Boolean(bool value) noexcept {
+        FormulaValue result(ValueType::Boolean);
+        result.m_boolean = value;
+        return result;
+    }
+    static FormulaValue Error(FormulaError error) noexcept {
+        FormulaValue result(ValueType::Error);
+        result.m_error = error;
+        return result;
+    }
+    static FormulaValue Text(std::string text) {
+        FormulaValue result(ValueType::Text);
+        result.m_text = std::make_shared<const std::string>(std::move(text));
+        return result;
+    }
+
+    ValueType GetType() const noexcept { return m_type; }
+    bool IsEmpty() const noexcept { return m_type == ValueType::Empty; }
+    bool IsNumber() const noexcept { return m_type == ValueType::Number; }
+    bool IsError() const noexcept { return m_type == ValueType::Error; }
+
+    double GetNumber() const noexcept { return m_number; }
+    bool GetBoolean() const noexcept { return m_boolean; }
+    FormulaError GetError() const noexcept { return m_error; }
+    const std::string& GetText() const noexcept;
+
+    /**
+     * @brief Conversions to and from the variant used by IFunctionLibrary and the public API.
+     *
+     * Errors convert to their display text ("#DIV/0!"); a string holding an
+     * error literal converts back to the error.
+     */
+    static FormulaValue FromVariant(const std::variant<double, std::string, bool>& value);
+    std::variant<double, std::string, bool> ToVariant() const;
+
+    friend bool operator==(const FormulaValue& a, const FormulaValue& b) noexcept;
+    friend bool operator!=(const FormulaValue& a, const FormulaValue& b) noexcept { return !(a == b); }
+
+private:
+    explicit FormulaValue(ValueType type) noexcept : m_type(type), m_number(0.0) {}
+
+    ValueType m_type;
+    union {
+        double m_number;
+        bool m_boolean;
+        FormulaError m_error;
+    };
+    std::shared_ptr<const std::string> m_text;
+};
+
+/**
+ * @brief Excel's implicit conversion to a number: empty is 0, booleans are 0 or 1,
+ * numeric text is parsed, and anything else fails with #VALUE! (or the value's own error).
+ */
+bool CoerceToNumber(const FormulaValue& value, double& number, FormulaError& error) noexcept;
+
+/**
+ * @brief Excel's implicit conversion to text; numbers use up to 15 significant digits.
+ */
+std::string CoerceToText(const FormulaValue& value);
+
+/**
+ * @brief Excel's sort order for comparisons and lookups: numbers < text < booleans,
+ * text compared case-insensitively. Empty compares as 0, "" or FALSE to match the other side.
+ * Errors are not ordered; callers handle them first.
+ */
+int CompareValues(const FormulaValue& left, const FormulaValue& right) noexcept;
+
+} // namespace ExcelCalculationEngine
+
+#endif // FORMULA_VALUE_H
@@ -0,0 +1,232 @@
+#include "IterativeCalculation.h"
+#include "FormulaVM.h"
+#include "../CalculationChain/DependencyGraph.h"
+#include "../CalculationChain/StronglyConnectedComponents.h"
+#include "../Multithreading/ParallelCalculation.h"
+#include "src/core-engine/Performance/Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+/**
+ * @brief The source, except that the cells being iterated read their latest value.
+ */
+class IterationValueSource : public ICellValueSource {
+public:
+    IterationValueSource(const ICellValueSource& base, const std::unordered_map<CellReference, std::uint32_t>& indices,
+                         const std::vector<FormulaValue>& values)
+        : m_base(base), m_indices(indices), m_values(values) {
+        for (const auto& entry : indices) {
+            m_columns.insert(ColumnKey(entry.first.sheet, entry.first.column));
+        }
+    }
+
+    FormulaValue GetCellValue(const CellReference& cell) const override {
+        auto it = m_indices.find(cell);
+        return it != m_indices.end() ? m_values[it->second] : m_base.GetCellValue(cell);
+    }
+
+    bool TryGetNumber(const CellReference& cell, double& number) const override {
+        auto it = m_indices.find(cell);
+        if (it == m_indices.end()) {
+            return m_base.TryGetNumber(cell, number);
+        }
+        const FormulaValue& value = m_values[it->second];
+        number = value.GetNumber();
+        return value.IsNumber();
+    }
+
+    std::optional<std::uint32_t> FindSheet(const std::string& name) const override { return m_base.FindSheet(name); }
+
+    bool NextColumnSegment(std::uint32_t sheet, std::int32_t column, std::int32_t row, std::int32_t lastRow,
+                           ColumnSegment& segment, FormulaValue& buffer) const override {
+        // Columns without an iterated cell keep the source's own blocks
+        if (m_columns.count(ColumnKey(sheet, column)) == 0) {
+            return m_base.NextColumnSegment(sheet, column, row, lastRow, segment, buffer);
+        }
+        return ICellValueSource::NextColumnSegment(sheet, column, row, lastRow, segment, buffer);
+    }
+
+private:
+    static std::uint64_t ColumnKey(std::uint32_t sheet, std::int32_t column) noexcept {
+        return (static_cast<std::uint64_t>(sheet) << 32) | static_cast<std::uint32_t>(column);
+    }
+
+    const ICellValueSource& m_base;
+    const std::unordered_map<CellReference, std::uint32_t>& m_indices;
+    const std::vector<FormulaValue>& m_values;
+    std::unordered_set<std::uint64_t> m_columns;
+};
+
+/**
+ * @brief Indices of the cells in the set that @p binding's formula reads, sorted and unique.
+ */
+std::vector<std::uint32_t> FindPrecedents(const FormulaBinding& binding, const std::vector<FormulaBinding>& cells,
+                                          const std::unordered_map<CellReference, std::uint32_t>& indices,
+                                          const ICellValueSource& source) {
+    std::vector<std::uint32_t> precedents;
+    const FormulaProgram& program = *binding.program;
+    if (program.HasDynamicReferences()) {
+        // OFFSET or INDIRECT could read any of them
+        for (std::uint32_t i = 0; i < cells.size(); ++i) {
+            precedents.push_back(i);
+        }
+        return precedents;
+    }
+    for (const ReferenceOperand& reference : program.GetReferences()) {
+        std::uint32_t sheet = binding.anchor.sheet;
+        if (reference.sheetName >= 0) {
+            const auto found = source.FindSheet(program.GetString(static_cast<std::uint32_t>(reference.sheetName)));
+            if (!found) {
+                continue;
+            }
+            sheet = *found;
+        }
+        const CellReference first = reference.first.Resolve(binding.anchor);
+        const CellReference last = reference.last.Resolve(binding.anchor);
+        const RangeReference range{sheet, std::min(first.row, last.row), std::min(first.column, last.column),
+                                   std::max(first.row, last.row), std::max(first.column, last.column)};
+        // Whichever is smaller: the cells of the range, or the cells of the set
+        if (range.GetRowCount() * range.GetColumnCount() <= static_cast<std::int64_t>(cells.size())) {
+            for (std::int32_t row = range.firstRow; row <= range.lastRow; ++row) {
+                for (std::int32_t column = range.firstColumn; column <= range.lastColumn; ++column) {
+                    auto it = indices.find(CellReference{sheet, row, column});
+                    if (it != indices.end()) {
+                        precedents.push_back(it->second);
+                    }
+                }
+            }
+        } else {
+            for (std::uint32_t i = 0; i < cells.size(); ++i) {
+                if (range.Contains(cells[i].anchor)) {
+                    precedents.push_back(i);
+                }
+            }
+        }
+    }
+    std::sort(precedents.begin(), precedents.end());
+    precedents.erase(std::unique(precedents.begin(), precedents.end()), precedents.end());
+    return precedents;
+}
+
+} // namespace
+
+IterativeCalculation::Result IterativeCalculation::Calculate(const std::vector<FormulaBinding>& cells,
+                                                             const ICellValueSource& source, IFunctionLibrary* functions,
+                                                             const IterationSettings& settings,
+                                                             ParallelCalculation* parallel) {
+    EXCEL_PROFILE_SCOPE("IterativeCalculation::Calculate");
+    Result result;
+    const std::size_t count = cells.size();
+    std::unordered_map<CellReference, std::uint32_t> indices;
+    indices.reserve(count);
+    result.values.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        indices.emplace(cells[i].anchor, i);
+        result.values.push_back(source.GetCellValue(cells[i].anchor));
+    }
+    std::vector<std::vector<std::uint32_t>> precedents(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        precedents[i] = FindPrecedents(cells[i], cells, indices, source);
+    }
+
+    // Components come out in calculation order: precedents first
+    std::vector<std::vector<std::uint32_t>> components;
+    std::vector<std::uint32_t> componentOf(count);
+    ForEachStronglyConnectedComponent<std::uint32_t>(
+        count, [](std::uint32_t) { return true; },
+        [&precedents](std::uint32_t cell, auto&& visit) {
+            for (std::uint32_t precedent : precedents[cell]) {
+                visit(precedent);
+            }
+        },
+        [&components, &componentOf](const std::uint32_t* first, const std::uint32_t* last) {
+            for (const std::uint32_t* cell = first; cell != last; ++cell) {
+                componentOf[*cell] = static_cast<std::uint32_t>(components.size());
+            }
+            components.emplace_back(first, last);
+        });
+
+    const IterationValueSource values(source, indices, result.values);
+    std::vector<int> iterations(components.size(), 0);
+    std::vector<std::uint8_t> converged(components.size(), 1);
+
+    // Each task writes only its own component's values, iterations and converged entries
+    auto calculateComponent = [&](std::uint32_t component) {
+        FormulaVM& vm = FormulaVM::ForCurrentThread();
+        const std::vector<std::uint32_t>& members = components[component];
+        const bool circular = members.size() > 1 ||
+            std::binary_search(precedents[members[0]].begin(), precedents[members[0]].end(), members[0]);
+        if (!circular) {
+            const FormulaBinding& binding = cells[members[0]];
+            result.values[members[0]] = vm.Execute(*binding.program, binding.anchor, values, functions);
+            return;
+        }
+        converged[component] = 0;
+        for (int iteration = 1; iteration <= settings.maxIterations; ++iteration) {
+            double largestChange = 0.0;
+            bool settled = true;
+            for (std::uint32_t member : members) {
+                const FormulaBinding& binding = cells[member];
+                FormulaValue next = vm.Execute(*binding.program, binding.anchor, values, functions);
+                FormulaValue& current = result.values[member];
+                if (next.IsNumber() && current.IsNumber()) {
+                    largestChange = std::max(largestChange, std::fabs(next.GetNumber() - current.GetNumber()));
+                } else {
+                    settled = settled && next == current;
+                }
+                // In place: the members after this one already see it
+                current = std::move(next);
+            }
+            iterations[component] = iteration;
+            if (settled && largestChange <= settings.maxChange) {
+                converged[component] = 1;
+                return;
+            }
+        }
+    };
+
+    if (parallel && components.size() > 1) {
+        // One node per component, linked to the components it reads
+        DependencyGraph graph;
+        std::vector<NodeId> nodes;
+        nodes.reserve(components.size());
+        for (std::size_t i = 0; i < components.size(); ++i) {
+            nodes.push_back(graph.AddNode());
+        }
+        graph.BeginBulkLoad();
+        std::vector<std::uint32_t> linkedFrom(components.size(), UINT32_MAX);
+        for (std::uint32_t component = 0; component < components.size(); ++component) {
+            for (std::uint32_t member : components[component]) {
+                for (std::uint32_t precedent : precedents[member]) {
+                    const std::uint32_t from = componentOf[precedent];
+                    if (from != component && linkedFrom[from] != component) {
+                        linkedFrom[from] = component;
+                        graph.AddDependency(nodes[component], nodes[from]);
+                    }
+                }
+            }
+        }
+        graph.EndBulkLoad();
+        // A fresh graph numbers its nodes from 0, so node i is component i
+        parallel->Recalculate(graph, nodes, [&calculateComponent](NodeId node) { calculateComponent(node); });
+    } else {
+        for (std::uint32_t component = 0; component < components.size(); ++component) {
+            calculateComponent(component);
+        }
+    }
+
+    for (std::size_t component = 0; component < components.size(); ++component) {
+        result.iterations = std::max(result.iterations, iterations[component]);
+        result.converged = result.converged && converged[component];
+    }
+    return result;
+}
+
+} // namespace ExcelCalculationEngine
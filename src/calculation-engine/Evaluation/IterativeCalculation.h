@@ -0,0 +1,57 @@
+#ifndef ITERATIVE_CALCULATION_H
+#define ITERATIVE_CALCULATION_H
+
+#include <vector>
+#include "FormulaValue.h"
+#include "../FormulaParser/FormulaProgram.h"
+#include "../Interfaces/ICellValueSource.h"
+#include "../Interfaces/IFunctionLibrary.h"
+
+namespace ExcelCalculationEngine {
+
+class ParallelCalculation;
+
+/**
+ * @struct IterationSettings
+ * @brief A workbook's iterative calculation options. The defaults are Excel's.
+ */
+struct IterationSettings {
+    int maxIterations = 100;
+    double maxChange = 0.001; ///< Iteration stops once no number moves by more than this.
+};
+
+/**
+ * @class IterativeCalculation
+ * @brief Calculates a set of formula cells that may read each other in loops.
+ *
+ * The cells are split into strongly connected components. A component that
+ * is a real loop is iterated on its own, Gauss-Seidel style: each cell's new
+ * value is visible to the cells after it in the same sweep, which usually
+ * converges in far fewer sweeps than recomputing everything from the
+ * previous sweep's values. Components run in calculation order, and ones
+ * that do not read each other run in parallel when given a ParallelCalculation.
+ *
+ * Programs are executed directly; nothing is parsed or looked up in a cache
+ * per iteration. Cells outside the set are read from the source as they are.
+ */
+class IterativeCalculation {
+public:
+    struct Result {
+        std::vector<FormulaValue> values; ///< Parallel to the cells passed in.
+        int iterations = 0;               ///< Sweeps of the slowest loop.
+        bool converged = true;            ///< False if some loop hit maxIterations first.
+    };
+
+    /**
+     * @brief Calculates every cell in @p cells, each identified by its binding's anchor.
+     * Iteration starts from the values @p source currently holds.
+     * @param parallel Runs independent components concurrently if not null.
+     */
+    static Result Calculate(const std::vector<FormulaBinding>& cells, const ICellValueSource& source,
+                            IFunctionLibrary* functions, const IterationSettings& settings,
+                            ParallelCalculation* parallel = nullptr);
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // ITERATIVE_CALCULATION_H
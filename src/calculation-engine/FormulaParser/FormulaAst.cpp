@@ -0,0 +1,62 @@
+#include "FormulaAst.h"
+#include <algorithm>
+#include <cstring>
+
+namespace ExcelCalculationEngine {
+
+FormulaArena::FormulaArena(std::size_t blockSize)
+    : m_blockSize(std::max<std::size_t>(blockSize, 256)) {}
+
+void* FormulaArena::Allocate(std::size_t size, std::size_t alignment) {
+    for (;;) {
+        if (m_current < m_blocks.size()) {
+            Block& block = m_blocks[m_current];
+            const std::size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+            if (start + size <= block.size) {
+                m_used = start + size;
+                return block.data.get() + start;
+            }
+            // Move on to a kept block, or past the last one
+            ++m_current;
+            m_used = 0;
+            continue;
+        }
+        // Blocks are allocated with new[], so their start is suitably aligned for any type here
+        const std::size_t blockSize = std::max(m_blockSize, size);
+        m_blocks.push_back(Block{std::unique_ptr<unsigned char[]>(new unsigned char[blockSize]), blockSize});
+        m_current = m_blocks.size() - 1;
+        m_used = 0;
+    }
+}
+
+std::string_view FormulaArena::CopyText(std::string_view text) {
+    if (text.empty()) {
+        return std::string_view();
+    }
+    char* copy = static_cast<char*>(Allocate(text.size(), 1));
+    std::memcpy(copy, text.data(), text.size());
+    return std::string_view(copy, text.size());
+}
+
+void FormulaArena::Rewind(const Mark& mark) noexcept {
+    m_current = mark.block;
+    m_used = mark.used;
+}
+
+std::size_t FormulaArena::GetBytesUsed() const noexcept {
+    std::size_t used = m_current < m_blocks.size() ? m_used : 0;
+    for (std::size_t i = 0; i < m_current && i < m_blocks.size(); ++i) {
+        used += m_blocks[i].size;
+    }
+    return used;
+}
+
+std::size_t FormulaArena::GetBytesReserved() const noexcept {
+    std::size_t reserved = 0;
+    for (const Block& block : m_blocks) {
+        reserved += block.size;
+    }
+    return reserved;
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,111 @@
+#ifndef FORMULA_AST_H
+#define FORMULA_AST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ExcelCalculationEngine {
+
+enum class FormulaNodeKind : std::uint8_t {
+    Number,
+    String,
+    Boolean,
+    Error,      ///< An error literal such as #N/A.
+    Reference,  ///< A cell reference, optionally sheet-qualified: B2, $A$1, 'My Sheet'!C3.
+    Name,       ///< Any other name: a defined name, or a column such as the A in A:A.
+    Missing,    ///< An omitted argument, as in IF(A1,,2).
+    Prefix,     ///< Unary + or -.
+    Postfix,    ///< %.
+    Binary,     ///< Arithmetic, & and comparisons.
+    Range,      ///< The : operator.
+    Call
+};
+
+/**
+ * @struct FormulaNode
+ * @brief One node of a parsed formula. Nodes live in a FormulaArena and are never freed one by one.
+ */
+struct FormulaNode {
+    FormulaNodeKind kind = FormulaNodeKind::Missing;
+    std::uint32_t offset = 0;            ///< Where the node's token starts in the formula.
+    std::uint32_t length = 0;            ///< Length of that token; the operator, for operator nodes.
+    std::string_view text;               ///< Operator, name, reference, error, or the unescaped string value.
+    double number = 0.0;                 ///< Number, and 1 or 0 for Boolean.
+    const FormulaNode* left = nullptr;   ///< The operand of Prefix and Postfix; the left side of Binary and Range.
+    const FormulaNode* right = nullptr;
+    const FormulaNode* const* arguments = nullptr; ///< Call only.
+    std::uint32_t argumentCount = 0;
+};
+
+/**
+ * @class FormulaArena
+ * @brief Bump allocator for the ASTs of one workbook.
+ *
+ * Allocation moves a pointer through fixed-size blocks; nothing is freed
+ * until Rewind() or Reset(), which keep the blocks for reuse. Only trivially
+ * destructible objects may be created, so dropping them runs no code.
+ * Not thread-safe.
+ */
+class FormulaArena {
+public:
+    static constexpr std::size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+    /**
+     * @brief A point to Rewind() to, dropping everything allocated after it.
+     */
+    struct Mark {
+        std::size_t block = 0;
+        std::size_t used = 0;
+    };
+
+    explicit FormulaArena(std::size_t blockSize = DEFAULT_BLOCK_SIZE);
+    FormulaArena(const FormulaArena&) = delete;
+    FormulaArena& operator=(const FormulaArena&) = delete;
+
+    /**
+     * @brief @p alignment must be a power of two no larger than the default new alignment.
+     */
+    void* Allocate(std::size_t size, std::size_t alignment);
+
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        return new (Allocate(sizeof(T), alignof(T))) T{std::forward<Args>(args)...};
+    }
+
+    /**
+     * @brief Copies @p text into the arena; the view stays valid until the arena is rewound past it.
+     */
+    std::string_view CopyText(std::string_view text);
+
+    Mark GetMark() const noexcept { return Mark{m_current, m_used}; }
+    void Rewind(const Mark& mark) noexcept;
+    void Reset() noexcept { Rewind(Mark{}); }
+
+    /**
+     * @brief Bytes up to the current position, including the unused tails of the blocks before it.
+     */
+    std::size_t GetBytesUsed() const noexcept;
+    std::size_t GetBytesReserved() const noexcept;
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        std::size_t size;
+    };
+
+    const std::size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    std::size_t m_current = 0; ///< Block being allocated from; blocks after it are free.
+    std::size_t m_used = 0;    ///< Bytes used in the current block.
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FORMULA_AST_H
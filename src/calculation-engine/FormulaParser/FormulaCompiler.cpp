@@ -0,0 +1,524 @@
+#include "FormulaCompiler.h"
+#include "../ErrorHandling/CalculationErrors.h"
+#include "FormulaParser.h"
+#include "TokenizerUtils.h"
+#include "../FunctionLibrary/FunctionRegistry.h"
+#include <algorithm>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+using Excel::CalculationEngine::CalculationErrorCode;
+using Excel::CalculationEngine::CalculationException;
+
+[[noreturn]] void ThrowInvalid(const std::string& message) {
+    throw CalculationException(CalculationErrorCode::INVALID_FORMULA, message);
+}
+
+bool IsLetter(char c) {
+    return TokenizerUtils::IsAlpha(c);
+}
+
+bool IsDigit(char c) {
+    return TokenizerUtils::IsDigit(c);
+}
+
+bool IsNameChar(char c) {
+    return IsLetter(c) || IsDigit(c) || c == '_' || c == '.';
+}
+
+char ToUpper(char c) {
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+std::string ToUpper(std::string_view text) {
+    std::string upper(text);
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](char c) { return ToUpper(c); });
+    return upper;
+}
+
+// Binding powers, as in FormulaParser. Operands that never need parentheses are ATOM.
+constexpr int NONE = 0;
+constexpr int COMPARISON = 1;
+constexpr int CONCATENATION = 2;
+constexpr int ADDITION = 3;
+constexpr int MULTIPLICATION = 4;
+constexpr int EXPONENT = 5;
+constexpr int PERCENT = 6;
+constexpr int PREFIX = 7;
+constexpr int ATOM = 9;
+
+int BinaryPower(std::string_view op) {
+    switch (op[0]) {
+        case '&': return CONCATENATION;
+        case '+':
+        case '-': return ADDITION;
+        case '*':
+        case '/': return MULTIPLICATION;
+        case '^': return EXPONENT;
+        default: return COMPARISON;
+    }
+}
+
+int Power(const FormulaNode& node) {
+    switch (node.kind) {
+        case FormulaNodeKind::Prefix: return PREFIX;
+        case FormulaNodeKind::Postfix: return PERCENT;
+        case FormulaNodeKind::Binary: return BinaryPower(node.text);
+        default: return ATOM;
+    }
+}
+
+Opcode BinaryOpcode(std::string_view op) {
+    switch (op[0]) {
+        case '+': return Opcode::Add;
+        case '-': return Opcode::Subtract;
+        case '*': return Opcode::Multiply;
+        case '/': return Opcode::Divide;
+        case '^': return Opcode::Power;
+        case '&': return Opcode::Concatenate;
+        case '=': return Opcode::Equal;
+        case '<': return op == "<=" ? Opcode::LessEqual : (op == "<>" ? Opcode::NotEqual : Opcode::Less);
+        default: return op == ">=" ? Opcode::GreaterEqual : Opcode::Greater;
+    }
+}
+
+// Trees are built in the calling thread's parser and dropped when their compiler is
+FormulaParser& ThreadParser() {
+    thread_local FormulaParser parser;
+    return parser;
+}
+
+// Text between quotes with each doubled quote made single
+std::string Unescape(std::string_view text, char quote) {
+    std::string value;
+    value.reserve(text.size());
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        value += text[i];
+        if (text[i] == quote && i + 1 < text.size() && text[i + 1] == quote) {
+            ++i;
+        }
+    }
+    return value;
+}
+
+/**
+ * Splits "Sheet1!A1" or "'My Sheet'!A1" at its last '!'. @p sheet receives the
+ * sheet name as written, quotes included; it is empty when there is no '!'.
+ * Returns the rest.
+ */
+std::string_view SplitSheet(std::string_view text, std::string_view& sheet) {
+    const std::size_t bang = text.rfind('!');
+    if (bang == std::string_view::npos) {
+        sheet = std::string_view();
+        return text;
+    }
+    sheet = text.substr(0, bang);
+    return text.substr(bang + 1);
+}
+
+// A sheet name as written, quoted or not, as the name itself; empty if it is malformed
+std::string SheetName(std::string_view written) {
+    if (written.empty() || written.front() != '\'') {
+        return std::string(written);
+    }
+    if (written.size() < 2 || written.back() != '\'') {
+        return std::string();
+    }
+    return Unescape(written.substr(1, written.size() - 2), '\'');
+}
+
+// [$]LETTERS at pos; returns the position after it, or npos if there is none.
+std::size_t ParseColumn(std::string_view text, std::size_t pos, RelativeReference& cell) {
+    cell.columnAbsolute = pos < text.size() && text[pos] == '$';
+    if (cell.columnAbsolute) {
+        ++pos;
+    }
+    std::int32_t column = 0;
+    std::size_t letters = 0;
+    while (pos < text.size() && IsLetter(text[pos]) && letters < 4) {
+        column = column * 26 + (ToUpper(text[pos]) - 'A' + 1);
+        ++pos;
+        ++letters;
+    }
+    if (letters == 0 || letters > 3 || column > MAX_COLUMNS) {
+        return std::string_view::npos;
+    }
+    cell.column = column - 1;
+    return pos;
+}
+
+// [$]DIGITS at pos; returns the position after it, or npos if there is none.
+std::size_t ParseRow(std::string_view text, std::size_t pos, RelativeReference& cell) {
+    cell.rowAbsolute = pos < text.size() && text[pos] == '$';
+    if (cell.rowAbsolute) {
+        ++pos;
+    }
+    std::int64_t row = 0;
+    std::size_t digits = 0;
+    while (pos < text.size() && IsDigit(text[pos]) && digits < 8) {
+        row = row * 10 + (text[pos] - '0');
+        ++pos;
+        ++digits;
+    }
+    if (digits == 0 || row < 1 || row > MAX_ROWS) {
+        return std::string_view::npos;
+    }
+    cell.row = static_cast<std::int32_t>(row - 1);
+    return pos;
+}
+
+/**
+ * Parses an A1 cell address ([$]COL[$]ROW) at pos into absolute zero-based
+ * coordinates. Returns the position after it, or npos if there is none.
+ */
+std::size_t ParseA1(std::string_view text, std::size_t pos, RelativeReference& cell) {
+    pos = ParseColumn(text, pos, cell);
+    if (pos == std::string_view::npos) {
+        return pos;
+    }
+    pos = ParseRow(text, pos, cell);
+    if (pos == std::string_view::npos) {
+        return pos;
+    }
+    // "LOG10(" or "A1B" are names, not references.
+    if (pos < text.size() && (IsNameChar(text[pos]) || text[pos] == '(')) {
+        return std::string_view::npos;
+    }
+    return pos;
+}
+
+void MakeRelative(RelativeReference& cell, const CellReference& anchor) {
+    if (!cell.rowAbsolute) {
+        cell.row -= anchor.row;
+    }
+    if (!cell.columnAbsolute) {
+        cell.column -= anchor.column;
+    }
+}
+
+void AppendR1C1(std::string& out, const RelativeReference& cell) {
+    out += 'R';
+    if (cell.rowAbsolute) {
+        out += std::to_string(cell.row + 1);
+    } else {
+        out += '[';
+        out += std::to_string(cell.row);
+        out += ']';
+    }
+    out += 'C';
+    if (cell.columnAbsolute) {
+        out += std::to_string(cell.column + 1);
+    } else {
+        out += '[';
+        out += std::to_string(cell.column);
+        out += ']';
+    }
+}
+
+} // namespace
+
+FormulaCompiler::FormulaCompiler(std::string_view formula, const CellReference& anchor)
+    : m_anchor(anchor), m_mark(ThreadParser().GetArena().GetMark()) {
+    try {
+        m_root = ThreadParser().Parse(formula);
+        m_shape.reserve(formula.size() + 8);
+        m_shape += '=';
+        AppendShape(*m_root, NONE);
+    } catch (...) {
+        ThreadParser().GetArena().Rewind(m_mark);
+        throw;
+    }
+}
+
+FormulaCompiler::~FormulaCompiler() {
+    ThreadParser().GetArena().Rewind(m_mark);
+}
+
+std::string FormulaCompiler::NormalizeShape(std::string_view formula, const CellReference& anchor) {
+    return FormulaCompiler(formula, anchor).GetShape();
+}
+
+bool FormulaCompiler::ParseReference(std::string_view text, std::string& sheet, ReferenceOperand& reference) {
+    std::string_view written;
+    const std::string_view cell = SplitSheet(text, written);
+    sheet = SheetName(written);
+    if (cell.size() != text.size() && sheet.empty()) {
+        return false;
+    }
+    text = cell;
+
+    reference = ReferenceOperand{};
+    std::size_t end = ParseA1(text, 0, reference.first);
+    if (end == std::string_view::npos) {
+        return false;
+    }
+    reference.last = reference.first;
+    if (end < text.size() && text[end] == ':') {
+        end = ParseA1(text, end + 1, reference.last);
+        if (end == std::string_view::npos) {
+            return false;
+        }
+        reference.isRange = true;
+    }
+    for (RelativeReference* corner : {&reference.first, &reference.last}) {
+        corner->rowAbsolute = true;
+        corner->columnAbsolute = true;
+    }
+    return end == text.size();
+}
+
+void FormulaCompiler::ToReference(const FormulaNode& node, std::string_view& sheet, ReferenceOperand& reference) const {
+    reference = ReferenceOperand{};
+    if (node.kind == FormulaNodeKind::Reference) {
+        // The parser has already checked that it is a cell
+        ParseA1(SplitSheet(node.text, sheet), 0, reference.first);
+        reference.last = reference.first;
+    } else {
+        for (const FormulaNode* corner : {node.left, node.right}) {
+            if (corner->kind != FormulaNodeKind::Reference && corner->kind != FormulaNodeKind::Name &&
+                corner->kind != FormulaNodeKind::Number) {
+                ThrowInvalid("Only ranges between two cells, columns or rows are supported");
+            }
+        }
+        std::string_view lastSheet;
+        const std::string_view first = SplitSheet(node.left->text, sheet);
+        const std::string_view last = SplitSheet(node.right->text, lastSheet);
+        if (!lastSheet.empty() && SheetName(lastSheet) != SheetName(sheet)) {
+            ThrowInvalid("A range cannot span sheets");
+        }
+        if (ParseA1(first, 0, reference.first) == first.size() && ParseA1(last, 0, reference.last) == last.size()) {
+            // A1:B2
+        } else if (ParseColumn(first, 0, reference.first) == first.size() &&
+                   ParseColumn(last, 0, reference.last) == last.size()) {
+            // A:B, every row
+            reference.first.row = 0;
+            reference.last.row = MAX_ROWS - 1;
+            reference.first.rowAbsolute = true;
+            reference.last.rowAbsolute = true;
+        } else if (ParseRow(first, 0, reference.first) == first.size() &&
+                   ParseRow(last, 0, reference.last) == last.size()) {
+            // 1:3, every column
+            reference.first.column = 0;
+            reference.last.column = MAX_COLUMNS - 1;
+            reference.first.columnAbsolute = true;
+            reference.last.columnAbsolute = true;
+        } else {
+            ThrowInvalid("Malformed range '" + std::string(node.left->text) + ":" + std::string(node.right->text) + "'");
+        }
+        reference.isRange = true;
+    }
+    MakeRelative(reference.first, m_anchor);
+    MakeRelative(reference.last, m_anchor);
+}
+
+void FormulaCompiler::AppendShape(const FormulaNode& node, int context) {
+    // Parentheses only where the tree needs them, so (1+2)*3 and ((1+2))*3 share a shape
+    const bool parenthesize = Power(node) < context;
+    if (parenthesize) {
+        m_shape += '(';
+    }
+    switch (node.kind) {
+        case FormulaNodeKind::Number:
+        case FormulaNodeKind::Error:
+            m_shape += node.text;
+            break;
+        case FormulaNodeKind::String:
+            m_shape += '"';
+            for (char c : node.text) {
+                m_shape += c;
+                if (c == '"') {
+                    m_shape += '"';
+                }
+            }
+            m_shape += '"';
+            break;
+        case FormulaNodeKind::Boolean:
+            m_shape += node.number != 0.0 ? "TRUE" : "FALSE";
+            break;
+        case FormulaNodeKind::Name:
+            // Defined names are not resolved yet; Excel shows #NAME? for unknown names.
+            m_shape += "#NAME?";
+            break;
+        case FormulaNodeKind::Missing:
+            break;
+        case FormulaNodeKind::Reference:
+        case FormulaNodeKind::Range: {
+            std::string_view sheet;
+            ReferenceOperand reference;
+            ToReference(node, sheet, reference);
+            if (!sheet.empty()) {
+                // Sheet1! and 'Sheet1'! are the same sheet; names that need quotes are written with them
+                const bool quoted = sheet.front() == '\'';
+                m_shape += quoted ? "" : "'";
+                m_shape += sheet;
+                m_shape += quoted ? "!" : "'!";
+            }
+            AppendR1C1(m_shape, reference.first);
+            if (reference.isRange) {
+                m_shape += ':';
+                AppendR1C1(m_shape, reference.last);
+            }
+            break;
+        }
+        case FormulaNodeKind::Prefix:
+            // Unary plus is a no-op and is dropped from the shape.
+            if (node.text == "-") {
+                m_shape += '-';
+            }
+            AppendShape(*node.left, PREFIX);
+            break;
+        case FormulaNodeKind::Postfix:
+            AppendShape(*node.left, PERCENT);
+            m_shape += '%';
+            break;
+        case FormulaNodeKind::Binary: {
+            // Left-associative: only the right operand needs parentheses at the same power
+            const int power = BinaryPower(node.text);
+            AppendShape(*node.left, power);
+            m_shape += node.text;
+            AppendShape(*node.right, power + 1);
+            break;
+        }
+        case FormulaNodeKind::Call:
+            for (char c : node.text) {
+                m_shape += ToUpper(c);
+            }
+            m_shape += '(';
+            for (std::uint32_t i = 0; i < node.argumentCount; ++i) {
+                if (i > 0) {
+                    m_shape += ',';
+                }
+                AppendShape(*node.arguments[i], NONE);
+            }
+            m_shape += ')';
+            break;
+    }
+    if (parenthesize) {
+        m_shape += ')';
+    }
+}
+
+std::shared_ptr<const FormulaProgram> FormulaCompiler::Compile() const {
+    auto program = std::make_shared<FormulaProgram>();
+    program->m_shape = m_shape;
+    std::int64_t depth = 0;
+
+    auto emit = [&](Opcode op, std::uint32_t operand = 0, std::uint32_t argumentCount = 0) {
+        switch (op) {
+            case Opcode::PushConstant:
+            case Opcode::LoadCell:
+            case Opcode::LoadRange:
+                ++depth;
+                break;
+            case Opcode::Negate:
+            case Opcode::Percent:
+                break;
+            case Opcode::CallFunction:
+            case Opcode::CallExternal:
+                if (argumentCount > UINT8_MAX) {
+                    ThrowInvalid("Too many arguments to a function");
+                }
+                depth -= static_cast<std::int64_t>(argumentCount) - 1;
+                break;
+            default:
+                --depth;
+                break;
+        }
+        program->m_maxStackDepth = std::max(program->m_maxStackDepth, static_cast<std::uint32_t>(std::max<std::int64_t>(depth, 0)));
+        Instruction instruction{op};
+        instruction.argumentCount = static_cast<std::uint8_t>(argumentCount);
+        instruction.operand = operand;
+        program->m_code.push_back(instruction);
+    };
+    auto addConstant = [&](FormulaValue value) {
+        program->m_constants.push_back(std::move(value));
+        return static_cast<std::uint32_t>(program->m_constants.size() - 1);
+    };
+    auto addString = [&](std::string text) {
+        program->m_strings.push_back(std::move(text));
+        return static_cast<std::uint32_t>(program->m_strings.size() - 1);
+    };
+
+    // Operands before their operator; wholeReference loads a cell as a reference rather than its value
+    auto compile = [&](auto& self, const FormulaNode& node, bool wholeReference) -> void {
+        switch (node.kind) {
+            case FormulaNodeKind::Number:
+                emit(Opcode::PushConstant, addConstant(FormulaValue::Number(node.number)));
+                break;
+            case FormulaNodeKind::String:
+                emit(Opcode::PushConstant, addConstant(FormulaValue::Text(std::string(node.text))));
+                break;
+            case FormulaNodeKind::Boolean:
+                emit(Opcode::PushConstant, addConstant(FormulaValue::Boolean(node.number != 0.0)));
+                break;
+            case FormulaNodeKind::Error:
+                emit(Opcode::PushConstant,
+                     addConstant(FormulaValue::Error(ParseErrorText(node.text).value_or(FormulaError::Value))));
+                break;
+            case FormulaNodeKind::Name:
+                emit(Opcode::PushConstant, addConstant(FormulaValue::Error(FormulaError::Name)));
+                break;
+            case FormulaNodeKind::Missing:
+                ThrowInvalid("Missing argument at position " + std::to_string(node.offset + 1));
+            case FormulaNodeKind::Reference:
+            case FormulaNodeKind::Range: {
+                std::string_view sheet;
+                ReferenceOperand reference;
+                ToReference(node, sheet, reference);
+                if (!sheet.empty()) {
+                    reference.sheetName = static_cast<std::int32_t>(addString(SheetName(sheet)));
+                }
+                program->m_references.push_back(reference);
+                emit(reference.isRange || wholeReference ? Opcode::LoadRange : Opcode::LoadCell,
+                     static_cast<std::uint32_t>(program->m_references.size() - 1));
+                break;
+            }
+            case FormulaNodeKind::Prefix:
+                self(self, *node.left, false);
+                if (node.text == "-") {
+                    emit(Opcode::Negate);
+                }
+                break;
+            case FormulaNodeKind::Postfix:
+                self(self, *node.left, false);
+                emit(Opcode::Percent);
+                break;
+            case FormulaNodeKind::Binary:
+                self(self, *node.left, false);
+                self(self, *node.right, false);
+                emit(BinaryOpcode(node.text));
+                break;
+            case FormulaNodeKind::Call: {
+                // Built-ins are bound to their id here; anything else is left to IFunctionLibrary by name.
+                std::string name = ToUpper(node.text);
+                const FunctionInfo* function = FunctionRegistry::Find(name);
+                if (function && (node.argumentCount < function->minArguments ||
+                                 node.argumentCount > function->maxArguments)) {
+                    ThrowInvalid("Wrong number of arguments to " + std::string(function->name));
+                }
+                // OFFSET(A1, ...) moves the reference itself, so A1 must not be read as a value.
+                const bool takesReference = function && function->TakesReference();
+                for (std::uint32_t i = 0; i < node.argumentCount; ++i) {
+                    self(self, *node.arguments[i], i == 0 && takesReference);
+                }
+                if (function) {
+                    emit(Opcode::CallFunction, static_cast<std::uint32_t>(function->id), node.argumentCount);
+                } else {
+                    emit(Opcode::CallExternal, addString(std::move(name)), node.argumentCount);
+                }
+                program->m_volatile = program->m_volatile || (function && function->IsVolatile());
+                program->m_dynamicReferences =
+                    program->m_dynamicReferences || (function && function->ReturnsReference());
+                break;
+            }
+        }
+    };
+
+    compile(compile, *m_root, false);
+    emit(Opcode::Return);
+    return program;
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,78 @@
+#ifndef FORMULA_COMPILER_H
+#define FORMULA_COMPILER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "FormulaProgram.h"
+#include "FormulaAst.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class FormulaCompiler
+ * @brief Turns the A1 text of a formula into its R1C1 shape and a FormulaProgram.
+ *
+ * The constructor parses the formula once with the calling thread's
+ * FormulaParser and prints the tree with every reference rewritten relative
+ * to the anchor cell, which yields the shape key: "=B2*C2" entered in D2 and
+ * "=B3*C3" entered in D3 both have the shape "=R[0]C[-2]*R[0]C[-1]".
+ * Compile() is only needed the first time a shape is seen; FormulaProgramCache
+ * uses GetShape() to find an existing program first.
+ *
+ * The tree lives in that parser's arena until the compiler is destroyed, so
+ * compilers on one thread must be destroyed in the reverse order of their
+ * construction, as local variables are.
+ *
+ * Malformed formulas throw CalculationException with INVALID_FORMULA.
+ */
+class FormulaCompiler {
+public:
+    FormulaCompiler(std::string_view formula, const CellReference& anchor);
+    ~FormulaCompiler();
+    FormulaCompiler(const FormulaCompiler&) = delete;
+    FormulaCompiler& operator=(const FormulaCompiler&) = delete;
+
+    /**
+     * @brief The formula in relative R1C1 notation, with whitespace and redundant parentheses
+     * removed and names upper-cased.
+     */
+    const std::string& GetShape() const noexcept { return m_shape; }
+
+    /**
+     * @brief Builds the postfix program for this shape.
+     */
+    std::shared_ptr<const FormulaProgram> Compile() const;
+
+    /**
+     * @brief Convenience wrapper returning only the shape key.
+     */
+    static std::string NormalizeShape(std::string_view formula, const CellReference& anchor);
+
+    /**
+     * @brief Parses reference text as INDIRECT receives it: "B2", "$A$1:C3", "'My Sheet'!A1".
+     * Both corners of @p reference come back absolute, '$' or not; there is no anchor to be relative to.
+     * @param sheet Receives the sheet name; empty if the text has none.
+     * @return False if the text is not a reference.
+     */
+    static bool ParseReference(std::string_view text, std::string& sheet, ReferenceOperand& reference);
+
+private:
+    /**
+     * @brief The operand of a Reference or Range node, relative to the anchor.
+     * @param sheet Receives the sheet name as written, quotes included; empty for the anchor's sheet.
+     */
+    void ToReference(const FormulaNode& node, std::string_view& sheet, ReferenceOperand& reference) const;
+
+    void AppendShape(const FormulaNode& node, int context);
+
+    CellReference m_anchor;
+    FormulaArena::Mark m_mark;
+    const FormulaNode* m_root = nullptr;
+    std::string m_shape;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FORMULA_COMPILER_H
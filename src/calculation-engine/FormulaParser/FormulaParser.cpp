@@ -1,141 +1,399 @@
 #include "FormulaParser.h"
-#include "TokenizerUtils.h"
-#include "CalculationErrors.h"
-#include <stack>
+#include "FormulaCompiler.h"
 #include <algorithm>
-#include <cctype>
-#include <stdexcept>
-
-// Define the operator precedence map
-const std::unordered_map<std::string, int> OPERATOR_PRECEDENCE = {
-    {"+", 1}, {"-", 1},
-    {"*", 2}, {"/", 2},
-    {"^", 3}
+#include <charconv>
+#include <string>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+using Excel::CalculationEngine::CalculationErrorCode;
+using Excel::CalculationEngine::CalculationException;
+
+const char* const ERROR_LITERALS[] = {
+    "#NULL!", "#DIV/0!", "#VALUE!", "#REF!", "#NAME?", "#NUM!", "#N/A", "#GETTING_DATA"
 };
 
-FormulaParser::FormulaParser(std::shared_ptr<IFunctionLibrary> functionLibrary)
-    : m_functionLibrary(functionLibrary) {}
+// Binding powers, loosest to tightest. A prefix operand binds at PREFIX, so
+// only the range operator can reach into it: -A1:B2 is -(A1:B2), -2^2 is (-2)^2.
+constexpr int NONE = 0;
+constexpr int COMPARISON = 1;
+constexpr int CONCATENATION = 2;
+constexpr int ADDITION = 3;
+constexpr int MULTIPLICATION = 4;
+constexpr int EXPONENT = 5;
+constexpr int PERCENT = 6;
+constexpr int PREFIX = 7;
+constexpr int RANGE = 8;
 
-std::vector<Token> FormulaParser::ParseFormula(const std::string& formula) {
-    try {
-        if (!ValidateFormula(formula)) {
-            throw CalculationError("Invalid formula syntax");
+bool EqualsIgnoringCase(std::string_view text, std::string_view upper) {
+    if (text.size() != upper.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i] >= 'a' && text[i] <= 'z' ? static_cast<char>(text[i] - 'a' + 'A') : text[i];
+        if (c != upper[i]) {
+            return false;
         }
-
-        std::vector<Token> tokens = TokenizeFormula(formula);
-        return ShuntingYardAlgorithm(tokens);
-    } catch (const std::exception& e) {
-        throw CalculationError(std::string("Error parsing formula: ") + e.what());
     }
+    return true;
 }
 
-bool FormulaParser::ValidateFormula(const std::string& formula) {
-    std::stack<char> parentheses;
-    bool lastWasOperator = true;
-    bool expectOperand = true;
-
-    for (char c : formula) {
-        if (std::isspace(c)) continue;
-
-        if (c == '(') {
-            parentheses.push(c);
-            expectOperand = true;
-        } else if (c == ')') {
-            if (parentheses.empty() || lastWasOperator) return false;
-            parentheses.pop();
-            expectOperand = false;
-        } else if (std::isalpha(c) || c == '_') {
-            if (!expectOperand) return false;
-            while (std::isalnum(c) || c == '_') c++;
-            expectOperand = false;
-        } else if (std::isdigit(c) || c == '.') {
-            if (!expectOperand) return false;
-            while (std::isdigit(c) || c == '.') c++;
-            expectOperand = false;
-        } else if (c == '+' || c == '-' || c == '*' || c == '/' || c == '^') {
-            if (expectOperand && (c != '+' && c != '-')) return false;
-            expectOperand = true;
-        } else {
-            return false;
-        }
+/**
+ * The state of one parse: a cursor over the tokens, and where nodes go.
+ */
+class PrattParser {
+public:
+    PrattParser(std::string_view formula, const std::vector<Token>& tokens, FormulaArena& arena,
+                std::vector<const FormulaNode*>& arguments, std::string& sheet)
+        : m_formula(formula), m_tokens(tokens), m_arena(arena), m_arguments(arguments), m_sheet(sheet) {}
 
-        lastWasOperator = expectOperand;
+    const FormulaNode* ParseFormula() {
+        // The leading '=' is not an operator
+        if (!AtEnd() && Peek().type == TOKEN_TYPES::OPERATOR && Text(Peek()) == "=") {
+            ++m_position;
+        }
+        if (AtEnd()) {
+            ThrowInvalid("Empty formula");
+        }
+        const FormulaNode* root = ParseExpression(NONE);
+        if (!AtEnd()) {
+            ThrowUnexpected(Peek());
+        }
+        return root;
     }
 
-    return parentheses.empty() && !lastWasOperator;
-}
+private:
+    bool AtEnd() const noexcept { return m_position == m_tokens.size(); }
+    const Token& Peek() const noexcept { return m_tokens[m_position]; }
+    std::string_view Text(const Token& token) const noexcept { return token.GetText(m_formula); }
 
-std::vector<Token> FormulaParser::TokenizeFormula(const std::string& formula) {
-    return TokenizerUtils::TokenizeFormula(formula);
-}
+    bool PeekIs(TOKEN_TYPES type, char c) const noexcept {
+        return !AtEnd() && Peek().type == type && Peek().length == 1 && m_formula[Peek().offset] == c;
+    }
+
+    [[noreturn]] void ThrowInvalid(const std::string& message) const {
+        throw CalculationException(CalculationErrorCode::INVALID_FORMULA, message);
+    }
 
-std::vector<Token> FormulaParser::ShuntingYardAlgorithm(const std::vector<Token>& tokens) {
-    std::vector<Token> output;
-    std::stack<Token> operators;
+    [[noreturn]] void ThrowUnexpected(const Token& token) const {
+        ThrowInvalid("Unexpected '" + std::string(Text(token)) + "' at position " + std::to_string(token.offset + 1));
+    }
 
-    for (const Token& token : tokens) {
-        switch (token.type) {
-            case TokenType::Number:
-            case TokenType::CellReference:
-                output.push_back(token);
-                break;
+    FormulaNode* NewNode(FormulaNodeKind kind, const Token& token) {
+        FormulaNode* node = m_arena.Create<FormulaNode>();
+        node->kind = kind;
+        node->offset = token.offset;
+        node->length = token.length;
+        node->text = Text(token);
+        return node;
+    }
 
-            case TokenType::Function:
-                operators.push(token);
-                break;
+    /**
+     * How tightly the token binds as an infix or postfix operator; NONE if it is not one.
+     */
+    int InfixPower(const Token& token) const noexcept {
+        const std::string_view text = Text(token);
+        if (token.type == TOKEN_TYPES::SEPARATOR) {
+            return text == ":" ? RANGE : NONE;
+        }
+        if (token.type != TOKEN_TYPES::OPERATOR) {
+            return NONE;
+        }
+        switch (text[0]) {
+            case '=':
+            case '<':
+            case '>': return COMPARISON;
+            case '&': return CONCATENATION;
+            case '+':
+            case '-': return ADDITION;
+            case '*':
+            case '/': return MULTIPLICATION;
+            case '^': return EXPONENT;
+            case '%': return PERCENT;
+            default: return NONE;
+        }
+    }
 
-            case TokenType::Operator:
-                while (!operators.empty() &&
-                       operators.top().type == TokenType::Operator &&
-                       OPERATOR_PRECEDENCE.at(operators.top().value) >= OPERATOR_PRECEDENCE.at(token.value)) {
-                    output.push_back(operators.top());
-                    operators.pop();
-                }
-                operators.push(token);
+    const FormulaNode* ParseExpression(int minimumPower) {
+        const FormulaNode* left = ParsePrefix();
+        while (!AtEnd()) {
+            const Token& token = Peek();
+            const int power = InfixPower(token);
+            if (power <= minimumPower) {
                 break;
+            }
+            ++m_position;
+            if (power == PERCENT) {
+                FormulaNode* node = NewNode(FormulaNodeKind::Postfix, token);
+                node->left = left;
+                left = node;
+                continue;
+            }
+            if (power == RANGE && !CanBeRangeOperand(*left)) {
+                ThrowUnexpected(token);
+            }
+            // Parsing the right side at the operator's own power makes it left-associative
+            const FormulaNode* right = ParseExpression(power);
+            if (power == RANGE && !CanBeRangeOperand(*right)) {
+                ThrowUnexpected(token);
+            }
+            FormulaNode* node = NewNode(power == RANGE ? FormulaNodeKind::Range : FormulaNodeKind::Binary, token);
+            node->left = left;
+            node->right = right;
+            left = node;
+        }
+        return left;
+    }
 
-            case TokenType::LeftParenthesis:
-                operators.push(token);
-                break;
+    static bool CanBeRangeOperand(const FormulaNode& node) noexcept {
+        switch (node.kind) {
+            case FormulaNodeKind::Reference:
+            case FormulaNodeKind::Name:
+            case FormulaNodeKind::Number:  // 1:3 is rows 1 to 3
+            case FormulaNodeKind::Range:
+            case FormulaNodeKind::Call:    // INDEX and OFFSET return references
+                return true;
+            default:
+                return false;
+        }
+    }
 
-            case TokenType::RightParenthesis:
-                while (!operators.empty() && operators.top().type != TokenType::LeftParenthesis) {
-                    output.push_back(operators.top());
-                    operators.pop();
+    const FormulaNode* ParsePrefix() {
+        if (AtEnd()) {
+            ThrowInvalid("Formula ends where an operand was expected");
+        }
+        const Token& token = m_tokens[m_position++];
+        switch (token.type) {
+            case TOKEN_TYPES::NUMBER: {
+                FormulaNode* node = NewNode(FormulaNodeKind::Number, token);
+                const char* first = m_formula.data() + token.offset;
+                const char* last = first + token.length;
+                const auto result = std::from_chars(first, last, node->number);
+                if (result.ec != std::errc() || result.ptr != last) {
+                    ThrowInvalid("Malformed number '" + std::string(Text(token)) + "'");
                 }
-                if (operators.empty()) {
-                    throw CalculationError("Mismatched parentheses");
+                return node;
+            }
+            case TOKEN_TYPES::STRING:
+                return ParseString(token);
+            case TOKEN_TYPES::ERROR_VALUE:
+                for (const char* literal : ERROR_LITERALS) {
+                    if (EqualsIgnoringCase(Text(token), literal)) {
+                        FormulaNode* node = NewNode(FormulaNodeKind::Error, token);
+                        node->text = literal;
+                        return node;
+                    }
                 }
-                operators.pop(); // Remove the left parenthesis
-
-                if (!operators.empty() && operators.top().type == TokenType::Function) {
-                    output.push_back(operators.top());
-                    operators.pop();
+                ThrowInvalid("Unknown error literal '" + std::string(Text(token)) + "'");
+            case TOKEN_TYPES::NAME:
+                return ParseName(token);
+            case TOKEN_TYPES::FUNCTION:
+                return ParseCall(token);
+            case TOKEN_TYPES::PARENTHESIS:
+                if (Text(token) == "(") {
+                    const FormulaNode* inner = ParseExpression(NONE);
+                    if (!PeekIs(TOKEN_TYPES::PARENTHESIS, ')')) {
+                        ThrowInvalid("Missing ')' for '(' at position " + std::to_string(token.offset + 1));
+                    }
+                    ++m_position;
+                    return inner;
+                }
+                break;
+            case TOKEN_TYPES::OPERATOR:
+                if (Text(token) == "-" || Text(token) == "+") {
+                    FormulaNode* node = NewNode(FormulaNodeKind::Prefix, token);
+                    node->left = ParseExpression(PREFIX);
+                    return node;
                 }
                 break;
+            default:
+                break;
+        }
+        ThrowUnexpected(token);
+    }
 
-            case TokenType::Comma:
-                while (!operators.empty() && operators.top().type != TokenType::LeftParenthesis) {
-                    output.push_back(operators.top());
-                    operators.pop();
+    const FormulaNode* ParseString(const Token& token) {
+        const std::string_view raw = Text(token);
+        // The tokenizer runs an unterminated string to the end; find whether its last quote closes it
+        std::size_t escapes = 0;
+        std::size_t i = 1;
+        for (; i < raw.size(); ++i) {
+            if (raw[i] == '"') {
+                if (i + 1 == raw.size()) {
+                    break;
                 }
-                if (operators.empty()) {
-                    throw CalculationError("Misplaced comma or mismatched parentheses");
+                ++escapes;
+                ++i;
+            }
+        }
+        if (raw.size() < 2 || i != raw.size() - 1) {
+            ThrowInvalid("Unterminated string literal at position " + std::to_string(token.offset + 1));
+        }
+        FormulaNode* node = NewNode(FormulaNodeKind::String, token);
+        node->text = raw.substr(1, raw.size() - 2);
+        if (escapes > 0) {
+            // Only strings with doubled quotes need a copy
+            char* value = static_cast<char*>(m_arena.Allocate(node->text.size() - escapes, 1));
+            std::size_t length = 0;
+            for (std::size_t j = 0; j < node->text.size(); ++j) {
+                value[length++] = node->text[j];
+                if (node->text[j] == '"') {
+                    ++j;
                 }
-                break;
+            }
+            node->text = std::string_view(value, length);
+        }
+        return node;
+    }
 
-            default:
-                throw CalculationError("Unknown token type");
+    const FormulaNode* ParseName(const Token& token) {
+        const std::string_view text = Text(token);
+        if (EqualsIgnoringCase(text, "TRUE") || EqualsIgnoringCase(text, "FALSE")) {
+            FormulaNode* node = NewNode(FormulaNodeKind::Boolean, token);
+            node->number = text.size() == 4 ? 1.0 : 0.0;
+            return node;
         }
+        ReferenceOperand reference;
+        if (FormulaCompiler::ParseReference(text, m_sheet, reference)) {
+            return NewNode(FormulaNodeKind::Reference, token);
+        }
+        // Sheet1!A in Sheet1!A:A is a name too; the range operator gives it its meaning
+        if (text.back() == '!') {
+            ThrowInvalid("Expected a reference after '" + std::string(text) + "'");
+        }
+        return NewNode(FormulaNodeKind::Name, token);
     }
 
-    while (!operators.empty()) {
-        if (operators.top().type == TokenType::LeftParenthesis) {
-            throw CalculationError("Mismatched parentheses");
+    const FormulaNode* ParseCall(const Token& token) {
+        FormulaNode* node = NewNode(FormulaNodeKind::Call, token);
+        if (!PeekIs(TOKEN_TYPES::PARENTHESIS, '(')) {
+            ThrowUnexpected(Peek());
+        }
+        ++m_position;
+        const std::size_t first = m_arguments.size();
+        if (PeekIs(TOKEN_TYPES::PARENTHESIS, ')')) {
+            ++m_position;
+        } else {
+            for (;;) {
+                if (PeekIs(TOKEN_TYPES::SEPARATOR, ',') || PeekIs(TOKEN_TYPES::PARENTHESIS, ')')) {
+                    const Token& next = Peek();
+                    FormulaNode* missing = NewNode(FormulaNodeKind::Missing, next);
+                    missing->length = 0;
+                    missing->text = std::string_view();
+                    m_arguments.push_back(missing);
+                } else {
+                    m_arguments.push_back(ParseExpression(NONE));
+                }
+                if (PeekIs(TOKEN_TYPES::SEPARATOR, ',')) {
+                    ++m_position;
+                    continue;
+                }
+                if (PeekIs(TOKEN_TYPES::PARENTHESIS, ')')) {
+                    ++m_position;
+                    break;
+                }
+                if (AtEnd()) {
+                    ThrowInvalid("Missing ')' after the arguments of " + std::string(Text(token)));
+                }
+                ThrowUnexpected(Peek());
+            }
         }
-        output.push_back(operators.top());
-        operators.pop();
+        node->argumentCount = static_cast<std::uint32_t>(m_arguments.size() - first);
+        if (node->argumentCount > 0) {
+            auto** arguments = static_cast<const FormulaNode**>(
+                m_arena.Allocate(sizeof(const FormulaNode*) * node->argumentCount, alignof(const FormulaNode*)));
+            std::copy(m_arguments.begin() + first, m_arguments.end(), arguments);
+            node->arguments = arguments;
+        }
+        m_arguments.resize(first);
+        return node;
+    }
+
+    std::string_view m_formula;
+    const std::vector<Token>& m_tokens;
+    FormulaArena& m_arena;
+    std::vector<const FormulaNode*>& m_arguments;
+    std::string& m_sheet;
+    std::size_t m_position = 0;
+};
+
+/**
+ * Appends the tokens of the tree below @p node in postfix order.
+ */
+void AppendPostfix(const FormulaNode& node, std::vector<Token>& tokens) {
+    auto push = [&tokens, &node](TOKEN_TYPES type) { tokens.push_back({node.offset, node.length, type}); };
+    switch (node.kind) {
+        case FormulaNodeKind::Number: push(TOKEN_TYPES::NUMBER); break;
+        case FormulaNodeKind::String: push(TOKEN_TYPES::STRING); break;
+        case FormulaNodeKind::Error: push(TOKEN_TYPES::ERROR_VALUE); break;
+        case FormulaNodeKind::Boolean:
+        case FormulaNodeKind::Reference:
+        case FormulaNodeKind::Name: push(TOKEN_TYPES::NAME); break;
+        case FormulaNodeKind::Missing: break;
+        case FormulaNodeKind::Prefix:
+        case FormulaNodeKind::Postfix:
+            AppendPostfix(*node.left, tokens);
+            push(TOKEN_TYPES::OPERATOR);
+            break;
+        case FormulaNodeKind::Binary:
+        case FormulaNodeKind::Range:
+            AppendPostfix(*node.left, tokens);
+            AppendPostfix(*node.right, tokens);
+            push(node.kind == FormulaNodeKind::Range ? TOKEN_TYPES::SEPARATOR : TOKEN_TYPES::OPERATOR);
+            break;
+        case FormulaNodeKind::Call:
+            for (std::uint32_t i = 0; i < node.argumentCount; ++i) {
+                AppendPostfix(*node.arguments[i], tokens);
+            }
+            push(TOKEN_TYPES::FUNCTION);
+            break;
     }
+}
+
+} // namespace
+
+FormulaParser::FormulaParser(std::shared_ptr<IFunctionLibrary> functionLibrary)
+    : m_functionLibrary(std::move(functionLibrary)) {}
+
+const FormulaNode* FormulaParser::Parse(std::string_view formula) {
+    // The tree's text views point into this copy, so the caller's string may go away
+    return ParseTokens(m_arena.CopyText(formula));
+}
+
+const FormulaNode* FormulaParser::ParseTokens(std::string_view formula) {
+    TokenizerUtils::TokenizeFormula(formula, m_tokens);
+    m_arguments.clear();
+    return PrattParser(formula, m_tokens, m_arena, m_arguments, m_sheet).ParseFormula();
+}
+
+std::vector<Token> FormulaParser::ParseFormula(const std::string& formula) {
+    // The tokens point into the caller's formula, so the tree is only needed until they are out
+    const FormulaArena::Mark mark = m_arena.GetMark();
+    std::vector<Token> postfix;
+    try {
+        const FormulaNode* root = ParseTokens(formula);
+        postfix.reserve(m_tokens.size());
+        AppendPostfix(*root, postfix);
+    } catch (...) {
+        m_arena.Rewind(mark);
+        throw;
+    }
+    m_arena.Rewind(mark);
+    return postfix;
+}
+
+bool FormulaParser::ValidateFormula(const std::string& formula) {
+    const FormulaArena::Mark mark = m_arena.GetMark();
+    bool valid = true;
+    try {
+        ParseTokens(formula);
+    } catch (const CalculationException&) {
+        valid = false;
+    }
+    m_arena.Rewind(mark);
+    return valid;
+}
 
-    return output;
-}
\ No newline at end of file
+} // namespace ExcelCalculationEngine
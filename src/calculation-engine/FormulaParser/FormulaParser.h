@@ -2,11 +2,12 @@
 #define FORMULA_PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 #include <memory>
 #include "../Interfaces/IFormulaParser.h"
 #include "../Interfaces/IFunctionLibrary.h"
+#include "FormulaAst.h"
 #include "TokenizerUtils.h"
 #include "../ErrorHandling/CalculationErrors.h"
 
@@ -15,24 +16,40 @@ namespace ExcelCalculationEngine {
 /**
  * @class FormulaParser
  * @brief Implements the parsing of Excel formulas in the Microsoft Excel Calculation Engine.
- * 
- * This class is responsible for parsing and tokenizing Excel formulas. It implements
- * the IFormulaParser interface and provides concrete implementation for parsing
- * Excel formulas.
+ *
+ * A Pratt parser over the tokens of TokenizerUtils: validating a formula and
+ * building its syntax tree are the same single pass. Precedence follows
+ * Excel, loosest to tightest: comparisons, &, + and -, * and /, ^, %, unary
+ * minus, and the : range operator. Binary operators are left-associative,
+ * so 2^3^2 is 64 as in Excel, and -2^2 is 4.
+ *
+ * One parser serves one workbook: the nodes of every tree it returns come
+ * from its FormulaArena and stay valid until ResetArena() or destruction.
+ * Not thread-safe.
  */
 class FormulaParser : public IFormulaParser {
 public:
     /**
      * @brief Constructor for FormulaParser.
-     * @param functionLibrary A shared pointer to the IFunctionLibrary.
+     * @param functionLibrary A shared pointer to the IFunctionLibrary. Unknown function
+     * names still parse; they evaluate to #NAME?.
      */
-    explicit FormulaParser(std::shared_ptr<IFunctionLibrary> functionLibrary);
+    explicit FormulaParser(std::shared_ptr<IFunctionLibrary> functionLibrary = nullptr);
 
     /**
-     * @brief Parses an Excel formula string into a vector of tokens.
-     * @param formula The input formula string to be parsed.
-     * @return A vector of Token objects representing the parsed formula.
-     * @throws CalculationError if the formula is invalid or cannot be parsed.
+     * @brief Parses an Excel formula into a syntax tree allocated from the workbook's arena.
+     * @param formula The formula text, with or without its leading '='. It is copied into the arena.
+     * @return The root node.
+     * @throws CalculationException with INVALID_FORMULA if the formula is malformed.
+     */
+    const FormulaNode* Parse(std::string_view formula);
+
+    /**
+     * @brief Parses an Excel formula string into its tokens in postfix order.
+     * @param formula The input formula string to be parsed. The tokens point into it.
+     * @return The tokens of the syntax tree, operands before their operator; a function
+     * token follows its arguments. Omitted arguments produce no token.
+     * @throws CalculationException with INVALID_FORMULA if the formula is malformed.
      */
     std::vector<Token> ParseFormula(const std::string& formula) override;
 
@@ -43,51 +60,26 @@ public:
      */
     bool ValidateFormula(const std::string& formula) override;
 
-private:
-    std::shared_ptr<IFunctionLibrary> m_functionLibrary;
-    std::unordered_map<std::string, int> m_operatorPrecedence;
-
-    /**
-     * @brief Tokenizes the formula string into individual tokens.
-     * @param formula The input formula string to be tokenized.
-     * @return A vector of Token objects representing the tokenized formula.
-     */
-    std::vector<Token> TokenizeFormula(const std::string& formula);
-
-    /**
-     * @brief Converts infix notation to Reverse Polish Notation (RPN) using the Shunting Yard algorithm.
-     * @param tokens The input vector of tokens in infix notation.
-     * @return A vector of Token objects in RPN.
-     */
-    std::vector<Token> ShuntingYardAlgorithm(const std::vector<Token>& tokens);
-
-    /**
-     * @brief Initializes the operator precedence map.
-     */
-    void InitializeOperatorPrecedence();
+    FormulaArena& GetArena() noexcept { return m_arena; }
 
     /**
-     * @brief Checks if the parentheses and brackets in the formula are balanced.
-     * @param formula The input formula string to be checked.
-     * @return True if the parentheses and brackets are balanced, false otherwise.
+     * @brief Frees every tree parsed so far at once, keeping the memory for the next ones.
      */
-    bool AreParenthesesBalanced(const std::string& formula);
+    void ResetArena() noexcept { m_arena.Reset(); }
 
-    /**
-     * @brief Validates the usage of operators in the formula.
-     * @param tokens The vector of tokens to be validated.
-     * @return True if the operator usage is valid, false otherwise.
-     */
-    bool ValidateOperatorUsage(const std::vector<Token>& tokens);
+private:
+    std::shared_ptr<IFunctionLibrary> m_functionLibrary;
+    FormulaArena m_arena;
+    std::vector<Token> m_tokens;                 ///< Reused by every parse.
+    std::vector<const FormulaNode*> m_arguments; ///< Arguments of the calls being parsed, innermost last.
+    std::string m_sheet;                         ///< Scratch for FormulaCompiler::ParseReference.
 
     /**
-     * @brief Validates the function names and argument counts in the formula.
-     * @param tokens The vector of tokens to be validated.
-     * @return True if the function usage is valid, false otherwise.
+     * @brief Tokenizes and parses @p formula, which must already live in the arena.
      */
-    bool ValidateFunctionUsage(const std::vector<Token>& tokens);
+    const FormulaNode* ParseTokens(std::string_view formula);
 };
 
 } // namespace ExcelCalculationEngine
 
-#endif // FORMULA_PARSER_H
\ No newline at end of file
+#endif // FORMULA_PARSER_H
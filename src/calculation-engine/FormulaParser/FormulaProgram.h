@@ -0,0 +1,151 @@
+#ifndef FORMULA_PROGRAM_H
+#define FORMULA_PROGRAM_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../Interfaces/GridReference.h"
+#include "../Evaluation/FormulaValue.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @struct RelativeReference
+ * @brief One corner of a compiled reference, stored the way R1C1 notation does.
+ *
+ * A relative component holds an offset from the anchor cell of the formula
+ * (B2 entered in D2 is R[0]C[-2]); an absolute component holds the zero-based
+ * row or column itself ($B$2 is R2C2).
+ */
+struct RelativeReference {
+    std::int32_t row = 0;
+    std::int32_t column = 0;
+    bool rowAbsolute = false;
+    bool columnAbsolute = false;
+
+    CellReference Resolve(const CellReference& anchor) const noexcept {
+        CellReference cell = anchor;
+        cell.row = rowAbsolute ? row : anchor.row + row;
+        cell.column = columnAbsolute ? column : anchor.column + column;
+        return cell;
+    }
+};
+
+/**
+ * @struct ReferenceOperand
+ * @brief A cell or rectangular range referenced by a formula.
+ */
+struct ReferenceOperand {
+    RelativeReference first;
+    RelativeReference last;   ///< Equal to first for a single cell.
+    bool isRange = false;
+    std::int32_t sheetName = -1; ///< Index into the program's string pool; -1 means the anchor's sheet.
+};
+
+/**
+ * @brief Bytecode instructions of a compiled formula, executed by FormulaVM.
+ *
+ * The numbering is also the computed-goto table order in FormulaVM.cpp.
+ */
+enum class Opcode : std::uint8_t {
+    PushConstant,   ///< operand: constant pool index
+    LoadCell,       ///< operand: reference pool index; pushes the cell's value
+    LoadRange,      ///< operand: reference pool index; pushes an unevaluated range
+    Negate,
+    Percent,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Power,
+    Concatenate,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    CallFunction,   ///< operand: FunctionId of a built-in; pops argumentCount values
+    CallExternal,   ///< operand: string pool index of a name the registry does not know; goes to IFunctionLibrary
+    Return
+};
+
+/**
+ * @brief One 8-byte instruction: opcode, argument count for calls, and a pool index.
+ */
+struct Instruction {
+    Opcode op;
+    std::uint8_t argumentCount = 0;
+    std::uint16_t reserved = 0;
+    std::uint32_t operand = 0;
+};
+
+static_assert(sizeof(Instruction) == 8, "Instruction should stay 8 bytes");
+
+/**
+ * @class FormulaProgram
+ * @brief Immutable compiled form of one formula shape.
+ *
+ * A program contains no absolute positions for relative references, so every
+ * cell whose formula normalizes to the same R1C1 shape shares one instance and
+ * supplies its own anchor when it is evaluated. Literals are materialized into
+ * the constant pool at compile time. Programs are created by FormulaCompiler
+ * and never modified afterwards, so they can be read from any number of threads.
+ */
+class FormulaProgram {
+public:
+    const std::string& GetShape() const noexcept { return m_shape; }
+    const std::vector<Instruction>& GetCode() const noexcept { return m_code; }
+
+    /**
+     * @brief Deepest the value stack gets while running; the VM reserves this once.
+     */
+    std::uint32_t GetMaxStackDepth() const noexcept { return m_maxStackDepth; }
+
+    const FormulaValue& GetConstant(std::uint32_t index) const { return m_constants[index]; }
+    const std::string& GetString(std::uint32_t index) const { return m_strings[index]; }
+    const ReferenceOperand& GetReference(std::uint32_t index) const { return m_references[index]; }
+
+    /**
+     * @brief All references in the formula, in source order; used to build precedent edges.
+     */
+    const std::vector<ReferenceOperand>& GetReferences() const noexcept { return m_references; }
+
+    /**
+     * @brief True if the formula calls a volatile built-in (NOW, TODAY, RAND), so
+     * its cell must be recalculated on every recalc, not only when a precedent changes.
+     */
+    bool IsVolatile() const noexcept { return m_volatile; }
+
+    /**
+     * @brief True if the formula calls OFFSET or INDIRECT. GetReferences() is then
+     * incomplete; FormulaVM::GetDynamicReferences() has the rest after each run.
+     */
+    bool HasDynamicReferences() const noexcept { return m_dynamicReferences; }
+
+private:
+    friend class FormulaCompiler;
+
+    std::string m_shape;
+    std::vector<Instruction> m_code;
+    std::uint32_t m_maxStackDepth = 0;
+    std::vector<FormulaValue> m_constants;
+    std::vector<std::string> m_strings;
+    std::vector<ReferenceOperand> m_references;
+    bool m_volatile = false;
+    bool m_dynamicReferences = false;
+};
+
+/**
+ * @struct FormulaBinding
+ * @brief What a formula cell stores: the shared program plus the cell's own anchor.
+ */
+struct FormulaBinding {
+    std::shared_ptr<const FormulaProgram> program;
+    CellReference anchor;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FORMULA_PROGRAM_H
@@ -1,87 +1,170 @@
 #include "TokenizerUtils.h"
-#include <cctype>
-#include <string>
-#include <vector>
 
-namespace ExcelFormula {
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EXCEL_TOKENIZER_SSE2 1
+#include <emmintrin.h>
+#endif
 
-bool IsOperator(char c) {
-    static const std::string operators = "+-*/^=><";
-    return operators.find(c) != std::string::npos;
-}
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
-bool IsDigit(char c) {
-    return std::isdigit(static_cast<unsigned char>(c)) != 0;
-}
+namespace ExcelCalculationEngine {
 
-bool IsAlpha(char c) {
-    return std::isalpha(static_cast<unsigned char>(c)) != 0;
-}
+namespace {
 
-std::vector<Token> TokenizeFormula(const std::string& formula) {
-    std::vector<Token> tokens;
-    std::string currentToken;
-    TokenType currentType = TokenType::Unknown;
+#if defined(EXCEL_TOKENIZER_SSE2)
+unsigned LowestBit(unsigned mask) noexcept {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+#endif
 
-    auto flushToken = [&]() {
-        if (!currentToken.empty()) {
-            tokens.push_back({currentType, currentToken});
-            currentToken.clear();
-            currentType = TokenType::Unknown;
+/**
+ * Skips a quoted string or sheet name starting at the opening quote at pos;
+ * a doubled quote inside is an escaped one. Returns the position after the
+ * closing quote, or the size if there is none.
+ */
+std::size_t SkipQuoted(std::string_view text, std::size_t pos, char quote) noexcept {
+    ++pos;
+    while ((pos = TokenizerUtils::FindQuote(text, pos, quote)) < text.size()) {
+        if (pos + 1 < text.size() && text[pos + 1] == quote) {
+            pos += 2;
+            continue;
         }
-    };
+        return pos + 1;
+    }
+    return text.size();
+}
 
-    for (size_t i = 0; i < formula.length(); ++i) {
-        char c = formula[i];
+} // namespace
 
-        if (std::isspace(static_cast<unsigned char>(c))) {
-            flushToken();
-            continue;
+std::size_t TokenizerUtils::SkipWhitespace(std::string_view text, std::size_t pos) noexcept {
+    // Most runs are one space or none at all; those never reach the vector loop
+    if (pos >= text.size() || !IsSpace(text[pos])) {
+        return pos;
+    }
+    ++pos;
+#if defined(EXCEL_TOKENIZER_SSE2)
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i controlSpan = _mm_set1_epi8('\r' - '\t');
+    while (pos + 16 <= text.size()) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        // '\t' through '\r' are the bytes at most four above '\t', compared unsigned
+        const __m128i control =
+            _mm_cmpeq_epi8(_mm_subs_epu8(_mm_sub_epi8(chunk, tab), controlSpan), _mm_setzero_si128());
+        const __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(chunk, space), control);
+        const unsigned other = static_cast<unsigned>(_mm_movemask_epi8(blank)) ^ 0xFFFFu;
+        if (other != 0) {
+            return pos + LowestBit(other);
         }
+        pos += 16;
+    }
+#endif
+    while (pos < text.size() && IsSpace(text[pos])) {
+        ++pos;
+    }
+    return pos;
+}
 
-        if (IsOperator(c)) {
-            flushToken();
-            tokens.push_back({TokenType::Operator, std::string(1, c)});
-            continue;
+std::size_t TokenizerUtils::FindQuote(std::string_view text, std::size_t pos, char quote) noexcept {
+#if defined(EXCEL_TOKENIZER_SSE2)
+    const __m128i target = _mm_set1_epi8(quote);
+    while (pos + 16 <= text.size()) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + pos));
+        const unsigned found = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, target)));
+        if (found != 0) {
+            return pos + LowestBit(found);
         }
+        pos += 16;
+    }
+#endif
+    while (pos < text.size() && text[pos] != quote) {
+        ++pos;
+    }
+    return pos;
+}
+
+std::vector<Token> TokenizerUtils::TokenizeFormula(std::string_view formula) {
+    std::vector<Token> tokens;
+    tokens.reserve(formula.size() / 2 + 1);
+    TokenizeFormula(formula, tokens);
+    return tokens;
+}
 
-        if (IsDigit(c) || (c == '.' && currentType == TokenType::Number)) {
-            if (currentType != TokenType::Number) {
-                flushToken();
-                currentType = TokenType::Number;
+void TokenizerUtils::TokenizeFormula(std::string_view formula, std::vector<Token>& tokens) {
+    tokens.clear();
+    const std::size_t size = formula.size();
+    auto push = [&tokens](TOKEN_TYPES type, std::size_t begin, std::size_t end) {
+        tokens.push_back({static_cast<std::uint32_t>(begin), static_cast<std::uint32_t>(end - begin), type});
+    };
+
+    std::size_t pos = 0;
+    while ((pos = SkipWhitespace(formula, pos)) < size) {
+        const std::size_t begin = pos;
+        const char c = formula[pos];
+        const std::uint8_t characterClass = GetClass(c);
+
+        if ((characterClass & DIGIT) != 0 || (c == '.' && pos + 1 < size && IsDigit(formula[pos + 1]))) {
+            while (pos < size && (IsDigit(formula[pos]) || formula[pos] == '.')) {
+                ++pos;
             }
-            currentToken += c;
-        } else if (IsAlpha(c) || c == '_' || (currentType == TokenType::Identifier && IsDigit(c))) {
-            if (currentType != TokenType::Identifier) {
-                flushToken();
-                currentType = TokenType::Identifier;
+            if (pos < size && (formula[pos] == 'e' || formula[pos] == 'E')) {
+                std::size_t exponent = pos + 1;
+                if (exponent < size && (formula[exponent] == '+' || formula[exponent] == '-')) {
+                    ++exponent;
+                }
+                if (exponent < size && IsDigit(formula[exponent])) {
+                    pos = exponent;
+                    while (pos < size && IsDigit(formula[pos])) {
+                        ++pos;
+                    }
+                }
             }
-            currentToken += c;
+            push(TOKEN_TYPES::NUMBER, begin, pos);
         } else if (c == '"') {
-            flushToken();
-            currentType = TokenType::String;
-            currentToken += c;
-            ++i;
-            while (i < formula.length() && formula[i] != '"') {
-                currentToken += formula[i];
-                ++i;
+            // An unterminated string runs to the end
+            pos = SkipQuoted(formula, pos, '"');
+            push(TOKEN_TYPES::STRING, begin, pos);
+        } else if ((characterClass & NAME_START) != 0 || c == '\'') {
+            if (c == '\'') {
+                pos = SkipQuoted(formula, pos, '\'');
+            }
+            // The name, or a sheet name, '!' and the reference after it
+            while (pos < size && (IsNameChar(formula[pos]) || formula[pos] == '!')) {
+                ++pos;
             }
-            if (i < formula.length()) {
-                currentToken += formula[i];
+            const std::size_t next = SkipWhitespace(formula, pos);
+            push(next < size && formula[next] == '(' ? TOKEN_TYPES::FUNCTION : TOKEN_TYPES::NAME, begin, pos);
+        } else if (c == '#') {
+            ++pos;
+            while (pos < size && (IsNameChar(formula[pos]) || formula[pos] == '/')) {
+                ++pos;
             }
-            flushToken();
-        } else if (c == '(' || c == ')' || c == ',' || c == ':') {
-            flushToken();
-            tokens.push_back({TokenType::Special, std::string(1, c)});
+            if (pos < size && (formula[pos] == '!' || formula[pos] == '?')) {
+                ++pos;
+            }
+            push(TOKEN_TYPES::ERROR_VALUE, begin, pos);
+        } else if ((characterClass & OPERATOR) != 0) {
+            const char next = pos + 1 < size ? formula[pos + 1] : '\0';
+            const bool twoCharacters = (c == '<' && (next == '=' || next == '>')) || (c == '>' && next == '=');
+            pos += twoCharacters ? 2 : 1;
+            push(TOKEN_TYPES::OPERATOR, begin, pos);
+        } else if ((characterClass & SEPARATOR) != 0) {
+            push(TOKEN_TYPES::SEPARATOR, begin, ++pos);
+        } else if ((characterClass & PARENTHESIS) != 0) {
+            push(TOKEN_TYPES::PARENTHESIS, begin, ++pos);
         } else {
             // Handle unexpected characters
-            flushToken();
-            tokens.push_back({TokenType::Unknown, std::string(1, c)});
+            push(TOKEN_TYPES::UNKNOWN, begin, ++pos);
         }
     }
-
-    flushToken();
-    return tokens;
 }
 
-} // namespace ExcelFormula
\ No newline at end of file
+} // namespace ExcelCalculationEngine
@@ -1,71 +1,150 @@
 #ifndef TOKENIZER_UTILS_H
 #define TOKENIZER_UTILS_H
 
-#include <string>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 #include <vector>
 
 namespace ExcelCalculationEngine {
-namespace FormulaParser {
 
 /**
  * @brief Enumeration of token types in Excel formulas.
  */
-enum class TOKEN_TYPES {
-    OPERATOR,
-    OPERAND,
-    FUNCTION,
-    SEPARATOR,
-    PARENTHESIS,
+enum class TOKEN_TYPES : std::uint8_t {
+    OPERATOR,    ///< + - * / ^ & % = < > <= >= <>
+    NUMBER,
+    STRING,      ///< Including its quotes; "" inside stays doubled.
+    ERROR_VALUE, ///< #DIV/0!, #N/A, ...
+    NAME,        ///< A reference, defined name or TRUE/FALSE, with any sheet prefix.
+    FUNCTION,    ///< A name followed by '('; the parenthesis is a token of its own.
+    SEPARATOR,   ///< , : ;
+    PARENTHESIS, ///< ( ) { }
     UNKNOWN
 };
 
 /**
- * @brief Represents a token in an Excel formula.
+ * @brief Represents a token in an Excel formula: where it is in the text, not a copy of it.
  */
 struct Token {
+    std::uint32_t offset;
+    std::uint32_t length;
     TOKEN_TYPES type;
-    std::string value;
+
+    /**
+     * @brief The token's text; @p formula must be the text it was tokenized from.
+     */
+    std::string_view GetText(std::string_view formula) const noexcept { return formula.substr(offset, length); }
 };
 
 /**
  * @brief Utility functions for tokenizing Excel formulas.
+ *
+ * Characters are classified by one lookup in a 256-entry table, and runs of
+ * whitespace and the bodies of quoted strings and sheet names are skipped
+ * sixteen bytes at a time with SSE2 where it is available.
  */
 class TokenizerUtils {
 public:
+    /**
+     * @brief Bits of the character class table.
+     */
+    enum CharacterClass : std::uint8_t {
+        SPACE = 1 << 0,
+        DIGIT = 1 << 1,
+        LETTER = 1 << 2,
+        NAME_START = 1 << 3,  ///< Letters, '_', '$' and '\\'.
+        NAME = 1 << 4,        ///< Letters, digits, '_', '.', '$' and '\\'.
+        OPERATOR = 1 << 5,
+        SEPARATOR = 1 << 6,
+        PARENTHESIS = 1 << 7
+    };
+
+    static std::uint8_t GetClass(char c) noexcept { return CHARACTER_CLASSES[static_cast<unsigned char>(c)]; }
+
     /**
      * @brief Checks if a given character is an Excel formula operator.
-     * @param c The character to check.
-     * @return True if the character is an operator, false otherwise.
      */
-    static bool IsOperator(char c);
+    static bool IsOperator(char c) noexcept { return (GetClass(c) & OPERATOR) != 0; }
+
+    /**
+     * @brief Checks if a given character is an ASCII digit.
+     */
+    static bool IsDigit(char c) noexcept { return (GetClass(c) & DIGIT) != 0; }
 
     /**
-     * @brief Checks if a given character is a digit.
-     * @param c The character to check.
-     * @return True if the character is a digit, false otherwise.
+     * @brief Checks if a given character is an ASCII letter.
      */
-    static bool IsDigit(char c);
+    static bool IsAlpha(char c) noexcept { return (GetClass(c) & LETTER) != 0; }
+
+    static bool IsSpace(char c) noexcept { return (GetClass(c) & SPACE) != 0; }
 
     /**
-     * @brief Checks if a given character is an alphabetic character.
-     * @param c The character to check.
-     * @return True if the character is alphabetic, false otherwise.
+     * @brief Checks if a given character can continue a name ("LOG10", "Sheet_1.A").
      */
-    static bool IsAlpha(char c);
+    static bool IsNameChar(char c) noexcept { return (GetClass(c) & NAME) != 0; }
+
+    /**
+     * @brief The position of the first non-whitespace character at or after @p pos, or the size.
+     */
+    static std::size_t SkipWhitespace(std::string_view text, std::size_t pos) noexcept;
+
+    /**
+     * @brief The position of the first @p quote at or after @p pos, or the size.
+     */
+    static std::size_t FindQuote(std::string_view text, std::size_t pos, char quote) noexcept;
 
     /**
      * @brief Tokenizes an Excel formula string into a vector of tokens.
-     * @param formula The Excel formula string to tokenize.
+     * @param formula The Excel formula string to tokenize. The tokens point into it.
      * @return A vector of tokens representing the parsed formula.
      */
-    static std::vector<Token> TokenizeFormula(const std::string& formula);
+    static std::vector<Token> TokenizeFormula(std::string_view formula);
+
+    /**
+     * @brief Same, into @p tokens, whose capacity is reused when tokenizing many formulas.
+     */
+    static void TokenizeFormula(std::string_view formula, std::vector<Token>& tokens);
 
 private:
+    static constexpr std::array<std::uint8_t, 256> MakeCharacterClasses() {
+        std::array<std::uint8_t, 256> classes{};
+        for (char c : std::string_view(" \t\n\v\f\r")) {
+            classes[static_cast<unsigned char>(c)] |= SPACE;
+        }
+        for (int c = '0'; c <= '9'; ++c) {
+            classes[c] |= DIGIT | NAME;
+        }
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            classes[c] |= LETTER | NAME_START | NAME;
+            classes[c - 'A' + 'a'] |= LETTER | NAME_START | NAME;
+        }
+        for (char c : std::string_view("_$\\")) {
+            classes[static_cast<unsigned char>(c)] |= NAME_START | NAME;
+        }
+        classes[static_cast<unsigned char>('.')] |= NAME;
+        for (char c : std::string_view("+-*/^&%=<>")) {
+            classes[static_cast<unsigned char>(c)] |= OPERATOR;
+        }
+        for (char c : std::string_view(",:;")) {
+            classes[static_cast<unsigned char>(c)] |= SEPARATOR;
+        }
+        for (char c : std::string_view("(){}")) {
+            classes[static_cast<unsigned char>(c)] |= PARENTHESIS;
+        }
+        return classes;
+    }
+
+    static const std::array<std::uint8_t, 256> CHARACTER_CLASSES;
+
     // Private constructor to prevent instantiation
     TokenizerUtils() = delete;
 };
 
-} // namespace FormulaParser
+// Constant-initialized; defined here because the class must be complete to call MakeCharacterClasses()
+inline const std::array<std::uint8_t, 256> TokenizerUtils::CHARACTER_CLASSES = TokenizerUtils::MakeCharacterClasses();
+
 } // namespace ExcelCalculationEngine
 
-#endif // TOKENIZER_UTILS_H
\ No newline at end of file
+#endif // TOKENIZER_UTILS_H
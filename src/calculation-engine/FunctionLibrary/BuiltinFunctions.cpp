@@ -0,0 +1,658 @@
+#include "BuiltinFunctions.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ExcelCalculationEngine::Builtins {
+
+namespace {
+
+// Day 0 of the 1900 date system as used by Excel (1899-12-30), in Unix days.
+constexpr double EXCEL_EPOCH_OFFSET = 25569.0;
+constexpr double SECONDS_PER_DAY = 86400.0;
+
+bool GetNumber(const FunctionArguments& arguments, std::uint32_t index, double& number, FormulaValue& result) {
+    FormulaError error = FormulaError::Value;
+    if (CoerceToNumber(arguments.GetScalar(index), number, error)) {
+        return true;
+    }
+    result = FormulaValue::Error(error);
+    return false;
+}
+
+bool GetCount(const FunctionArguments& arguments, std::uint32_t index, std::size_t& count, FormulaValue& result) {
+    double number;
+    if (!GetNumber(arguments, index, number, result)) {
+        return false;
+    }
+    if (number < 0.0) {
+        result = FormulaValue::Error(FormulaError::Value);
+        return false;
+    }
+    count = static_cast<std::size_t>(number);
+    return true;
+}
+
+bool GetText(const FunctionArguments& arguments, std::uint32_t index, std::string& text, FormulaValue& result) {
+    const FormulaValue value = arguments.GetScalar(index);
+    if (value.IsError()) {
+        result = value;
+        return false;
+    }
+    text = CoerceToText(value);
+    return true;
+}
+
+FormulaValue Checked(double number) {
+    return std::isfinite(number) ? FormulaValue::Number(number) : FormulaValue::Error(FormulaError::Number);
+}
+
+/**
+ * Visits the numbers an aggregate considers. Numbers, booleans and numeric
+ * text passed directly are coerced; inside ranges only numbers count. Other
+ * values are skipped, and the first error becomes the result.
+ */
+template <typename Visit>
+bool ForEachNumber(const FunctionArguments& arguments, FormulaValue& result, Visit visit) {
+    for (std::uint32_t i = 0; i < arguments.GetCount(); ++i) {
+        const FunctionArgument& argument = arguments[i];
+        if (!argument.isRange) {
+            double number;
+            FormulaError error = FormulaError::Value;
+            if (argument.value.IsError()) {
+                result = argument.value;
+                return false;
+            }
+            if (!argument.value.IsEmpty() && CoerceToNumber(argument.value, number, error)) {
+                visit(number);
+            }
+            continue;
+        }
+        const bool complete = ForEachCell(arguments.GetCells(), argument.range,
+            [&](std::int32_t, std::int32_t, const FormulaValue& value) {
+                if (value.IsError()) {
+                    result = value;
+                    return false;
+                }
+                if (value.IsNumber()) {
+                    visit(value.GetNumber());
+                }
+                return true;
+            });
+        if (!complete) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// AND and OR consider numbers and booleans; nothing to consider is #VALUE!.
+template <typename Combine>
+FormulaValue Logical(const FunctionArguments& arguments, bool initial, Combine combine) {
+    bool result = initial;
+    bool any = false;
+    auto consider = [&](const FormulaValue& value) {
+        if (value.GetType() == ValueType::Boolean) {
+            result = combine(result, value.GetBoolean());
+            any = true;
+        } else if (value.IsNumber()) {
+            result = combine(result, value.GetNumber() != 0.0);
+            any = true;
+        }
+    };
+    FormulaValue error;
+    for (std::uint32_t i = 0; i < arguments.GetCount(); ++i) {
+        const FunctionArgument& argument = arguments[i];
+        if (!argument.isRange) {
+            consider(argument.value);
+            continue;
+        }
+        const bool complete = ForEachCell(arguments.GetCells(), argument.range,
+            [&](std::int32_t, std::int32_t, const FormulaValue& value) {
+                if (value.IsError()) {
+                    error = value;
+                    return false;
+                }
+                consider(value);
+                return true;
+            });
+        if (!complete) {
+            return error;
+        }
+    }
+    return any ? FormulaValue::Boolean(result) : FormulaValue::Error(FormulaError::Value);
+}
+
+template <typename Transform>
+FormulaValue MapCharacters(const FunctionArguments& arguments, Transform transform) {
+    FormulaValue result;
+    std::string text;
+    if (!GetText(arguments, 0, text, result)) {
+        return result;
+    }
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [&transform](char c) { return static_cast<char>(transform(static_cast<unsigned char>(c))); });
+    return FormulaValue::Text(std::move(text));
+}
+
+/**
+ * The first column (vertical) or first row of a lookup range, read lazily.
+ */
+struct LookupLine {
+    RangeReference cells;
+    bool vertical;
+
+    std::int64_t GetLength() const noexcept {
+        return vertical ? cells.GetRowCount() : cells.GetColumnCount();
+    }
+
+    FormulaValue At(const FunctionArguments& arguments, std::int64_t index) const {
+        return vertical ? arguments.GetCell(cells, index, 0) : arguments.GetCell(cells, 0, index);
+    }
+};
+
+LookupLine FirstColumn(const RangeReference& range) {
+    RangeReference column = range;
+    column.lastColumn = column.firstColumn;
+    return LookupLine{column, true};
+}
+
+LookupLine FirstRow(const RangeReference& range) {
+    RangeReference row = range;
+    row.lastRow = row.firstRow;
+    return LookupLine{row, false};
+}
+
+bool Matches(const FormulaValue& lookup, const FormulaValue& value) {
+    return value.GetType() == lookup.GetType() && CompareValues(lookup, value) == 0;
+}
+
+// Position of the first cell equal to lookup (text ignores case), or -1.
+std::int64_t FindExact(const FunctionArguments& arguments, const LookupLine& line, const FormulaValue& lookup) {
+    std::int64_t found = -1;
+    if (line.vertical) {
+        // Columns are streamed by segment, which skips empty stretches for free.
+        ForEachCell(arguments.GetCells(), line.cells, [&](std::int32_t row, std::int32_t, const FormulaValue& value) {
+            if (Matches(lookup, value)) {
+                found = row - line.cells.firstRow;
+                return false;
+            }
+            return true;
+        });
+        return found;
+    }
+    for (std::int64_t i = 0; i < line.GetLength(); ++i) {
+        if (Matches(lookup, line.At(arguments, i))) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Binary search over a sorted line. With ascending order, the last position
+ * whose value is <= lookup; with descending order, the last whose value is
+ * >= lookup. -1 if there is none. Only O(log n) cells are read.
+ */
+std::int64_t FindSorted(const FunctionArguments& arguments, const LookupLine& line, const FormulaValue& lookup,
+                        bool ascending) {
+    std::int64_t low = 0;
+    std::int64_t high = line.GetLength() - 1;
+    std::int64_t found = -1;
+    while (low <= high) {
+        const std::int64_t middle = low + (high - low) / 2;
+        const int order = CompareValues(line.At(arguments, middle), lookup);
+        if (ascending ? order <= 0 : order >= 0) {
+            found = middle;
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return found;
+}
+
+// VLOOKUP and HLOOKUP differ only in which way the table is read.
+FormulaValue TableLookup(const FunctionArguments& arguments, bool vertical) {
+    const FormulaValue lookup = arguments.GetScalar(0);
+    if (lookup.IsError()) {
+        return lookup;
+    }
+    if (!arguments[1].isRange) {
+        return FormulaValue::Error(FormulaError::Value);
+    }
+    const RangeReference& table = arguments[1].range;
+
+    FormulaValue result;
+    double index;
+    double approximate = 1.0;
+    if (!GetNumber(arguments, 2, index, result) ||
+        (arguments.GetCount() > 3 && !GetNumber(arguments, 3, approximate, result))) {
+        return result;
+    }
+    index = std::trunc(index);
+    if (index < 1.0) {
+        return FormulaValue::Error(FormulaError::Value);
+    }
+    const std::int64_t offset = static_cast<std::int64_t>(index) - 1;
+    if (offset >= (vertical ? table.GetColumnCount() : table.GetRowCount())) {
+        return FormulaValue::Error(FormulaError::Reference);
+    }
+
+    const LookupLine line = vertical ? FirstColumn(table) : FirstRow(table);
+    const std::int64_t position = approximate != 0.0 ? FindSorted(arguments, line, lookup, true)
+                                                     : FindExact(arguments, line, lookup);
+    if (position < 0) {
+        return FormulaValue::Error(FormulaError::NotAvailable);
+    }
+    return vertical ? arguments.GetCell(table, position, offset) : arguments.GetCell(table, offset, position);
+}
+
+} // namespace
+
+FormulaValue Abs(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double number;
+    return GetNumber(arguments, 0, number, result) ? FormulaValue::Number(std::fabs(number)) : result;
+}
+
+FormulaValue Int(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double number;
+    return GetNumber(arguments, 0, number, result) ? FormulaValue::Number(std::floor(number)) : result;
+}
+
+FormulaValue Mod(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double number;
+    double divisor;
+    if (!GetNumber(arguments, 0, number, result) || !GetNumber(arguments, 1, divisor, result)) {
+        return result;
+    }
+    if (divisor == 0.0) {
+        return FormulaValue::Error(FormulaError::DivideByZero);
+    }
+    // The result takes the sign of the divisor.
+    return Checked(number - divisor * std::floor(number / divisor));
+}
+
+FormulaValue Power(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double base;
+    double exponent;
+    if (!GetNumber(arguments, 0, base, result) || !GetNumber(arguments, 1, exponent, result)) {
+        return result;
+    }
+    if (base == 0.0 && exponent == 0.0) {
+        return FormulaValue::Error(FormulaError::Number);
+    }
+    return Checked(std::pow(base, exponent));
+}
+
+FormulaValue Product(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double product = 1.0;
+    bool any = false;
+    if (!ForEachNumber(arguments, result, [&](double number) {
+            product *= number;
+            any = true;
+        })) {
+        return result;
+    }
+    return Checked(any ? product : 0.0);
+}
+
+FormulaValue Round(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double number;
+    double digits = 0.0;
+    if (!GetNumber(arguments, 0, number, result) ||
+        (arguments.GetCount() > 1 && !GetNumber(arguments, 1, digits, result))) {
+        return result;
+    }
+    // Halves round away from zero, and negative digits round to the left of the point.
+    const double scale = std::pow(10.0, std::trunc(digits));
+    return Checked(std::round(number * scale) / scale);
+}
+
+FormulaValue Sqrt(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double number;
+    if (!GetNumber(arguments, 0, number, result)) {
+        return result;
+    }
+    return number < 0.0 ? FormulaValue::Error(FormulaError::Number) : FormulaValue::Number(std::sqrt(number));
+}
+
+FormulaValue Sum(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double total = 0.0;
+    if (!ForEachNumber(arguments, result, [&total](double number) { total += number; })) {
+        return result;
+    }
+    return Checked(total);
+}
+
+FormulaValue Rand(const FunctionArguments&) {
+    thread_local std::mt19937_64 generator{std::random_device{}()};
+    return FormulaValue::Number(std::uniform_real_distribution<double>(0.0, 1.0)(generator));
+}
+
+FormulaValue Average(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double total = 0.0;
+    std::size_t numbers = 0;
+    if (!ForEachNumber(arguments, result, [&](double number) {
+            total += number;
+            ++numbers;
+        })) {
+        return result;
+    }
+    if (numbers == 0) {
+        return FormulaValue::Error(FormulaError::DivideByZero);
+    }
+    return Checked(total / static_cast<double>(numbers));
+}
+
+FormulaValue Count(const FunctionArguments& arguments) {
+    // Errors are not counted and do not stop the count.
+    std::size_t numbers = 0;
+    for (std::uint32_t i = 0; i < arguments.GetCount(); ++i) {
+        const FunctionArgument& argument = arguments[i];
+        if (!argument.isRange) {
+            double number;
+            FormulaError error;
+            if (!argument.value.IsEmpty() && CoerceToNumber(argument.value, number, error)) {
+                ++numbers;
+            }
+            continue;
+        }
+        ForEachCell(arguments.GetCells(), argument.range, [&numbers](std::int32_t, std::int32_t, const FormulaValue& value) {
+            numbers += value.IsNumber() ? 1 : 0;
+            return true;
+        });
+    }
+    return FormulaValue::Number(static_cast<double>(numbers));
+}
+
+FormulaValue CountA(const FunctionArguments& arguments) {
+    std::size_t values = 0;
+    for (std::uint32_t i = 0; i < arguments.GetCount(); ++i) {
+        const FunctionArgument& argument = arguments[i];
+        if (!argument.isRange) {
+            values += argument.value.IsEmpty() ? 0 : 1;
+            continue;
+        }
+        ForEachCell(arguments.GetCells(), argument.range, [&values](std::int32_t, std::int32_t, const FormulaValue&) {
+            ++values;
+            return true;
+        });
+    }
+    return FormulaValue::Number(static_cast<double>(values));
+}
+
+FormulaValue Max(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double best = -HUGE_VAL;
+    if (!ForEachNumber(arguments, result, [&best](double number) { best = std::max(best, number); })) {
+        return result;
+    }
+    return FormulaValue::Number(std::isinf(best) ? 0.0 : best);
+}
+
+FormulaValue Median(const FunctionArguments& arguments) {
+    FormulaValue result;
+    std::vector<double> numbers;
+    if (!ForEachNumber(arguments, result, [&numbers](double number) { numbers.push_back(number); })) {
+        return result;
+    }
+    if (numbers.empty()) {
+        return FormulaValue::Error(FormulaError::Number);
+    }
+    const std::size_t middle = numbers.size() / 2;
+    std::nth_element(numbers.begin(), numbers.begin() + middle, numbers.end());
+    double median = numbers[middle];
+    if (numbers.size() % 2 == 0) {
+        median = (median + *std::max_element(numbers.begin(), numbers.begin() + middle)) / 2.0;
+    }
+    return FormulaValue::Number(median);
+}
+
+FormulaValue Min(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double best = HUGE_VAL;
+    if (!ForEachNumber(arguments, result, [&best](double number) { best = std::min(best, number); })) {
+        return result;
+    }
+    return FormulaValue::Number(std::isinf(best) ? 0.0 : best);
+}
+
+FormulaValue StDev(const FunctionArguments& arguments) {
+    // Sample standard deviation, accumulated with Welford's method.
+    FormulaValue result;
+    double mean = 0.0;
+    double squares = 0.0;
+    std::size_t n = 0;
+    if (!ForEachNumber(arguments, result, [&](double number) {
+            ++n;
+            const double delta = number - mean;
+            mean += delta / static_cast<double>(n);
+            squares += delta * (number - mean);
+        })) {
+        return result;
+    }
+    if (n < 2) {
+        return FormulaValue::Error(FormulaError::DivideByZero);
+    }
+    return Checked(std::sqrt(squares / static_cast<double>(n - 1)));
+}
+
+FormulaValue And(const FunctionArguments& arguments) {
+    return Logical(arguments, true, [](bool a, bool b) { return a && b; });
+}
+
+FormulaValue If(const FunctionArguments& arguments) {
+    // IF accepts errors so that only the chosen branch can produce one.
+    FormulaValue result;
+    double condition;
+    if (!GetNumber(arguments, 0, condition, result)) {
+        return result;
+    }
+    if (condition != 0.0) {
+        return arguments.GetScalar(1);
+    }
+    return arguments.GetCount() > 2 ? arguments.GetScalar(2) : FormulaValue::Boolean(false);
+}
+
+FormulaValue IfError(const FunctionArguments& arguments) {
+    const FormulaValue value = arguments.GetScalar(0);
+    return value.IsError() ? arguments.GetScalar(1) : value;
+}
+
+FormulaValue IsBlank(const FunctionArguments& arguments) {
+    return FormulaValue::Boolean(arguments.GetScalar(0).IsEmpty());
+}
+
+FormulaValue IsError(const FunctionArguments& arguments) {
+    return FormulaValue::Boolean(arguments.GetScalar(0).IsError());
+}
+
+FormulaValue IsNumber(const FunctionArguments& arguments) {
+    return FormulaValue::Boolean(arguments.GetScalar(0).IsNumber());
+}
+
+FormulaValue IsText(const FunctionArguments& arguments) {
+    return FormulaValue::Boolean(arguments.GetScalar(0).GetType() == ValueType::Text);
+}
+
+FormulaValue Not(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double number;
+    return GetNumber(arguments, 0, number, result) ? FormulaValue::Boolean(number == 0.0) : result;
+}
+
+FormulaValue Or(const FunctionArguments& arguments) {
+    return Logical(arguments, false, [](bool a, bool b) { return a || b; });
+}
+
+FormulaValue Concatenate(const FunctionArguments& arguments) {
+    FormulaValue result;
+    std::string text;
+    std::string part;
+    for (std::uint32_t i = 0; i < arguments.GetCount(); ++i) {
+        if (!GetText(arguments, i, part, result)) {
+            return result;
+        }
+        text += part;
+    }
+    return FormulaValue::Text(std::move(text));
+}
+
+FormulaValue Left(const FunctionArguments& arguments) {
+    FormulaValue result;
+    std::string text;
+    std::size_t length = 1;
+    if (!GetText(arguments, 0, text, result) || (arguments.GetCount() > 1 && !GetCount(arguments, 1, length, result))) {
+        return result;
+    }
+    return FormulaValue::Text(text.substr(0, length));
+}
+
+FormulaValue Len(const FunctionArguments& arguments) {
+    FormulaValue result;
+    std::string text;
+    return GetText(arguments, 0, text, result) ? FormulaValue::Number(static_cast<double>(text.size())) : result;
+}
+
+FormulaValue Lower(const FunctionArguments& arguments) {
+    return MapCharacters(arguments, [](unsigned char c) { return std::tolower(c); });
+}
+
+FormulaValue Mid(const FunctionArguments& arguments) {
+    FormulaValue result;
+    std::string text;
+    double start;
+    std::size_t length;
+    if (!GetText(arguments, 0, text, result) || !GetNumber(arguments, 1, start, result) ||
+        !GetCount(arguments, 2, length, result)) {
+        return result;
+    }
+    if (start < 1.0) {
+        return FormulaValue::Error(FormulaError::Value);
+    }
+    const std::size_t offset = static_cast<std::size_t>(start) - 1;
+    return FormulaValue::Text(offset < text.size() ? text.substr(offset, length) : std::string());
+}
+
+FormulaValue Right(const FunctionArguments& arguments) {
+    FormulaValue result;
+    std::string text;
+    std::size_t length = 1;
+    if (!GetText(arguments, 0, text, result) || (arguments.GetCount() > 1 && !GetCount(arguments, 1, length, result))) {
+        return result;
+    }
+    return FormulaValue::Text(text.substr(text.size() - std::min(length, text.size())));
+}
+
+FormulaValue Trim(const FunctionArguments& arguments) {
+    // Leading and trailing spaces go; runs of inner spaces become one.
+    FormulaValue result;
+    std::string text;
+    if (!GetText(arguments, 0, text, result)) {
+        return result;
+    }
+    std::string trimmed;
+    trimmed.reserve(text.size());
+    for (char c : text) {
+        if (c != ' ' || (!trimmed.empty() && trimmed.back() != ' ')) {
+            trimmed.push_back(c);
+        }
+    }
+    if (!trimmed.empty() && trimmed.back() == ' ') {
+        trimmed.pop_back();
+    }
+    return FormulaValue::Text(std::move(trimmed));
+}
+
+FormulaValue Upper(const FunctionArguments& arguments) {
+    return MapCharacters(arguments, [](unsigned char c) { return std::toupper(c); });
+}
+
+FormulaValue HLookup(const FunctionArguments& arguments) {
+    return TableLookup(arguments, false);
+}
+
+FormulaValue Index(const FunctionArguments& arguments) {
+    FormulaValue result;
+    double row;
+    double column = 1.0;
+    if (!GetNumber(arguments, 1, row, result) ||
+        (arguments.GetCount() > 2 && !GetNumber(arguments, 2, column, result))) {
+        return result;
+    }
+    if (!arguments[0].isRange) {
+        const bool first = std::trunc(row) <= 1.0 && std::trunc(column) <= 1.0;
+        return first ? arguments[0].value : FormulaValue::Error(FormulaError::Reference);
+    }
+    const RangeReference& range = arguments[0].range;
+    // A single row indexed with one number is read across, like a single column is read down.
+    if (arguments.GetCount() == 2 && range.GetRowCount() == 1) {
+        std::swap(row, column);
+    }
+    const std::int64_t rowOffset = static_cast<std::int64_t>(std::trunc(row)) - 1;
+    const std::int64_t columnOffset = static_cast<std::int64_t>(std::trunc(column)) - 1;
+    if (rowOffset < 0 || columnOffset < 0) {
+        // Row or column 0 selects a whole line, which needs array results.
+        return FormulaValue::Error(FormulaError::Value);
+    }
+    if (rowOffset >= range.GetRowCount() || columnOffset >= range.GetColumnCount()) {
+        return FormulaValue::Error(FormulaError::Reference);
+    }
+    return arguments.GetCell(range, rowOffset, columnOffset);
+}
+
+FormulaValue Match(const FunctionArguments& arguments) {
+    const FormulaValue lookup = arguments.GetScalar(0);
+    if (lookup.IsError()) {
+        return lookup;
+    }
+    if (!arguments[1].isRange) {
+        return FormulaValue::Error(FormulaError::NotAvailable);
+    }
+    const RangeReference& range = arguments[1].range;
+    if (range.GetRowCount() != 1 && range.GetColumnCount() != 1) {
+        return FormulaValue::Error(FormulaError::NotAvailable);
+    }
+
+    FormulaValue result;
+    double type = 1.0;
+    if (arguments.GetCount() > 2 && !GetNumber(arguments, 2, type, result)) {
+        return result;
+    }
+    const LookupLine line{range, range.GetColumnCount() == 1};
+    const std::int64_t position = type == 0.0 ? FindExact(arguments, line, lookup)
+                                              : FindSorted(arguments, line, lookup, type > 0.0);
+    if (position < 0) {
+        return FormulaValue::Error(FormulaError::NotAvailable);
+    }
+    return FormulaValue::Number(static_cast<double>(position + 1));
+}
+
+FormulaValue VLookup(const FunctionArguments& arguments) {
+    return TableLookup(arguments, true);
+}
+
+FormulaValue Now(const FunctionArguments&) {
+    const double seconds = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    return FormulaValue::Number(seconds / SECONDS_PER_DAY + EXCEL_EPOCH_OFFSET);
+}
+
+FormulaValue Today(const FunctionArguments& arguments) {
+    return FormulaValue::Number(std::floor(Now(arguments).GetNumber()));
+}
+
+} // namespace ExcelCalculationEngine::Builtins
@@ -0,0 +1,65 @@
+#ifndef BUILTIN_FUNCTIONS_H
+#define BUILTIN_FUNCTIONS_H
+
+#include "FunctionArguments.h"
+
+/**
+ * @brief Implementations behind FunctionRegistry. Each has the FunctionImplementation
+ * signature and is only called with an argument count inside its registered arity.
+ */
+namespace ExcelCalculationEngine::Builtins {
+
+// Math
+FormulaValue Abs(const FunctionArguments& arguments);
+FormulaValue Int(const FunctionArguments& arguments);
+FormulaValue Mod(const FunctionArguments& arguments);
+FormulaValue Power(const FunctionArguments& arguments);
+FormulaValue Product(const FunctionArguments& arguments);
+FormulaValue Round(const FunctionArguments& arguments);
+FormulaValue Sqrt(const FunctionArguments& arguments);
+FormulaValue Sum(const FunctionArguments& arguments);
+FormulaValue Rand(const FunctionArguments& arguments);
+
+// Statistical
+FormulaValue Average(const FunctionArguments& arguments);
+FormulaValue Count(const FunctionArguments& arguments);
+FormulaValue CountA(const FunctionArguments& arguments);
+FormulaValue Max(const FunctionArguments& arguments);
+FormulaValue Median(const FunctionArguments& arguments);
+FormulaValue Min(const FunctionArguments& arguments);
+FormulaValue StDev(const FunctionArguments& arguments);
+
+// Logical and information
+FormulaValue And(const FunctionArguments& arguments);
+FormulaValue If(const FunctionArguments& arguments);
+FormulaValue IfError(const FunctionArguments& arguments);
+FormulaValue IsBlank(const FunctionArguments& arguments);
+FormulaValue IsError(const FunctionArguments& arguments);
+FormulaValue IsNumber(const FunctionArguments& arguments);
+FormulaValue IsText(const FunctionArguments& arguments);
+FormulaValue Not(const FunctionArguments& arguments);
+FormulaValue Or(const FunctionArguments& arguments);
+
+// Text
+FormulaValue Concatenate(const FunctionArguments& arguments);
+FormulaValue Left(const FunctionArguments& arguments);
+FormulaValue Len(const FunctionArguments& arguments);
+FormulaValue Lower(const FunctionArguments& arguments);
+FormulaValue Mid(const FunctionArguments& arguments);
+FormulaValue Right(const FunctionArguments& arguments);
+FormulaValue Trim(const FunctionArguments& arguments);
+FormulaValue Upper(const FunctionArguments& arguments);
+
+// Lookup
+FormulaValue HLookup(const FunctionArguments& arguments);
+FormulaValue Index(const FunctionArguments& arguments);
+FormulaValue Match(const FunctionArguments& arguments);
+FormulaValue VLookup(const FunctionArguments& arguments);
+
+// Date and time
+FormulaValue Now(const FunctionArguments& arguments);
+FormulaValue Today(const FunctionArguments& arguments);
+
+} // namespace ExcelCalculationEngine::Builtins
+
+#endif // BUILTIN_FUNCTIONS_H
@@ -0,0 +1,103 @@
+#ifndef FUNCTION_ARGUMENTS_H
+#define FUNCTION_ARGUMENTS_H
+
+#include <algorithm>
+#include <cstdint>
+#include "../Evaluation/FormulaValue.h"
+#include "../Interfaces/GridReference.h"
+#include "../Interfaces/ICellValueSource.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @struct FunctionArgument
+ * @brief One argument of a built-in call: an evaluated value, or a range that has not been read.
+ */
+struct FunctionArgument {
+    FormulaValue value;   ///< Scalar arguments only.
+    RangeReference range; ///< Range arguments only; bounds are resolved against the calling cell.
+    bool isRange = false;
+};
+
+/**
+ * @brief Visits the non-empty cells of a range column by column, top to bottom.
+ *
+ * Cells are read through ICellValueSource::NextColumnSegment, so nothing is
+ * copied or allocated. @p visit is called as visit(row, column, value) and
+ * returns false to stop; ForEachCell returns false if it was stopped.
+ */
+template <typename Visit>
+bool ForEachCell(const ICellValueSource& cells, const RangeReference& range, Visit&& visit) {
+    ColumnSegment segment;
+    FormulaValue buffer;
+    for (std::int32_t column = range.firstColumn; column <= range.lastColumn; ++column) {
+        std::int32_t row = range.firstRow;
+        while (row <= range.lastRow &&
+               cells.NextColumnSegment(range.sheet, column, row, range.lastRow, segment, buffer)) {
+            const std::int64_t segmentEnd = static_cast<std::int64_t>(segment.firstRow) + static_cast<std::int64_t>(segment.count) - 1;
+            const std::int32_t end = static_cast<std::int32_t>(std::min<std::int64_t>(segmentEnd, range.lastRow));
+            for (std::int32_t current = std::max(row, segment.firstRow); current <= end; ++current) {
+                const FormulaValue& value = segment.values[current - segment.firstRow];
+                if (!value.IsEmpty() && !visit(current, column, value)) {
+                    return false;
+                }
+            }
+            if (end < row) {
+                break; // A source that returns no progress would otherwise loop forever.
+            }
+            row = end + 1;
+        }
+    }
+    return true;
+}
+
+/**
+ * @class FunctionArguments
+ * @brief The calling convention for built-in functions.
+ *
+ * Ranges arrive as bounds plus the cell source, and each function decides
+ * how to read them: aggregates stream them with ForEachCell, lookups read
+ * single cells, and scalar parameters call GetScalar(). A call never
+ * flattens a range into a temporary vector.
+ */
+class FunctionArguments {
+public:
+    FunctionArguments(const FunctionArgument* arguments, std::uint32_t count, const ICellValueSource& cells) noexcept
+        : m_arguments(arguments), m_count(count), m_cells(cells) {}
+
+    std::uint32_t GetCount() const noexcept { return m_count; }
+    const FunctionArgument& operator[](std::uint32_t index) const noexcept { return m_arguments[index]; }
+    const ICellValueSource& GetCells() const noexcept { return m_cells; }
+
+    /**
+     * @brief An argument used where a single value is expected. A one-cell range
+     * yields that cell; a larger range is #VALUE!.
+     */
+    FormulaValue GetScalar(std::uint32_t index) const {
+        const FunctionArgument& argument = m_arguments[index];
+        if (!argument.isRange) {
+            return argument.value;
+        }
+        if (argument.range.GetRowCount() != 1 || argument.range.GetColumnCount() != 1) {
+            return FormulaValue::Error(FormulaError::Value);
+        }
+        return GetCell(argument.range, 0, 0);
+    }
+
+    /**
+     * @brief A cell of a range argument by zero-based offset from its top-left corner.
+     */
+    FormulaValue GetCell(const RangeReference& range, std::int64_t rowOffset, std::int64_t columnOffset) const {
+        return m_cells.GetCellValue(CellReference{range.sheet, static_cast<std::int32_t>(range.firstRow + rowOffset),
+                                                  static_cast<std::int32_t>(range.firstColumn + columnOffset)});
+    }
+
+private:
+    const FunctionArgument* m_arguments;
+    std::uint32_t m_count;
+    const ICellValueSource& m_cells;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FUNCTION_ARGUMENTS_H
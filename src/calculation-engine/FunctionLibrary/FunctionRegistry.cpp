@@ -0,0 +1,151 @@
+#include "FunctionRegistry.h"
+#include "BuiltinFunctions.h"
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+// Must stay in FunctionId order; checked below.
+constexpr FunctionInfo FUNCTIONS[] = {
+    {"ABS", FunctionId::Abs, 1, 1, FUNCTION_NONE, &Builtins::Abs},
+    {"AND", FunctionId::And, 1, VARIADIC, FUNCTION_NONE, &Builtins::And},
+    {"AVERAGE", FunctionId::Average, 1, VARIADIC, FUNCTION_NONE, &Builtins::Average},
+    {"CONCATENATE", FunctionId::Concatenate, 1, VARIADIC, FUNCTION_NONE, &Builtins::Concatenate},
+    {"COUNT", FunctionId::Count, 1, VARIADIC, FUNCTION_ACCEPTS_ERRORS, &Builtins::Count},
+    {"COUNTA", FunctionId::CountA, 1, VARIADIC, FUNCTION_ACCEPTS_ERRORS, &Builtins::CountA},
+    {"HLOOKUP", FunctionId::HLookup, 3, 4, FUNCTION_NONE, &Builtins::HLookup},
+    {"IF", FunctionId::If, 2, 3, FUNCTION_ACCEPTS_ERRORS, &Builtins::If},
+    {"IFERROR", FunctionId::IfError, 2, 2, FUNCTION_ACCEPTS_ERRORS, &Builtins::IfError},
+    {"INDEX", FunctionId::Index, 2, 3, FUNCTION_NONE, &Builtins::Index},
+    {"INDIRECT", FunctionId::Indirect, 1, 2, FUNCTION_RETURNS_REFERENCE, nullptr},
+    {"INT", FunctionId::Int, 1, 1, FUNCTION_NONE, &Builtins::Int},
+    {"ISBLANK", FunctionId::IsBlank, 1, 1, FUNCTION_ACCEPTS_ERRORS, &Builtins::IsBlank},
+    {"ISERROR", FunctionId::IsError, 1, 1, FUNCTION_ACCEPTS_ERRORS, &Builtins::IsError},
+    {"ISNUMBER", FunctionId::IsNumber, 1, 1, FUNCTION_ACCEPTS_ERRORS, &Builtins::IsNumber},
+    {"ISTEXT", FunctionId::IsText, 1, 1, FUNCTION_ACCEPTS_ERRORS, &Builtins::IsText},
+    {"LEFT", FunctionId::Left, 1, 2, FUNCTION_NONE, &Builtins::Left},
+    {"LEN", FunctionId::Len, 1, 1, FUNCTION_NONE, &Builtins::Len},
+    {"LOWER", FunctionId::Lower, 1, 1, FUNCTION_NONE, &Builtins::Lower},
+    {"MATCH", FunctionId::Match, 2, 3, FUNCTION_NONE, &Builtins::Match},
+    {"MAX", FunctionId::Max, 1, VARIADIC, FUNCTION_NONE, &Builtins::Max},
+    {"MEDIAN", FunctionId::Median, 1, VARIADIC, FUNCTION_NONE, &Builtins::Median},
+    {"MID", FunctionId::Mid, 3, 3, FUNCTION_NONE, &Builtins::Mid},
+    {"MIN", FunctionId::Min, 1, VARIADIC, FUNCTION_NONE, &Builtins::Min},
+    {"MOD", FunctionId::Mod, 2, 2, FUNCTION_NONE, &Builtins::Mod},
+    {"NOT", FunctionId::Not, 1, 1, FUNCTION_NONE, &Builtins::Not},
+    {"NOW", FunctionId::Now, 0, 0, FUNCTION_VOLATILE, &Builtins::Now},
+    {"OFFSET", FunctionId::Offset, 3, 5, FUNCTION_RETURNS_REFERENCE | FUNCTION_TAKES_REFERENCE, nullptr},
+    {"OR", FunctionId::Or, 1, VARIADIC, FUNCTION_NONE, &Builtins::Or},
+    {"POWER", FunctionId::Power, 2, 2, FUNCTION_NONE, &Builtins::Power},
+    {"PRODUCT", FunctionId::Product, 1, VARIADIC, FUNCTION_NONE, &Builtins::Product},
+    {"RAND", FunctionId::Rand, 0, 0, FUNCTION_VOLATILE, &Builtins::Rand},
+    {"RIGHT", FunctionId::Right, 1, 2, FUNCTION_NONE, &Builtins::Right},
+    {"ROUND", FunctionId::Round, 1, 2, FUNCTION_NONE, &Builtins::Round},
+    {"SQRT", FunctionId::Sqrt, 1, 1, FUNCTION_NONE, &Builtins::Sqrt},
+    {"STDEV", FunctionId::StDev, 1, VARIADIC, FUNCTION_NONE, &Builtins::StDev},
+    {"SUM", FunctionId::Sum, 1, VARIADIC, FUNCTION_NONE, &Builtins::Sum},
+    {"TODAY", FunctionId::Today, 0, 0, FUNCTION_VOLATILE, &Builtins::Today},
+    {"TRIM", FunctionId::Trim, 1, 1, FUNCTION_NONE, &Builtins::Trim},
+    {"UPPER", FunctionId::Upper, 1, 1, FUNCTION_NONE, &Builtins::Upper},
+    {"VLOOKUP", FunctionId::VLookup, 3, 4, FUNCTION_NONE, &Builtins::VLookup},
+};
+
+constexpr std::size_t FUNCTION_COUNT = sizeof(FUNCTIONS) / sizeof(FUNCTIONS[0]);
+
+constexpr bool InIdOrder() {
+    for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+        if (static_cast<std::size_t>(FUNCTIONS[i].id) != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(FUNCTION_COUNT == static_cast<std::size_t>(FunctionId::VLookup) + 1, "Every FunctionId needs an entry");
+static_assert(InIdOrder(), "FUNCTIONS must be listed in FunctionId order");
+
+constexpr char FoldCase(char c) {
+    return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// FNV-1a over the upper-cased name, with the seed mixed into the offset basis.
+constexpr std::uint32_t Hash(std::string_view name, std::uint32_t seed) {
+    std::uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(FoldCase(c));
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+// A sparse table keeps the seed search short; a slot holds the entry index + 1.
+constexpr std::size_t SLOT_COUNT = 256;
+constexpr std::uint32_t NO_SEED = UINT32_MAX;
+static_assert(FUNCTION_COUNT < SLOT_COUNT && FUNCTION_COUNT < UINT8_MAX, "Grow SLOT_COUNT and the slot type");
+
+constexpr bool IsPerfect(std::uint32_t seed) {
+    bool used[SLOT_COUNT] = {};
+    for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+        const std::size_t slot = Hash(FUNCTIONS[i].name, seed) & (SLOT_COUNT - 1);
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr std::uint32_t FindSeed() {
+    for (std::uint32_t seed = 0; seed < 100000; ++seed) {
+        if (IsPerfect(seed)) {
+            return seed;
+        }
+    }
+    return NO_SEED;
+}
+
+constexpr std::uint32_t SEED = FindSeed();
+static_assert(SEED != NO_SEED, "No collision-free seed for the function table");
+
+struct SlotTable {
+    std::uint8_t slots[SLOT_COUNT];
+};
+
+constexpr SlotTable BuildSlots() {
+    SlotTable table{};
+    for (std::size_t i = 0; i < FUNCTION_COUNT; ++i) {
+        table.slots[Hash(FUNCTIONS[i].name, SEED) & (SLOT_COUNT - 1)] = static_cast<std::uint8_t>(i + 1);
+    }
+    return table;
+}
+
+constexpr SlotTable SLOTS = BuildSlots();
+
+} // namespace
+
+const FunctionInfo* FunctionRegistry::Find(std::string_view name) noexcept {
+    const std::uint8_t slot = SLOTS.slots[Hash(name, SEED) & (SLOT_COUNT - 1)];
+    if (slot == 0) {
+        return nullptr;
+    }
+    const FunctionInfo& function = FUNCTIONS[slot - 1];
+    if (name.size() != function.name.size()) {
+        return nullptr;
+    }
+    for (std::size_t i = 0; i < name.size(); ++i) {
+        if (FoldCase(name[i]) != function.name[i]) {
+            return nullptr;
+        }
+    }
+    return &function;
+}
+
+const FunctionInfo& FunctionRegistry::Get(FunctionId id) noexcept {
+    return FUNCTIONS[static_cast<std::size_t>(id)];
+}
+
+std::size_t FunctionRegistry::GetFunctionCount() noexcept {
+    return FUNCTION_COUNT;
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,113 @@
+#ifndef FUNCTION_REGISTRY_H
+#define FUNCTION_REGISTRY_H
+
+#include <cstdint>
+#include <string_view>
+#include "FunctionArguments.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @brief Built-in worksheet functions. The compiler stores these in
+ * CallFunction instructions in place of the name.
+ */
+enum class FunctionId : std::uint16_t {
+    Abs,
+    And,
+    Average,
+    Concatenate,
+    Count,
+    CountA,
+    HLookup,
+    If,
+    IfError,
+    Index,
+    Indirect,
+    Int,
+    IsBlank,
+    IsError,
+    IsNumber,
+    IsText,
+    Left,
+    Len,
+    Lower,
+    Match,
+    Max,
+    Median,
+    Mid,
+    Min,
+    Mod,
+    Not,
+    Now,
+    Offset,
+    Or,
+    Power,
+    Product,
+    Rand,
+    Right,
+    Round,
+    Sqrt,
+    StDev,
+    Sum,
+    Today,
+    Trim,
+    Upper,
+    VLookup
+};
+
+/**
+ * @brief Properties the compiler, VM and dependency tracking need to know about a function.
+ */
+enum FunctionFlags : std::uint8_t {
+    FUNCTION_NONE = 0,
+    FUNCTION_VOLATILE = 1 << 0,       ///< Recalculated on every recalc (NOW, RAND).
+    FUNCTION_ACCEPTS_ERRORS = 1 << 1, ///< Error arguments are passed in rather than short-circuiting the call.
+    FUNCTION_RETURNS_REFERENCE = 1 << 2, ///< Evaluates to a reference only known at run time (OFFSET, INDIRECT).
+    FUNCTION_TAKES_REFERENCE = 1 << 3    ///< A bare cell as the first argument is passed as a reference, not its value.
+};
+
+/**
+ * @brief A built-in implementation. Scalar arguments are already evaluated and
+ * ranges are passed unread; errors are returned, never thrown.
+ */
+using FunctionImplementation = FormulaValue (*)(const FunctionArguments& arguments);
+
+constexpr std::uint8_t VARIADIC = UINT8_MAX;
+
+struct FunctionInfo {
+    std::string_view name; ///< Upper case.
+    FunctionId id;
+    std::uint8_t minArguments;
+    std::uint8_t maxArguments; ///< VARIADIC for no limit.
+    std::uint8_t flags;
+    FunctionImplementation implementation; ///< Null for FUNCTION_RETURNS_REFERENCE; the VM evaluates those itself.
+
+    bool IsVolatile() const noexcept { return (flags & FUNCTION_VOLATILE) != 0; }
+    bool AcceptsErrors() const noexcept { return (flags & FUNCTION_ACCEPTS_ERRORS) != 0; }
+    bool ReturnsReference() const noexcept { return (flags & FUNCTION_RETURNS_REFERENCE) != 0; }
+    bool TakesReference() const noexcept { return (flags & FUNCTION_TAKES_REFERENCE) != 0; }
+};
+
+/**
+ * @class FunctionRegistry
+ * @brief The table of built-in functions, indexed by FunctionId and by name.
+ *
+ * Name lookup uses a perfect hash whose seed and slot table are computed at
+ * compile time, so Find() is one hash, one probe and one string compare. It
+ * is only used while compiling; evaluation dispatches on FunctionId.
+ */
+class FunctionRegistry {
+public:
+    /**
+     * @brief Looks a function up by name, ignoring case. Returns nullptr for unknown names.
+     */
+    static const FunctionInfo* Find(std::string_view name) noexcept;
+
+    static const FunctionInfo& Get(FunctionId id) noexcept;
+
+    static std::size_t GetFunctionCount() noexcept;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // FUNCTION_REGISTRY_H
@@ -0,0 +1,86 @@
+#ifndef GRID_REFERENCE_H
+#define GRID_REFERENCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @struct CellReference
+ * @brief Zero-based coordinates of a single cell in a workbook.
+ *
+ * Plain value type used by the compiled-formula path; it is cheap to copy and
+ * hash, unlike the string addresses used by the core data model.
+ */
+struct CellReference {
+    std::uint32_t sheet = 0;
+    std::int32_t row = 0;
+    std::int32_t column = 0;
+
+    friend bool operator==(const CellReference& a, const CellReference& b) noexcept {
+        return a.sheet == b.sheet && a.row == b.row && a.column == b.column;
+    }
+    friend bool operator!=(const CellReference& a, const CellReference& b) noexcept {
+        return !(a == b);
+    }
+};
+
+/**
+ * @struct RangeReference
+ * @brief Resolved rectangular range; bounds are inclusive and normalized so first <= last.
+ */
+struct RangeReference {
+    std::uint32_t sheet = 0;
+    std::int32_t firstRow = 0;
+    std::int32_t firstColumn = 0;
+    std::int32_t lastRow = 0;
+    std::int32_t lastColumn = 0;
+
+    std::int64_t GetRowCount() const noexcept { return static_cast<std::int64_t>(lastRow) - firstRow + 1; }
+    std::int64_t GetColumnCount() const noexcept { return static_cast<std::int64_t>(lastColumn) - firstColumn + 1; }
+
+    bool Contains(const CellReference& cell) const noexcept {
+        return cell.sheet == sheet && cell.row >= firstRow && cell.row <= lastRow &&
+               cell.column >= firstColumn && cell.column <= lastColumn;
+    }
+
+    friend bool operator==(const RangeReference& a, const RangeReference& b) noexcept {
+        return a.sheet == b.sheet && a.firstRow == b.firstRow && a.firstColumn == b.firstColumn &&
+               a.lastRow == b.lastRow && a.lastColumn == b.lastColumn;
+    }
+};
+
+/**
+ * @brief Maximum grid dimensions, matching the .xlsx format.
+ */
+constexpr std::int32_t MAX_ROWS = 1048576;
+constexpr std::int32_t MAX_COLUMNS = 16384;
+
+} // namespace ExcelCalculationEngine
+
+namespace std {
+template <>
+struct hash<ExcelCalculationEngine::CellReference> {
+    size_t operator()(const ExcelCalculationEngine::CellReference& cell) const noexcept {
+        // Rows fit in 21 bits and columns in 15, so this packing is collision free.
+        const std::uint64_t packed = (static_cast<std::uint64_t>(cell.sheet) << 36) ^
+                                     (static_cast<std::uint64_t>(static_cast<std::uint32_t>(cell.row)) << 15) ^
+                                     static_cast<std::uint64_t>(static_cast<std::uint32_t>(cell.column));
+        return std::hash<std::uint64_t>{}(packed);
+    }
+};
+
+template <>
+struct hash<ExcelCalculationEngine::RangeReference> {
+    size_t operator()(const ExcelCalculationEngine::RangeReference& range) const noexcept {
+        const hash<ExcelCalculationEngine::CellReference> corner;
+        const size_t first = corner({range.sheet, range.firstRow, range.firstColumn});
+        const size_t last = corner({range.sheet, range.lastRow, range.lastColumn});
+        return first ^ (last + 0x9e3779b97f4a7c15ull + (first << 6) + (first >> 2));
+    }
+};
+} // namespace std
+
+#endif // GRID_REFERENCE_H
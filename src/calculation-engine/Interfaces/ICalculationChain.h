@@ -3,7 +3,7 @@
 
 #include <vector>
 #include <unordered_set>
-#include "DependencyGraph.h"
+#include "../CalculationChain/DependencyGraph.h"
 #include "IFormulaParser.h"
 #include "../../../core-engine/DataStructures/Cell.h"
 
@@ -0,0 +1,86 @@
+#ifndef ICELL_VALUE_SOURCE_H
+#define ICELL_VALUE_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include "GridReference.h"
+#include "../Evaluation/FormulaValue.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @struct ColumnSegment
+ * @brief A run of consecutive cells in one column, owned by the cell source.
+ *
+ * values[i] is the cell at row firstRow + i. Rows between two segments are
+ * empty; a segment may also contain Empty values.
+ */
+struct ColumnSegment {
+    std::int32_t firstRow = 0;
+    const FormulaValue* values = nullptr;
+    std::size_t count = 0;
+};
+
+/**
+ * @interface ICellValueSource
+ * @brief Read access to current cell values for the formula VM.
+ *
+ * Implemented by whatever owns the grid (the workbook model, or a test
+ * fixture). Calls come from the evaluation loop, so implementations should
+ * not lock or allocate on the read path.
+ */
+class ICellValueSource {
+public:
+    virtual ~ICellValueSource() = default;
+
+    /**
+     * @brief Value of a cell; Empty for cells that have never been set.
+     */
+    virtual FormulaValue GetCellValue(const CellReference& cell) const = 0;
+
+    /**
+     * @brief Fast path for single-cell loads: if the cell holds a number, stores
+     * it in @p number and returns true. Otherwise returns false and the VM
+     * reads the cell with GetCellValue().
+     *
+     * Most cells that formulas read are numbers. Answering here skips
+     * building and destroying a FormulaValue for each of them. The default
+     * always returns false.
+     */
+    virtual bool TryGetNumber(const CellReference& cell, double& number) const {
+        (void)cell;
+        (void)number;
+        return false;
+    }
+
+    /**
+     * @brief Index of a sheet by name, or nullopt if there is none (the reference becomes #REF!).
+     */
+    virtual std::optional<std::uint32_t> FindSheet(const std::string& name) const = 0;
+
+    /**
+     * @brief Finds the first stored segment of a column that ends at or after @p row,
+     * looking no further than @p lastRow. Returns false when nothing else is stored.
+     *
+     * Range functions walk ranges with this, so a columnar store should return
+     * its own contiguous blocks. The default reads one cell at a time into
+     * @p buffer, which keeps it allocation-free but slow over sparse columns.
+     */
+    virtual bool NextColumnSegment(std::uint32_t sheet, std::int32_t column, std::int32_t row, std::int32_t lastRow,
+                                   ColumnSegment& segment, FormulaValue& buffer) const {
+        for (; row <= lastRow; ++row) {
+            buffer = GetCellValue(CellReference{sheet, row, column});
+            if (!buffer.IsEmpty()) {
+                segment = ColumnSegment{row, &buffer, 1};
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // ICELL_VALUE_SOURCE_H
@@ -1,20 +1,23 @@
 #ifndef PARALLEL_CALCULATION_H
 #define PARALLEL_CALCULATION_H
 
+#include <cstddef>
 #include <memory>
-#include <thread>
-#include <mutex>
-#include <condition_variable>
 #include <vector>
-#include <queue>
-#include <atomic>
-#include "../Interfaces/ICalculationChain.h"
-#include "../Optimization/CalculationOptimizer.h"
-#include "../../core-engine/DataStructures/Cell.h"
-#include "../../core-engine/DataStructures/Worksheet.h"
+#include "../CalculationChain/DependencyGraph.h"
+#include "RecalcScheduler.h"
+#include "WorkStealingPool.h"
 
 namespace ExcelCalculationEngine {
 
+/**
+ * @class ParallelCalculation
+ * @brief Multi-threaded recalculation that respects dependencies.
+ *
+ * Owns a WorkStealingPool and runs dirty nodes through a RecalcScheduler:
+ * a cell starts as soon as its precedents are done, not when a whole level
+ * of the chain is.
+ */
 class ParallelCalculation {
 public:
     // Constructor
@@ -23,35 +26,26 @@ public:
     // Destructor
     ~ParallelCalculation();
 
-    // Initialize the parallel calculation system
+    // Start the workers; threadCount includes the calling thread, 0 means one per hardware thread
     void Initialize(size_t threadCount);
 
-    // Perform parallel calculation of all cells in a worksheet
-    void CalculateWorksheet(const Worksheet& worksheet);
+    // Evaluate the given nodes, each after its precedents among them; returns once all are done.
+    // Initializes with the default thread count if needed.
+    void Recalculate(const DependencyGraph& graph, const std::vector<NodeId>& nodes,
+                     const RecalcScheduler::Evaluate& evaluate);
 
-    // Perform parallel calculation of cells within a specified range
-    void CalculateRange(const CellRange& range);
+    // Number of workers, or 0 before Initialize()
+    size_t GetThreadCount() const;
 
-    // Shut down the parallel calculation system
+    // Stop and join the workers
     void Shutdown();
 
 private:
-    // The main function executed by each worker thread
-    void WorkerThread();
-
-    // Distribute calculation tasks among worker threads
-    void DistributeTasks(const std::vector<Cell>& cells);
-
     // Member variables
-    std::shared_ptr<ICalculationChain> m_calculationChain;
-    std::unique_ptr<CalculationOptimizer> m_optimizer;
-    std::vector<std::thread> m_threads;
-    std::queue<Cell> m_taskQueue;
-    std::mutex m_mutex;
-    std::condition_variable m_conditionVariable;
-    std::atomic<bool> m_isRunning;
+    std::unique_ptr<WorkStealingPool> m_pool;
+    std::unique_ptr<RecalcScheduler> m_scheduler;
 };
 
 } // namespace ExcelCalculationEngine
 
-#endif // PARALLEL_CALCULATION_H
\ No newline at end of file
+#endif // PARALLEL_CALCULATION_H
@@ -0,0 +1,152 @@
+#include "RecalcScheduler.h"
+#include "src/calculation-engine/ErrorHandling/CalculationErrors.h"
+#include "src/core-engine/Performance/Profiler.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+using Excel::CalculationEngine::CalculationErrorCode;
+using Excel::CalculationEngine::CalculationException;
+
+// Assumed nanoseconds for a node that has never been measured.
+constexpr double UNMEASURED_COST = 1000.0;
+// Below this much estimated work the pool is not woken; the nodes run inline in calculation order.
+constexpr double MIN_COST_FOR_POOL = 256 * UNMEASURED_COST;
+// Root ranges stop splitting below this much estimated work.
+constexpr double ROOT_GRAIN_COST = 16 * UNMEASURED_COST;
+
+} // namespace
+
+RecalcScheduler::RecalcScheduler(WorkStealingPool& pool) : m_pool(pool) {}
+
+void RecalcScheduler::Run(const DependencyGraph& graph, const std::vector<NodeId>& nodes, const Evaluate& evaluate) {
+    EXCEL_PROFILE_SCOPE("RecalcScheduler::Run");
+    if (m_slots.size() < graph.GetNodeCapacity()) {
+        m_slots.resize(graph.GetNodeCapacity(), UNSCHEDULED);
+    }
+    m_graph = &graph;
+    m_nodes.clear();
+    auto resetSlots = [this] {
+        for (NodeId node : m_nodes) {
+            m_slots[node] = UNSCHEDULED;
+        }
+    };
+
+    try {
+        double cost = 0.0;
+        for (NodeId node : nodes) {
+            if (!graph.IsNode(node)) {
+                throw std::out_of_range("Unknown dependency graph node");
+            }
+            if (m_slots[node] == UNSCHEDULED) {
+                m_slots[node] = static_cast<std::uint32_t>(m_nodes.size());
+                m_nodes.push_back(node);
+                cost += EstimatedCost(node);
+            }
+        }
+
+        if (cost < MIN_COST_FOR_POOL || m_pool.GetThreadCount() == 1) {
+            std::sort(m_nodes.begin(), m_nodes.end(),
+                      [&graph](NodeId a, NodeId b) { return graph.GetOrder(a) < graph.GetOrder(b); });
+            for (NodeId node : m_nodes) {
+                evaluate(node);
+            }
+            resetSlots();
+            return;
+        }
+
+        if (m_pendingCapacity < m_nodes.size()) {
+            m_pendingCapacity = std::max(m_nodes.size(), m_pendingCapacity * 2);
+            m_pending.reset(new std::atomic<std::uint32_t>[m_pendingCapacity]);
+        }
+        m_roots.clear();
+        m_rootCosts.assign(1, 0.0);
+        for (std::uint32_t slot = 0; slot < m_nodes.size(); ++slot) {
+            std::uint32_t pending = 0;
+            graph.ForEachPrecedent(m_nodes[slot], [this, &pending](NodeId precedent) {
+                pending += m_slots[precedent] != UNSCHEDULED;
+            });
+            m_pending[slot].store(pending, std::memory_order_relaxed);
+            if (pending == 0) {
+                m_roots.push_back(slot);
+                m_rootCosts.push_back(m_rootCosts.back() + EstimatedCost(m_nodes[slot]));
+            }
+        }
+
+        m_evaluate = &evaluate;
+        if (!m_roots.empty()) {
+            m_pool.Run({ROOT_RANGE | (static_cast<Task>(m_roots.size()) << 32)}, [this](Task task) { Execute(task); });
+        }
+
+        // Nodes whose count never reached zero sit on a cycle inside the set.
+        for (std::uint32_t slot = 0; slot < m_nodes.size(); ++slot) {
+            if (m_pending[slot].load(std::memory_order_relaxed) != 0) {
+                throw CalculationException(CalculationErrorCode::CIRCULAR_REFERENCE, "Circular dependency detected");
+            }
+        }
+    } catch (...) {
+        resetSlots();
+        throw;
+    }
+    resetSlots();
+}
+
+void RecalcScheduler::Execute(Task task) {
+    if ((task & ROOT_RANGE) == 0) {
+        RunChain(static_cast<std::uint32_t>(task));
+        return;
+    }
+    const std::uint64_t start = task & UINT32_MAX;
+    std::uint64_t count = (task & ~ROOT_RANGE) >> 32;
+    // Keep the front half of the work and offer the back half; thieves take the oldest, i.e. largest, halves.
+    while (count > 1 && m_rootCosts[start + count] - m_rootCosts[start] > ROOT_GRAIN_COST) {
+        const double middle = (m_rootCosts[start] + m_rootCosts[start + count]) / 2;
+        const auto first = m_rootCosts.begin() + static_cast<std::ptrdiff_t>(start);
+        const std::uint64_t half = std::min<std::uint64_t>(
+            static_cast<std::uint64_t>(std::upper_bound(first + 1, first + static_cast<std::ptrdiff_t>(count), middle) - first),
+            count - 1);
+        m_pool.Spawn(ROOT_RANGE | ((count - half) << 32) | (start + half));
+        count = half;
+    }
+    for (std::uint64_t i = start; i < start + count; ++i) {
+        RunChain(m_roots[i]);
+    }
+}
+
+void RecalcScheduler::RunChain(std::uint32_t slot) {
+    for (;;) {
+        const NodeId node = m_nodes[slot];
+        (*m_evaluate)(node);
+
+        std::uint32_t next = UNSCHEDULED;
+        m_graph->ForEachDependent(node, [this, &next](NodeId dependent) {
+            const std::uint32_t dependentSlot = m_slots[dependent];
+            if (dependentSlot == UNSCHEDULED ||
+                m_pending[dependentSlot].fetch_sub(1, std::memory_order_acq_rel) != 1) {
+                return;
+            }
+            if (next == UNSCHEDULED) {
+                next = dependentSlot;
+            } else if (EstimatedCost(dependent) > EstimatedCost(m_nodes[next])) {
+                m_pool.Spawn(next);
+                next = dependentSlot;
+            } else {
+                m_pool.Spawn(dependentSlot);
+            }
+        });
+        if (next == UNSCHEDULED) {
+            return;
+        }
+        slot = next;
+    }
+}
+
+double RecalcScheduler::EstimatedCost(NodeId node) const noexcept {
+    const float cost = m_graph->GetCost(node);
+    return cost > 0.0f ? cost : UNMEASURED_COST;
+}
+
+} // namespace ExcelCalculationEngine
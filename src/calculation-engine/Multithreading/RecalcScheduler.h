@@ -0,0 +1,74 @@
+#ifndef RECALC_SCHEDULER_H
+#define RECALC_SCHEDULER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "../CalculationChain/DependencyGraph.h"
+#include "WorkStealingPool.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class RecalcScheduler
+ * @brief Runs a set of graph nodes on a WorkStealingPool, each one as soon as
+ * its precedents within the set are done.
+ *
+ * Every node gets an atomic count of unfinished precedents in the set. The
+ * worker that finishes a node decrements its dependents' counts; the most
+ * expensive one to reach zero runs next on the same worker, and any others
+ * are pushed for stealing. A chain of cells therefore runs as one task with
+ * no deque traffic, and only real fan-out is handed to other cores. The
+ * ready nodes at the start are handed out as ranges that split into halves
+ * of equal estimated cost when stolen.
+ *
+ * Costs come from DependencyGraph::GetCost(), i.e. earlier recalculations.
+ * Sets with too little estimated work to pay for waking the pool run
+ * inline in calculation order.
+ */
+class RecalcScheduler {
+public:
+    using Evaluate = std::function<void(NodeId)>;
+
+    explicit RecalcScheduler(WorkStealingPool& pool);
+
+    /**
+     * @brief Calls evaluate(node) once for each distinct node in @p nodes,
+     * after every precedent of it that is also in @p nodes. Other precedents
+     * are assumed up to date. The graph must not change until this returns,
+     * other than @p evaluate recording costs.
+     */
+    void Run(const DependencyGraph& graph, const std::vector<NodeId>& nodes, const Evaluate& evaluate);
+
+private:
+    using Task = WorkStealingPool::Task;
+
+    /// Tasks with this bit set are a range of m_roots: start in the low 32 bits, count in bits 32-62.
+    static constexpr Task ROOT_RANGE = Task{1} << 63;
+    static constexpr std::uint32_t UNSCHEDULED = UINT32_MAX;
+
+    void Execute(Task task);
+
+    /// Nanoseconds @p node is expected to take, with a default for nodes never measured.
+    double EstimatedCost(NodeId node) const noexcept;
+
+    /// Evaluates slot @p slot, then whichever dependent it readies first, and so on.
+    void RunChain(std::uint32_t slot);
+
+    WorkStealingPool& m_pool;
+    const DependencyGraph* m_graph = nullptr;
+    const Evaluate* m_evaluate = nullptr;
+    std::vector<std::uint32_t> m_slots;  ///< Indexed by NodeId: position in m_nodes, or UNSCHEDULED.
+    std::vector<NodeId> m_nodes;
+    std::unique_ptr<std::atomic<std::uint32_t>[]> m_pending; ///< Unfinished precedents per slot.
+    std::size_t m_pendingCapacity = 0;
+    std::vector<std::uint32_t> m_roots;  ///< Slots with no precedent in the set.
+    std::vector<double> m_rootCosts;     ///< Prefix sums: m_rootCosts[i] is the estimated cost of m_roots[0, i).
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // RECALC_SCHEDULER_H
@@ -0,0 +1,132 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class WorkStealingDeque
+ * @brief Chase-Lev deque of 64-bit tasks: the owning thread pushes and pops
+ * at the bottom, any other thread steals from the top.
+ *
+ * Memory orderings follow Le, Pop, Cohen and Zappa Nardelli, "Correct and
+ * Efficient Work-Stealing for Weak Memory Models" (PPoPP 2013). The ring
+ * doubles when full. Outgrown rings are kept until destruction, because a
+ * thief may still be reading one; they add up to less than the live ring.
+ */
+class WorkStealingDeque {
+public:
+    using Task = std::uint64_t;
+
+    explicit WorkStealingDeque(std::size_t capacity = 1024) {
+        std::size_t rounded = 1;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        m_rings.push_back(std::make_unique<Ring>(rounded));
+        m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    /**
+     * @brief Owner only.
+     */
+    void Push(Task task) {
+        const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+        const std::int64_t top = m_top.load(std::memory_order_acquire);
+        Ring* ring = m_ring.load(std::memory_order_relaxed);
+        if (bottom - top > static_cast<std::int64_t>(ring->mask)) {
+            ring = Grow(ring, top, bottom);
+        }
+        ring->Store(bottom, task);
+        // A release store rather than the paper's release fence: same ordering, and visible to TSan.
+        m_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Owner only. Takes the most recently pushed task.
+     */
+    bool Pop(Task& task) {
+        const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        Ring* ring = m_ring.load(std::memory_order_relaxed);
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        std::int64_t top = m_top.load(std::memory_order_relaxed);
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return false;
+        }
+        task = ring->Load(bottom);
+        if (top == bottom) {
+            // Last task: race the thieves for it.
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                                           std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Any thread. Takes the oldest task; fails if empty or if another thread got there first.
+     */
+    bool Steal(Task& task) {
+        std::int64_t top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+        if (top >= bottom) {
+            return false;
+        }
+        task = m_ring.load(std::memory_order_acquire)->Load(top);
+        return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief A hint only; exact for the owner when no thief is active.
+     */
+    bool IsEmpty() const noexcept {
+        return m_bottom.load(std::memory_order_relaxed) <= m_top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Ring {
+        explicit Ring(std::size_t capacity) : mask(capacity - 1), slots(new std::atomic<Task>[capacity]) {}
+
+        Task Load(std::int64_t index) const noexcept {
+            return slots[static_cast<std::size_t>(index) & mask].load(std::memory_order_relaxed);
+        }
+        void Store(std::int64_t index, Task task) noexcept {
+            slots[static_cast<std::size_t>(index) & mask].store(task, std::memory_order_relaxed);
+        }
+
+        std::size_t mask;
+        std::unique_ptr<std::atomic<Task>[]> slots;
+    };
+
+    Ring* Grow(Ring* ring, std::int64_t top, std::int64_t bottom) {
+        auto grown = std::make_unique<Ring>((ring->mask + 1) * 2);
+        for (std::int64_t i = top; i < bottom; ++i) {
+            grown->Store(i, ring->Load(i));
+        }
+        m_rings.push_back(std::move(grown));
+        m_ring.store(m_rings.back().get(), std::memory_order_release);
+        return m_rings.back().get();
+    }
+
+    // Owner and thieves write different ends; keep them off one cache line.
+    alignas(64) std::atomic<std::int64_t> m_top{0};
+    alignas(64) std::atomic<std::int64_t> m_bottom{0};
+    std::atomic<Ring*> m_ring{nullptr};
+    std::vector<std::unique_ptr<Ring>> m_rings; ///< Owner only. Current ring last.
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // WORK_STEALING_DEQUE_H
@@ -0,0 +1,186 @@
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace ExcelCalculationEngine {
+
+namespace {
+
+// Failed FindTask() rounds, each followed by a yield, before an idle worker sleeps.
+constexpr int SPIN_ROUNDS = 64;
+
+// The pool and worker slot of the current thread, so Spawn() can find its deque.
+thread_local WorkStealingPool* t_pool = nullptr;
+thread_local std::size_t t_worker = 0;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(std::size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers.back()->random = (i + 1) * 0x9E3779B97F4A7C15ull;
+    }
+    // Worker 0 is whichever thread calls Run().
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        m_threads.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    m_stopping.store(true);
+    WakeAll();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::Spawn(Task task) {
+    if (t_pool != this) {
+        throw std::logic_error("WorkStealingPool::Spawn called outside a task of this pool");
+    }
+    // The spawning task is still outstanding, so the count cannot reach zero in between.
+    m_outstanding.fetch_add(1, std::memory_order_relaxed);
+    m_workers[t_worker]->deque.Push(task);
+    // Pairs with the fence in WaitForWork(): either the sleeper sees the task or we see the sleeper.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleepers.load(std::memory_order_relaxed) != 0) {
+        WakeOne();
+    }
+}
+
+void WorkStealingPool::RunErased(const std::vector<Task>& tasks, ExecuteFunction execute, void* context) {
+    std::lock_guard<std::mutex> run(m_runMutex);
+    if (tasks.empty()) {
+        return;
+    }
+    m_execute = execute;
+    m_context = context;
+    m_error = nullptr;
+    m_outstanding.store(tasks.size(), std::memory_order_relaxed);
+
+    WorkStealingPool* const previousPool = t_pool;
+    const std::size_t previousWorker = t_worker;
+    t_pool = this;
+    t_worker = 0;
+    for (Task task : tasks) {
+        m_workers[0]->deque.Push(task);
+    }
+    WakeAll();
+
+    Task task;
+    while (m_outstanding.load(std::memory_order_acquire) != 0) {
+        if (FindTask(0, task)) {
+            Execute(task);
+        } else {
+            WaitForWork(true);
+        }
+    }
+    t_pool = previousPool;
+    t_worker = previousWorker;
+
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void WorkStealingPool::WorkerLoop(std::size_t self) {
+    t_pool = this;
+    t_worker = self;
+    Task task;
+    for (;;) {
+        if (FindTask(self, task)) {
+            Execute(task);
+        } else if (!WaitForWork(false)) {
+            return;
+        }
+    }
+}
+
+bool WorkStealingPool::FindTask(std::size_t self, Task& task) {
+    Worker& worker = *m_workers[self];
+    if (worker.deque.Pop(task)) {
+        return true;
+    }
+    const std::size_t count = m_workers.size();
+    worker.random ^= worker.random << 13;
+    worker.random ^= worker.random >> 7;
+    worker.random ^= worker.random << 17;
+    const std::size_t start = static_cast<std::size_t>(worker.random % count);
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t victim = (start + i) % count;
+        if (victim != self && m_workers[victim]->deque.Steal(task)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Execute(Task task) {
+    try {
+        m_execute(m_context, task);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        if (!m_error) {
+            m_error = std::current_exception();
+        }
+    }
+    if (m_outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        WakeAll(); // The Run() caller may be asleep.
+    }
+}
+
+bool WorkStealingPool::WaitForWork(bool runCaller) {
+    const std::uint64_t generation = m_wakeGeneration.load();
+    for (int round = 0; round < SPIN_ROUNDS; ++round) {
+        for (const auto& worker : m_workers) {
+            if (!worker->deque.IsEmpty()) {
+                return true;
+            }
+        }
+        if (m_stopping.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        if (runCaller && m_outstanding.load(std::memory_order_acquire) == 0) {
+            return true;
+        }
+        std::this_thread::yield();
+    }
+
+    m_sleepers.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool work = false;
+    for (const auto& worker : m_workers) {
+        work = work || !worker->deque.IsEmpty();
+    }
+    if (!work && !(runCaller && m_outstanding.load(std::memory_order_acquire) == 0)) {
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        m_wakeCondition.wait(lock, [this, generation] {
+            return m_wakeGeneration.load() != generation || m_stopping.load();
+        });
+    }
+    m_sleepers.fetch_sub(1);
+    return !m_stopping.load();
+}
+
+void WorkStealingPool::WakeOne() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeGeneration.fetch_add(1);
+    }
+    m_wakeCondition.notify_one();
+}
+
+void WorkStealingPool::WakeAll() {
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wakeGeneration.fetch_add(1);
+    }
+    m_wakeCondition.notify_all();
+}
+
+} // namespace ExcelCalculationEngine
@@ -0,0 +1,99 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include "WorkStealingDeque.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class WorkStealingPool
+ * @brief Fixed set of workers, one Chase-Lev deque each.
+ *
+ * A task is a 64-bit value the caller of Run() interprets. Tasks spawned
+ * from inside a task go to the spawning worker's own deque and run
+ * newest-first there, so related work stays on one core. Idle workers steal
+ * the oldest tasks from random victims. The thread calling Run() is worker 0
+ * and works until every task has finished; the others spin briefly when
+ * idle, then sleep.
+ *
+ * One Run() at a time.
+ */
+class WorkStealingPool {
+public:
+    using Task = WorkStealingDeque::Task;
+
+    /**
+     * @param threadCount Workers including the caller of Run(); 0 means one per hardware thread.
+     */
+    explicit WorkStealingPool(std::size_t threadCount = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    std::size_t GetThreadCount() const noexcept { return m_workers.size(); }
+
+    /**
+     * @brief Calls execute(task) for each of @p tasks and for everything they
+     * Spawn(), on any worker. Returns once all of it has finished, rethrowing
+     * the first exception a task threw; the remaining tasks still run.
+     */
+    template <typename Execute>
+    void Run(const std::vector<Task>& tasks, Execute&& execute) {
+        auto call = [](void* context, Task task) { (*static_cast<std::remove_reference_t<Execute>*>(context))(task); };
+        RunErased(tasks, call, &execute);
+    }
+
+    /**
+     * @brief Queues @p task on the calling worker. Only valid inside a task of this pool.
+     */
+    void Spawn(Task task);
+
+private:
+    using ExecuteFunction = void (*)(void*, Task);
+
+    struct Worker {
+        WorkStealingDeque deque;
+        std::uint64_t random = 0; ///< xorshift state for picking victims
+    };
+
+    void RunErased(const std::vector<Task>& tasks, ExecuteFunction execute, void* context);
+    void WorkerLoop(std::size_t self);
+    bool FindTask(std::size_t self, Task& task);
+    void Execute(Task task);
+
+    /// Spins, then sleeps until woken. Returns false when the pool is stopping.
+    bool WaitForWork(bool runCaller);
+    void WakeOne();
+    void WakeAll();
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    ExecuteFunction m_execute = nullptr;
+    void* m_context = nullptr;
+    std::atomic<std::size_t> m_outstanding{0}; ///< Queued or running tasks of the current Run().
+    std::mutex m_errorMutex;
+    std::exception_ptr m_error;
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wakeCondition;
+    std::atomic<std::uint64_t> m_wakeGeneration{0};
+    std::atomic<std::size_t> m_sleepers{0};
+    std::atomic<bool> m_stopping{false};
+    std::mutex m_runMutex;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // WORK_STEALING_POOL_H
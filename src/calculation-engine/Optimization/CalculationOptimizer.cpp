@@ -3,11 +3,15 @@
 #include "../../core-engine/DataStructures/Cell.h"
 #include "../../core-engine/DataStructures/Worksheet.h"
 #include "../FormulaParser/FormulaParser.h"
+#include "../CalculationChain/StronglyConnectedComponents.h"
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
 #include <memory>
 
+using ExcelCalculationEngine::ForEachStronglyConnectedComponent;
+using ExcelCalculationEngine::NodeId;
+
 CalculationOptimizer::CalculationOptimizer() : m_cellCache() {}
 
 void CalculationOptimizer::OptimizeCalculationChain(const Worksheet& worksheet) {
@@ -181,41 +185,46 @@ std::string CalculationOptimizer::GenerateCacheKey(const Cell& cell) const {
 
 void CalculationOptimizer::IdentifyCircularReferences() {
     m_circularReferences.clear();
-    std::unordered_set<std::string> visited;
-    std::unordered_set<std::string> recursionStack;
 
+    // Dense ids for every cell that appears in the graph, as a formula or as a reference.
+    std::unordered_map<std::string, NodeId> ids;
+    std::vector<const std::string*> cellIds;
+    auto idOf = [&ids, &cellIds](const std::string& cellId) {
+        auto inserted = ids.emplace(cellId, static_cast<NodeId>(cellIds.size()));
+        if (inserted.second) {
+            cellIds.push_back(&inserted.first->first);
+        }
+        return inserted.first->second;
+    };
+    std::vector<std::vector<NodeId>> precedents;
     for (const auto& entry : m_dependencyGraph) {
-        if (HasCircularDependency(entry.first, visited, recursionStack)) {
-            m_circularReferences.insert(entry.first);
+        const NodeId dependent = idOf(entry.first);
+        std::vector<NodeId> row;
+        row.reserve(entry.second.size());
+        for (const auto& dependency : entry.second) {
+            row.push_back(idOf(dependency));
         }
+        precedents.resize(cellIds.size());
+        precedents[dependent] = std::move(row);
     }
-}
-
-bool CalculationOptimizer::HasCircularDependency(const std::string& cellId,
-                                                 std::unordered_set<std::string>& visited,
-                                                 std::unordered_set<std::string>& recursionStack) {
-    if (recursionStack.find(cellId) != recursionStack.end()) {
-        return true;
-    }
-
-    if (visited.find(cellId) != visited.end()) {
-        return false;
-    }
+    precedents.resize(cellIds.size());
 
-    visited.insert(cellId);
-    recursionStack.insert(cellId);
-
-    auto it = m_dependencyGraph.find(cellId);
-    if (it != m_dependencyGraph.end()) {
-        for (const auto& dependency : it->second) {
-            if (HasCircularDependency(dependency, visited, recursionStack)) {
-                return true;
+    ForEachStronglyConnectedComponent<NodeId>(
+        cellIds.size(), [](NodeId) { return true; },
+        [&precedents](NodeId node, auto&& visit) {
+            for (NodeId precedent : precedents[node]) {
+                visit(precedent);
             }
-        }
-    }
-
-    recursionStack.erase(cellId);
-    return false;
+        },
+        [this, &precedents, &cellIds](const NodeId* first, const NodeId* last) {
+            const bool circular = last - first > 1 ||
+                std::find(precedents[*first].begin(), precedents[*first].end(), *first) != precedents[*first].end();
+            if (circular) {
+                for (const NodeId* node = first; node != last; ++node) {
+                    m_circularReferences.insert(*cellIds[*node]);
+                }
+            }
+        });
 }
 
 void CalculationOptimizer::DetermineParallelGroups() {
@@ -1,15 +1,25 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include "../../CalculationChain/CalculationChain.h"
 #include "../../Interfaces/ICalculationChain.h"
 #include "../../../core-engine/DataStructures/Cell.h"
 #include "../../ErrorHandling/CalculationErrors.h"
+#include "../../Evaluation/FormulaVM.h"
+#include "../../FormulaParser/FormulaCompiler.h"
+#include "TestCellSource.h"
 
 using namespace testing;
 using namespace std;
 
+class MockCellCalculator {
+public:
+    MOCK_METHOD(void, Calculate, (Cell& cell));
+};
+
 class CalculationChainTest : public Test {
 protected:
     unique_ptr<CalculationChain> calculationChain;
@@ -153,4 +163,359 @@ TEST_F(CalculationChainTest, TestLargeDataset) {
     EXPECT_LT(duration.count(), 5000); // Assuming it should take less than 5 seconds
 }
 
-// Additional tests can be added here to cover more scenarios and edge cases
\ No newline at end of file
+TEST_F(CalculationChainTest, TestTimeSlicedRecalculationResumes) {
+    vector<shared_ptr<Cell>> cells;
+    for (int i = 0; i < 5000; ++i) {
+        cells.push_back(make_shared<Cell>());
+        calculationChain->AddCell(cells.back());
+        if (i > 0) {
+            calculationChain->UpdateDependencies(cells[i], {cells[i - 1]});
+        }
+    }
+    calculationChain->InvalidateCell(cells[0]);
+
+    // A zero slice still makes progress: one cell per call
+    CancellationToken cancellation;
+    int slices = 1;
+    while (!calculationChain->RecalculateChain(chrono::nanoseconds(0), cancellation)) {
+        ++slices;
+    }
+    EXPECT_EQ(slices, 5000);
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+    for (const auto& cell : cells) {
+        EXPECT_FALSE(cell->IsDirty());
+    }
+}
+
+TEST_F(CalculationChainTest, TestCancelledRecalculationKeepsItsWork) {
+    for (const auto& cell : mockCells) {
+        calculationChain->AddCell(cell);
+    }
+    calculationChain->UpdateDependencies(mockCells[0], {mockCells[1]});
+    calculationChain->InvalidateCell(mockCells[1]);
+
+    CancellationToken cancellation;
+    cancellation.Cancel();
+    EXPECT_FALSE(calculationChain->RecalculateChain(chrono::seconds(1), cancellation));
+    EXPECT_TRUE(mockCells[0]->IsDirty());
+    EXPECT_TRUE(calculationChain->HasPendingWork());
+
+    cancellation.Reset();
+    EXPECT_TRUE(calculationChain->RecalculateChain(chrono::seconds(1), cancellation));
+    EXPECT_FALSE(mockCells[0]->IsDirty());
+    EXPECT_FALSE(mockCells[1]->IsDirty());
+}
+
+TEST_F(CalculationChainTest, TestPriorityRegionIsCalculatedFirst) {
+    // Two independent columns of 100 chained cells; only column C is visible
+    vector<shared_ptr<Cell>> columnA;
+    vector<shared_ptr<Cell>> columnC;
+    for (int row = 0; row < 100; ++row) {
+        columnA.push_back(make_shared<Cell>());
+        columnC.push_back(make_shared<Cell>());
+        calculationChain->AddCell(columnA.back(), CellReference{0, row, 0});
+        calculationChain->AddCell(columnC.back(), CellReference{0, row, 2});
+        if (row > 0) {
+            calculationChain->UpdateDependencies(columnA[row], {columnA[row - 1]});
+            calculationChain->UpdateDependencies(columnC[row], {columnC[row - 1]});
+        }
+    }
+    calculationChain->InvalidateCell(columnA[0]);
+    calculationChain->InvalidateCell(columnC[0]);
+    // The viewport shows C50:C99, which still needs C1:C49 first
+    calculationChain->SetPriorityRegion(RangeReference{0, 50, 2, 99, 2});
+
+    CancellationToken cancellation;
+    for (int slice = 0; slice < 100; ++slice) {
+        EXPECT_FALSE(calculationChain->RecalculateChain(chrono::nanoseconds(0), cancellation));
+    }
+    for (int row = 0; row < 100; ++row) {
+        EXPECT_FALSE(columnC[row]->IsDirty());
+        EXPECT_TRUE(columnA[row]->IsDirty());
+    }
+    EXPECT_TRUE(calculationChain->RecalculateChain(chrono::seconds(1), cancellation));
+    EXPECT_FALSE(columnA[99]->IsDirty());
+}
+
+TEST_F(CalculationChainTest, TestVolatileCellsSeedEachRecalculation) {
+    for (const auto& cell : mockCells) {
+        calculationChain->AddCell(cell);
+    }
+    calculationChain->UpdateDependencies(mockCells[1], {mockCells[0]});
+    calculationChain->UpdateDependencies(mockCells[2], {mockCells[1]});
+    calculationChain->UpdateDependencies(mockCells[4], {mockCells[3]});
+    calculationChain->SetVolatile(mockCells[0], true);
+
+    // Only the volatile cell and what reads it are invalidated
+    calculationChain->InvalidateVolatileCells();
+    EXPECT_TRUE(mockCells[0]->IsDirty());
+    EXPECT_TRUE(mockCells[2]->IsDirty());
+    EXPECT_FALSE(mockCells[3]->IsDirty());
+    EXPECT_FALSE(mockCells[4]->IsDirty());
+
+    calculationChain->RecalculateChain();
+    EXPECT_FALSE(mockCells[2]->IsDirty());
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+
+    calculationChain->SetVolatile(mockCells[0], false);
+    calculationChain->InvalidateVolatileCells();
+    EXPECT_FALSE(mockCells[0]->IsDirty());
+}
+
+TEST_F(CalculationChainTest, TestDynamicDependenciesAreRecorded) {
+    // mockCells[1] reads A1 through INDIRECT, which no static analysis can see
+    const RangeReference a1{0, 0, 0, 0, 0};
+    calculationChain->AddCell(mockCells[0], CellReference{0, 0, 0});
+    calculationChain->AddCell(mockCells[1]);
+    calculationChain->AddCell(mockCells[2]);
+    calculationChain->UpdateDependencies(mockCells[2], {mockCells[1]});
+
+    // Recorded while A1 was still dirty: the value read was stale
+    calculationChain->InvalidateCell(mockCells[0]);
+    EXPECT_TRUE(calculationChain->SetDynamicDependencies(mockCells[1], {a1}));
+    calculationChain->RecalculateChain();
+    EXPECT_FALSE(mockCells[1]->IsDirty());
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+    auto order = calculationChain->GetCalculationOrder();
+    EXPECT_LT(find(order.begin(), order.end(), mockCells[0]), find(order.begin(), order.end(), mockCells[1]));
+
+    // Reading the same cells again changes nothing
+    EXPECT_FALSE(calculationChain->SetDynamicDependencies(mockCells[1], {a1, a1}));
+
+    // Edits to A1 now reach the reader and what reads it, and nothing is volatile
+    calculationChain->InvalidateCell(CellReference{0, 0, 0});
+    EXPECT_TRUE(mockCells[1]->IsDirty());
+    EXPECT_TRUE(mockCells[2]->IsDirty());
+    calculationChain->RecalculateChain();
+
+    // Once the cell stops reading A1 the edge goes, but its static precedents stay
+    EXPECT_FALSE(calculationChain->SetDynamicDependencies(mockCells[1], {}));
+    calculationChain->InvalidateCell(CellReference{0, 0, 0});
+    EXPECT_FALSE(mockCells[1]->IsDirty());
+    calculationChain->InvalidateCell(mockCells[1]);
+    EXPECT_TRUE(mockCells[2]->IsDirty());
+
+    // Reading a cell that reads this one is a circular reference, found when it happens
+    calculationChain->AddCell(mockCells[3], CellReference{0, 0, 1});
+    calculationChain->UpdateDependencies(mockCells[3], {mockCells[1]});
+    EXPECT_THROW(calculationChain->SetDynamicDependencies(mockCells[1], {RangeReference{0, 0, 0, 0, 1}}),
+                 Excel::CalculationEngine::CalculationException);
+    EXPECT_FALSE(calculationChain->SetDynamicDependencies(mockCells[1], {}));
+}
+
+TEST_F(CalculationChainTest, TestCutoffStillCleansEveryDirtyCell) {
+    // 4 reads 3 reads ... reads 0; whether or not a recalculated value changes, nothing is left dirty
+    for (const auto& cell : mockCells) {
+        calculationChain->AddCell(cell);
+    }
+    for (int i = 1; i < 5; ++i) {
+        calculationChain->UpdateDependencies(mockCells[i], {mockCells[i - 1]});
+    }
+    calculationChain->InvalidateCell(mockCells[0]);
+    EXPECT_TRUE(mockCells[4]->IsDirty());
+    calculationChain->RecalculateChain();
+    for (const auto& cell : mockCells) {
+        EXPECT_FALSE(cell->IsDirty());
+    }
+
+    calculationChain->InvalidateCell(mockCells[2]);
+    EXPECT_FALSE(mockCells[1]->IsDirty());
+    EXPECT_TRUE(mockCells[4]->IsDirty());
+    EXPECT_TRUE(calculationChain->RecalculateChain(chrono::seconds(1), CancellationToken()));
+    EXPECT_FALSE(mockCells[3]->IsDirty());
+    EXPECT_FALSE(mockCells[4]->IsDirty());
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+}
+
+TEST_F(CalculationChainTest, TestBatchedEditsMergeIntoOnePass) {
+    // mockCells[0] sums A1:A3 and the rest read it in a chain
+    calculationChain->AddCell(mockCells[0], CellReference{0, 0, 1});
+    calculationChain->UpdateDependencies(mockCells[0], {}, {RangeReference{0, 0, 0, 2, 0}});
+    for (int i = 1; i < 5; ++i) {
+        calculationChain->AddCell(mockCells[i]);
+        calculationChain->UpdateDependencies(mockCells[i], {mockCells[i - 1]});
+    }
+
+    // A thousand ticks on three cells, invalidated together
+    vector<CellReference> edits;
+    for (int tick = 0; tick < 1000; ++tick) {
+        edits.push_back(CellReference{0, tick % 3, 0});
+    }
+    edits.push_back(CellReference{0, 5, 0}); // read by nothing
+    calculationChain->InvalidateCells(edits);
+    for (const auto& cell : mockCells) {
+        EXPECT_TRUE(cell->IsDirty());
+    }
+    calculationChain->RecalculateChain();
+    for (const auto& cell : mockCells) {
+        EXPECT_FALSE(cell->IsDirty());
+    }
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+}
+
+TEST_F(CalculationChainTest, TestBulkLoadKeepsLoops) {
+    // 0 and 1 read each other through a range, 2 reads the loop
+    calculationChain->AddCell(mockCells[0], CellReference{0, 0, 0});
+    calculationChain->AddCell(mockCells[1], CellReference{0, 1, 0});
+    calculationChain->AddCell(mockCells[2]);
+    calculationChain->BeginBulkLoad();
+    calculationChain->UpdateDependencies(mockCells[0], {}, {RangeReference{0, 1, 0, 1, 0}});
+    calculationChain->UpdateDependencies(mockCells[1], {mockCells[0]});
+    calculationChain->UpdateDependencies(mockCells[2], {mockCells[1]});
+    auto loops = calculationChain->EndBulkLoad();
+    ASSERT_EQ(loops.size(), 1u);
+    EXPECT_THAT(loops[0], UnorderedElementsAre(mockCells[0], mockCells[1]));
+    EXPECT_EQ(calculationChain->GetCalculationOrder().back(), mockCells[2]);
+
+    // Reading 2 back would close a second loop, which the order alone cannot see
+    EXPECT_THROW(calculationChain->UpdateDependencies(mockCells[0], {mockCells[2]}, {RangeReference{0, 1, 0, 1, 0}}),
+                 Excel::CalculationEngine::CalculationException);
+    calculationChain->InvalidateCells({mockCells[0], mockCells[2]});
+    EXPECT_TRUE(mockCells[1]->IsDirty());
+    calculationChain->RecalculateChain();
+    EXPECT_FALSE(mockCells[2]->IsDirty());
+}
+
+TEST_F(CalculationChainTest, TestLoopsAreCalculatedTogether) {
+    // 0 and 1 read each other, 2 reads 1 and 3 reads 2
+    for (const auto& cell : mockCells) {
+        calculationChain->AddCell(cell);
+    }
+    calculationChain->BeginBulkLoad();
+    calculationChain->UpdateDependencies(mockCells[0], {mockCells[1]});
+    calculationChain->UpdateDependencies(mockCells[1], {mockCells[0]});
+    calculationChain->UpdateDependencies(mockCells[2], {mockCells[1]});
+    calculationChain->UpdateDependencies(mockCells[3], {mockCells[2]});
+    calculationChain->EndBulkLoad();
+    calculationChain->InvalidateCells({mockCells[0], mockCells[2]});
+
+    double loopValue = 1.0;
+    vector<vector<Cell*>> loopRuns;
+    calculationChain->SetLoopCalculator([&](const vector<Cell*>& cells) {
+        loopRuns.push_back(cells);
+        for (Cell* cell : cells) {
+            cell->SetValue(loopValue);
+        }
+    });
+    MockCellCalculator calculator;
+    ON_CALL(calculator, Calculate(_)).WillByDefault([](Cell& cell) { cell.SetValue(2.0); });
+    calculationChain->SetCellCalculator([&calculator](Cell& cell) { calculator.Calculate(cell); });
+
+    EXPECT_CALL(calculator, Calculate(_)).Times(2);
+    calculationChain->RecalculateChain();
+    Mock::VerifyAndClearExpectations(&calculator);
+    ASSERT_EQ(loopRuns.size(), 1u);
+    EXPECT_THAT(loopRuns[0], UnorderedElementsAre(mockCells[0].get(), mockCells[1].get()));
+
+    // The loop comes out unchanged, so nothing outside it runs
+    EXPECT_CALL(calculator, Calculate(_)).Times(0);
+    calculationChain->InvalidateCell(mockCells[0]);
+    calculationChain->RecalculateChain();
+    Mock::VerifyAndClearExpectations(&calculator);
+    EXPECT_EQ(loopRuns.size(), 2u);
+
+    // Values set outside the chain: only the readers outside the loop run
+    loopValue = 3.0;
+    mockCells[0]->SetValue(loopValue);
+    mockCells[1]->SetValue(loopValue);
+    calculationChain->InvalidateDependents({mockCells[0], mockCells[1]});
+    EXPECT_FALSE(mockCells[0]->IsDirty());
+    EXPECT_CALL(calculator, Calculate(Ref(*mockCells[2]))).Times(1);
+    EXPECT_CALL(calculator, Calculate(Ref(*mockCells[3]))).Times(0); // 2 comes out 2 again
+    calculationChain->RecalculateChain();
+    Mock::VerifyAndClearExpectations(&calculator);
+    EXPECT_EQ(loopRuns.size(), 2u);
+    for (const auto& cell : mockCells) {
+        EXPECT_FALSE(cell->IsDirty());
+    }
+}
+
+// Additional tests can be added here to cover more scenarios and edge cases
+
+TEST_F(CalculationChainTest, TestUnchangedValuesAreNotPropagated) {
+    // mockCells[1] caps mockCells[0] at 10, 2 reads 1 and 3 reads 2
+    for (const auto& cell : mockCells) {
+        calculationChain->AddCell(cell);
+    }
+    for (int i = 1; i < 4; ++i) {
+        calculationChain->UpdateDependencies(mockCells[i], {mockCells[i - 1]});
+    }
+    double input = 0.0;
+    MockCellCalculator calculator;
+    ON_CALL(calculator, Calculate(_)).WillByDefault([&](Cell& cell) {
+        if (&cell == mockCells[0].get()) {
+            cell.SetValue(input);
+        } else if (&cell == mockCells[1].get()) {
+            cell.SetValue(min(input, 10.0));
+        } else {
+            cell.SetValue(1.0);
+        }
+    });
+    calculationChain->SetCellCalculator([&calculator](Cell& cell) { calculator.Calculate(cell); });
+
+    // Sets mockCells[0] to newInput and checks how often each cell is recalculated
+    auto recalculate = [&](double newInput, vector<int> runs) {
+        input = newInput;
+        for (int i = 0; i < 4; ++i) {
+            EXPECT_CALL(calculator, Calculate(Ref(*mockCells[i]))).Times(runs[i]);
+        }
+        calculationChain->InvalidateCell(mockCells[0]);
+        calculationChain->RecalculateChain();
+        Mock::VerifyAndClearExpectations(&calculator);
+        for (const auto& cell : mockCells) {
+            EXPECT_FALSE(cell->IsDirty());
+        }
+    };
+    recalculate(20.0, {1, 1, 1, 1});
+    recalculate(30.0, {1, 1, 0, 0}); // still capped at 10: nothing reads a new value
+    recalculate(5.0, {1, 1, 1, 0});  // 2 reads a new value but comes out 1 again
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+}
+
+TEST_F(CalculationChainTest, TestVMReferencesBecomeDynamicDependencies) {
+    // B1 is =INDIRECT(C1)*2 and C1 names the cell it reads
+    using ExcelCalculationEngine::FormulaValue;
+    ExcelCalculationEngine::MapCellSource cells;
+    cells.Set(0, 0, FormulaValue::Number(1.0));
+    cells.Set(1, 0, FormulaValue::Number(5.0));
+    cells.Set(0, 2, FormulaValue::Text("A1"));
+    const CellReference b1{0, 0, 1};
+    auto program = ExcelCalculationEngine::FormulaCompiler("=INDIRECT(C1)*2", b1).Compile();
+    auto reader = mockCells[0];
+    calculationChain->AddCell(reader, b1);
+    calculationChain->UpdateDependencies(reader, {}, {RangeReference{0, 0, 2, 0, 2}});
+
+    // As CalculationEngine does: run the program, then record what it read
+    ExcelCalculationEngine::FormulaVM vm;
+    calculationChain->SetCellCalculator([&](Cell& cell) {
+        const FormulaValue value = vm.Execute(*program, b1, cells, nullptr);
+        calculationChain->SetDynamicDependencies(reader, vm.GetDynamicReferences());
+        cell.SetValue(value.GetNumber());
+    });
+    auto value = [&reader] { return get<double>(reader->GetValue()); };
+    calculationChain->InvalidateCell(reader);
+    calculationChain->RecalculateChain();
+    EXPECT_EQ(value(), 2.0);
+
+    // Only the cell INDIRECT read reaches the reader
+    cells.Set(1, 0, FormulaValue::Number(7.0));
+    calculationChain->InvalidateCell(CellReference{0, 1, 0});
+    EXPECT_FALSE(reader->IsDirty());
+    cells.Set(0, 0, FormulaValue::Number(4.0));
+    calculationChain->InvalidateCell(CellReference{0, 0, 0});
+    EXPECT_TRUE(reader->IsDirty());
+    calculationChain->RecalculateChain();
+    EXPECT_EQ(value(), 8.0);
+
+    // Pointing C1 elsewhere moves the edge
+    cells.Set(0, 2, FormulaValue::Text("A2"));
+    calculationChain->InvalidateCell(CellReference{0, 0, 2});
+    calculationChain->RecalculateChain();
+    EXPECT_EQ(value(), 14.0);
+    calculationChain->InvalidateCell(CellReference{0, 0, 0});
+    EXPECT_FALSE(reader->IsDirty());
+    calculationChain->InvalidateCell(CellReference{0, 1, 0});
+    EXPECT_TRUE(reader->IsDirty());
+    calculationChain->RecalculateChain();
+    EXPECT_FALSE(calculationChain->HasPendingWork());
+}
@@ -0,0 +1,204 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "../../CalculationEngine.h"
+#include "../../../core-engine/Performance/Metrics.h"
+
+using namespace Microsoft::Excel::CalculationEngine;
+
+namespace {
+
+// Zero-based, as the compiled-formula path addresses cells
+const CellReference A1{0, 0, 0};
+const CellReference B1{0, 0, 1};
+const CellReference C1{0, 0, 2};
+const CellReference D1{0, 0, 3};
+const CellReference E1{0, 0, 4};
+
+double Number(const std::variant<double, std::string, bool>& value) {
+    const double* number = std::get_if<double>(&value);
+    return number ? *number : -1.0;
+}
+
+// Formulas the engine has run so far, across every engine in the process
+std::uint64_t CellsEvaluated() {
+    return excel::core_engine::performance::GetMetrics()
+        .GetCounter("excel_calc_cells_evaluated_total", "Formulas evaluated (cache misses that ran the evaluator).")
+        .Value();
+}
+
+} // namespace
+
+class CalculationEngineTest : public ::testing::Test {
+protected:
+    std::shared_ptr<CalculationChain> chain = std::make_shared<CalculationChain>();
+    CalculationEngine engine{nullptr, chain};
+
+    // C1 reads both inputs and D1 reads C1, all calculated
+    void SetUpDependents() {
+        engine.SetCellFormula(C1, "=A1+B1");
+        engine.SetCellFormula(D1, "=C1*2");
+        engine.RecalculateAll();
+    }
+};
+
+TEST_F(CalculationEngineTest, UpdatedValuesAreRead) {
+    engine.UpdateCell("A1", "2");
+    EXPECT_EQ(engine.GetCellValue("A1"), 2.0);
+    engine.UpdateCell("A1", "TRUE");
+    EXPECT_EQ(engine.GetCellValue("A1"), 1.0);
+}
+
+TEST_F(CalculationEngineTest, AdHocFormulasReadCurrentValues) {
+    engine.UpdateCell("A1", "2");
+    EXPECT_EQ(Number(engine.Calculate("=A1*2", B1)), 4.0);
+    // Not in the chain, so a cached result would never be invalidated
+    engine.UpdateCell("A1", "3");
+    EXPECT_EQ(Number(engine.Calculate("=A1*2", B1)), 6.0);
+}
+
+TEST_F(CalculationEngineTest, CalculateFormulaLeavesA1Alone) {
+    engine.UpdateCell("B1", "1");
+    engine.SetCellFormula(A1, "=B1*2");
+    EXPECT_EQ(Number(engine.Calculate(A1)), 2.0);
+    EXPECT_EQ(engine.CalculateFormula("=5", {}), 5.0);
+    EXPECT_EQ(engine.CalculateFormula("=B1+1", {}), 2.0);
+    EXPECT_EQ(Number(engine.Calculate(A1)), 2.0);
+    EXPECT_THROW(engine.CalculateFormula("=x", {{"x", 1.0}}), std::invalid_argument);
+}
+
+TEST_F(CalculationEngineTest, ApplyUpdatesRunsEachDependentOnce) {
+    SetUpDependents();
+    const std::uint64_t before = CellsEvaluated();
+    engine.ApplyUpdates({CellUpdate{A1, 1.0}, CellUpdate{B1, 2.0}, CellUpdate{A1, 3.0}});
+    EXPECT_EQ(CellsEvaluated() - before, 2u);
+    EXPECT_EQ(engine.GetCellValue("A1"), 3.0);
+    EXPECT_EQ(engine.GetCellValue("C1"), 5.0);
+    EXPECT_EQ(engine.GetCellValue("D1"), 10.0);
+}
+
+TEST_F(CalculationEngineTest, BatchAppliesTheLastWriteOnCommit) {
+    SetUpDependents();
+    const std::uint64_t before = CellsEvaluated();
+    engine.BeginBatch();
+    engine.UpdateCell("A1", "1");
+    engine.UpdateCell("B1", "2");
+    engine.UpdateCell("A1", "4");
+    EXPECT_EQ(engine.GetCellValue("A1"), 0.0);
+    EXPECT_EQ(CellsEvaluated(), before);
+
+    engine.CommitBatch();
+    EXPECT_EQ(CellsEvaluated() - before, 2u);
+    EXPECT_EQ(engine.GetCellValue("A1"), 4.0);
+    EXPECT_EQ(engine.GetCellValue("D1"), 12.0);
+}
+
+TEST_F(CalculationEngineTest, NestedBatchesApplyAtTheOutermostCommit) {
+    SetUpDependents();
+    const std::uint64_t before = CellsEvaluated();
+    engine.BeginBatch();
+    engine.UpdateCell("A1", "1");
+    engine.BeginBatch();
+    engine.UpdateCell("B1", "2");
+    engine.CommitBatch();
+    EXPECT_EQ(engine.GetCellValue("B1"), 0.0);
+    EXPECT_EQ(engine.GetCellValue("C1"), 0.0);
+
+    engine.CommitBatch();
+    EXPECT_EQ(CellsEvaluated() - before, 2u);
+    EXPECT_EQ(engine.GetCellValue("C1"), 3.0);
+    EXPECT_EQ(engine.GetCellValue("D1"), 6.0);
+    EXPECT_THROW(engine.CommitBatch(), std::logic_error);
+}
+
+TEST_F(CalculationEngineTest, UpdateCellsRecalculatesOnce) {
+    SetUpDependents();
+    const std::uint64_t before = CellsEvaluated();
+    engine.UpdateCells({{"A1", "1"}, {"B1", "2"}, {"B1", "5"}});
+    EXPECT_EQ(CellsEvaluated() - before, 2u);
+    EXPECT_EQ(engine.GetCellValue("D1"), 12.0);
+
+    // Nothing is written when a reference does not parse
+    EXPECT_THROW(engine.UpdateCells({{"A1", "7"}, {"not a cell", "1"}}), std::invalid_argument);
+    EXPECT_EQ(engine.GetCellValue("A1"), 1.0);
+    engine.UpdateCell("B1", "1");
+    EXPECT_EQ(engine.GetCellValue("D1"), 4.0);
+}
+
+TEST_F(CalculationEngineTest, LoadedFormulasAreCalculatedInOrder) {
+    engine.UpdateCell("A1", "1");
+    // Listed dependents first: the order is worked out once, after everything is linked
+    engine.LoadFormulas({{D1, "=C1+B1"}, {C1, "=B1*2"}, {B1, "=A1+1"}});
+    engine.RecalculateWorksheet();
+    EXPECT_EQ(engine.GetCellValue("B1"), 2.0);
+    EXPECT_EQ(engine.GetCellValue("C1"), 4.0);
+    EXPECT_EQ(engine.GetCellValue("D1"), 6.0);
+
+    engine.UpdateCell("A1", "2");
+    EXPECT_EQ(engine.GetCellValue("D1"), 9.0);
+    EXPECT_THROW(engine.LoadFormulas({{E1, "=A1"}, {A1, "=("}}), std::exception);
+    EXPECT_EQ(Number(engine.Calculate(E1)), 0.0); // still blank: nothing was stored
+}
+
+TEST_F(CalculationEngineTest, EditsAfterLoadingALoopAreCheckedForNewLoops) {
+    engine.SetIterationSettings(IterationSettings{1000, 1e-12});
+    engine.UpdateCell("E1", "1");
+    engine.LoadFormulas({{A1, "=B1"}, {B1, "=A1"}, {C1, "=A1"}});
+    // C1 is ordered after the loop, so only a full search sees that B1 reading C1 closes a second loop;
+    // iterated apart from it, B1 would read a stale C1. Together, B1 = 0.75 * B1 + 1.
+    EXPECT_NO_THROW(engine.SetCellFormula(B1, "=A1*0.5+C1*0.25+E1"));
+    engine.SetCellFormula(D1, "=C1+1");
+    engine.RecalculateAll();
+    EXPECT_NEAR(engine.GetCellValue("B1"), 4.0, 1e-9);
+    EXPECT_NEAR(engine.GetCellValue("D1"), 5.0, 1e-9);
+}
+
+TEST_F(CalculationEngineTest, InterestLoopsAreIterated) {
+    // The interest is paid on the balance, which includes the interest
+    engine.SetIterationSettings(IterationSettings{1000, 1e-12});
+    engine.UpdateCell("A1", "100");
+    engine.SetCellFormula(B1, "=A1+C1");
+    EXPECT_NO_THROW(engine.SetCellFormula(C1, "=B1*0.05"));
+    engine.SetCellFormula(D1, "=B1*2");
+    engine.RecalculateAll();
+    EXPECT_NEAR(engine.GetCellValue("B1"), 100.0 / 0.95, 1e-9);
+    EXPECT_NEAR(engine.GetCellValue("C1"), 5.0 / 0.95, 1e-9);
+    EXPECT_NEAR(engine.GetCellValue("D1"), 200.0 / 0.95, 1e-9);
+
+    engine.UpdateCell("A1", "190");
+    EXPECT_NEAR(engine.GetCellValue("B1"), 200.0, 1e-9);
+    EXPECT_NEAR(engine.GetCellValue("D1"), 400.0, 1e-9);
+
+    // Breaking the loop leaves ordinary formulas
+    engine.SetCellFormula(C1, "=A1*0.05");
+    engine.RecalculateAll();
+    EXPECT_NEAR(engine.GetCellValue("B1"), 199.5, 1e-9);
+    EXPECT_NEAR(engine.GetCellValue("D1"), 399.0, 1e-9);
+}
+
+TEST_F(CalculationEngineTest, HandleCircularReferenceUpdatesReadersOutsideTheLoop) {
+    // One sweep leaves the interest loop short of its fixed point
+    engine.SetIterationSettings(IterationSettings{1, 1e-12});
+    engine.UpdateCell("A1", "100");
+    engine.SetCellFormula(B1, "=A1+C1");
+    engine.SetCellFormula(C1, "=B1*0.05");
+    engine.SetCellFormula(D1, "=B1*2");
+    engine.RecalculateAll();
+    const double partial = engine.GetCellValue("D1");
+    EXPECT_LT(partial, 200.0 / 0.95 - 1e-3);
+
+    // Not converged: nothing is written
+    EXPECT_THROW(engine.HandleCircularReference({B1, C1}), CalculationError);
+    EXPECT_EQ(engine.GetCellValue("D1"), partial);
+
+    engine.SetIterationSettings(IterationSettings{1000, 1e-12});
+    engine.HandleCircularReference({B1, C1});
+    EXPECT_NEAR(engine.GetCellValue("B1"), 100.0 / 0.95, 1e-9);
+    EXPECT_NEAR(Number(engine.Calculate(B1)), 100.0 / 0.95, 1e-9);
+    EXPECT_NEAR(engine.GetCellValue("D1"), 200.0 / 0.95, 1e-9);
+}
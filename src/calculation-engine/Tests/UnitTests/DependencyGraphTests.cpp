@@ -0,0 +1,521 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+#include "../../CalculationChain/DependencyGraph.h"
+#include "../../ErrorHandling/CalculationErrors.h"
+
+using namespace ExcelCalculationEngine;
+using Excel::CalculationEngine::CalculationException;
+
+namespace {
+
+std::vector<NodeId> Sorted(std::vector<NodeId> nodes) {
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+std::vector<NodeId> AddNodes(DependencyGraph& graph, int count) {
+    std::vector<NodeId> nodes;
+    for (int i = 0; i < count; ++i) {
+        nodes.push_back(graph.AddNode());
+    }
+    return nodes;
+}
+
+} // namespace
+
+TEST(DependencyGraphTest, EdgesAreVisibleFromBothSides) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 3);
+    EXPECT_TRUE(graph.AddDependency(n[0], n[1]));
+    EXPECT_TRUE(graph.AddDependency(n[0], n[2]));
+    EXPECT_FALSE(graph.AddDependency(n[0], n[1]));
+    EXPECT_EQ(graph.GetEdgeCount(), 2u);
+
+    EXPECT_EQ(Sorted(graph.GetPrecedents(n[0])), (std::vector<NodeId>{n[1], n[2]}));
+    EXPECT_EQ(graph.GetDependents(n[1]), std::vector<NodeId>{n[0]});
+    EXPECT_TRUE(graph.HasDependency(n[0], n[2]));
+    EXPECT_FALSE(graph.HasDependency(n[2], n[0]));
+
+    EXPECT_TRUE(graph.RemoveDependency(n[0], n[1]));
+    EXPECT_FALSE(graph.RemoveDependency(n[0], n[1]));
+    EXPECT_TRUE(graph.GetDependents(n[1]).empty());
+    EXPECT_EQ(graph.GetEdgeCount(), 1u);
+}
+
+TEST(DependencyGraphTest, EditsAfterCompactionTombstoneAndRevive) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 4);
+    graph.AddDependency(n[0], n[1]);
+    graph.AddDependency(n[0], n[2]);
+    graph.Compact();
+    EXPECT_EQ(graph.GetPendingEditCount(), 0u);
+
+    EXPECT_TRUE(graph.RemoveDependency(n[0], n[2]));
+    EXPECT_FALSE(graph.HasDependency(n[0], n[2]));
+    EXPECT_EQ(graph.GetPendingEditCount(), 1u);
+
+    EXPECT_TRUE(graph.AddDependency(n[0], n[2]));
+    EXPECT_TRUE(graph.AddDependency(n[0], n[3]));
+    EXPECT_EQ(Sorted(graph.GetPrecedents(n[0])), (std::vector<NodeId>{n[1], n[2], n[3]}));
+    EXPECT_EQ(graph.GetDependents(n[2]), std::vector<NodeId>{n[0]});
+    // The revived edge reuses its CSR slot; only the new one sits in the overlay.
+    EXPECT_EQ(graph.GetPendingEditCount(), 1u);
+}
+
+TEST(DependencyGraphTest, RemovedNodesLoseTheirEdgesAndAreReused) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 3);
+    graph.AddDependency(n[0], n[1]);
+    graph.AddDependency(n[1], n[2]);
+    graph.Compact();
+
+    graph.RemoveNode(n[1]);
+    EXPECT_FALSE(graph.IsNode(n[1]));
+    EXPECT_EQ(graph.GetEdgeCount(), 0u);
+    EXPECT_TRUE(graph.GetPrecedents(n[0]).empty());
+    EXPECT_TRUE(graph.GetDependents(n[2]).empty());
+    EXPECT_THROW(graph.AddDependency(n[0], n[1]), std::out_of_range);
+
+    const NodeId reused = graph.AddNode();
+    EXPECT_EQ(reused, n[1]);
+    EXPECT_EQ(graph.GetNodeCount(), 3u);
+    EXPECT_TRUE(graph.GetPrecedents(reused).empty());
+    EXPECT_EQ(graph.GetTopologicalOrder().size(), 3u);
+}
+
+TEST(DependencyGraphTest, VolatileSetFollowsNodeLifetime) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 3);
+    graph.SetVolatile(n[0], true);
+    graph.SetVolatile(n[2], true);
+    graph.SetVolatile(n[2], true);
+    EXPECT_TRUE(graph.IsVolatile(n[0]));
+    EXPECT_FALSE(graph.IsVolatile(n[1]));
+    EXPECT_EQ(graph.GetVolatileNodes().size(), 2u);
+
+    graph.SetVolatile(n[0], false);
+    EXPECT_EQ(graph.GetVolatileNodes(), std::vector<NodeId>{n[2]});
+
+    graph.RemoveNode(n[2]);
+    EXPECT_TRUE(graph.GetVolatileNodes().empty());
+    const NodeId reused = graph.AddNode();
+    EXPECT_EQ(reused, n[2]);
+    EXPECT_FALSE(graph.IsVolatile(reused));
+    EXPECT_THROW(graph.SetVolatile(n[2] + 1, true), std::out_of_range);
+}
+
+TEST(DependencyGraphTest, CyclesAreRejected) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 3);
+    graph.AddDependency(n[0], n[1]);
+    graph.AddDependency(n[1], n[2]);
+    EXPECT_THROW(graph.AddDependency(n[2], n[0]), CalculationException);
+    EXPECT_THROW(graph.AddDependency(n[1], n[1]), CalculationException);
+    EXPECT_FALSE(graph.HasDependency(n[2], n[0]));
+    EXPECT_EQ(graph.GetEdgeCount(), 2u);
+}
+
+TEST(DependencyGraphTest, FailedUpdateRestoresPreviousPrecedents) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 4);
+    graph.UpdateDependencies(n[0], {n[1], n[2]});
+    graph.AddDependency(n[3], n[0]);
+
+    EXPECT_THROW(graph.UpdateDependencies(n[0], {n[2], n[3]}), CalculationException);
+    EXPECT_EQ(Sorted(graph.GetPrecedents(n[0])), (std::vector<NodeId>{n[1], n[2]}));
+    EXPECT_EQ(graph.GetDependents(n[3]), std::vector<NodeId>{});
+    EXPECT_EQ(graph.GetEdgeCount(), 3u);
+
+    graph.UpdateDependencies(n[0], {n[2]});
+    EXPECT_EQ(graph.GetPrecedents(n[0]), std::vector<NodeId>{n[2]});
+}
+
+TEST(DependencyGraphTest, TopologicalOrderPutsPrecedentsFirst) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 5);
+    graph.UpdateDependencies(n[0], {n[1], n[2]});
+    graph.UpdateDependencies(n[1], {n[3]});
+    graph.UpdateDependencies(n[2], {n[4]});
+
+    const auto order = graph.GetTopologicalOrder();
+    ASSERT_EQ(order.size(), 5u);
+    auto position = [&order](NodeId node) { return std::find(order.begin(), order.end(), node) - order.begin(); };
+    EXPECT_GT(position(n[0]), position(n[1]));
+    EXPECT_GT(position(n[0]), position(n[2]));
+    EXPECT_GT(position(n[1]), position(n[3]));
+    EXPECT_GT(position(n[2]), position(n[4]));
+}
+
+TEST(DependencyGraphTest, LongChainsDoNotRecurse) {
+    DependencyGraph graph;
+    const int length = 200000;
+    auto n = AddNodes(graph, length);
+    // Linked from the far end so each insert's cycle check stays short.
+    for (int i = length - 2; i >= 0; --i) {
+        graph.AddDependency(n[i + 1], n[i]);
+    }
+    EXPECT_THROW(graph.AddDependency(n[0], n[length - 1]), CalculationException);
+    EXPECT_EQ(graph.GetTopologicalOrder().front(), n[0]);
+}
+
+TEST(DependencyGraphTest, MatchesReferenceModelAcrossCompactions) {
+    DependencyGraph graph;
+    const int nodeCount = 300;
+    auto n = AddNodes(graph, nodeCount);
+    std::set<std::pair<NodeId, NodeId>> expected;
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> pick(0, nodeCount - 1);
+
+    for (int step = 0; step < 60000; ++step) {
+        int a = pick(random);
+        int b = pick(random);
+        if (a == b) {
+            continue;
+        }
+        // Only edges from higher to lower index, so no insert can close a cycle.
+        const NodeId dependent = n[std::max(a, b)];
+        const NodeId precedent = n[std::min(a, b)];
+        if (random() % 3 == 0) {
+            EXPECT_EQ(graph.RemoveDependency(dependent, precedent), expected.erase({dependent, precedent}) == 1);
+        } else {
+            EXPECT_EQ(graph.AddDependency(dependent, precedent), expected.insert({dependent, precedent}).second);
+        }
+    }
+    ASSERT_EQ(graph.GetEdgeCount(), expected.size());
+    EXPECT_LE(graph.GetPendingEditCount(), std::max<std::size_t>(4096, expected.size() / 8) + 1);
+
+    for (NodeId node : n) {
+        std::vector<NodeId> precedents;
+        std::vector<NodeId> dependents;
+        for (const auto& edge : expected) {
+            if (edge.first == node) {
+                precedents.push_back(edge.second);
+            }
+            if (edge.second == node) {
+                dependents.push_back(edge.first);
+            }
+        }
+        EXPECT_EQ(Sorted(graph.GetPrecedents(node)), precedents);
+        EXPECT_EQ(Sorted(graph.GetDependents(node)), Sorted(dependents));
+    }
+}
+
+TEST(DependencyGraphTest, OrderIsRepairedWhenAnEdgeContradictsIt) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 6);
+    // Nodes start in creation order; each edge below points backwards against it.
+    graph.AddDependency(n[0], n[1]);
+    graph.AddDependency(n[1], n[5]);
+    graph.AddDependency(n[2], n[4]);
+    graph.AddDependency(n[4], n[0]);
+
+    for (NodeId node : n) {
+        graph.ForEachPrecedent(node, [&](NodeId precedent) {
+            EXPECT_LT(graph.GetOrder(precedent), graph.GetOrder(node));
+        });
+    }
+    EXPECT_EQ(graph.GetTopologicalOrder().size(), 6u);
+    EXPECT_THROW(graph.AddDependency(n[5], n[2]), CalculationException);
+}
+
+TEST(DependencyGraphTest, IncrementalOrderMatchesBruteForceReachability) {
+    DependencyGraph graph;
+    const int nodeCount = 120;
+    auto n = AddNodes(graph, nodeCount);
+    std::vector<std::vector<NodeId>> precedents(nodeCount);
+    std::mt19937 random(3);
+
+    auto reaches = [&](int from, int to) {
+        std::vector<char> seen(nodeCount, 0);
+        std::vector<int> stack{from};
+        while (!stack.empty()) {
+            const int node = stack.back();
+            stack.pop_back();
+            if (node == to) {
+                return true;
+            }
+            for (NodeId next : precedents[node]) {
+                if (!seen[next]) {
+                    seen[next] = 1;
+                    stack.push_back(static_cast<int>(next));
+                }
+            }
+        }
+        return false;
+    };
+
+    for (int step = 0; step < 3000; ++step) {
+        const int dependent = static_cast<int>(random() % nodeCount);
+        const int precedent = static_cast<int>(random() % nodeCount);
+        if (step % 5 == 0 && !precedents[dependent].empty()) {
+            const NodeId removed = precedents[dependent].back();
+            precedents[dependent].pop_back();
+            graph.RemoveDependency(n[dependent], removed);
+            continue;
+        }
+        if (graph.HasDependency(n[dependent], n[precedent])) {
+            continue;
+        }
+        if (reaches(precedent, dependent)) {
+            EXPECT_THROW(graph.AddDependency(n[dependent], n[precedent]), CalculationException);
+        } else {
+            EXPECT_TRUE(graph.AddDependency(n[dependent], n[precedent]));
+            precedents[dependent].push_back(n[precedent]);
+        }
+    }
+
+    for (int node = 0; node < nodeCount; ++node) {
+        for (NodeId precedent : precedents[node]) {
+            ASSERT_LT(graph.GetOrder(precedent), graph.GetOrder(n[node]));
+        }
+    }
+}
+
+TEST(DependencyGraphTest, RepeatedMovesIntoOneGapRelabel) {
+    DependencyGraph graph;
+    const NodeId first = graph.AddNode();
+    const NodeId last = graph.AddNode();
+    graph.AddDependency(last, first);
+
+    // Each new node is created at the end and then squeezed in just before `last`,
+    // halving the same label gap until it has to be widened.
+    std::vector<NodeId> middle;
+    for (int i = 0; i < 2000; ++i) {
+        const NodeId node = graph.AddNode();
+        graph.AddDependency(last, node);
+        graph.AddDependency(node, first);
+        if (!middle.empty()) {
+            graph.AddDependency(node, middle.back());
+        }
+        middle.push_back(node);
+    }
+
+    const auto order = graph.GetTopologicalOrder();
+    ASSERT_EQ(order.size(), middle.size() + 2);
+    EXPECT_EQ(order.front(), first);
+    EXPECT_EQ(order.back(), last);
+    for (std::size_t i = 1; i < order.size(); ++i) {
+        EXPECT_LT(graph.GetOrder(order[i - 1]), graph.GetOrder(order[i]));
+    }
+    for (std::size_t i = 1; i < middle.size(); ++i) {
+        EXPECT_LT(graph.GetOrder(middle[i - 1]), graph.GetOrder(middle[i]));
+    }
+}
+
+TEST(DependencyGraphTest, BulkLoadReturnsCircularComponents) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 6);
+    graph.BeginBulkLoad();
+    graph.AddDependency(n[1], n[0]);
+    graph.AddDependency(n[2], n[3]); // n[2] and n[3] read each other
+    graph.AddDependency(n[3], n[2]);
+    graph.AddDependency(n[4], n[3]);
+    graph.AddDependency(n[5], n[5]); // reads itself
+    auto circular = graph.EndBulkLoad();
+    EXPECT_FALSE(graph.IsBulkLoading());
+
+    ASSERT_EQ(circular.size(), 2u);
+    for (auto& component : circular) {
+        component = Sorted(component);
+    }
+    std::sort(circular.begin(), circular.end());
+    EXPECT_EQ(circular[0], (std::vector<NodeId>{n[2], n[3]}));
+    EXPECT_EQ(circular[1], std::vector<NodeId>{n[5]});
+    EXPECT_EQ(graph.FindCircularComponents().size(), 2u);
+
+    // Acyclic edges are ordered; the loop sits as one block ahead of its reader.
+    EXPECT_LT(graph.GetOrder(n[0]), graph.GetOrder(n[1]));
+    const auto order = graph.GetTopologicalOrder();
+    const auto loop = std::find_if(order.begin(), order.end(), [&n](NodeId node) { return node == n[2] || node == n[3]; });
+    ASSERT_NE(loop + 1, order.end());
+    EXPECT_TRUE(loop[1] == n[2] || loop[1] == n[3]);
+    EXPECT_LT(graph.GetOrder(n[2]), graph.GetOrder(n[4]));
+    EXPECT_LT(graph.GetOrder(n[3]), graph.GetOrder(n[4]));
+
+    // Breaking the loop leaves only the self-reference.
+    graph.RemoveDependency(n[2], n[3]);
+    EXPECT_EQ(graph.FindCircularComponents(), std::vector<std::vector<NodeId>>{{n[5]}});
+}
+
+TEST(DependencyGraphTest, ComponentSearchDoesNotRecurse) {
+    DependencyGraph graph;
+    const int length = 1000000;
+    auto n = AddNodes(graph, length);
+    graph.BeginBulkLoad();
+    for (int i = 0; i + 1 < length; ++i) {
+        graph.AddDependency(n[i + 1], n[i]);
+    }
+    EXPECT_TRUE(graph.EndBulkLoad().empty());
+    const auto order = graph.GetTopologicalOrder();
+    EXPECT_EQ(order.front(), n[0]);
+    EXPECT_EQ(order.back(), n[length - 1]);
+
+    graph.BeginBulkLoad();
+    graph.AddDependency(n[0], n[length - 1]);
+    const auto circular = graph.EndBulkLoad();
+    ASSERT_EQ(circular.size(), 1u);
+    EXPECT_EQ(circular[0].size(), static_cast<std::size_t>(length));
+}
+
+TEST(DependencyGraphTest, ComponentsMatchBruteForceReachability) {
+    const int nodeCount = 80;
+    std::mt19937 random(5);
+    for (int round = 0; round < 20; ++round) {
+        DependencyGraph graph;
+        auto n = AddNodes(graph, nodeCount);
+        // reach[a][b]: a reads b, directly or not.
+        std::vector<std::vector<char>> reach(nodeCount, std::vector<char>(nodeCount, 0));
+        graph.BeginBulkLoad();
+        for (int edge = 0; edge < 110; ++edge) {
+            const int dependent = static_cast<int>(random() % nodeCount);
+            const int precedent = static_cast<int>(random() % nodeCount);
+            graph.AddDependency(n[dependent], n[precedent]);
+            reach[dependent][precedent] = 1;
+        }
+        for (int via = 0; via < nodeCount; ++via) {
+            for (int from = 0; from < nodeCount; ++from) {
+                for (int to = 0; to < nodeCount; ++to) {
+                    reach[from][to] |= reach[from][via] && reach[via][to];
+                }
+            }
+        }
+        const auto circular = graph.EndBulkLoad();
+
+        std::vector<int> component(nodeCount, -1);
+        for (std::size_t i = 0; i < circular.size(); ++i) {
+            for (NodeId node : circular[i]) {
+                component[node] = static_cast<int>(i);
+            }
+        }
+        for (int a = 0; a < nodeCount; ++a) {
+            EXPECT_EQ(component[a] >= 0, reach[a][a] != 0);
+            for (int b = 0; b < nodeCount; ++b) {
+                if (a != b) {
+                    ASSERT_EQ(component[a] >= 0 && component[a] == component[b], reach[a][b] && reach[b][a]);
+                }
+                // Across components, precedents still come first.
+                if (reach[a][b] && !reach[b][a]) {
+                    ASSERT_LT(graph.GetOrder(n[b]), graph.GetOrder(n[a]));
+                }
+            }
+        }
+    }
+}
+
+TEST(DependencyGraphTest, EditsAfterACyclicBulkLoadAreFullyChecked) {
+    const int nodeCount = 40;
+    std::mt19937 random(11);
+    for (int round = 0; round < 40; ++round) {
+        DependencyGraph graph;
+        auto n = AddNodes(graph, nodeCount);
+        // reads[a][b]: a reads b directly.
+        std::vector<std::vector<char>> reads(nodeCount, std::vector<char>(nodeCount, 0));
+        graph.BeginBulkLoad();
+        for (int edge = 0; edge < 45; ++edge) {
+            const int dependent = static_cast<int>(random() % nodeCount);
+            const int precedent = static_cast<int>(random() % nodeCount);
+            graph.AddDependency(n[dependent], n[precedent]);
+            reads[dependent][precedent] = 1;
+        }
+        const bool loaded = !graph.EndBulkLoad().empty();
+        EXPECT_EQ(graph.HasCircularComponents(), loaded);
+
+        auto reaches = [&reads, nodeCount](int from, int to) {
+            std::vector<char> seen(nodeCount, 0);
+            std::vector<int> stack{from};
+            while (!stack.empty()) {
+                const int node = stack.back();
+                stack.pop_back();
+                for (int next = 0; next < nodeCount; ++next) {
+                    if (reads[node][next] && !seen[next]) {
+                        if (next == to) {
+                            return true;
+                        }
+                        seen[next] = 1;
+                        stack.push_back(next);
+                    }
+                }
+            }
+            return false;
+        };
+
+        for (int edit = 0; edit < 40; ++edit) {
+            const int dependent = static_cast<int>(random() % nodeCount);
+            const int precedent = static_cast<int>(random() % nodeCount);
+            const bool cycle = dependent == precedent || reaches(precedent, dependent);
+            if (random() % 2 == 0) {
+                if (reads[dependent][precedent]) {
+                    continue;
+                }
+                if (cycle) {
+                    ASSERT_THROW(graph.AddDependency(n[dependent], n[precedent]), CalculationException);
+                } else {
+                    graph.AddDependency(n[dependent], n[precedent]);
+                    reads[dependent][precedent] = 1;
+                }
+            } else if (cycle) {
+                const auto before = Sorted(graph.GetPrecedents(n[dependent]));
+                ASSERT_THROW(graph.UpdateDependencies(n[dependent], {n[precedent]}), CalculationException);
+                EXPECT_EQ(Sorted(graph.GetPrecedents(n[dependent])), before);
+            } else {
+                graph.UpdateDependencies(n[dependent], {n[precedent]});
+                std::fill(reads[dependent].begin(), reads[dependent].end(), 0);
+                reads[dependent][precedent] = 1;
+            }
+        }
+
+        // Across loops, precedents still come first.
+        for (int a = 0; a < nodeCount; ++a) {
+            for (int b = 0; b < nodeCount; ++b) {
+                if (reads[a][b] && !reaches(b, a)) {
+                    ASSERT_LT(graph.GetOrder(n[b]), graph.GetOrder(n[a]));
+                }
+            }
+        }
+    }
+}
+
+TEST(DependencyGraphTest, BreakingTheLastLoadedLoopRestoresIncrementalOrdering) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 3);
+    graph.BeginBulkLoad();
+    graph.AddDependency(n[0], n[1]);
+    graph.AddDependency(n[1], n[0]);
+    graph.EndBulkLoad();
+    EXPECT_TRUE(graph.HasCircularComponents());
+    ASSERT_NE(graph.GetCircularComponent(n[0]), NO_COMPONENT);
+    EXPECT_EQ(graph.GetCircularComponent(n[1]), graph.GetCircularComponent(n[0]));
+    EXPECT_EQ(graph.GetCircularComponent(n[2]), NO_COMPONENT);
+
+    // n[2] reads the loop; the loop reading n[2] back would close a second one.
+    graph.AddDependency(n[2], n[0]);
+    EXPECT_THROW(graph.AddDependency(n[1], n[2]), CalculationException);
+    EXPECT_THROW(graph.UpdateDependencies(n[0], {n[1], n[2]}), CalculationException);
+    EXPECT_EQ(graph.GetPrecedents(n[0]), std::vector<NodeId>{n[1]});
+
+    graph.UpdateDependencies(n[0], {});
+    EXPECT_FALSE(graph.HasCircularComponents());
+    EXPECT_TRUE(graph.GetCircularComponents().empty());
+    EXPECT_EQ(graph.GetCircularComponent(n[0]), NO_COMPONENT);
+    EXPECT_LT(graph.GetOrder(n[0]), graph.GetOrder(n[1]));
+    EXPECT_THROW(graph.AddDependency(n[0], n[2]), CalculationException);
+}
+
+TEST(DependencyGraphTest, CostsAreSmoothedAndResetWithTheNode) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 2);
+    EXPECT_EQ(graph.GetCost(n[0]), 0.0f);
+    graph.RecordCost(n[0], 800.0f); // the first sample is taken as is
+    EXPECT_FLOAT_EQ(graph.GetCost(n[0]), 800.0f);
+    graph.RecordCost(n[0], 400.0f);
+    EXPECT_FLOAT_EQ(graph.GetCost(n[0]), 800.0f - 400.0f * DependencyGraph::COST_SMOOTHING);
+    EXPECT_EQ(graph.GetCost(n[1]), 0.0f);
+
+    // A reused id starts unmeasured.
+    graph.RemoveNode(n[0]);
+    EXPECT_EQ(graph.GetCost(graph.AddNode()), 0.0f);
+}
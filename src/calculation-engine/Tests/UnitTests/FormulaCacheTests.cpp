@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../../Caching/FormulaCache.h"
+
+using namespace ExcelCalculationEngine;
+
+TEST(FormulaCacheTest, HitsOnlyForTheSameCellAndFormula) {
+    FormulaCache cache;
+    const CellReference a1{0, 0, 0};
+    cache.Set("=B1+1", a1, 2.0);
+
+    auto hit = cache.Get("=B1+1", a1);
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(std::get<double>(*hit), 2.0);
+    EXPECT_FALSE(cache.Get("=B1+2", a1).has_value());
+    EXPECT_FALSE(cache.Get("=B1+1", CellReference{1, 0, 0}).has_value()); // same address, other sheet
+
+    cache.Set("=B1+2", a1, std::string("x"));
+    EXPECT_EQ(std::get<std::string>(*cache.Get("=B1+2", a1)), "x");
+
+    const auto statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.hits, 2u);
+    EXPECT_EQ(statistics.misses, 2u);
+    EXPECT_EQ(statistics.entries, 1u);
+}
+
+TEST(FormulaCacheTest, InvalidationIsExact) {
+    FormulaCache cache;
+    const CellReference a1{0, 0, 0};
+    const CellReference a10{0, 9, 0};
+    const CellReference b1{0, 0, 1};
+    cache.Set("=1", a1, 1.0);
+    cache.Set("=10", a10, 10.0);
+    cache.Set("=A1", b1, 1.0);
+
+    // "A1" is a prefix of "A10"; only the cell itself and its reported dependents go.
+    cache.Invalidate(std::vector<CellReference>{a1, b1});
+    EXPECT_FALSE(cache.Get("=1", a1).has_value());
+    EXPECT_FALSE(cache.Get("=A1", b1).has_value());
+    EXPECT_TRUE(cache.Get("=10", a10).has_value());
+    EXPECT_EQ(cache.GetStatistics().invalidations, 2u);
+
+    // Freed slots are reused before anything is evicted.
+    cache.Set("=1", a1, 1.0);
+    EXPECT_EQ(cache.GetStatistics().evictions, 0u);
+}
+
+TEST(FormulaCacheTest, ClockEvictsEntriesNotUsedSinceTheHandPassed) {
+    FormulaCache cache(4);
+    for (int row = 0; row < 4; ++row) {
+        cache.Set("=1", CellReference{0, row, 0}, 1.0);
+    }
+    // A full sweep clears every bit and takes the first slot; row 0 goes.
+    cache.Set("=1", CellReference{0, 4, 0}, 1.0);
+    EXPECT_FALSE(cache.Get("=1", CellReference{0, 0, 0}).has_value());
+
+    // Row 1 is used again before the hand reaches it, so row 2 goes instead.
+    EXPECT_TRUE(cache.Get("=1", CellReference{0, 1, 0}).has_value());
+    cache.Set("=1", CellReference{0, 5, 0}, 1.0);
+    EXPECT_TRUE(cache.Get("=1", CellReference{0, 1, 0}).has_value());
+    EXPECT_FALSE(cache.Get("=1", CellReference{0, 2, 0}).has_value());
+
+    const auto statistics = cache.GetStatistics();
+    EXPECT_EQ(statistics.evictions, 2u);
+    EXPECT_EQ(statistics.entries, 4u);
+}
+
+TEST(FormulaCacheTest, KeysAreDistinctAcrossTheGrid) {
+    const CellReference corners[] = {
+        {0, 0, 0}, {0, MAX_ROWS - 1, 0}, {0, 0, MAX_COLUMNS - 1}, {0, MAX_ROWS - 1, MAX_COLUMNS - 1}, {1, 0, 0}};
+    for (const auto& a : corners) {
+        for (const auto& b : corners) {
+            EXPECT_EQ(FormulaCache::GetKey(a) == FormulaCache::GetKey(b), a == b);
+        }
+    }
+}
@@ -1,16 +1,56 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
+#include <chrono>
+#include <cstdio>
 #include "../../FormulaParser/FormulaParser.h"
 #include "../../Interfaces/IFormulaParser.h"
 #include "../../ErrorHandling/CalculationErrors.h"
 
+using namespace ExcelCalculationEngine;
+using Excel::CalculationEngine::CalculationErrorCode;
+using Excel::CalculationEngine::CalculationException;
+
 class FormulaParserTests : public ::testing::Test {
 protected:
-    std::unique_ptr<IFormulaParser> formulaParser;
+    std::unique_ptr<FormulaParser> formulaParser;
 
     void SetUp() override {
         formulaParser = std::make_unique<FormulaParser>();
     }
+
+    // The postfix token texts, space-separated
+    std::string Postfix(const std::string& formula) {
+        std::string result;
+        for (const Token& token : formulaParser->ParseFormula(formula)) {
+            result += (result.empty() ? "" : " ") + std::string(token.GetText(formula));
+        }
+        return result;
+    }
+
+    // The tree in fully parenthesized form
+    static std::string Print(const FormulaNode& node) {
+        switch (node.kind) {
+            case FormulaNodeKind::String: return "\"" + std::string(node.text) + "\"";
+            case FormulaNodeKind::Missing: return "_";
+            case FormulaNodeKind::Prefix: return "(" + std::string(node.text) + Print(*node.left) + ")";
+            case FormulaNodeKind::Postfix: return "(" + Print(*node.left) + std::string(node.text) + ")";
+            case FormulaNodeKind::Binary:
+            case FormulaNodeKind::Range:
+                return "(" + Print(*node.left) + std::string(node.text) + Print(*node.right) + ")";
+            case FormulaNodeKind::Call: {
+                std::string call = std::string(node.text) + "(";
+                for (std::uint32_t i = 0; i < node.argumentCount; ++i) {
+                    call += (i ? "," : "") + Print(*node.arguments[i]);
+                }
+                return call + ")";
+            }
+            default: return std::string(node.text);
+        }
+    }
+
+    std::string Tree(const std::string& formula) {
+        return Print(*formulaParser->Parse(formula));
+    }
 };
 
 TEST_F(FormulaParserTests, ParseSimpleFormula) {
@@ -19,34 +59,17 @@ TEST_F(FormulaParserTests, ParseSimpleFormula) {
     auto result = formulaParser->ParseFormula(simpleFormula);
 
     ASSERT_EQ(result.size(), 3);
-    EXPECT_EQ(result[0].type, TokenType::CellReference);
-    EXPECT_EQ(result[0].value, "A1");
-    EXPECT_EQ(result[1].type, TokenType::Operator);
-    EXPECT_EQ(result[1].value, "+");
-    EXPECT_EQ(result[2].type, TokenType::CellReference);
-    EXPECT_EQ(result[2].value, "B2");
+    EXPECT_EQ(result[0].type, TOKEN_TYPES::NAME);
+    EXPECT_EQ(result[0].GetText(simpleFormula), "A1");
+    EXPECT_EQ(result[1].type, TOKEN_TYPES::NAME);
+    EXPECT_EQ(result[1].GetText(simpleFormula), "B2");
+    EXPECT_EQ(result[2].type, TOKEN_TYPES::OPERATOR);
+    EXPECT_EQ(result[2].GetText(simpleFormula), "+");
 }
 
 TEST_F(FormulaParserTests, ParseComplexFormula) {
     // This test case verifies that the FormulaParser correctly parses a complex formula with multiple operators and functions.
-    const std::string complexFormula = "=SUM(A1:A10) + AVERAGE(B1:B5) * 2";
-    auto result = formulaParser->ParseFormula(complexFormula);
-
-    ASSERT_EQ(result.size(), 7);
-    EXPECT_EQ(result[0].type, TokenType::Function);
-    EXPECT_EQ(result[0].value, "SUM");
-    EXPECT_EQ(result[1].type, TokenType::Range);
-    EXPECT_EQ(result[1].value, "A1:A10");
-    EXPECT_EQ(result[2].type, TokenType::Operator);
-    EXPECT_EQ(result[2].value, "+");
-    EXPECT_EQ(result[3].type, TokenType::Function);
-    EXPECT_EQ(result[3].value, "AVERAGE");
-    EXPECT_EQ(result[4].type, TokenType::Range);
-    EXPECT_EQ(result[4].value, "B1:B5");
-    EXPECT_EQ(result[5].type, TokenType::Operator);
-    EXPECT_EQ(result[5].value, "*");
-    EXPECT_EQ(result[6].type, TokenType::Number);
-    EXPECT_EQ(result[6].value, "2");
+    EXPECT_EQ(Postfix("=SUM(A1:A10) + AVERAGE(B1:B5) * 2"), "A1 A10 : SUM B1 B5 : AVERAGE 2 * +");
 }
 
 TEST_F(FormulaParserTests, ValidateCorrectFormula) {
@@ -65,18 +88,93 @@ TEST_F(FormulaParserTests, ValidateIncorrectFormula) {
     EXPECT_FALSE(isValid);
 }
 
-TEST_F(FormulaParserTests, HandleDivideByZeroError) {
-    // This test case verifies that the FormulaParser correctly handles and reports a divide by zero error.
-    const std::string divideByZeroFormula = "=10 / 0";
+TEST_F(FormulaParserTests, DivideByZeroIsLeftToEvaluation) {
+    // Parsing does not evaluate: "=10 / 0" is well formed and yields #DIV/0! only when calculated.
+    EXPECT_EQ(Postfix("=10 / 0"), "10 0 /");
+}
 
-    EXPECT_THROW({
+TEST_F(FormulaParserTests, FollowsExcelPrecedence) {
+    EXPECT_EQ(Tree("=1+2*3^2"), "(1+(2*(3^2)))");
+    EXPECT_EQ(Tree("=2^3^2"), "((2^3)^2)");      // left-associative, 64
+    EXPECT_EQ(Tree("=-2^2"), "((-2)^2)");        // negation binds tighter, 4
+    EXPECT_EQ(Tree("=-A1:B2"), "(-(A1:B2))");
+    EXPECT_EQ(Tree("=1+50%*2"), "(1+((50%)*2))");
+    EXPECT_EQ(Tree("=A1&B1=C1&\"x\""), "((A1&B1)=(C1&\"x\"))");
+    EXPECT_EQ(Tree("=1-2-3<=+4"), "(((1-2)-3)<=(+4))");
+    EXPECT_EQ(Tree("=(1+2)*3"), "((1+2)*3)");
+}
+
+TEST_F(FormulaParserTests, ParsesReferencesLiteralsAndCalls) {
+    const FormulaNode* root = formulaParser->Parse("='My Sheet'!A1:Sheet2!$B$2 <> \"say \"\"hi\"\"\"");
+    EXPECT_EQ(Print(*root), "(('My Sheet'!A1:Sheet2!$B$2)<>\"say \"hi\"\")");
+    EXPECT_EQ(root->left->left->kind, FormulaNodeKind::Reference);
+    EXPECT_EQ(root->right->kind, FormulaNodeKind::String);
+
+    EXPECT_EQ(Tree("=IF(A1,,#n/a)"), "IF(A1,_,#N/A)");
+    EXPECT_EQ(Tree("=SUM(Data!A:A, 1:3)"), "SUM((Data!A:A),(1:3))");
+    EXPECT_EQ(Tree("=NOW()"), "NOW()");
+    EXPECT_EQ(formulaParser->Parse("=true")->kind, FormulaNodeKind::Boolean);
+    EXPECT_EQ(formulaParser->Parse("=Rate")->kind, FormulaNodeKind::Name);
+}
+
+TEST_F(FormulaParserTests, RejectsMalformedFormulas) {
+    for (const char* formula : {"=", "=1+", "=*2", "=(1", "=1)", "=SUM(1 2)", "=\"open", "=#BOGUS!",
+                                "=Sheet1!", "=\"a\":B1", "=1 @ 2", "={1,2}"}) {
+        EXPECT_FALSE(formulaParser->ValidateFormula(formula)) << formula;
         try {
-            formulaParser->ParseFormula(divideByZeroFormula);
+            formulaParser->ParseFormula(formula);
+            ADD_FAILURE() << formula;
         } catch (const CalculationException& e) {
-            EXPECT_EQ(e.GetErrorCode(), CalculationErrorCode::DIVIDE_BY_ZERO);
-            throw;
+            EXPECT_EQ(e.getCalculationErrorCode(), CalculationErrorCode::INVALID_FORMULA) << formula;
         }
-    }, CalculationException);
+    }
+}
+
+TEST_F(FormulaParserTests, TreesLiveInTheWorkbookArena) {
+    std::string formula = "=SUM(A1:A10)*2";
+    const FormulaNode* root = formulaParser->Parse(formula);
+    const std::size_t used = formulaParser->GetArena().GetBytesUsed();
+    formula.assign(formula.size(), '?'); // the tree keeps its own copy of the text
+    EXPECT_EQ(Print(*root), "(SUM((A1:A10))*2)");
+
+    // Validation and postfix parsing leave nothing behind
+    EXPECT_TRUE(formulaParser->ValidateFormula("=1+2"));
+    EXPECT_FALSE(formulaParser->ValidateFormula("=1+"));
+    formulaParser->ParseFormula("=A1*3");
+    EXPECT_EQ(formulaParser->GetArena().GetBytesUsed(), used);
+
+    formulaParser->ResetArena();
+    EXPECT_EQ(formulaParser->GetArena().GetBytesUsed(), 0u);
+}
+
+TEST_F(FormulaParserTests, TestParseThroughput) {
+    // Formulas typical of a large model, filled down 100,000 rows
+    const char* shapes[] = {
+        "=SUM(A%d:A%d)*1.05 + IF(B%d>0, \"positive\", \"negative\")",
+        "=VLOOKUP($A%d, 'Price List'!$A$1:$F$500, 3, FALSE) & \" units\"",
+        "=ROUND((C%d-D%d)/D%d, 4)",
+        "=IFERROR(INDEX(Data!B:B, MATCH(A%d, Data!A:A, 0)), #N/A) <> \"\"",
+    };
+    std::vector<std::string> formulas;
+    std::size_t bytes = 0;
+    char buffer[128];
+    for (int row = 1; row <= 100000; ++row) {
+        std::snprintf(buffer, sizeof(buffer), shapes[row % 4], row, row + 1, row + 2);
+        formulas.emplace_back(buffer);
+        bytes += formulas.back().size();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& formula : formulas) {
+        formulaParser->Parse(formula);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    // Reported in the test XML rather than asserted, so loaded or sanitizer builds cannot fail on time
+    RecordProperty("formulas_per_second", static_cast<int>(formulas.size() / seconds));
+    RecordProperty("megabytes_per_second", static_cast<int>(bytes / seconds / 1e6));
+    RecordProperty("arena_bytes", static_cast<int>(formulaParser->GetArena().GetBytesUsed()));
 }
 
 // Additional test cases can be added here to cover more scenarios and edge cases
@@ -84,4 +182,4 @@ TEST_F(FormulaParserTests, HandleDivideByZeroError) {
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,205 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include "../../FormulaParser/FormulaCompiler.h"
+#include "../../Caching/FormulaProgramCache.h"
+#include "../../FunctionLibrary/FunctionRegistry.h"
+#include "../../ErrorHandling/CalculationErrors.h"
+
+using namespace ExcelCalculationEngine;
+
+namespace {
+
+CellReference At(std::int32_t row, std::int32_t column) {
+    return CellReference{0, row, column};
+}
+
+std::vector<Opcode> Ops(const FormulaProgram& program) {
+    std::vector<Opcode> ops;
+    for (const auto& instruction : program.GetCode()) {
+        if (instruction.op != Opcode::Return) {
+            ops.push_back(instruction.op);
+        }
+    }
+    return ops;
+}
+
+} // namespace
+
+TEST(FormulaShapeTest, FilledDownFormulasShareOneShape) {
+    // =B2*C2 in D2 and =B3*C3 in D3 are the same relative formula.
+    const std::string first = FormulaCompiler::NormalizeShape("=B2*C2", At(1, 3));
+    const std::string second = FormulaCompiler::NormalizeShape("=B3*C3", At(2, 3));
+    EXPECT_EQ(first, "=R[0]C[-2]*R[0]C[-1]");
+    EXPECT_EQ(first, second);
+}
+
+TEST(FormulaShapeTest, AbsoluteComponentsAreKeptAbsolute) {
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("=$B$2+B$2+$B2", At(4, 4)),
+              "=R2C2+R2C[-3]+R[-3]C2");
+    EXPECT_NE(FormulaCompiler::NormalizeShape("=$A$1", At(0, 1)),
+              FormulaCompiler::NormalizeShape("=A1", At(0, 1)));
+}
+
+TEST(FormulaShapeTest, WhitespaceAndCaseDoNotChangeTheShape) {
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("= sum( a1:a3 ) ", At(3, 0)),
+              FormulaCompiler::NormalizeShape("=SUM(A1:A3)", At(3, 0)));
+}
+
+TEST(FormulaShapeTest, NamesThatLookLikeReferencesAreNotRewritten) {
+    // LOG10 is a function, and references inside strings are plain text.
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("=LOG10(A1)&\"B2\"", At(0, 1)),
+              "=LOG10(R[0]C[-1])&\"B2\"");
+}
+
+TEST(FormulaShapeTest, SheetQualifiedReferences) {
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("='My Sheet'!A1+Data!$B$1", At(0, 0)),
+              "='My Sheet'!R[0]C[0]+'Data'!R1C2");
+}
+
+TEST(FormulaShapeTest, ParenthesesTheTreeDoesNotNeedAreDropped) {
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("=((1+2))*(3)", At(0, 0)), "=(1+2)*3");
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("=1-(2-3)", At(0, 0)), "=1-(2-3)");
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("=(1-2)-3", At(0, 0)), "=1-2-3");
+    EXPECT_EQ(FormulaCompiler::NormalizeShape("=+A1", At(0, 1)), FormulaCompiler::NormalizeShape("=A1", At(0, 1)));
+}
+
+TEST(FormulaCompilerTest, WholeColumnsAndRows) {
+    auto program = FormulaCompiler("=SUM(A:B,$2:3)", At(4, 2)).Compile();
+    ASSERT_EQ(program->GetReferences().size(), 2u);
+    const ReferenceOperand& columns = program->GetReferences()[0];
+    EXPECT_EQ(columns.first.Resolve(At(4, 2)), At(0, 0));
+    EXPECT_EQ(columns.last.Resolve(At(4, 2)), At(MAX_ROWS - 1, 1));
+    const ReferenceOperand& rows = program->GetReferences()[1];
+    EXPECT_EQ(rows.first.Resolve(At(4, 2)), At(1, 0));
+    EXPECT_EQ(rows.last.Resolve(At(4, 2)), At(2, MAX_COLUMNS - 1));
+    EXPECT_EQ(Ops(*program), (std::vector<Opcode>{Opcode::LoadRange, Opcode::LoadRange, Opcode::CallFunction}));
+}
+
+TEST(FormulaCompilerTest, ExcelPrecedence) {
+    // -2^2 is 4 in Excel: negation binds tighter than exponentiation.
+    auto program = FormulaCompiler("=-2^2", At(0, 0)).Compile();
+    EXPECT_EQ(Ops(*program), (std::vector<Opcode>{Opcode::PushConstant, Opcode::Negate,
+                                                     Opcode::PushConstant, Opcode::Power}));
+
+    program = FormulaCompiler("=1+2*3&\"x\"=A1", At(0, 1)).Compile();
+    EXPECT_EQ(Ops(*program), (std::vector<Opcode>{
+        Opcode::PushConstant, Opcode::PushConstant, Opcode::PushConstant, Opcode::Multiply,
+        Opcode::Add, Opcode::PushConstant, Opcode::Concatenate, Opcode::LoadCell,
+        Opcode::Equal}));
+
+    program = FormulaCompiler("=50%^2", At(0, 0)).Compile();
+    EXPECT_EQ(Ops(*program), (std::vector<Opcode>{Opcode::PushConstant, Opcode::Percent,
+                                                     Opcode::PushConstant, Opcode::Power}));
+}
+
+TEST(FormulaCompilerTest, FunctionArity) {
+    auto program = FormulaCompiler("=IF(A1>0,SUM(B1:B3,1),NOW())", At(0, 2)).Compile();
+    const auto& code = program->GetCode();
+    ASSERT_GE(code.size(), 2u);
+    EXPECT_EQ(code.back().op, Opcode::Return);
+    const Instruction& call = code[code.size() - 2];
+    EXPECT_EQ(call.op, Opcode::CallFunction);
+    EXPECT_EQ(static_cast<FunctionId>(call.operand), FunctionId::If);
+    EXPECT_EQ(call.argumentCount, 3u);
+
+    std::uint32_t nowArgs = 99;
+    std::uint32_t sumArgs = 99;
+    for (const auto& instruction : code) {
+        if (instruction.op != Opcode::CallFunction) continue;
+        const auto id = static_cast<FunctionId>(instruction.operand);
+        if (id == FunctionId::Now) nowArgs = instruction.argumentCount;
+        if (id == FunctionId::Sum) sumArgs = instruction.argumentCount;
+    }
+    EXPECT_EQ(nowArgs, 0u);
+    EXPECT_EQ(sumArgs, 2u);
+
+    ASSERT_EQ(program->GetReferences().size(), 2u);
+    const ReferenceOperand& range = program->GetReferences()[1];
+    EXPECT_TRUE(range.isRange);
+    EXPECT_EQ(range.first.Resolve(At(0, 2)), At(0, 1));
+    EXPECT_EQ(range.last.Resolve(At(0, 2)), At(2, 1));
+}
+
+TEST(FormulaCompilerTest, VolatileFunctionsMarkTheProgram) {
+    EXPECT_TRUE(FormulaCompiler("=NOW()+1", At(0, 0)).Compile()->IsVolatile());
+    EXPECT_TRUE(FormulaCompiler("=IF(A1,1,RAND())", At(0, 0)).Compile()->IsVolatile());
+    EXPECT_FALSE(FormulaCompiler("=SUM(A1:A2)", At(0, 0)).Compile()->IsVolatile());
+}
+
+TEST(FormulaCompilerTest, ReferenceFunctionsAreDynamicNotVolatile) {
+    auto program = FormulaCompiler("=SUM(OFFSET(A1,0,0,2,1))", At(0, 2)).Compile();
+    EXPECT_TRUE(program->HasDynamicReferences());
+    EXPECT_FALSE(program->IsVolatile());
+    // OFFSET's first argument is loaded as a reference, not read as a value
+    EXPECT_EQ(Ops(*program)[0], Opcode::LoadRange);
+    EXPECT_FALSE(FormulaCompiler("=SUM(A1:A2)", At(0, 0)).Compile()->HasDynamicReferences());
+
+    std::string sheet;
+    ReferenceOperand reference;
+    ASSERT_TRUE(FormulaCompiler::ParseReference("'It''s'!B2:$C$4", sheet, reference));
+    EXPECT_EQ(sheet, "It's");
+    EXPECT_TRUE(reference.isRange);
+    EXPECT_EQ(reference.first.Resolve(At(9, 9)), At(1, 1));
+    EXPECT_EQ(reference.last.Resolve(At(9, 9)), At(3, 2));
+    EXPECT_FALSE(FormulaCompiler::ParseReference("B2+1", sheet, reference));
+    EXPECT_FALSE(FormulaCompiler::ParseReference("!B2", sheet, reference));
+}
+
+TEST(FormulaCompilerTest, RejectsMalformedFormulas) {
+    using Excel::CalculationEngine::CalculationException;
+    for (const char* formula : {"=1+", "=(1", "=1)", "=SUM(1,)", "=1 2", "=\"open", "=*2", "=(1,2)", "={1,2}",
+                                "=Sheet1!A1:Sheet2!B2", "=OFFSET(A1,0,0):B2"}) {
+        EXPECT_THROW(FormulaCompiler(formula, At(0, 0)).Compile(), CalculationException) << formula;
+    }
+}
+
+TEST(FormulaProgramCacheTest, CompilesEachShapeOnce) {
+    FormulaProgramCache cache;
+    FormulaBinding first;
+    for (std::int32_t row = 1; row <= 1000; ++row) {
+        const std::string formula = "=B" + std::to_string(row + 1) + "*C" + std::to_string(row + 1);
+        FormulaBinding binding = cache.Bind(formula, At(row, 3));
+        EXPECT_EQ(binding.anchor, At(row, 3));
+        if (row == 1) {
+            first = binding;
+        } else {
+            EXPECT_EQ(binding.program.get(), first.program.get());
+        }
+    }
+    EXPECT_EQ(cache.GetShapeCount(), 1u);
+    EXPECT_EQ(cache.GetCompileCount(), 1u);
+
+    // The shared program resolves against each cell's own anchor.
+    const ReferenceOperand& reference = first.program->GetReference(0);
+    EXPECT_EQ(reference.first.Resolve(At(500, 3)), At(500, 1));
+
+    FormulaBinding absolute = cache.Bind("=$B$2*C2", At(1, 3));
+    EXPECT_EQ(cache.GetShapeCount(), 2u);
+    EXPECT_NE(cache.Find("=R[0]C[-2]*R[0]C[-1]"), nullptr);
+}
+
+TEST(FormulaProgramCacheTest, ReleasesShapesNoCellUses) {
+    FormulaProgramCache cache;
+    FormulaBinding kept = cache.Bind("=A1+1", At(0, 1));
+    std::weak_ptr<const FormulaProgram> released;
+    {
+        FormulaBinding cleared = cache.Bind("=A1*2", At(0, 1));
+        released = cleared.program;
+        EXPECT_EQ(cache.GetShapeCount(), 2u);
+    }
+    EXPECT_TRUE(released.expired());
+    EXPECT_EQ(cache.GetShapeCount(), 1u);
+    EXPECT_EQ(cache.Find("=R[0]C[-1]*2"), nullptr);
+
+    // A freed shape is compiled again when it comes back
+    cache.Bind("=A1*2", At(0, 1));
+    EXPECT_EQ(cache.GetCompileCount(), 3u);
+
+    // Expired entries do not pile up as distinct formulas come and go
+    for (int i = 0; i < 1000; ++i) {
+        cache.Bind("=A1*" + std::to_string(i), At(0, 1));
+    }
+    EXPECT_EQ(cache.GetShapeCount(), 1u);
+    EXPECT_NE(cache.Find("=R[0]C[-1]+1"), nullptr);
+}
@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../../Evaluation/CellValueStore.h"
+#include "../../Evaluation/FormulaVM.h"
+#include "../../FormulaParser/FormulaCompiler.h"
+#include "TestCellSource.h"
+
+using namespace ExcelCalculationEngine;
+
+namespace {
+
+// Stands in for an add-in: receives calls to names the registry does not know.
+class AddInLibrary : public IFunctionLibrary {
+public:
+    std::variant<double, std::string, bool> ExecuteFunction(
+        const std::string& functionName,
+        const std::vector<std::variant<double, std::string, bool>>& arguments) override {
+        if (functionName != "MYSUM") {
+            throw std::invalid_argument("unsupported");
+        }
+        double total = 0.0;
+        for (const auto& argument : arguments) {
+            if (const double* number = std::get_if<double>(&argument)) total += *number;
+        }
+        return total;
+    }
+
+    bool IsFunctionSupported(const std::string& functionName) const override {
+        return functionName == "MYSUM";
+    }
+};
+
+// Counts the reads of each kind that the VM makes.
+class CountingCellSource : public MapCellSource {
+public:
+    FormulaValue GetCellValue(const CellReference& cell) const override {
+        ++valueReads;
+        return MapCellSource::GetCellValue(cell);
+    }
+
+    bool TryGetNumber(const CellReference& cell, double& number) const override {
+        ++numberReads;
+        return MapCellSource::TryGetNumber(cell, number);
+    }
+
+    mutable int valueReads = 0;
+    mutable int numberReads = 0;
+};
+
+class FormulaVMTest : public ::testing::Test {
+protected:
+    FormulaValue Run(const std::string& formula, CellReference anchor = CellReference{0, 10, 10}) {
+        auto program = FormulaCompiler(formula, anchor).Compile();
+        return vm.Execute(*program, anchor, cells, &library);
+    }
+
+    double RunNumber(const std::string& formula) {
+        const FormulaValue value = Run(formula);
+        EXPECT_TRUE(value.IsNumber()) << formula;
+        return value.GetNumber();
+    }
+
+    FormulaVM vm;
+    MapCellSource cells;
+    AddInLibrary library;
+};
+
+} // namespace
+
+TEST_F(FormulaVMTest, Arithmetic) {
+    EXPECT_DOUBLE_EQ(RunNumber("=1+2*3"), 7.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=(1+2)*3"), 9.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=-2^2"), 4.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=2^3^2"), 64.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=50%*4"), 2.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=\"3\"+TRUE"), 4.0);
+}
+
+TEST_F(FormulaVMTest, SharedProgramUsesEachAnchor) {
+    for (std::int32_t row = 0; row < 5; ++row) {
+        cells.Set(row, 1, FormulaValue::Number(row));
+        cells.Set(row, 2, FormulaValue::Number(10));
+    }
+    auto program = FormulaCompiler("=B1*C1", CellReference{0, 0, 3}).Compile();
+    for (std::int32_t row = 0; row < 5; ++row) {
+        const FormulaValue value = vm.Execute(*program, CellReference{0, row, 3}, cells, &library);
+        EXPECT_EQ(value, FormulaValue::Number(row * 10.0));
+    }
+}
+
+TEST_F(FormulaVMTest, ErrorsPropagateAsValues) {
+    EXPECT_EQ(Run("=1/0"), FormulaValue::Error(FormulaError::DivideByZero));
+    EXPECT_EQ(Run("=1/0+5"), FormulaValue::Error(FormulaError::DivideByZero));
+    EXPECT_EQ(Run("=\"abc\"*2"), FormulaValue::Error(FormulaError::Value));
+    EXPECT_EQ(Run("=#N/A&\"x\""), FormulaValue::Error(FormulaError::NotAvailable));
+    EXPECT_EQ(Run("=SUM(1,#REF!)"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=NOSUCHFUNCTION(1)"), FormulaValue::Error(FormulaError::Name));
+    EXPECT_EQ(Run("=Missing!A1"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=0^0"), FormulaValue::Error(FormulaError::Number));
+    // A relative reference that moves off the grid.
+    EXPECT_EQ(Run("=A1", CellReference{0, 0, 0}), FormulaValue());
+    auto program = FormulaCompiler("=A1", CellReference{0, 5, 5}).Compile();
+    EXPECT_EQ(vm.Execute(*program, CellReference{0, 0, 5}, cells, &library),
+              FormulaValue::Error(FormulaError::Reference));
+}
+
+TEST_F(FormulaVMTest, TextAndComparisons) {
+    cells.Set(0, 0, FormulaValue::Text("Hello"));
+    EXPECT_EQ(Run("=A1&\" \"&1.5"), FormulaValue::Text("Hello 1.5"));
+    EXPECT_EQ(Run("=A1=\"HELLO\""), FormulaValue::Boolean(true));
+    EXPECT_EQ(Run("=A1<>\"hello\""), FormulaValue::Boolean(false));
+    EXPECT_EQ(Run("=1<\"a\""), FormulaValue::Boolean(true));
+    EXPECT_EQ(Run("=Z99=0"), FormulaValue::Boolean(true));
+    EXPECT_EQ(Run("=2>=3"), FormulaValue::Boolean(false));
+}
+
+TEST_F(FormulaVMTest, FunctionCallsExpandRanges) {
+    for (std::int32_t row = 0; row < 4; ++row) {
+        cells.Set(row, 0, FormulaValue::Number(row + 1));
+    }
+    EXPECT_DOUBLE_EQ(RunNumber("=SUM(A1:A4)"), 10.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=SUM(Sheet1!A1:A2,100)*2"), 206.0);
+    EXPECT_EQ(Run("=A1:A4"), FormulaValue::Error(FormulaError::Value));
+    EXPECT_EQ(Run("=A2:A2"), FormulaValue::Number(2));
+    EXPECT_DOUBLE_EQ(RunNumber("=MYSUM(A1:A4,1)"), 11.0);
+}
+
+TEST_F(FormulaVMTest, OffsetAndIndirectRecordWhatTheyResolve) {
+    for (std::int32_t row = 0; row < 3; ++row) {
+        cells.Set(row, 0, FormulaValue::Number(row + 1));
+    }
+    cells.Set(0, 1, FormulaValue::Text("A2"));
+
+    EXPECT_DOUBLE_EQ(RunNumber("=SUM(OFFSET(A1,1,0,2,1))"), 5.0);
+    ASSERT_EQ(vm.GetDynamicReferences().size(), 1u);
+    EXPECT_EQ(vm.GetDynamicReferences()[0], (RangeReference{0, 1, 0, 2, 0}));
+
+    // One-cell results read as values
+    EXPECT_DOUBLE_EQ(RunNumber("=OFFSET(A1,2,0)*2"), 6.0);
+    EXPECT_DOUBLE_EQ(RunNumber("=INDIRECT(B1)+1"), 3.0);
+    EXPECT_EQ(vm.GetDynamicReferences(), std::vector<RangeReference>{(RangeReference{0, 1, 0, 1, 0})});
+    EXPECT_EQ(Run("=OFFSET(INDIRECT(B1),-1,0)&\"!\""), FormulaValue::Text("1!"));
+    EXPECT_EQ(vm.GetDynamicReferences().size(), 2u);
+    EXPECT_DOUBLE_EQ(RunNumber("=SUM(INDIRECT(\"Sheet1!$A$1:A3\"))"), 6.0);
+
+    EXPECT_EQ(Run("=OFFSET(A1,-1,0)"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=INDIRECT(\"not a cell\")"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=INDIRECT(\"Other!A1\")"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=OFFSET(A1:A3,0,0)"), FormulaValue::Error(FormulaError::Value));
+    EXPECT_TRUE(vm.GetDynamicReferences().size() == 1u);
+    EXPECT_DOUBLE_EQ(RunNumber("=A1+1"), 2.0);
+    EXPECT_TRUE(vm.GetDynamicReferences().empty());
+}
+
+TEST_F(FormulaVMTest, StackIsReusedAcrossRuns) {
+    auto deep = FormulaCompiler("=1+(2+(3+(4+(5+(6+7)))))", CellReference{}).Compile();
+    EXPECT_EQ(deep->GetMaxStackDepth(), 7u);
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_EQ(vm.Execute(*deep, CellReference{}, cells, &library), FormulaValue::Number(28));
+    }
+}
+
+TEST_F(FormulaVMTest, NumbersLoadWithoutBuildingValues) {
+    CountingCellSource counting;
+    counting.Set(0, 0, FormulaValue::Number(2));
+    counting.Set(0, 1, FormulaValue::Text("x"));
+    auto program = FormulaCompiler("=A1*A1+LEN(B1)", CellReference{}).Compile();
+    EXPECT_EQ(vm.Execute(*program, CellReference{}, counting, &library), FormulaValue::Number(5));
+    EXPECT_EQ(counting.numberReads, 3);
+    EXPECT_EQ(counting.valueReads, 1); // only the text
+}
+
+TEST(CellValueStoreTest, WrittenValuesShadowTheBase) {
+    auto base = std::make_shared<MapCellSource>();
+    base->Set(0, 0, FormulaValue::Number(1));
+    base->Set(1, 0, FormulaValue::Number(2));
+    CellValueStore store;
+    auto program = FormulaCompiler("=A1+A2", CellReference{}).Compile();
+    FormulaVM vm;
+
+    EXPECT_FALSE(store.FindSheet("Other"));
+    EXPECT_EQ(vm.Execute(*program, CellReference{}, store, nullptr), FormulaValue::Number(0));
+    store.SetBase(base);
+    EXPECT_EQ(vm.Execute(*program, CellReference{}, store, nullptr), FormulaValue::Number(3));
+    store.Set(CellReference{0, 1, 0}, FormulaValue::Number(10));
+    EXPECT_EQ(vm.Execute(*program, CellReference{}, store, nullptr), FormulaValue::Number(11));
+    store.Set(CellReference{0, 0, 0}, FormulaValue::Text("a"));
+    EXPECT_EQ(vm.Execute(*program, CellReference{}, store, nullptr), FormulaValue::Error(FormulaError::Value));
+}
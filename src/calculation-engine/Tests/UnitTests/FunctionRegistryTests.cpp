@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../../FunctionLibrary/FunctionRegistry.h"
+#include "../../FormulaParser/FormulaCompiler.h"
+#include "../../Evaluation/FormulaVM.h"
+#include "../../ErrorHandling/CalculationErrors.h"
+
+using namespace ExcelCalculationEngine;
+
+namespace {
+
+class FixedCellSource : public ICellValueSource {
+public:
+    FormulaValue GetCellValue(const CellReference& cell) const override {
+        if (cell.column == 0 && cell.row < 3) {
+            return FormulaValue::Number(cell.row + 1);
+        }
+        if (cell.column == 1 && cell.row == 0) {
+            return FormulaValue::Error(FormulaError::NotAvailable);
+        }
+        return FormulaValue();
+    }
+
+    std::optional<std::uint32_t> FindSheet(const std::string&) const override {
+        return std::nullopt;
+    }
+};
+
+FormulaValue Evaluate(const std::string& formula) {
+    static FixedCellSource cells;
+    const CellReference anchor{0, 10, 10};
+    auto program = FormulaCompiler(formula, anchor).Compile();
+    return FormulaVM::ForCurrentThread().Execute(*program, anchor, cells, nullptr);
+}
+
+} // namespace
+
+TEST(FunctionRegistryTest, EveryEntryIsFoundByItsName) {
+    for (std::size_t i = 0; i < FunctionRegistry::GetFunctionCount(); ++i) {
+        const FunctionInfo& function = FunctionRegistry::Get(static_cast<FunctionId>(i));
+        EXPECT_EQ(FunctionRegistry::Find(function.name), &function) << function.name;
+        // Reference functions are evaluated by the VM, everything else through the table.
+        ASSERT_EQ(function.implementation == nullptr, function.ReturnsReference()) << function.name;
+    }
+}
+
+TEST(FunctionRegistryTest, LookupIgnoresCaseAndRejectsUnknownNames) {
+    const FunctionInfo* sum = FunctionRegistry::Find("sUm");
+    ASSERT_NE(sum, nullptr);
+    EXPECT_EQ(sum->id, FunctionId::Sum);
+    EXPECT_EQ(FunctionRegistry::Find("SUMX"), nullptr);
+    EXPECT_EQ(FunctionRegistry::Find("SU"), nullptr);
+    EXPECT_EQ(FunctionRegistry::Find(""), nullptr);
+    EXPECT_EQ(FunctionRegistry::Find("VLOOKUPS"), nullptr);
+}
+
+TEST(FunctionRegistryTest, Flags) {
+    EXPECT_TRUE(FunctionRegistry::Get(FunctionId::Now).IsVolatile());
+    EXPECT_TRUE(FunctionRegistry::Get(FunctionId::Rand).IsVolatile());
+    EXPECT_FALSE(FunctionRegistry::Get(FunctionId::Sum).IsVolatile());
+    EXPECT_TRUE(FunctionRegistry::Get(FunctionId::IfError).AcceptsErrors());
+    EXPECT_FALSE(FunctionRegistry::Get(FunctionId::Sum).AcceptsErrors());
+    // Their precedents are recorded at run time instead of recalculating them every time.
+    EXPECT_FALSE(FunctionRegistry::Get(FunctionId::Offset).IsVolatile());
+    EXPECT_FALSE(FunctionRegistry::Get(FunctionId::Indirect).IsVolatile());
+    EXPECT_TRUE(FunctionRegistry::Get(FunctionId::Offset).TakesReference());
+    EXPECT_FALSE(FunctionRegistry::Get(FunctionId::Indirect).TakesReference());
+}
+
+TEST(FunctionRegistryTest, CompilerChecksArity) {
+    using Excel::CalculationEngine::CalculationException;
+    EXPECT_THROW(FormulaCompiler("=ABS(1,2)", CellReference{}).Compile(), CalculationException);
+    EXPECT_THROW(FormulaCompiler("=MID(\"abc\",1)", CellReference{}).Compile(), CalculationException);
+    EXPECT_THROW(FormulaCompiler("=SUM()", CellReference{}).Compile(), CalculationException);
+    EXPECT_THROW(FormulaCompiler("=IF(A1)", CellReference{}).Compile(), CalculationException);
+    EXPECT_NO_THROW(FormulaCompiler("=IF(A1,1)", CellReference{}).Compile());
+    EXPECT_NO_THROW(FormulaCompiler("=NOW()", CellReference{}).Compile());
+    // Names outside the registry are not checked; they are resolved by IFunctionLibrary at run time.
+    EXPECT_NO_THROW(FormulaCompiler("=CUSTOM(1,2,3)", CellReference{}).Compile());
+}
+
+TEST(FunctionRegistryTest, Builtins) {
+    EXPECT_EQ(Evaluate("=SUM(A1:A5,10)"), FormulaValue::Number(16));
+    EXPECT_EQ(Evaluate("=AVERAGE(A1:A3)"), FormulaValue::Number(2));
+    EXPECT_EQ(Evaluate("=COUNT(A1:B3)"), FormulaValue::Number(3));
+    EXPECT_EQ(Evaluate("=COUNTA(A1:B3)"), FormulaValue::Number(4));
+    EXPECT_EQ(Evaluate("=MAX(A1:A3)-MIN(A1:A3)"), FormulaValue::Number(2));
+    EXPECT_EQ(Evaluate("=MEDIAN(1,4,2,3)"), FormulaValue::Number(2.5));
+    EXPECT_EQ(Evaluate("=ROUND(2.5,0)"), FormulaValue::Number(3));
+    EXPECT_EQ(Evaluate("=ROUND(-1.25,1)"), FormulaValue::Number(-1.3));
+    EXPECT_EQ(Evaluate("=MOD(-3,2)"), FormulaValue::Number(1));
+    EXPECT_EQ(Evaluate("=UPPER(LEFT(\"hello\",2))&MID(\"hello\",3,2)&RIGHT(\"hello\")"), FormulaValue::Text("HEllo"));
+    EXPECT_EQ(Evaluate("=TRIM(\"  a   b \")"), FormulaValue::Text("a b"));
+    EXPECT_EQ(Evaluate("=AND(TRUE,A1:A3)"), FormulaValue::Boolean(true));
+    EXPECT_EQ(Evaluate("=LEN(A2:A2)"), FormulaValue::Number(1));
+}
+
+TEST(FunctionRegistryTest, ErrorHandlingFollowsFlags) {
+    EXPECT_EQ(Evaluate("=SUM(A1:B3)"), FormulaValue::Error(FormulaError::NotAvailable));
+    EXPECT_EQ(Evaluate("=IF(TRUE,1,1/0)"), FormulaValue::Number(1));
+    EXPECT_EQ(Evaluate("=IF(1/0,1,2)"), FormulaValue::Error(FormulaError::DivideByZero));
+    EXPECT_EQ(Evaluate("=IFERROR(B1,\"none\")"), FormulaValue::Text("none"));
+    EXPECT_EQ(Evaluate("=ISERROR(B1)"), FormulaValue::Boolean(true));
+    EXPECT_EQ(Evaluate("=LEN(A1:A3)"), FormulaValue::Error(FormulaError::Value));
+    EXPECT_EQ(Evaluate("=SQRT(-1)"), FormulaValue::Error(FormulaError::Number));
+    EXPECT_EQ(Evaluate("=AVERAGE(C1:C3)"), FormulaValue::Error(FormulaError::DivideByZero));
+    EXPECT_EQ(Evaluate("=CUSTOM(1)"), FormulaValue::Error(FormulaError::Name));
+}
@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../../Evaluation/IterativeCalculation.h"
+#include "../../FormulaParser/FormulaCompiler.h"
+#include "../../Multithreading/ParallelCalculation.h"
+#include "TestCellSource.h"
+
+using namespace ExcelCalculationEngine;
+
+namespace {
+
+FormulaBinding Bind(const std::string& formula, std::int32_t row, std::int32_t column) {
+    const CellReference anchor{0, row, column};
+    return FormulaBinding{FormulaCompiler(formula, anchor).Compile(), anchor};
+}
+
+} // namespace
+
+TEST(IterativeCalculationTest, InterestCircularityConverges) {
+    // B1 is the balance including interest, C1 the interest on it; D1 reads the loop
+    MapCellSource cells;
+    cells.Set(0, 0, FormulaValue::Number(1000.0));
+    const std::vector<FormulaBinding> bindings = {
+        Bind("=C1*2", 0, 3), Bind("=A1+C1", 0, 1), Bind("=B1*0.05", 0, 2)};
+    IterationSettings settings;
+    settings.maxChange = 1e-9;
+
+    const auto result = IterativeCalculation::Calculate(bindings, cells, nullptr, settings);
+    ASSERT_TRUE(result.converged);
+    EXPECT_LT(result.iterations, 20);
+    EXPECT_NEAR(result.values[1].GetNumber(), 1000.0 / 0.95, 1e-6);
+    EXPECT_NEAR(result.values[2].GetNumber(), 50.0 / 0.95, 1e-6);
+    EXPECT_NEAR(result.values[0].GetNumber(), 100.0 / 0.95, 1e-6); // after the loop settled
+}
+
+TEST(IterativeCalculationTest, StopsAtMaxIterations) {
+    MapCellSource cells;
+    IterationSettings settings;
+    settings.maxIterations = 10;
+
+    const auto result = IterativeCalculation::Calculate({Bind("=A1+1", 0, 0)}, cells, nullptr, settings);
+    EXPECT_FALSE(result.converged);
+    EXPECT_EQ(result.iterations, 10);
+    EXPECT_EQ(result.values[0].GetNumber(), 10.0);
+
+    // Without a loop a cell runs once and nothing is iterated
+    const auto single = IterativeCalculation::Calculate({Bind("=1+1", 0, 0)}, cells, nullptr, settings);
+    EXPECT_TRUE(single.converged);
+    EXPECT_EQ(single.iterations, 0);
+    EXPECT_EQ(single.values[0].GetNumber(), 2.0);
+}
+
+TEST(IterativeCalculationTest, IndependentLoopsRunInParallel) {
+    // 50 separate two-cell loops in columns A:B, each halving toward its row number, and a total over all of them
+    MapCellSource cells;
+    std::vector<FormulaBinding> bindings;
+    for (int row = 0; row < 50; ++row) {
+        const std::string other = std::to_string(row + 1);
+        bindings.push_back(Bind("=B" + other + "/2+" + std::to_string(row), row, 0));
+        bindings.push_back(Bind("=A" + other, row, 1));
+    }
+    bindings.push_back(Bind("=SUM(A1:A50)", 0, 2));
+    IterationSettings settings;
+    settings.maxChange = 1e-9;
+    ParallelCalculation parallel;
+    parallel.Initialize(4);
+
+    const auto result = IterativeCalculation::Calculate(bindings, cells, nullptr, settings, &parallel);
+    ASSERT_TRUE(result.converged);
+    double total = 0.0;
+    for (int row = 0; row < 50; ++row) {
+        EXPECT_NEAR(result.values[2 * row].GetNumber(), 2.0 * row, 1e-6);
+        total += 2.0 * row;
+    }
+    EXPECT_NEAR(result.values.back().GetNumber(), total, 1e-5);
+}
@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include "../../FunctionLibrary/FunctionArguments.h"
+#include "../../FormulaParser/FormulaCompiler.h"
+#include "../../Evaluation/FormulaVM.h"
+
+using namespace ExcelCalculationEngine;
+
+// GCC flags malloc/free inside replaced operator new/delete once they are inlined into callers.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+namespace {
+
+std::atomic<std::size_t> g_allocations{0};
+
+} // namespace
+
+// Counts every heap allocation in this test binary so a test can assert there were none.
+void* operator new(std::size_t size) {
+    ++g_allocations;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+// Dense columns starting at row 0, handed out as one segment each, like a columnar store.
+class ColumnarSource : public ICellValueSource {
+public:
+    std::vector<FormulaValue>& Column(std::int32_t column) { return m_columns[column]; }
+
+    FormulaValue GetCellValue(const CellReference& cell) const override {
+        auto it = m_columns.find(cell.column);
+        if (it == m_columns.end() || cell.row < 0 || static_cast<std::size_t>(cell.row) >= it->second.size()) {
+            return FormulaValue();
+        }
+        return it->second[static_cast<std::size_t>(cell.row)];
+    }
+
+    std::optional<std::uint32_t> FindSheet(const std::string&) const override {
+        return std::nullopt;
+    }
+
+    bool NextColumnSegment(std::uint32_t, std::int32_t column, std::int32_t row, std::int32_t,
+                           ColumnSegment& segment, FormulaValue&) const override {
+        auto it = m_columns.find(column);
+        if (it == m_columns.end() || static_cast<std::size_t>(row) >= it->second.size()) {
+            return false;
+        }
+        segment = ColumnSegment{0, it->second.data(), it->second.size()};
+        ++segmentCalls;
+        return true;
+    }
+
+    mutable std::size_t segmentCalls = 0;
+
+private:
+    std::map<std::int32_t, std::vector<FormulaValue>> m_columns;
+};
+
+class RangeFunctionTest : public ::testing::Test {
+protected:
+    RangeFunctionTest() {
+        // A: keys 10, 20, 30, 40; B: names; C: a sorted-descending list.
+        const char* names[] = {"ten", "twenty", "thirty", "forty"};
+        for (int i = 0; i < 4; ++i) {
+            cells.Column(0).push_back(FormulaValue::Number((i + 1) * 10));
+            cells.Column(1).push_back(FormulaValue::Text(names[i]));
+            cells.Column(2).push_back(FormulaValue::Number(40 - i * 10));
+        }
+    }
+
+    FormulaValue Run(const std::string& formula) {
+        const CellReference anchor{0, 0, 10};
+        auto program = FormulaCompiler(formula, anchor).Compile();
+        return vm.Execute(*program, anchor, cells, nullptr);
+    }
+
+    FormulaVM vm;
+    ColumnarSource cells;
+};
+
+} // namespace
+
+TEST_F(RangeFunctionTest, VerticalLookup) {
+    EXPECT_EQ(Run("=VLOOKUP(30,A1:B4,2,FALSE)"), FormulaValue::Text("thirty"));
+    EXPECT_EQ(Run("=VLOOKUP(35,A1:B4,2)"), FormulaValue::Text("thirty"));
+    EXPECT_EQ(Run("=VLOOKUP(35,A1:B4,2,FALSE)"), FormulaValue::Error(FormulaError::NotAvailable));
+    EXPECT_EQ(Run("=VLOOKUP(5,A1:B4,2,TRUE)"), FormulaValue::Error(FormulaError::NotAvailable));
+    EXPECT_EQ(Run("=VLOOKUP(10,A1:B4,3,FALSE)"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=VLOOKUP(10,A1:B4,0,FALSE)"), FormulaValue::Error(FormulaError::Value));
+    EXPECT_EQ(Run("=VLOOKUP(\"FORTY\",B1:B4,1,FALSE)"), FormulaValue::Text("forty"));
+}
+
+TEST_F(RangeFunctionTest, HorizontalLookupIndexAndMatch) {
+    EXPECT_EQ(Run("=HLOOKUP(\"twenty\",A2:C3,2,FALSE)"), FormulaValue::Text("thirty"));
+    EXPECT_EQ(Run("=INDEX(A1:C4,2,3)"), FormulaValue::Number(30));
+    EXPECT_EQ(Run("=INDEX(B1:B4,4)"), FormulaValue::Text("forty"));
+    EXPECT_EQ(Run("=INDEX(A1:B4,5,1)"), FormulaValue::Error(FormulaError::Reference));
+    EXPECT_EQ(Run("=MATCH(\"twenty\",B1:B4,0)"), FormulaValue::Number(2));
+    EXPECT_EQ(Run("=MATCH(25,A1:A4)"), FormulaValue::Number(2));
+    EXPECT_EQ(Run("=MATCH(25,C1:C4,-1)"), FormulaValue::Number(2));
+    EXPECT_EQ(Run("=MATCH(1,A1:B4,0)"), FormulaValue::Error(FormulaError::NotAvailable));
+}
+
+TEST_F(RangeFunctionTest, AggregatesStreamSegments) {
+    EXPECT_EQ(Run("=SUM(A1:C4)"), FormulaValue::Number(200));
+    EXPECT_EQ(Run("=COUNTA(A1:C4)"), FormulaValue::Number(12));
+    EXPECT_EQ(Run("=SUM(A2:A3,\"5\",TRUE)"), FormulaValue::Number(56));
+    // Each column of the range is one segment from the source.
+    cells.segmentCalls = 0;
+    Run("=SUM(A1:C4)");
+    EXPECT_EQ(cells.segmentCalls, 3u);
+}
+
+TEST_F(RangeFunctionTest, SumOverAMillionRowsDoesNotAllocate) {
+    std::vector<FormulaValue>& column = cells.Column(5);
+    column.assign(1000000, FormulaValue::Number(1.0));
+
+    const CellReference anchor{0, 0, 10};
+    auto program = FormulaCompiler("=SUM(F1:F1000000)", anchor).Compile();
+    EXPECT_EQ(vm.Execute(*program, anchor, cells, nullptr), FormulaValue::Number(1000000));
+
+    const std::size_t before = g_allocations.load();
+    const FormulaValue result = vm.Execute(*program, anchor, cells, nullptr);
+    const std::size_t after = g_allocations.load();
+    EXPECT_EQ(result, FormulaValue::Number(1000000));
+    EXPECT_EQ(after - before, 0u);
+}
+
+TEST(ForEachCellTest, DefaultSegmentsSkipEmptyCells) {
+    class SparseSource : public ICellValueSource {
+    public:
+        FormulaValue GetCellValue(const CellReference& cell) const override {
+            return cell.row % 3 == 0 ? FormulaValue::Number(cell.row) : FormulaValue();
+        }
+        std::optional<std::uint32_t> FindSheet(const std::string&) const override { return std::nullopt; }
+    } cells;
+
+    std::vector<std::int32_t> rows;
+    const bool complete = ForEachCell(cells, RangeReference{0, 1, 0, 10, 0},
+        [&rows](std::int32_t row, std::int32_t, const FormulaValue&) {
+            rows.push_back(row);
+            return row < 6;
+        });
+    EXPECT_FALSE(complete);
+    EXPECT_EQ(rows, (std::vector<std::int32_t>{3, 6}));
+}
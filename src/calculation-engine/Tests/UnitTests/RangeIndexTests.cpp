@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "../../CalculationChain/RangeIndex.h"
+
+using namespace ExcelCalculationEngine;
+
+namespace {
+
+std::vector<NodeId> Containing(const RangeIndex& index, const CellReference& cell) {
+    std::vector<NodeId> nodes;
+    index.ForEachContaining(cell, [&nodes](NodeId node, RangeEntryId) { nodes.push_back(node); });
+    std::sort(nodes.begin(), nodes.end());
+    return nodes;
+}
+
+} // namespace
+
+TEST(RangeIndexTest, StabbingQueryFindsContainingRanges) {
+    RangeIndex index;
+    index.Insert(RangeReference{0, 0, 0, 999999, 0}, 1);   // A1:A1000000
+    index.Insert(RangeReference{0, 10, 0, 19, 2}, 2);      // A11:C20
+    index.Insert(RangeReference{1, 0, 0, 999999, 0}, 3);   // Sheet2!A:A
+
+    EXPECT_EQ(Containing(index, CellReference{0, 15, 0}), (std::vector<NodeId>{1, 2}));
+    EXPECT_EQ(Containing(index, CellReference{0, 15, 2}), std::vector<NodeId>{2});
+    EXPECT_EQ(Containing(index, CellReference{0, 500000, 0}), std::vector<NodeId>{1});
+    EXPECT_EQ(Containing(index, CellReference{1, 15, 0}), std::vector<NodeId>{3});
+    EXPECT_TRUE(Containing(index, CellReference{0, 15, 3}).empty());
+    EXPECT_TRUE(Containing(index, CellReference{2, 0, 0}).empty());
+}
+
+TEST(RangeIndexTest, RemovedEntriesStopMatchingBeforeAndAfterRebuild) {
+    RangeIndex index;
+    const RangeEntryId overlayEntry = index.Insert(RangeReference{0, 0, 0, 9, 0}, 1);
+    index.Remove(overlayEntry);
+    EXPECT_TRUE(Containing(index, CellReference{0, 5, 0}).empty());
+
+    const RangeEntryId treeEntry = index.Insert(RangeReference{0, 0, 0, 9, 0}, 2);
+    index.Rebuild();
+    EXPECT_EQ(Containing(index, CellReference{0, 5, 0}), std::vector<NodeId>{2});
+    index.Remove(treeEntry);
+    EXPECT_TRUE(Containing(index, CellReference{0, 5, 0}).empty());
+
+    // The tombstoned id is not handed out again while a leaf still points at it.
+    EXPECT_NE(index.Insert(RangeReference{0, 20, 0, 29, 0}, 3), treeEntry);
+    EXPECT_EQ(Containing(index, CellReference{0, 25, 0}), std::vector<NodeId>{3});
+    EXPECT_TRUE(Containing(index, CellReference{0, 5, 0}).empty());
+    EXPECT_EQ(index.GetCount(), 1u);
+}
+
+TEST(RangeIndexTest, RollingWindowsCostOneEntryEach) {
+    // =SUM(A{i}:A{i+99}) down a column: one rectangle per formula, not 100 edges.
+    RangeIndex index;
+    const int formulas = 100000;
+    for (int i = 0; i < formulas; ++i) {
+        index.Insert(RangeReference{0, i, 0, i + 99, 0}, static_cast<NodeId>(i));
+    }
+    EXPECT_EQ(index.GetCount(), static_cast<std::size_t>(formulas));
+
+    std::size_t matches = 0;
+    index.ForEachContaining(CellReference{0, 5000, 0}, [&matches](NodeId node, RangeEntryId) {
+        EXPECT_GE(node, 4901u);
+        EXPECT_LE(node, 5000u);
+        ++matches;
+    });
+    EXPECT_EQ(matches, 100u);
+}
+
+TEST(RangeIndexTest, MatchesBruteForce) {
+    RangeIndex index;
+    std::vector<std::pair<RangeReference, RangeEntryId>> live;
+    std::mt19937 random(11);
+    auto coordinate = [&random](int limit) { return static_cast<std::int32_t>(random() % limit); };
+
+    for (int step = 0; step < 20000; ++step) {
+        if (!live.empty() && random() % 4 == 0) {
+            const std::size_t victim = random() % live.size();
+            index.Remove(live[victim].second);
+            live[victim] = live.back();
+            live.pop_back();
+            continue;
+        }
+        const std::int32_t row = coordinate(5000);
+        const std::int32_t column = coordinate(50);
+        const RangeReference range{static_cast<std::uint32_t>(random() % 2), row, column,
+                                   row + coordinate(300), column + coordinate(5)};
+        live.emplace_back(range, index.Insert(range, static_cast<NodeId>(step)));
+    }
+
+    for (int query = 0; query < 2000; ++query) {
+        const CellReference cell{static_cast<std::uint32_t>(random() % 2), coordinate(5300), coordinate(55)};
+        std::vector<NodeId> expected;
+        for (const auto& entry : live) {
+            if (entry.first.Contains(cell)) {
+                expected.push_back(index.GetNode(entry.second));
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        ASSERT_EQ(Containing(index, cell), expected);
+    }
+}
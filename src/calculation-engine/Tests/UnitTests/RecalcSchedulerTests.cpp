@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "../../CalculationChain/DependencyGraph.h"
+#include "../../ErrorHandling/CalculationErrors.h"
+#include "../../Multithreading/RecalcScheduler.h"
+#include "../../Multithreading/WorkStealingPool.h"
+
+using namespace ExcelCalculationEngine;
+using Excel::CalculationEngine::CalculationException;
+
+namespace {
+
+std::vector<NodeId> AddNodes(DependencyGraph& graph, int count) {
+    std::vector<NodeId> nodes;
+    for (int i = 0; i < count; ++i) {
+        nodes.push_back(graph.AddNode());
+    }
+    return nodes;
+}
+
+/**
+ * @brief Evaluates by checking that every precedent in the set already ran.
+ */
+struct OrderChecker {
+    const DependencyGraph& graph;
+    std::unique_ptr<std::atomic<int>[]> runs;
+    std::atomic<int> violations{0};
+
+    explicit OrderChecker(const DependencyGraph& graph)
+        : graph(graph), runs(new std::atomic<int>[graph.GetNodeCapacity()]) {
+        for (std::size_t i = 0; i < graph.GetNodeCapacity(); ++i) {
+            runs[i] = 0;
+        }
+    }
+
+    void operator()(NodeId node) {
+        graph.ForEachPrecedent(node, [this](NodeId precedent) {
+            if (runs[precedent].load(std::memory_order_acquire) == 0) {
+                ++violations;
+            }
+        });
+        runs[node].fetch_add(1, std::memory_order_release);
+    }
+};
+
+} // namespace
+
+TEST(WorkStealingPoolTest, RunsEverySpawnedTask) {
+    WorkStealingPool pool(4);
+    std::atomic<int> executed{0};
+    // Each task n spawns 2n+1 and 2n+2 below the limit: a binary tree of 100000 tasks.
+    const WorkStealingPool::Task limit = 100000;
+    for (int round = 0; round < 3; ++round) {
+        executed = 0;
+        pool.Run({0}, [&pool, &executed, limit](WorkStealingPool::Task task) {
+            ++executed;
+            for (WorkStealingPool::Task child : {2 * task + 1, 2 * task + 2}) {
+                if (child < limit) {
+                    pool.Spawn(child);
+                }
+            }
+        });
+        EXPECT_EQ(executed.load(), static_cast<int>(limit));
+    }
+}
+
+TEST(WorkStealingPoolTest, RethrowsTheFirstErrorAfterFinishing) {
+    WorkStealingPool pool(3);
+    std::atomic<int> executed{0};
+    std::vector<WorkStealingPool::Task> tasks(1000);
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        tasks[i] = i;
+    }
+    EXPECT_THROW(pool.Run(tasks, [&executed](WorkStealingPool::Task task) {
+        ++executed;
+        if (task % 100 == 7) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+    EXPECT_EQ(executed.load(), 1000);
+    EXPECT_THROW(pool.Spawn(1), std::logic_error);
+}
+
+TEST(RecalcSchedulerTest, RunsEachNodeAfterItsPrecedents) {
+    DependencyGraph graph;
+    const int nodeCount = 20000;
+    auto n = AddNodes(graph, nodeCount);
+    std::mt19937 random(7);
+    // Mostly short edges (long chains) plus some wide fan-in and fan-out.
+    for (int i = 1; i < nodeCount; ++i) {
+        graph.AddDependency(n[i], n[i - 1 - random() % std::min(i, 8)]);
+        if (random() % 4 == 0) {
+            graph.AddDependency(n[i], n[random() % i]);
+        }
+    }
+
+    WorkStealingPool pool(4);
+    RecalcScheduler scheduler(pool);
+    OrderChecker checker(graph);
+    std::vector<NodeId> nodes(n.rbegin(), n.rend());
+    nodes.push_back(n[5]); // duplicates run once
+    scheduler.Run(graph, nodes, [&checker](NodeId node) { checker(node); });
+
+    EXPECT_EQ(checker.violations.load(), 0);
+    for (NodeId node : n) {
+        ASSERT_EQ(checker.runs[node].load(), 1);
+    }
+}
+
+TEST(RecalcSchedulerTest, PrecedentsOutsideTheSetAreNotWaitedFor) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 1000);
+    for (int i = 1; i < 1000; ++i) {
+        graph.AddDependency(n[i], n[i - 1]);
+    }
+    // Only the second half changed.
+    std::vector<NodeId> nodes(n.begin() + 500, n.end());
+    WorkStealingPool pool(2);
+    RecalcScheduler scheduler(pool);
+    std::vector<NodeId> order;
+    scheduler.Run(graph, nodes, [&order](NodeId node) { order.push_back(node); });
+    EXPECT_EQ(order, nodes); // a single chain runs in order on one worker
+}
+
+TEST(RecalcSchedulerTest, WideModelsRunEveryColumn) {
+    // 64 independent columns of 2000 chained cells each, summed by one total.
+    DependencyGraph graph;
+    const int columns = 64;
+    const int rows = 2000;
+    std::vector<NodeId> nodes;
+    const NodeId total = graph.AddNode();
+    for (int column = 0; column < columns; ++column) {
+        NodeId previous = INVALID_NODE;
+        for (int row = 0; row < rows; ++row) {
+            const NodeId node = graph.AddNode();
+            if (previous != INVALID_NODE) {
+                graph.AddDependency(node, previous);
+            }
+            nodes.push_back(node);
+            previous = node;
+        }
+        graph.AddDependency(total, previous);
+    }
+    nodes.push_back(total);
+
+    WorkStealingPool pool(4);
+    RecalcScheduler scheduler(pool);
+    OrderChecker checker(graph);
+    scheduler.Run(graph, nodes, [&checker](NodeId node) { checker(node); });
+    EXPECT_EQ(checker.violations.load(), 0);
+    EXPECT_EQ(checker.runs[total].load(), 1);
+}
+
+TEST(RecalcSchedulerTest, CyclesInsideTheSetAreReported) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 400);
+    graph.BeginBulkLoad();
+    for (int i = 1; i < 400; ++i) {
+        graph.AddDependency(n[i], n[i - 1]);
+    }
+    graph.AddDependency(n[200], n[300]);
+    graph.EndBulkLoad();
+
+    WorkStealingPool pool(2);
+    RecalcScheduler scheduler(pool);
+    std::atomic<int> executed{0};
+    EXPECT_THROW(scheduler.Run(graph, n, [&executed](NodeId) { ++executed; }), CalculationException);
+    EXPECT_EQ(executed.load(), 200); // everything ahead of the loop
+}
+
+TEST(RecalcSchedulerTest, MeasuredCostsDecideWhetherToUseThePool) {
+    DependencyGraph graph;
+    auto n = AddNodes(graph, 8);
+    WorkStealingPool pool(4);
+    RecalcScheduler scheduler(pool);
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    auto evaluate = [&](NodeId) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.insert(std::this_thread::get_id());
+    };
+
+    // Eight unmeasured cells are not worth waking anyone for.
+    scheduler.Run(graph, n, evaluate);
+    EXPECT_EQ(threads, std::set<std::thread::id>{std::this_thread::get_id()});
+
+    // Once they are known to be slow, the same eight are shared out.
+    for (NodeId node : n) {
+        graph.RecordCost(node, 20e6f);
+    }
+    threads.clear();
+    scheduler.Run(graph, n, evaluate);
+    EXPECT_GT(threads.size(), 1u);
+}
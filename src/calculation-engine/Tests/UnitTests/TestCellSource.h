@@ -0,0 +1,47 @@
+#ifndef TEST_CELL_SOURCE_H
+#define TEST_CELL_SOURCE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include "../../Interfaces/ICellValueSource.h"
+
+namespace ExcelCalculationEngine {
+
+/**
+ * @class MapCellSource
+ * @brief Cell values for tests, kept in a map. Sheet1 is sheet 0; unset cells are empty.
+ */
+class MapCellSource : public ICellValueSource {
+public:
+    void Set(std::int32_t row, std::int32_t column, FormulaValue value) {
+        m_cells[CellReference{0, row, column}] = std::move(value);
+    }
+
+    FormulaValue GetCellValue(const CellReference& cell) const override {
+        auto it = m_cells.find(cell);
+        return it != m_cells.end() ? it->second : FormulaValue();
+    }
+
+    bool TryGetNumber(const CellReference& cell, double& number) const override {
+        auto it = m_cells.find(cell);
+        if (it == m_cells.end() || !it->second.IsNumber()) {
+            return false;
+        }
+        number = it->second.GetNumber();
+        return true;
+    }
+
+    std::optional<std::uint32_t> FindSheet(const std::string& name) const override {
+        if (name == "Sheet1") return 0u;
+        return std::nullopt;
+    }
+
+private:
+    std::unordered_map<CellReference, FormulaValue> m_cells;
+};
+
+} // namespace ExcelCalculationEngine
+
+#endif // TEST_CELL_SOURCE_H
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../FormulaParser/TokenizerUtils.h"
+
+using namespace ExcelCalculationEngine;
+
+namespace {
+
+std::vector<std::pair<TOKEN_TYPES, std::string_view>> Tokens(std::string_view formula) {
+    std::vector<std::pair<TOKEN_TYPES, std::string_view>> result;
+    for (const Token& token : TokenizerUtils::TokenizeFormula(formula)) {
+        result.emplace_back(token.type, token.GetText(formula));
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(TokenizerUtilsTest, TokensPointIntoTheFormula) {
+    const std::string formula = "=SUM(Sheet1!A1:B2, 'My ''Q'' Sheet'!$C$3) >= 1.5E+3";
+    const auto tokens = Tokens(formula);
+    const std::vector<std::pair<TOKEN_TYPES, std::string_view>> expected = {
+        {TOKEN_TYPES::OPERATOR, "="},
+        {TOKEN_TYPES::FUNCTION, "SUM"},
+        {TOKEN_TYPES::PARENTHESIS, "("},
+        {TOKEN_TYPES::NAME, "Sheet1!A1"},
+        {TOKEN_TYPES::SEPARATOR, ":"},
+        {TOKEN_TYPES::NAME, "B2"},
+        {TOKEN_TYPES::SEPARATOR, ","},
+        {TOKEN_TYPES::NAME, "'My ''Q'' Sheet'!$C$3"},
+        {TOKEN_TYPES::PARENTHESIS, ")"},
+        {TOKEN_TYPES::OPERATOR, ">="},
+        {TOKEN_TYPES::NUMBER, "1.5E+3"},
+    };
+    EXPECT_EQ(tokens, expected);
+    for (const auto& token : tokens) {
+        EXPECT_GE(token.second.data(), formula.data());
+        EXPECT_LE(token.second.data() + token.second.size(), formula.data() + formula.size());
+    }
+}
+
+TEST(TokenizerUtilsTest, StringsErrorsAndOddCharacters) {
+    const std::vector<std::pair<TOKEN_TYPES, std::string_view>> expected = {
+        {TOKEN_TYPES::STRING, "\"say \"\"hi\"\"\""},
+        {TOKEN_TYPES::OPERATOR, "&"},
+        {TOKEN_TYPES::ERROR_VALUE, "#DIV/0!"},
+        {TOKEN_TYPES::OPERATOR, "<>"},
+        {TOKEN_TYPES::ERROR_VALUE, "#N/A"},
+        {TOKEN_TYPES::UNKNOWN, "@"},
+        {TOKEN_TYPES::STRING, "\"open"},
+    };
+    EXPECT_EQ(Tokens("\"say \"\"hi\"\"\" & #DIV/0! <> #N/A @ \"open"), expected);
+    EXPECT_TRUE(Tokens(" \t\r\n ").empty());
+}
+
+TEST(TokenizerUtilsTest, VectorScansAgreeWithScalarOnesAtEveryAlignment) {
+    // Runs longer than one 16-byte block, ending at every offset within the next one
+    for (std::size_t run = 0; run < 40; ++run) {
+        const std::string blanks = std::string(run, ' ') + "\t\r\n\v\f" + "x" + std::string(20, ' ');
+        EXPECT_EQ(TokenizerUtils::SkipWhitespace(blanks, 0), run + 5);
+
+        const std::string text = std::string(run, 'a') + "\"" + std::string(20, 'b');
+        EXPECT_EQ(TokenizerUtils::FindQuote(text, 0, '"'), run);
+        EXPECT_EQ(TokenizerUtils::FindQuote(text, run + 1, '"'), text.size());
+    }
+    EXPECT_EQ(TokenizerUtils::SkipWhitespace(std::string(33, ' '), 0), 33u);
+    EXPECT_EQ(TokenizerUtils::SkipWhitespace("\x80 ", 0), 0u); // high bytes are not blanks
+}
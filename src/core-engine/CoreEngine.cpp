@@ -12,13 +12,16 @@
 #include "FileIO/FileWriter.h"
 #include "Utils/ErrorHandling.h"
 #include "Utils/Logging.h"
+#include "Performance/Profiler.h"
+#include "Performance/Metrics.h"
 #include <memory>
 #include <vector>
 #include <string>
 #include <exception>
+#include <stdexcept>
 
-CoreEngine::CoreEngine()
-    : m_calculationEngine(std::make_unique<CalculationEngine>()),
+CoreEngine::CoreEngine(std::unique_ptr<ICalculationEngine> calculationEngine)
+    : m_calculationEngine(std::move(calculationEngine)),
       m_dataAnalysisEngine(std::make_unique<DataAnalysisEngine>()),
       m_chartingEngine(std::make_unique<ChartingEngine>()),
       m_collaborationService(std::make_unique<CollaborationService>()),
@@ -28,6 +31,10 @@ CoreEngine::CoreEngine()
       m_fileWriter(std::make_unique<FileWriter>()),
       m_currentWorkbook(nullptr)
 {
+    if (!m_calculationEngine)
+    {
+        throw std::invalid_argument("CoreEngine needs a calculation engine");
+    }
     Logging::Log(LogLevel::Info, "CoreEngine initialized successfully");
 }
 
@@ -48,6 +55,9 @@ void CoreEngine::InitializeWorkbook(const std::string& name)
 
 void CoreEngine::LoadWorkbook(const std::string& filePath)
 {
+    auto trace = BeginPendingTrace();
+    EXCEL_PROFILE_SCOPE("CoreEngine::LoadWorkbook");
+
     try
     {
         auto workbookData = m_fileReader->ReadWorkbook(filePath);
@@ -81,9 +91,12 @@ void CoreEngine::SaveWorkbook(const std::string& filePath)
 
 double CoreEngine::PerformCalculation(const std::string& formula)
 {
+    auto trace = BeginPendingTrace();
+    EXCEL_PROFILE_SCOPE("CoreEngine::PerformCalculation");
+
     try
     {
-        return m_calculationEngine->CalculateFormula(formula);
+        return m_calculationEngine->CalculateFormula(formula, {});
     }
     catch (const std::exception& e)
     {
@@ -94,6 +107,9 @@ double CoreEngine::PerformCalculation(const std::string& formula)
 
 void CoreEngine::UpdateCell(const std::string& cellReference, const std::string& value)
 {
+    auto trace = BeginPendingTrace();
+    EXCEL_PROFILE_SCOPE("CoreEngine::UpdateCell");
+
     if (!m_currentWorkbook)
     {
         ErrorHandling::HandleError(ErrorType::NoActiveWorkbookError, "No active workbook for cell update");
@@ -108,7 +124,7 @@ void CoreEngine::UpdateCell(const std::string& cellReference, const std::string&
         cell.SetValue(value);
 
         m_calculationEngine->UpdateCell(cellReference, value);
-        Logging::Log(LogLevel::Info, "Cell updated: " + cellReference);
+        EXCEL_LOG(DEBUG, "Cell updated: " + cellReference);
     }
     catch (const std::exception& e)
     {
@@ -116,6 +132,35 @@ void CoreEngine::UpdateCell(const std::string& cellReference, const std::string&
     }
 }
 
+void CoreEngine::UpdateCells(const std::vector<std::pair<std::string, std::string>>& updates)
+{
+    auto trace = BeginPendingTrace();
+    EXCEL_PROFILE_SCOPE("CoreEngine::UpdateCells");
+
+    if (!m_currentWorkbook)
+    {
+        ErrorHandling::HandleError(ErrorType::NoActiveWorkbookError, "No active workbook for cell update");
+        return;
+    }
+
+    try
+    {
+        for (const auto& [cellReference, value] : updates)
+        {
+            auto [sheetName, cellCoords] = ParseCellReference(cellReference);
+            m_currentWorkbook->GetWorksheet(sheetName).GetCell(cellCoords).SetValue(value);
+        }
+
+        // One recalculation for the whole batch
+        m_calculationEngine->UpdateCells(updates);
+        EXCEL_LOG(DEBUG, "Cells updated: " + std::to_string(updates.size()));
+    }
+    catch (const std::exception& e)
+    {
+        ErrorHandling::HandleError(ErrorType::CellUpdateError, "Failed to update cells: " + std::string(e.what()));
+    }
+}
+
 void CoreEngine::GenerateChart(const std::string& chartType, const std::string& dataRange)
 {
     if (!m_currentWorkbook)
@@ -165,6 +210,32 @@ std::vector<double> CoreEngine::PerformDataAnalysis(const std::string& analysisT
     }
 }
 
+void CoreEngine::CaptureNextTrace(const std::string& outputPath)
+{
+    m_pendingTracePath = outputPath;
+}
+
+excel::core_engine::performance::MetricsSnapshot CoreEngine::GetMetricsSnapshot() const
+{
+    return excel::core_engine::performance::GetMetrics().Snapshot();
+}
+
+std::string CoreEngine::GetMetricsText() const
+{
+    return excel::core_engine::performance::GetMetrics().ExportText();
+}
+
+std::unique_ptr<excel::core_engine::performance::TraceCapture> CoreEngine::BeginPendingTrace()
+{
+    if (m_pendingTracePath.empty())
+    {
+        return nullptr;
+    }
+    auto capture = std::make_unique<excel::core_engine::performance::TraceCapture>(std::move(m_pendingTracePath));
+    m_pendingTracePath.clear();
+    return capture;
+}
+
 std::pair<std::string, CellCoordinates> CoreEngine::ParseCellReference(const std::string& cellReference)
 {
     // Implementation of cell reference parsing
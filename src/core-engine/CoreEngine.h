@@ -4,6 +4,7 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <utility>
 
 // Forward declarations
 class ICalculationEngine;
@@ -18,6 +19,11 @@ class MemoryManager;
 class FileReader;
 class FileWriter;
 
+namespace excel::core_engine::performance {
+class TraceCapture;
+struct MetricsSnapshot;
+}
+
 /**
  * @class CoreEngine
  * @brief The main class representing the core engine of Microsoft Excel, integrating various components and services.
@@ -29,8 +35,12 @@ class CoreEngine {
 public:
     /**
      * @brief Constructor for the CoreEngine class, initializing all components and services.
+     * @param calculationEngine Evaluates formulas and cell updates, e.g. the calculation
+     * engine library's CalculationEngine. The application supplies it, so the core
+     * engine does not depend on that library.
+     * @throws std::invalid_argument if @p calculationEngine is null.
      */
-    CoreEngine();
+    explicit CoreEngine(std::unique_ptr<ICalculationEngine> calculationEngine);
 
     /**
      * @brief Destructor for the CoreEngine class, ensuring proper cleanup of resources.
@@ -69,6 +79,12 @@ public:
      */
     void UpdateCell(const std::string& cellReference, const std::string& value);
 
+    /**
+     * @brief Updates several cells, then recalculates once for all of them.
+     * @param updates Pairs of cell reference and new value, e.g. a burst of market-data ticks.
+     */
+    void UpdateCells(const std::vector<std::pair<std::string, std::string>>& updates);
+
     /**
      * @brief Generates a chart based on the specified chart type and data range.
      * @param chartType The type of chart to generate.
@@ -84,7 +100,28 @@ public:
      */
     std::vector<double> PerformDataAnalysis(const std::string& analysisType, const std::string& dataRange);
 
+    /**
+     * @brief Records a trace of the next LoadWorkbook, PerformCalculation, UpdateCell or UpdateCells call.
+     * @param outputPath The Chrome trace-event JSON file to write. It opens in chrome://tracing or Perfetto.
+     */
+    void CaptureNextTrace(const std::string& outputPath);
+
+    /**
+     * @brief Returns the current value of every engine metric (recalcs, cache, graph, memory, I/O, add-ins).
+     */
+    excel::core_engine::performance::MetricsSnapshot GetMetricsSnapshot() const;
+
+    /**
+     * @brief Returns the engine metrics in the Prometheus text exposition format.
+     */
+    std::string GetMetricsText() const;
+
 private:
+    /**
+     * @brief Starts the capture requested by CaptureNextTrace, if any. The trace is written when the result is destroyed.
+     */
+    std::unique_ptr<excel::core_engine::performance::TraceCapture> BeginPendingTrace();
+
     std::unique_ptr<ICalculationEngine> m_calculationEngine;
     std::unique_ptr<IDataAnalysisEngine> m_dataAnalysisEngine;
     std::unique_ptr<IChartingEngine> m_chartingEngine;
@@ -94,6 +131,7 @@ private:
     std::unique_ptr<MemoryManager> m_memoryManager;
     std::unique_ptr<FileReader> m_fileReader;
     std::unique_ptr<FileWriter> m_fileWriter;
+    std::string m_pendingTracePath;
 };
 
 #endif // CORE_ENGINE_H
\ No newline at end of file
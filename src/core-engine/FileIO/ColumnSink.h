@@ -0,0 +1,52 @@
+#ifndef CORE_ENGINE_FILEIO_COLUMNSINK_H
+#define CORE_ENGINE_FILEIO_COLUMNSINK_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CoreEngine {
+namespace FileIO {
+
+/**
+ * @brief Options for importing a file as a columnar table rather than a workbook.
+ */
+struct ColumnarImportOptions {
+    char delimiter = ',';      ///< Field delimiter for delimited text formats.
+    bool hasHeaderRow = true;  ///< Whether the first record holds the column names.
+};
+
+/**
+ * @class IColumnSink
+ * @brief Receives records streamed by FileReader::ImportColumns.
+ *
+ * The sink sees each record exactly once, in file order, and no worksheet
+ * Cell objects are created. Field views are only valid for the duration of
+ * the AppendRow call; implementations must copy or convert them immediately.
+ */
+class IColumnSink {
+public:
+    virtual ~IColumnSink() = default;
+
+    /**
+     * @brief Called once before any row, with the table's column names.
+     * @param columnNames The column names, from the header row or generated.
+     */
+    virtual void BeginTable(const std::vector<std::string>& columnNames) = 0;
+
+    /**
+     * @brief Called for every data record.
+     * @param fields The record's fields; may be shorter or longer than the header.
+     */
+    virtual void AppendRow(const std::vector<std::string_view>& fields) = 0;
+
+    /**
+     * @brief Called once after the last row.
+     */
+    virtual void EndTable() = 0;
+};
+
+} // namespace FileIO
+} // namespace CoreEngine
+
+#endif // CORE_ENGINE_FILEIO_COLUMNSINK_H
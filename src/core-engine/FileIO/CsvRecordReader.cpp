@@ -0,0 +1,152 @@
+#include "CsvRecordReader.h"
+#include "../Utils/ErrorHandling.h"
+#include <cstring>
+
+namespace CoreEngine {
+namespace FileIO {
+
+CsvRecordReader::CsvRecordReader(std::istream& stream, char delimiter, std::size_t blockSize)
+    : m_stream(stream), m_delimiter(delimiter), m_blockSize(blockSize == 0 ? 4096 : blockSize) {
+    m_buffer.resize(m_blockSize);
+}
+
+bool CsvRecordReader::Refill() {
+    if (m_eof) {
+        return false;
+    }
+
+    // Compact unconsumed bytes to the front, then grow if a single record
+    // is larger than the remaining space.
+    std::size_t pending = m_end - m_begin;
+    if (m_begin > 0 && pending > 0) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_begin, pending);
+    }
+    m_begin = 0;
+    m_end = pending;
+    if (m_buffer.size() - m_end < m_blockSize) {
+        m_buffer.resize(m_end + m_blockSize);
+    }
+
+    m_stream.read(m_buffer.data() + m_end, static_cast<std::streamsize>(m_blockSize));
+    std::size_t count = static_cast<std::size_t>(m_stream.gcount());
+    m_end += count;
+    m_bytesRead += count;
+    if (count < m_blockSize) {
+        m_eof = true;
+    }
+    return count > 0;
+}
+
+bool CsvRecordReader::FindRecordEnd(std::size_t& recordEnd) const {
+    // Like SplitRecord, a quote only opens a quoted section at the start of a
+    // field; elsewhere it is an ordinary character. A quote straight after a
+    // closing quote is the second half of an escaped "".
+    bool inQuotes = false;
+    bool fieldStart = true;
+    bool quoteClosed = false;
+    for (std::size_t i = m_begin; i < m_end; ++i) {
+        char c = m_buffer[i];
+        if (inQuotes) {
+            if (c == '"') {
+                inQuotes = false;
+                quoteClosed = true;
+            }
+            continue;
+        }
+        if (c == '"' && (fieldStart || quoteClosed)) {
+            inQuotes = true;
+        } else if (c == '\n') {
+            recordEnd = i;
+            return true;
+        }
+        fieldStart = c == m_delimiter;
+        quoteClosed = false;
+    }
+
+    if (m_eof) {
+        if (inQuotes) {
+            throw Utils::ExcelException(Utils::ErrorCode::FILE_IO_ERROR, "Unterminated quoted field in CSV data");
+        }
+        recordEnd = m_end;
+        return true;
+    }
+    return false;
+}
+
+bool CsvRecordReader::ReadRecord(std::vector<std::string_view>& fields) {
+    fields.clear();
+
+    while (true) {
+        std::size_t recordEnd = 0;
+        while (m_begin == m_end || !FindRecordEnd(recordEnd)) {
+            if (!Refill() && m_begin == m_end) {
+                return false;
+            }
+        }
+
+        std::size_t next = recordEnd < m_end ? recordEnd + 1 : recordEnd;
+        std::size_t contentEnd = recordEnd;
+        if (contentEnd > m_begin && m_buffer[contentEnd - 1] == '\r') {
+            --contentEnd;
+        }
+
+        // Skip blank lines.
+        if (contentEnd == m_begin) {
+            m_begin = next;
+            continue;
+        }
+
+        SplitRecord(contentEnd, fields);
+        m_begin = next;
+        return true;
+    }
+}
+
+void CsvRecordReader::SplitRecord(std::size_t recordEnd, std::vector<std::string_view>& fields) {
+    char* data = m_buffer.data();
+    std::size_t pos = m_begin;
+
+    while (true) {
+        if (pos < recordEnd && data[pos] == '"') {
+            // Quoted field: collapse "" into " in place, writing behind the read cursor.
+            std::size_t start = pos + 1;
+            std::size_t write = start;
+            std::size_t read = start;
+            while (read < recordEnd) {
+                if (data[read] == '"') {
+                    if (read + 1 < recordEnd && data[read + 1] == '"') {
+                        data[write++] = '"';
+                        read += 2;
+                        continue;
+                    }
+                    ++read;
+                    break;
+                }
+                data[write++] = data[read++];
+            }
+            // Tolerate stray characters between the closing quote and the delimiter.
+            while (read < recordEnd && data[read] != m_delimiter) {
+                data[write++] = data[read++];
+            }
+            fields.emplace_back(data + start, write - start);
+            pos = read;
+        } else {
+            std::size_t start = pos;
+            const void* found = std::memchr(data + pos, m_delimiter, recordEnd - pos);
+            pos = found ? static_cast<std::size_t>(static_cast<const char*>(found) - data) : recordEnd;
+            fields.emplace_back(data + start, pos - start);
+        }
+
+        if (pos >= recordEnd) {
+            break;
+        }
+        ++pos; // Skip the delimiter.
+        if (pos == recordEnd) {
+            fields.emplace_back();
+            break;
+        }
+    }
+}
+
+} // namespace FileIO
+} // namespace CoreEngine
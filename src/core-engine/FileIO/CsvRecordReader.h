@@ -0,0 +1,73 @@
+#ifndef CORE_ENGINE_FILEIO_CSVRECORDREADER_H
+#define CORE_ENGINE_FILEIO_CSVRECORDREADER_H
+
+#include <cstddef>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+namespace CoreEngine {
+namespace FileIO {
+
+/**
+ * @class CsvRecordReader
+ * @brief Streams RFC 4180 records from an input stream without per-field allocations.
+ *
+ * Input is read in large blocks into a reusable buffer. Each record is split
+ * in place: the returned fields are views into that buffer, and quoted fields
+ * have their doubled quotes collapsed in place. Views stay valid until the
+ * next call to ReadRecord.
+ */
+class CsvRecordReader {
+public:
+    /**
+     * @brief Constructs a reader over the given stream.
+     * @param stream The stream to read from.
+     * @param delimiter The field delimiter.
+     * @param blockSize The number of bytes requested from the stream at a time.
+     */
+    explicit CsvRecordReader(std::istream& stream, char delimiter = ',', std::size_t blockSize = 1 << 20);
+
+    /**
+     * @brief Reads the next record.
+     * @param fields Receives views of the record's fields.
+     * @return False when the end of the stream has been reached.
+     * @throws Utils::ExcelException if the stream ends inside a quoted field.
+     */
+    bool ReadRecord(std::vector<std::string_view>& fields);
+
+    /**
+     * @brief Returns the total number of bytes consumed from the stream.
+     */
+    std::size_t BytesRead() const { return m_bytesRead; }
+
+private:
+    std::istream& m_stream;
+    char m_delimiter;
+    std::size_t m_blockSize;
+    std::vector<char> m_buffer;
+    std::size_t m_begin = 0; ///< Start of unconsumed data in m_buffer.
+    std::size_t m_end = 0;   ///< End of valid data in m_buffer.
+    std::size_t m_bytesRead = 0;
+    bool m_eof = false;
+
+    /**
+     * @brief Moves unconsumed data to the front of the buffer and reads another block.
+     * @return False if no more data could be read.
+     */
+    bool Refill();
+
+    /**
+     * @brief Finds the end of the record starting at m_begin.
+     * @param recordEnd Receives the offset of the terminating newline (or m_end at EOF).
+     * @return False if the buffer does not yet contain a complete record.
+     */
+    bool FindRecordEnd(std::size_t& recordEnd) const;
+
+    void SplitRecord(std::size_t recordEnd, std::vector<std::string_view>& fields);
+};
+
+} // namespace FileIO
+} // namespace CoreEngine
+
+#endif // CORE_ENGINE_FILEIO_CSVRECORDREADER_H
@@ -6,6 +6,7 @@
 #include <iostream>
 #include "../DataStructures/Workbook.h"
 #include "../Utils/ErrorHandling.h"
+#include "ColumnSink.h"
 
 namespace CoreEngine {
 namespace FileIO {
@@ -46,6 +47,33 @@ public:
      */
     bool IsSupportedFormat(const std::string& format) const;
 
+    /**
+     * @brief Streams a file column-by-column into a sink without building a Workbook.
+     *
+     * Intended for data-model imports that never appear on a sheet: no Cell
+     * objects are created and records are handed to the sink as they are read.
+     *
+     * @param filePath The path of the file to import.
+     * @param sink The sink receiving the table's header and records.
+     * @param options Delimiter and header settings.
+     * @return The number of data records imported.
+     * @throws ErrorHandling::FileReadError if the file cannot be read or the format has no columnar reader.
+     */
+    std::size_t ImportColumns(const std::string& filePath, IColumnSink& sink,
+                              const ColumnarImportOptions& options = ColumnarImportOptions());
+
+    /**
+     * @brief Streams tabular data from an input stream into a sink without building a Workbook.
+     * @param stream The input stream containing the data.
+     * @param format The format of the data in the stream.
+     * @param sink The sink receiving the table's header and records.
+     * @param options Delimiter and header settings.
+     * @return The number of data records imported.
+     * @throws ErrorHandling::FileReadError if the format has no columnar reader.
+     */
+    std::size_t ImportColumnsFromStream(std::istream& stream, const std::string& format, IColumnSink& sink,
+                                        const ColumnarImportOptions& options = ColumnarImportOptions());
+
 private:
     std::vector<std::string> supportedFormats;
 
@@ -1,10 +1,27 @@
 #include "FileWriter.h"
 #include "../DataStructures/Workbook.h"
 #include "../Utils/ErrorHandling.h"
+#include "../Performance/Metrics.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
 
+namespace {
+
+excel::core_engine::performance::Histogram& WriteDurationHistogram() {
+    static auto& histogram = excel::core_engine::performance::GetMetrics().GetHistogram(
+        "excel_io_write_duration_seconds", "Time to write a workbook.");
+    return histogram;
+}
+
+excel::core_engine::performance::Counter& WriteBytesCounter() {
+    static auto& counter = excel::core_engine::performance::GetMetrics().GetCounter(
+        "excel_io_write_bytes_total", "Bytes written by workbook saves.");
+    return counter;
+}
+
+} // namespace
+
 FileWriter::FileWriter() {
     // Initialize supportedFormats vector with supported file formats
     supportedFormats = {"xlsx", "csv", "txt"};
@@ -24,6 +41,7 @@ bool FileWriter::WriteWorkbook(const Workbook& workbook, const std::string& file
         return false;
     }
 
+    excel::core_engine::performance::ScopedTimer writeTimer(WriteDurationHistogram());
     bool result = false;
     try {
         if (format == "xlsx") {
@@ -38,6 +56,10 @@ bool FileWriter::WriteWorkbook(const Workbook& workbook, const std::string& file
         result = false;
     }
 
+    const std::streamoff written = file.tellp();
+    if (written > 0) {
+        WriteBytesCounter().Increment(static_cast<std::uint64_t>(written));
+    }
     file.close();
     return result;
 }
@@ -3,6 +3,8 @@
 
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 /**
  * @interface ICalculationEngine
@@ -35,6 +37,18 @@ public:
      */
     virtual void UpdateCell(const std::string& cellReference, const std::string& newValue) = 0;
 
+    /**
+     * @brief Updates several cells and recalculates their dependents once, not once per cell.
+     * @param updates Pairs of cell reference and new value, applied in order; the last write to a cell wins.
+     *
+     * The default forwards to UpdateCell() one at a time. Engines that can merge the recalculations should override it.
+     */
+    virtual void UpdateCells(const std::vector<std::pair<std::string, std::string>>& updates) {
+        for (const auto& update : updates) {
+            UpdateCell(update.first, update.second);
+        }
+    }
+
     /**
      * @brief Recalculates all formulas in the current worksheet.
      */
@@ -1,9 +1,17 @@
 #include "MemoryManager.h"
 #include "../Utils/ErrorHandling.h"
+#include "../Performance/Metrics.h"
 #include <algorithm>
 #include <stdexcept>
 
-MemoryManager::MemoryManager() : totalAllocated(0), maxAllocation(std::numeric_limits<std::size_t>::max()) {}
+MemoryManager::MemoryManager() : MemoryManager("core") {}
+
+MemoryManager::MemoryManager(const std::string& subsystem)
+    : totalAllocated(0),
+      maxAllocation(std::numeric_limits<std::size_t>::max()),
+      allocatedBytesGauge(&excel::core_engine::performance::GetMetrics().GetGauge(
+          "excel_memory_allocated_bytes", "Bytes currently allocated through MemoryManager.",
+          "subsystem=\"" + subsystem + "\"")) {}
 
 void* MemoryManager::AllocateMemory(std::size_t size) {
     std::lock_guard<std::mutex> lock(mutex);
@@ -43,6 +51,7 @@ void* MemoryManager::AllocateMemory(std::size_t size) {
 
     // Update totalAllocated
     totalAllocated += size;
+    allocatedBytesGauge->Add(static_cast<std::int64_t>(size));
 
     return ptr;
 }
@@ -62,6 +71,7 @@ void MemoryManager::DeallocateMemory(void* ptr) {
     // Mark the block as free
     it->inUse = false;
     totalAllocated -= it->size;
+    allocatedBytesGauge->Add(-static_cast<std::int64_t>(it->size));
 
     // Merge adjacent free blocks
     auto next = std::next(it);
@@ -136,6 +146,7 @@ void MemoryManager::OptimizeMemory() {
 }
 
 MemoryManager::~MemoryManager() {
+    allocatedBytesGauge->Add(-static_cast<std::int64_t>(totalAllocated));
     for (const auto& block : memoryPool) {
         if (block.inUse) {
             ErrorHandling::ReportError("Memory leak detected: not all allocated memory was freed");
@@ -2,6 +2,7 @@
 #define MEMORY_MANAGER_H
 
 #include <cstddef>
+#include <string>
 #include <vector>
 
 // Forward declaration for error handling
@@ -9,9 +10,16 @@ namespace ErrorHandling {
     void ReportError(const char* message);
 }
 
+namespace excel::core_engine::performance {
+class Gauge;
+}
+
 class MemoryManager {
 public:
     MemoryManager();
+
+    // Attributes allocations to a subsystem in the excel_memory_allocated_bytes metric
+    explicit MemoryManager(const std::string& subsystem);
     ~MemoryManager();
 
     // Allocates a block of memory of the specified size
@@ -39,6 +47,7 @@ private:
     std::vector<MemoryBlock> memoryPool;
     std::size_t totalAllocated;
     std::size_t maxAllocation;
+    excel::core_engine::performance::Gauge* allocatedBytesGauge;
 
     // Helper functions
     MemoryBlock* FindSuitableBlock(std::size_t size);
@@ -0,0 +1,118 @@
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace excel::core_engine::performance {
+
+namespace {
+
+unsigned HighestBit(std::uint64_t value) noexcept {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+} // namespace
+
+void HistogramSnapshot::Merge(const HistogramSnapshot& other) {
+    if (buckets.size() < other.buckets.size()) {
+        buckets.resize(other.buckets.size(), 0);
+    }
+    for (std::size_t i = 0; i < other.buckets.size(); ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+std::uint64_t HistogramSnapshot::Percentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(percentile / 100.0 * static_cast<double>(count)));
+    rank = std::max<std::uint64_t>(rank, 1);
+
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(LatencyHistogram::BucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+LatencyHistogram::LatencyHistogram() {
+    Reset();
+}
+
+std::size_t LatencyHistogram::BucketIndex(std::uint64_t value) noexcept {
+    if (value < SUB_BUCKETS) {
+        return static_cast<std::size_t>(value);
+    }
+    unsigned exponent = HighestBit(value);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    unsigned shift = exponent - SUB_BUCKET_BITS;
+    std::size_t sub = static_cast<std::size_t>(value >> shift) & (SUB_BUCKETS - 1);
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub;
+}
+
+std::uint64_t LatencyHistogram::BucketUpperBound(std::size_t index) noexcept {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    std::size_t group = index / SUB_BUCKETS;
+    std::size_t sub = index % SUB_BUCKETS;
+    unsigned shift = static_cast<unsigned>(group - 1);
+    std::uint64_t lower = static_cast<std::uint64_t>(SUB_BUCKETS + sub) << shift;
+    return lower + ((std::uint64_t{1} << shift) - 1);
+}
+
+void LatencyHistogram::Record(std::uint64_t value) noexcept {
+    m_buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+
+    std::uint64_t previous = m_max.load(std::memory_order_relaxed);
+    while (value > previous &&
+           !m_max.compare_exchange_weak(previous, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Reset() noexcept {
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+    HistogramSnapshot snapshot;
+    snapshot.buckets.resize(BUCKET_COUNT);
+    std::uint64_t total = 0;
+    for (std::size_t i = 0; i < BUCKET_COUNT; ++i) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += snapshot.buckets[i];
+    }
+    // Use the bucket total so percentiles stay consistent with a concurrent writer.
+    snapshot.count = total;
+    snapshot.sum = m_sum.load(std::memory_order_relaxed);
+    snapshot.max = m_max.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+} // namespace excel::core_engine::performance
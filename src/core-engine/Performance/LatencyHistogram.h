@@ -0,0 +1,91 @@
+#ifndef EXCEL_CORE_ENGINE_PERFORMANCE_LATENCY_HISTOGRAM_H
+#define EXCEL_CORE_ENGINE_PERFORMANCE_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace excel::core_engine::performance {
+
+/**
+ * @brief A point-in-time copy of a LatencyHistogram, mergeable across threads.
+ */
+struct HistogramSnapshot {
+    std::uint64_t count{0};
+    std::uint64_t sum{0};
+    std::uint64_t max{0};
+    std::vector<std::uint64_t> buckets;
+
+    /**
+     * @brief Adds another snapshot's samples to this one.
+     */
+    void Merge(const HistogramSnapshot& other);
+
+    /**
+     * @brief Returns the value at the given percentile (0-100).
+     *
+     * The result is the upper bound of the bucket containing the percentile,
+     * clamped to the recorded maximum, so it over-estimates by at most one
+     * bucket width (12.5%).
+     */
+    std::uint64_t Percentile(double percentile) const;
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Log-linear histogram of non-negative integer samples (typically nanoseconds).
+ *
+ * Each power of two is split into 8 linear sub-buckets, giving a relative
+ * error below 12.5% up to 2^53 with a fixed footprint of about 400
+ * buckets. Recording is wait-free: relaxed atomic adds only, so a
+ * histogram owned by one thread can be read by another at any time.
+ */
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 3;
+    static constexpr std::size_t SUB_BUCKETS = std::size_t{1} << SUB_BUCKET_BITS;
+    static constexpr unsigned MAX_EXPONENT = 52;
+    static constexpr std::size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    /**
+     * @brief Records one sample.
+     */
+    void Record(std::uint64_t value) noexcept;
+
+    /**
+     * @brief Clears all recorded samples.
+     */
+    void Reset() noexcept;
+
+    /**
+     * @brief Copies the current contents.
+     */
+    HistogramSnapshot Snapshot() const;
+
+    /**
+     * @brief Maps a value to its bucket index.
+     */
+    static std::size_t BucketIndex(std::uint64_t value) noexcept;
+
+    /**
+     * @brief Returns the largest value that maps to the given bucket.
+     */
+    static std::uint64_t BucketUpperBound(std::size_t index) noexcept;
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKET_COUNT> m_buckets;
+    std::atomic<std::uint64_t> m_count{0};
+    std::atomic<std::uint64_t> m_sum{0};
+    std::atomic<std::uint64_t> m_max{0};
+};
+
+} // namespace excel::core_engine::performance
+
+#endif // EXCEL_CORE_ENGINE_PERFORMANCE_LATENCY_HISTOGRAM_H
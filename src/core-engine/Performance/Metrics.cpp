@@ -0,0 +1,187 @@
+#include "Metrics.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+namespace excel::core_engine::performance {
+
+namespace {
+
+std::atomic<std::size_t> g_nextShard{0};
+
+constexpr double NANOSECONDS_PER_SECOND = 1e9;
+
+double ToSeconds(std::uint64_t nanoseconds) {
+    return static_cast<double>(nanoseconds) / NANOSECONDS_PER_SECOND;
+}
+
+std::string SeriesName(const std::string& name, const std::string& labels, std::string_view extraLabel = {}) {
+    std::string series = name;
+    if (labels.empty() && extraLabel.empty()) {
+        return series;
+    }
+    series += '{';
+    series += labels;
+    if (!labels.empty() && !extraLabel.empty()) {
+        series += ',';
+    }
+    series.append(extraLabel.data(), extraLabel.size());
+    series += '}';
+    return series;
+}
+
+// Emits HELP/TYPE once per metric family; samples with labels share a family.
+void WriteFamilyHeader(std::ostream& out, const std::string& name, const std::string& help,
+                       const char* type, std::string& lastFamily) {
+    if (name == lastFamily) {
+        return;
+    }
+    lastFamily = name;
+    if (!help.empty()) {
+        out << "# HELP " << name << ' ' << help << '\n';
+    }
+    out << "# TYPE " << name << ' ' << type << '\n';
+}
+
+} // namespace
+
+std::size_t Counter::ShardIndex() noexcept {
+    thread_local std::size_t shard = g_nextShard.fetch_add(1, std::memory_order_relaxed) % SHARDS;
+    return shard;
+}
+
+std::uint64_t Counter::Value() const noexcept {
+    std::uint64_t total = 0;
+    for (const auto& shard : m_shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+ScopedTimer::ScopedTimer(Histogram& histogram) noexcept
+    : m_histogram(histogram), m_startNs(Profiler::NowNanoseconds()) {}
+
+ScopedTimer::~ScopedTimer() {
+    const std::uint64_t endNs = Profiler::NowNanoseconds();
+    m_histogram.Observe(endNs > m_startNs ? endNs - m_startNs : 0);
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+    // Never destroyed: metrics are updated from static destructors and worker
+    // threads that may outlive main().
+    static MetricsRegistry* instance = new MetricsRegistry();
+    return *instance;
+}
+
+template <typename Metric>
+Metric& MetricsRegistry::FindOrAdd(std::vector<Entry<Metric>>& entries, std::string_view name,
+                                   std::string_view help, std::string_view labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : entries) {
+        if (entry.name == name && entry.labels == labels) {
+            return *entry.metric;
+        }
+    }
+    entries.push_back({std::string(name), std::string(labels), std::string(help), std::make_unique<Metric>()});
+    return *entries.back().metric;
+}
+
+Counter& MetricsRegistry::GetCounter(std::string_view name, std::string_view help, std::string_view labels) {
+    return FindOrAdd(m_counters, name, help, labels);
+}
+
+Gauge& MetricsRegistry::GetGauge(std::string_view name, std::string_view help, std::string_view labels) {
+    return FindOrAdd(m_gauges, name, help, labels);
+}
+
+Histogram& MetricsRegistry::GetHistogram(std::string_view name, std::string_view help, std::string_view labels) {
+    return FindOrAdd(m_histograms, name, help, labels);
+}
+
+void MetricsRegistry::RegisterComputedGauge(std::string_view name, std::string_view help,
+                                            std::function<double()> compute) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& gauge : m_computedGauges) {
+        if (gauge.name == name) {
+            gauge.help = std::string(help);
+            gauge.compute = std::move(compute);
+            return;
+        }
+    }
+    m_computedGauges.push_back({std::string(name), std::string(help), std::move(compute)});
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() const {
+    MetricsSnapshot snapshot;
+    snapshot.timestampMs = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    std::vector<ComputedGauge> computed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_counters) {
+            snapshot.counters.push_back({entry.name, entry.labels, entry.help,
+                                         static_cast<double>(entry.metric->Value())});
+        }
+        for (const auto& entry : m_gauges) {
+            snapshot.gauges.push_back({entry.name, entry.labels, entry.help,
+                                       static_cast<double>(entry.metric->Value())});
+        }
+        for (const auto& entry : m_histograms) {
+            const HistogramSnapshot data = entry.metric->Snapshot();
+            HistogramSample sample;
+            sample.name = entry.name;
+            sample.labels = entry.labels;
+            sample.help = entry.help;
+            sample.count = data.count;
+            sample.sumSeconds = ToSeconds(data.sum);
+            sample.p50Seconds = ToSeconds(data.Percentile(50.0));
+            sample.p90Seconds = ToSeconds(data.Percentile(90.0));
+            sample.p99Seconds = ToSeconds(data.Percentile(99.0));
+            sample.maxSeconds = ToSeconds(data.max);
+            snapshot.histograms.push_back(std::move(sample));
+        }
+        computed = m_computedGauges;
+    }
+
+    // Callbacks may read other metrics, so run them outside the lock.
+    for (const auto& gauge : computed) {
+        snapshot.gauges.push_back({gauge.name, std::string(), gauge.help, gauge.compute ? gauge.compute() : 0.0});
+    }
+
+    auto byName = [](const auto& a, const auto& b) {
+        return a.name != b.name ? a.name < b.name : a.labels < b.labels;
+    };
+    std::sort(snapshot.counters.begin(), snapshot.counters.end(), byName);
+    std::sort(snapshot.gauges.begin(), snapshot.gauges.end(), byName);
+    std::sort(snapshot.histograms.begin(), snapshot.histograms.end(), byName);
+    return snapshot;
+}
+
+std::string MetricsRegistry::FormatText(const MetricsSnapshot& snapshot) {
+    std::ostringstream out;
+    out << std::setprecision(9);
+    std::string lastFamily;
+
+    for (const auto& sample : snapshot.counters) {
+        WriteFamilyHeader(out, sample.name, sample.help, "counter", lastFamily);
+        out << SeriesName(sample.name, sample.labels) << ' ' << sample.value << '\n';
+    }
+    for (const auto& sample : snapshot.gauges) {
+        WriteFamilyHeader(out, sample.name, sample.help, "gauge", lastFamily);
+        out << SeriesName(sample.name, sample.labels) << ' ' << sample.value << '\n';
+    }
+    for (const auto& sample : snapshot.histograms) {
+        WriteFamilyHeader(out, sample.name, sample.help, "summary", lastFamily);
+        out << SeriesName(sample.name, sample.labels, "quantile=\"0.5\"") << ' ' << sample.p50Seconds << '\n';
+        out << SeriesName(sample.name, sample.labels, "quantile=\"0.9\"") << ' ' << sample.p90Seconds << '\n';
+        out << SeriesName(sample.name, sample.labels, "quantile=\"0.99\"") << ' ' << sample.p99Seconds << '\n';
+        out << SeriesName(sample.name + "_sum", sample.labels) << ' ' << sample.sumSeconds << '\n';
+        out << SeriesName(sample.name + "_count", sample.labels) << ' ' << sample.count << '\n';
+    }
+    return out.str();
+}
+
+} // namespace excel::core_engine::performance
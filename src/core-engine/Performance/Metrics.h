@@ -0,0 +1,198 @@
+#ifndef EXCEL_CORE_ENGINE_PERFORMANCE_METRICS_H
+#define EXCEL_CORE_ENGINE_PERFORMANCE_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LatencyHistogram.h"
+
+namespace excel::core_engine::performance {
+
+/**
+ * @class Counter
+ * @brief Monotonic counter sharded across cache lines so concurrent
+ *        increments from different threads do not contend.
+ */
+class Counter {
+public:
+    static constexpr std::size_t SHARDS = 16;
+
+    Counter() = default;
+    Counter(const Counter&) = delete;
+    Counter& operator=(const Counter&) = delete;
+
+    void Increment(std::uint64_t amount = 1) noexcept {
+        m_shards[ShardIndex()].value.fetch_add(amount, std::memory_order_relaxed);
+    }
+
+    std::uint64_t Value() const noexcept;
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    static std::size_t ShardIndex() noexcept;
+
+    std::array<Shard, SHARDS> m_shards;
+};
+
+/**
+ * @class Gauge
+ * @brief Integer value that can go up and down (sizes, byte counts).
+ */
+class Gauge {
+public:
+    Gauge() = default;
+    Gauge(const Gauge&) = delete;
+    Gauge& operator=(const Gauge&) = delete;
+
+    void Set(std::int64_t value) noexcept { m_value.store(value, std::memory_order_relaxed); }
+    void Add(std::int64_t delta) noexcept { m_value.fetch_add(delta, std::memory_order_relaxed); }
+    std::int64_t Value() const noexcept { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::int64_t> m_value{0};
+};
+
+/**
+ * @class Histogram
+ * @brief Distribution of durations in nanoseconds, backed by a LatencyHistogram.
+ *
+ * Exported as a summary in seconds (p50, p90, p99, sum, count).
+ */
+class Histogram {
+public:
+    void Observe(std::uint64_t nanoseconds) noexcept { m_histogram.Record(nanoseconds); }
+    HistogramSnapshot Snapshot() const { return m_histogram.Snapshot(); }
+
+private:
+    LatencyHistogram m_histogram;
+};
+
+/**
+ * @class ScopedTimer
+ * @brief Observes the lifetime of the scope into a Histogram.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram& histogram) noexcept;
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Histogram& m_histogram;
+    std::uint64_t m_startNs;
+};
+
+/**
+ * @brief Point-in-time value of one counter or gauge.
+ */
+struct MetricSample {
+    std::string name;   ///< Metric family name, e.g. "excel_calc_cells_evaluated_total".
+    std::string labels; ///< Label set without braces, e.g. subsystem="core"; may be empty.
+    std::string help;
+    double value{0.0};
+};
+
+/**
+ * @brief Point-in-time summary of one histogram; durations in seconds.
+ */
+struct HistogramSample {
+    std::string name;
+    std::string labels;
+    std::string help;
+    std::uint64_t count{0};
+    double sumSeconds{0.0};
+    double p50Seconds{0.0};
+    double p90Seconds{0.0};
+    double p99Seconds{0.0};
+    double maxSeconds{0.0};
+};
+
+struct MetricsSnapshot {
+    std::uint64_t timestampMs{0}; ///< Wall-clock time of the snapshot.
+    std::vector<MetricSample> counters;
+    std::vector<MetricSample> gauges;
+    std::vector<HistogramSample> histograms;
+};
+
+/**
+ * @class MetricsRegistry
+ * @brief Process-wide registry of named counters, gauges and histograms.
+ *
+ * Registration takes a lock and returns a reference that stays valid for the
+ * life of the process, so call sites look a metric up once (typically into a
+ * function-local static) and then update it with relaxed atomics only.
+ * Requesting an existing name and label set returns the same metric.
+ */
+class MetricsRegistry {
+public:
+    static MetricsRegistry& GetInstance();
+
+    Counter& GetCounter(std::string_view name, std::string_view help, std::string_view labels = {});
+    Gauge& GetGauge(std::string_view name, std::string_view help, std::string_view labels = {});
+    Histogram& GetHistogram(std::string_view name, std::string_view help, std::string_view labels = {});
+
+    /**
+     * @brief Registers a gauge whose value is computed when a snapshot is taken.
+     *
+     * Used for derived values such as ratios. Re-registering a name replaces the callback.
+     */
+    void RegisterComputedGauge(std::string_view name, std::string_view help, std::function<double()> compute);
+
+    MetricsSnapshot Snapshot() const;
+
+    /**
+     * @brief Renders a snapshot in the Prometheus text exposition format.
+     */
+    static std::string FormatText(const MetricsSnapshot& snapshot);
+
+    std::string ExportText() const { return FormatText(Snapshot()); }
+
+private:
+    MetricsRegistry() = default;
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    template <typename Metric>
+    struct Entry {
+        std::string name;
+        std::string labels;
+        std::string help;
+        std::unique_ptr<Metric> metric;
+    };
+
+    struct ComputedGauge {
+        std::string name;
+        std::string help;
+        std::function<double()> compute;
+    };
+
+    template <typename Metric>
+    Metric& FindOrAdd(std::vector<Entry<Metric>>& entries, std::string_view name,
+                      std::string_view help, std::string_view labels);
+
+    mutable std::mutex m_mutex;
+    std::vector<Entry<Counter>> m_counters;
+    std::vector<Entry<Gauge>> m_gauges;
+    std::vector<Entry<Histogram>> m_histograms;
+    std::vector<ComputedGauge> m_computedGauges;
+};
+
+inline MetricsRegistry& GetMetrics() {
+    return MetricsRegistry::GetInstance();
+}
+
+} // namespace excel::core_engine::performance
+
+#endif // EXCEL_CORE_ENGINE_PERFORMANCE_METRICS_H
@@ -1,54 +1,551 @@
 #include "Profiler.h"
+#include "../Utils/ErrorHandling.h"
 #include "../Utils/Logging.h"
+#include <algorithm>
+#include <array>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <new>
 #include <sstream>
 
-// Singleton instance
-Profiler& GetProfiler() {
-    static Profiler instance;
-    return instance;
+namespace excel::core_engine::performance {
+
+/**
+ * @brief Per-thread span storage. Written only by its owning thread.
+ *
+ * Histograms are allocated the first time the thread records a span id. The
+ * ring keeps the most recent RING_CAPACITY spans; each slot is guarded by a
+ * sequence number so readers can detect and skip slots overwritten mid-read.
+ *
+ * A buffer outlives its thread: on exit the thread releases it, and the next
+ * new thread takes it over with its histograms and ring intact, so the
+ * statistics and trace keep what the old thread recorded.
+ */
+class ThreadProfileBuffer {
+public:
+    explicit ThreadProfileBuffer(std::uint32_t threadId) : m_threadId(threadId) {
+        for (auto& histogram : m_histograms) {
+            histogram.store(nullptr, std::memory_order_relaxed);
+        }
+        for (auto& slot : m_ring) {
+            slot.sequence.store(0, std::memory_order_relaxed);
+            slot.startNs.store(0, std::memory_order_relaxed);
+            slot.durationNs.store(0, std::memory_order_relaxed);
+            slot.meta.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    ~ThreadProfileBuffer() {
+        for (auto& histogram : m_histograms) {
+            delete histogram.load(std::memory_order_relaxed);
+        }
+    }
+
+    ThreadProfileBuffer(const ThreadProfileBuffer&) = delete;
+    ThreadProfileBuffer& operator=(const ThreadProfileBuffer&) = delete;
+
+    /**
+     * @brief Claims a released buffer for the calling thread.
+     */
+    bool TryAcquire() noexcept {
+        bool inUse = false;
+        return m_inUse.compare_exchange_strong(inUse, true, std::memory_order_acq_rel);
+    }
+
+    void Release() noexcept { m_inUse.store(false, std::memory_order_release); }
+
+    void Record(SpanId id, std::uint32_t depth, std::uint64_t startNs, std::uint64_t durationNs) noexcept {
+        LatencyHistogram* histogram = m_histograms[id].load(std::memory_order_acquire);
+        if (histogram == nullptr) {
+            histogram = new (std::nothrow) LatencyHistogram();
+            m_histograms[id].store(histogram, std::memory_order_release);
+        }
+        if (histogram != nullptr) {
+            histogram->Record(durationNs);
+        }
+
+        const std::uint64_t index = m_head.load(std::memory_order_relaxed);
+        Slot& slot = m_ring[index & (Profiler::RING_CAPACITY - 1)];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.startNs.store(startNs, std::memory_order_relaxed);
+        slot.durationNs.store(durationNs, std::memory_order_relaxed);
+        slot.meta.store((static_cast<std::uint64_t>(depth) << 32) | id, std::memory_order_relaxed);
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+        m_head.store(index + 1, std::memory_order_release);
+    }
+
+    void AppendSnapshot(SpanId id, HistogramSnapshot& merged) const {
+        const LatencyHistogram* histogram = m_histograms[id].load(std::memory_order_acquire);
+        if (histogram != nullptr) {
+            merged.Merge(histogram->Snapshot());
+        }
+    }
+
+    void AppendRecentSpans(std::vector<SpanRecord>& records) const {
+        const std::uint64_t head = m_head.load(std::memory_order_acquire);
+        std::uint64_t first = m_floor.load(std::memory_order_relaxed);
+        if (head - std::min(head, first) > Profiler::RING_CAPACITY) {
+            first = head - Profiler::RING_CAPACITY;
+        }
+
+        for (std::uint64_t index = first; index < head; ++index) {
+            const Slot& slot = m_ring[index & (Profiler::RING_CAPACITY - 1)];
+            const std::uint64_t before = slot.sequence.load(std::memory_order_acquire);
+            SpanRecord record;
+            record.startNs = slot.startNs.load(std::memory_order_relaxed);
+            record.durationNs = slot.durationNs.load(std::memory_order_relaxed);
+            const std::uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+
+            // Skip slots the owning thread has lapped or is rewriting.
+            if (before != after || before != 2 * index + 2) {
+                continue;
+            }
+            record.spanId = static_cast<SpanId>(meta & 0xFFFFFFFFu);
+            record.depth = static_cast<std::uint32_t>(meta >> 32);
+            record.threadId = m_threadId;
+            records.push_back(record);
+        }
+    }
+
+    void Reset() noexcept {
+        for (auto& histogram : m_histograms) {
+            LatencyHistogram* existing = histogram.load(std::memory_order_acquire);
+            if (existing != nullptr) {
+                existing->Reset();
+            }
+        }
+        ClearRecent();
+    }
+
+    void ClearRecent() noexcept {
+        m_floor.store(m_head.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+    std::uint32_t ThreadId() const noexcept { return m_threadId; }
+
+    std::string name; ///< Trace display name; guarded by Profiler::m_bufferMutex.
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> sequence;
+        std::atomic<std::uint64_t> startNs;
+        std::atomic<std::uint64_t> durationNs;
+        std::atomic<std::uint64_t> meta; ///< depth << 32 | span id
+    };
+
+    std::uint32_t m_threadId;
+    std::array<std::atomic<LatencyHistogram*>, Profiler::MAX_SPANS> m_histograms;
+    std::array<Slot, Profiler::RING_CAPACITY> m_ring;
+    std::atomic<std::uint64_t> m_head{0};
+    std::atomic<std::uint64_t> m_floor{0}; ///< Ring entries before this index have been cleared.
+    std::atomic<bool> m_inUse{true};       ///< Owned by a live thread.
+};
+
+namespace {
+
+static_assert((Profiler::RING_CAPACITY & (Profiler::RING_CAPACITY - 1)) == 0,
+              "RING_CAPACITY must be a power of two");
+
+constexpr double SAMPLE_SCALE = 4294967296.0; // 2^32
+
+struct ManualSpan {
+    SpanId id;
+    std::uint64_t startNs;
+    bool recorded;
+};
+
+struct ThreadProfileState {
+    std::shared_ptr<ThreadProfileBuffer> buffer;
+    std::uint32_t depth{0};
+    bool sampled{false};
+    std::uint64_t random{0};
+    std::vector<ManualSpan> manualSpans;
+
+    // Runs at thread exit; the profiler keeps the buffer for the next new thread.
+    ~ThreadProfileState() {
+        if (buffer) {
+            buffer->Release();
+        }
+    }
+};
+
+void WriteJsonString(std::ostream& out, const std::string& value) {
+    out << '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    out << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+                        << static_cast<int>(c) << std::dec << std::setfill(' ');
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+thread_local ThreadProfileState t_profileState;
+
+std::uint32_t NextRandom(ThreadProfileState& state) noexcept {
+    if (state.random == 0) {
+        state.random = (reinterpret_cast<std::uintptr_t>(&state) * 0x9E3779B97F4A7C15ull) ^
+                       static_cast<std::uint64_t>(Profiler::NowNanoseconds()) ^ 1u;
+    }
+    // xorshift64*
+    state.random ^= state.random >> 12;
+    state.random ^= state.random << 25;
+    state.random ^= state.random >> 27;
+    return static_cast<std::uint32_t>((state.random * 0x2545F4914F6CDD1Dull) >> 32);
+}
+
+} // namespace
+
+Profiler::Profiler() : m_sampleThreshold(0) {
+    m_spanNames.emplace_back("<overflow>");
+    m_spanIds.emplace(m_spanNames.back(), OVERFLOW_SPAN_ID);
+
+    // Production switch: EXCEL_PROFILE_SAMPLE_RATE=0.01 enables 1% sampling.
+    if (const char* rate = std::getenv("EXCEL_PROFILE_SAMPLE_RATE")) {
+        const double parsed = std::atof(rate);
+        if (parsed > 0.0) {
+            SetSampleRate(parsed);
+            m_enabled.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    // Whole-process trace: record everything and dump it at exit.
+    if (const char* tracePath = std::getenv("EXCEL_PROFILE_TRACE")) {
+        if (*tracePath != '\0') {
+            m_exitTracePath = tracePath;
+            SetSampleRate(1.0);
+            m_enabled.store(true, std::memory_order_relaxed);
+        }
+    }
+}
+
+Profiler::~Profiler() {
+    if (!m_exitTracePath.empty()) {
+        try {
+            WriteChromeTrace(m_exitTracePath);
+        } catch (...) {
+            // Nothing sensible to report this late in shutdown.
+        }
+    }
+}
+
+std::uint64_t Profiler::NowNanoseconds() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+SpanId Profiler::InternSpan(std::string_view name) {
+    std::lock_guard<std::mutex> lock(m_spanMutex);
+    std::string key(name);
+    auto it = m_spanIds.find(key);
+    if (it != m_spanIds.end()) {
+        return it->second;
+    }
+    if (m_spanNames.size() >= MAX_SPANS) {
+        return OVERFLOW_SPAN_ID;
+    }
+    const SpanId id = static_cast<SpanId>(m_spanNames.size());
+    m_spanNames.push_back(key);
+    m_spanIds.emplace(std::move(key), id);
+    return id;
+}
+
+std::string Profiler::GetSpanName(SpanId id) const {
+    std::lock_guard<std::mutex> lock(m_spanMutex);
+    return id < m_spanNames.size() ? m_spanNames[id] : std::string();
+}
+
+void Profiler::EnableProfiling(bool enable) {
+    m_enabled.store(enable, std::memory_order_relaxed);
+    std::string status = enable ? "enabled" : "disabled";
+    CoreEngine::Utils::Log(CoreEngine::Utils::LogLevel::INFO, "Profiling " + status);
+}
+
+void Profiler::SetSampleRate(double rate) {
+    rate = std::clamp(rate, 0.0, 1.0);
+    m_sampleAll.store(rate >= 1.0, std::memory_order_relaxed);
+    const double threshold = std::min(rate * SAMPLE_SCALE, SAMPLE_SCALE - 1.0);
+    m_sampleThreshold.store(static_cast<std::uint32_t>(threshold), std::memory_order_relaxed);
 }
 
-Profiler::Profiler() : isEnabled(false) {}
+double Profiler::GetSampleRate() const {
+    if (m_sampleAll.load(std::memory_order_relaxed)) {
+        return 1.0;
+    }
+    return static_cast<double>(m_sampleThreshold.load(std::memory_order_relaxed)) / SAMPLE_SCALE;
+}
+
+bool Profiler::EnterSpan() noexcept {
+    ThreadProfileState& state = t_profileState;
+    if (state.depth++ == 0) {
+        state.sampled = m_sampleAll.load(std::memory_order_relaxed) ||
+                        NextRandom(state) < m_sampleThreshold.load(std::memory_order_relaxed);
+    }
+    return state.sampled;
+}
+
+void Profiler::LeaveSpan(SpanId id, std::uint64_t startNs, bool recorded) noexcept {
+    ThreadProfileState& state = t_profileState;
+    if (state.depth > 0) {
+        --state.depth;
+    }
+    if (!recorded) {
+        return;
+    }
+
+    const std::uint64_t endNs = NowNanoseconds();
+    ThreadProfileBuffer* buffer = GetThreadBuffer();
+    if (buffer == nullptr) {
+        return;
+    }
+    buffer->Record(id < MAX_SPANS ? id : OVERFLOW_SPAN_ID, state.depth, startNs,
+                   endNs > startNs ? endNs - startNs : 0);
+}
+
+ThreadProfileBuffer* Profiler::GetThreadBuffer() noexcept {
+    ThreadProfileState& state = t_profileState;
+    if (!state.buffer) {
+        try {
+            std::lock_guard<std::mutex> lock(m_bufferMutex);
+            // Memory stays bounded by the peak number of live threads, however many come and go
+            for (const auto& released : m_buffers) {
+                if (released->TryAcquire()) {
+                    released->name.clear();
+                    state.buffer = released;
+                    return state.buffer.get();
+                }
+            }
+            auto buffer = std::make_shared<ThreadProfileBuffer>(static_cast<std::uint32_t>(m_buffers.size() + 1));
+            m_buffers.push_back(buffer);
+            state.buffer = std::move(buffer);
+        } catch (...) {
+            return nullptr;
+        }
+    }
+    return state.buffer.get();
+}
+
+std::size_t Profiler::GetThreadBufferCount() const {
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    return m_buffers.size();
+}
+
+std::vector<std::shared_ptr<ThreadProfileBuffer>> Profiler::CopyBuffers() const {
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    return m_buffers;
+}
 
 void Profiler::StartProfile(const std::string& operationName) {
-    if (!isEnabled) return;
+    if (!IsEnabled()) return;
 
-    auto startTime = std::chrono::high_resolution_clock::now();
-    profilingData[operationName] = startTime;
+    ManualSpan span{InternSpan(operationName), 0, EnterSpan()};
+    if (span.recorded) {
+        span.startNs = NowNanoseconds();
+    }
+    t_profileState.manualSpans.push_back(span);
 }
 
 void Profiler::EndProfile(const std::string& operationName) {
-    if (!isEnabled) return;
+    auto& spans = t_profileState.manualSpans;
+    if (spans.empty()) return;
+
+    // Match the innermost open span with this name, so nested and recursive
+    // spans pair up correctly.
+    const SpanId id = InternSpan(operationName);
+    for (auto it = spans.rbegin(); it != spans.rend(); ++it) {
+        if (it->id == id) {
+            const ManualSpan span = *it;
+            spans.erase(std::next(it).base());
+            LeaveSpan(span.id, span.startNs, span.recorded);
+            return;
+        }
+    }
+}
 
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto startTime = profilingData[operationName];
-    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime);
+std::vector<SpanStatistics> Profiler::GetStatistics() const {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_spanMutex);
+        names = m_spanNames;
+    }
+    const auto buffers = CopyBuffers();
 
-    // Update the profilingData with the elapsed time
-    profilingData[operationName] = duration;
+    std::vector<SpanStatistics> statistics;
+    for (SpanId id = 0; id < names.size(); ++id) {
+        HistogramSnapshot merged;
+        for (const auto& buffer : buffers) {
+            buffer->AppendSnapshot(id, merged);
+        }
+        if (merged.count == 0) {
+            continue;
+        }
 
-    // Log the profiling information
-    std::ostringstream logMessage;
-    logMessage << "Profiling: " << operationName << " took " << duration.count() << " microseconds";
-    Logging::Log(LogLevel::Debug, logMessage.str());
+        SpanStatistics entry;
+        entry.spanId = id;
+        entry.name = names[id];
+        entry.count = merged.count;
+        entry.totalNs = merged.sum;
+        entry.p50Ns = merged.Percentile(50.0);
+        entry.p99Ns = merged.Percentile(99.0);
+        entry.maxNs = merged.max;
+        statistics.push_back(std::move(entry));
+    }
+    return statistics;
 }
 
-std::string Profiler::GetProfileReport() {
+std::vector<SpanRecord> Profiler::GetRecentSpans() const {
+    std::vector<SpanRecord> records;
+    for (const auto& buffer : CopyBuffers()) {
+        buffer->AppendRecentSpans(records);
+    }
+    return records;
+}
+
+std::string Profiler::GetProfileReport() const {
+    std::vector<SpanStatistics> statistics = GetStatistics();
+    std::sort(statistics.begin(), statistics.end(),
+              [](const SpanStatistics& a, const SpanStatistics& b) { return a.totalNs > b.totalNs; });
+
+    auto micros = [](std::uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+
     std::ostringstream report;
-    report << "Profiling Report:\n";
+    report << "Profiling Report (sample rate " << GetSampleRate() << "):\n";
+    report << std::fixed << std::setprecision(1);
+    for (const auto& entry : statistics) {
+        report << entry.name << ": count=" << entry.count
+               << " p50=" << micros(entry.p50Ns) << "us"
+               << " p99=" << micros(entry.p99Ns) << "us"
+               << " max=" << micros(entry.maxNs) << "us"
+               << " total=" << micros(entry.totalNs) << "us\n";
+    }
+    return report.str();
+}
 
-    for (const auto& entry : profilingData) {
-        const auto& operationName = entry.first;
-        const auto& duration = std::chrono::duration_cast<std::chrono::microseconds>(entry.second).count();
-        report << operationName << ": " << duration << " microseconds\n";
+void Profiler::Reset() {
+    for (const auto& buffer : CopyBuffers()) {
+        buffer->Reset();
     }
+}
 
-    return report.str();
+void Profiler::ClearRecentSpans() {
+    for (const auto& buffer : CopyBuffers()) {
+        buffer->ClearRecent();
+    }
 }
 
-void Profiler::EnableProfiling(bool enable) {
-    isEnabled = enable;
-    std::string status = enable ? "enabled" : "disabled";
-    Logging::Log(LogLevel::Info, "Profiling " + status);
-}
\ No newline at end of file
+void Profiler::SetThreadName(std::string_view name) {
+    ThreadProfileBuffer* buffer = GetThreadBuffer();
+    if (buffer == nullptr) return;
+    std::lock_guard<std::mutex> lock(m_bufferMutex);
+    buffer->name.assign(name.data(), name.size());
+}
+
+void Profiler::ExportChromeTrace(std::ostream& out) const {
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_spanMutex);
+        names = m_spanNames;
+    }
+    std::vector<std::pair<std::uint32_t, std::string>> threads;
+    std::vector<std::shared_ptr<ThreadProfileBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_bufferMutex);
+        buffers = m_buffers;
+        for (const auto& buffer : buffers) {
+            threads.emplace_back(buffer->ThreadId(), buffer->name);
+        }
+    }
+
+    std::vector<SpanRecord> records;
+    for (const auto& buffer : buffers) {
+        buffer->AppendRecentSpans(records);
+    }
+
+    // Trace timestamps are microseconds; rebase them so the trace starts at zero.
+    std::uint64_t originNs = records.empty() ? 0 : records.front().startNs;
+    for (const auto& record : records) {
+        originNs = std::min(originNs, record.startNs);
+    }
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    out << std::fixed << std::setprecision(3);
+    bool first = true;
+    for (const auto& thread : threads) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.first
+            << ",\"args\":{\"name\":";
+        WriteJsonString(out, thread.second.empty() ? "Thread " + std::to_string(thread.first) : thread.second);
+        out << "}}";
+    }
+    for (const auto& record : records) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\":";
+        WriteJsonString(out, record.spanId < names.size() ? names[record.spanId] : std::string("<unknown>"));
+        out << ",\"cat\":\"excel\",\"ph\":\"X\",\"pid\":1,\"tid\":" << record.threadId
+            << ",\"ts\":" << static_cast<double>(record.startNs - originNs) / 1000.0
+            << ",\"dur\":" << static_cast<double>(record.durationNs) / 1000.0
+            << ",\"args\":{\"depth\":" << record.depth << "}}";
+    }
+    out << "\n]}\n";
+}
+
+void Profiler::WriteChromeTrace(const std::string& filePath) const {
+    std::ofstream file(filePath, std::ios::out | std::ios::trunc);
+    if (!file) {
+        throw CoreEngine::Utils::ExcelException(CoreEngine::Utils::ErrorCode::FILE_IO_ERROR,
+                                                "Cannot open trace file: " + filePath);
+    }
+    ExportChromeTrace(file);
+    file.flush();
+    if (!file) {
+        throw CoreEngine::Utils::ExcelException(CoreEngine::Utils::ErrorCode::FILE_IO_ERROR,
+                                                "Failed to write trace file: " + filePath);
+    }
+}
+
+TraceCapture::TraceCapture(std::string outputPath)
+    : m_outputPath(std::move(outputPath)) {
+    Profiler& profiler = Profiler::GetInstance();
+    m_wasEnabled = profiler.IsEnabled();
+    m_previousSampleRate = profiler.GetSampleRate();
+    profiler.ClearRecentSpans();
+    profiler.SetSampleRate(1.0);
+    profiler.EnableProfiling(true);
+}
+
+TraceCapture::~TraceCapture() {
+    if (m_finished) return;
+    try {
+        Finish();
+    } catch (const std::exception& e) {
+        CoreEngine::Utils::Log(CoreEngine::Utils::LogLevel::ERROR, std::string("Trace capture failed: ") + e.what());
+    }
+}
+
+void TraceCapture::Finish() {
+    if (m_finished) return;
+    m_finished = true;
+
+    Profiler& profiler = Profiler::GetInstance();
+    profiler.SetSampleRate(m_previousSampleRate);
+    profiler.EnableProfiling(m_wasEnabled);
+    profiler.WriteChromeTrace(m_outputPath);
+}
+
+} // namespace excel::core_engine::performance
@@ -1,42 +1,263 @@
 #ifndef EXCEL_CORE_ENGINE_PERFORMANCE_PROFILER_H
 #define EXCEL_CORE_ENGINE_PERFORMANCE_PROFILER_H
 
-#include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <memory>
+#include <vector>
+#include "LatencyHistogram.h"
 
 namespace excel::core_engine::performance {
 
-struct ProfileData {
-    std::chrono::high_resolution_clock::time_point startTime;
-    std::chrono::duration<double> totalTime{};
-    int callCount{0};
+/// Dense identifier of an interned span name.
+using SpanId = std::uint32_t;
+
+/**
+ * @brief One completed span, as kept in the per-thread ring buffers.
+ */
+struct SpanRecord {
+    SpanId spanId{0};
+    std::uint32_t threadId{0};
+    std::uint32_t depth{0};
+    std::uint64_t startNs{0};
+    std::uint64_t durationNs{0};
 };
 
+/**
+ * @brief Aggregated latency statistics for one span name, merged across threads.
+ */
+struct SpanStatistics {
+    SpanId spanId{0};
+    std::string name;
+    std::uint64_t count{0};
+    std::uint64_t totalNs{0};
+    std::uint64_t p50Ns{0};
+    std::uint64_t p99Ns{0};
+    std::uint64_t maxNs{0};
+};
+
+class ThreadProfileBuffer;
+
+/**
+ * @class Profiler
+ * @brief Low-overhead, thread-safe span profiler.
+ *
+ * Span names are interned once into dense SpanIds. Each thread records into
+ * its own buffer: a log-linear LatencyHistogram per span and a lock-free ring
+ * of recent SpanRecords, so recording never takes a lock or touches shared
+ * cache lines. Readers merge the per-thread buffers on demand.
+ *
+ * Sampling is decided once per outermost span on each thread and inherited by
+ * nested spans, so sampled call trees are always complete. When profiling is
+ * disabled a scope costs one relaxed atomic load.
+ *
+ * The rings double as a bounded trace buffer: ExportChromeTrace writes them
+ * as Chrome trace-event JSON, and TraceCapture scopes a capture to one
+ * operation. Setting EXCEL_PROFILE_TRACE=<path> traces the whole process and
+ * writes the file at exit.
+ *
+ * A thread's buffer is handed to the next new thread when it exits, so the
+ * profiler's memory is bounded by the peak number of concurrent threads.
+ * Trace events keep the thread id of the buffer they were recorded in.
+ */
 class Profiler {
 public:
+    static constexpr std::size_t MAX_SPANS = 4096;
+    static constexpr std::size_t RING_CAPACITY = 8192;
+    static constexpr SpanId OVERFLOW_SPAN_ID = 0;
+
     static Profiler& GetInstance() {
         static Profiler instance;
         return instance;
     }
 
+    /**
+     * @brief Returns the id for a span name, registering it on first use.
+     *
+     * Takes a lock; call it once per call site (EXCEL_PROFILE_SCOPE caches the
+     * result in a function-local static). Names beyond MAX_SPANS share
+     * OVERFLOW_SPAN_ID.
+     */
+    SpanId InternSpan(std::string_view name);
+
+    /**
+     * @brief Returns the name registered for a span id.
+     */
+    std::string GetSpanName(SpanId id) const;
+
+    void EnableProfiling(bool enable);
+
+    bool IsEnabled() const noexcept {
+        return m_enabled.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Sets the fraction (0-1) of outermost spans that are recorded.
+     */
+    void SetSampleRate(double rate);
+    double GetSampleRate() const;
+
+    /**
+     * @brief Starts a named span on the calling thread.
+     *
+     * Prefer EXCEL_PROFILE_SCOPE. Calls must be balanced with EndProfile on
+     * the same thread; nested and concurrent spans with the same name are
+     * tracked independently.
+     */
     void StartProfile(const std::string& operationName);
     void EndProfile(const std::string& operationName);
+
+    /**
+     * @brief Returns merged statistics for every span with at least one sample.
+     */
+    std::vector<SpanStatistics> GetStatistics() const;
+
+    /**
+     * @brief Returns the spans still held in the per-thread rings, oldest first per thread.
+     */
+    std::vector<SpanRecord> GetRecentSpans() const;
+
     std::string GetProfileReport() const;
-    void EnableProfiling(bool enable);
+
+    /**
+     * @brief Clears all histograms and recent spans.
+     */
+    void Reset();
+
+    /**
+     * @brief Clears the recent-span rings but keeps the histograms.
+     */
+    void ClearRecentSpans();
+
+    /**
+     * @brief Number of per-thread buffers allocated: the peak number of threads that recorded at once.
+     */
+    std::size_t GetThreadBufferCount() const;
+
+    /**
+     * @brief Names the calling thread in exported traces.
+     */
+    void SetThreadName(std::string_view name);
+
+    /**
+     * @brief Writes the recent spans as Chrome trace-event JSON.
+     *
+     * The output opens in chrome://tracing and Perfetto. Each thread keeps at
+     * most RING_CAPACITY spans, so long captures keep the newest spans only.
+     */
+    void ExportChromeTrace(std::ostream& out) const;
+
+    /**
+     * @brief Writes ExportChromeTrace output to a file.
+     * @throws CoreEngine::Utils::ExcelException if the file cannot be written.
+     */
+    void WriteChromeTrace(const std::string& filePath) const;
+
+    static std::uint64_t NowNanoseconds() noexcept;
+
+    /**
+     * @brief Enters a span on the calling thread.
+     * @return True if the span is sampled and must be passed to LeaveSpan as recorded.
+     */
+    bool EnterSpan() noexcept;
+
+    /**
+     * @brief Leaves a span entered with EnterSpan, recording it if sampled.
+     */
+    void LeaveSpan(SpanId id, std::uint64_t startNs, bool recorded) noexcept;
 
 private:
-    Profiler() = default;
-    ~Profiler() = default;
+    Profiler();
+    ~Profiler();
     Profiler(const Profiler&) = delete;
     Profiler& operator=(const Profiler&) = delete;
 
-    std::unordered_map<std::string, ProfileData> profilingData;
-    bool isEnabled{false};
+    ThreadProfileBuffer* GetThreadBuffer() noexcept;
+    std::vector<std::shared_ptr<ThreadProfileBuffer>> CopyBuffers() const;
+
+    std::atomic<bool> m_enabled{false};
+    std::atomic<std::uint32_t> m_sampleThreshold; ///< Sample when a 32-bit random draw is below this.
+    std::atomic<bool> m_sampleAll{true};
+    std::string m_exitTracePath; ///< From EXCEL_PROFILE_TRACE; written by the destructor.
+
+    mutable std::mutex m_spanMutex;
+    std::vector<std::string> m_spanNames;
+    std::unordered_map<std::string, SpanId> m_spanIds;
+
+    mutable std::mutex m_bufferMutex;
+    std::vector<std::shared_ptr<ThreadProfileBuffer>> m_buffers;
+};
+
+/**
+ * @class ProfileScope
+ * @brief RAII span: enters on construction and leaves on destruction.
+ */
+class ProfileScope {
+public:
+    explicit ProfileScope(SpanId id) noexcept : m_id(id) {
+        Profiler& profiler = Profiler::GetInstance();
+        if (profiler.IsEnabled()) {
+            m_entered = true;
+            m_recorded = profiler.EnterSpan();
+            if (m_recorded) {
+                m_startNs = Profiler::NowNanoseconds();
+            }
+        }
+    }
+
+    ~ProfileScope() {
+        if (m_entered) {
+            Profiler::GetInstance().LeaveSpan(m_id, m_startNs, m_recorded);
+        }
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    SpanId m_id;
+    std::uint64_t m_startNs{0};
+    bool m_entered{false};
+    bool m_recorded{false};
+};
+
+/**
+ * @class TraceCapture
+ * @brief Records every span on every thread for the lifetime of the object
+ *        and writes them to a Chrome trace file.
+ *
+ * Wrap one recalc or load in a TraceCapture to get a trace of just that
+ * operation. Profiling state and sample rate are restored afterwards.
+ */
+class TraceCapture {
+public:
+    explicit TraceCapture(std::string outputPath);
+
+    /**
+     * @brief Writes the trace if Finish was not called. Errors are logged, not thrown.
+     */
+    ~TraceCapture();
+
+    TraceCapture(const TraceCapture&) = delete;
+    TraceCapture& operator=(const TraceCapture&) = delete;
+
+    /**
+     * @brief Stops the capture and writes the trace file.
+     * @throws CoreEngine::Utils::ExcelException if the file cannot be written.
+     */
+    void Finish();
 
-    // TODO: Implement logging functionality when Logging.h is available
-    // void Log(const std::string& message) const;
+private:
+    std::string m_outputPath;
+    bool m_wasEnabled;
+    double m_previousSampleRate;
+    bool m_finished{false};
 };
 
 // Global function to get the Profiler instance
@@ -46,4 +267,19 @@ inline Profiler& GetProfiler() {
 
 } // namespace excel::core_engine::performance
 
-#endif // EXCEL_CORE_ENGINE_PERFORMANCE_PROFILER_H
\ No newline at end of file
+#define EXCEL_PROFILE_CONCAT_INNER(a, b) a##b
+#define EXCEL_PROFILE_CONCAT(a, b) EXCEL_PROFILE_CONCAT_INNER(a, b)
+
+// Profiles the enclosing scope under a string-literal name. Define
+// EXCEL_DISABLE_PROFILING to compile all scopes out.
+#if defined(EXCEL_DISABLE_PROFILING)
+#define EXCEL_PROFILE_SCOPE(name) ((void)0)
+#else
+#define EXCEL_PROFILE_SCOPE(name)                                                                   \
+    static const ::excel::core_engine::performance::SpanId EXCEL_PROFILE_CONCAT(excelSpanId_, __LINE__) = \
+        ::excel::core_engine::performance::Profiler::GetInstance().InternSpan(name);                \
+    ::excel::core_engine::performance::ProfileScope EXCEL_PROFILE_CONCAT(excelProfileScope_, __LINE__)( \
+        EXCEL_PROFILE_CONCAT(excelSpanId_, __LINE__))
+#endif
+
+#endif // EXCEL_CORE_ENGINE_PERFORMANCE_PROFILER_H
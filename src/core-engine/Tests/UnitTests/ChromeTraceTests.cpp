@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "../../Performance/Profiler.h"
+#include "../../Utils/ErrorHandling.h"
+
+using namespace excel::core_engine::performance;
+
+namespace {
+
+std::size_t CountOccurrences(const std::string& text, const std::string& pattern) {
+    std::size_t count = 0;
+    for (std::size_t at = text.find(pattern); at != std::string::npos; at = text.find(pattern, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+
+std::string ReadFile(const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+class ChromeTraceTest : public ::testing::Test {
+protected:
+    Profiler& profiler = Profiler::GetInstance();
+
+    void SetUp() override {
+        profiler.SetSampleRate(1.0);
+        profiler.EnableProfiling(true);
+        profiler.Reset();
+    }
+
+    void TearDown() override {
+        profiler.EnableProfiling(false);
+        profiler.Reset();
+    }
+
+    std::string Export() const {
+        std::ostringstream out;
+        profiler.ExportChromeTrace(out);
+        return out.str();
+    }
+};
+
+} // namespace
+
+TEST_F(ChromeTraceTest, EmptyTraceIsValid) {
+    profiler.ClearRecentSpans();
+    const std::string trace = Export();
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+    EXPECT_EQ(CountOccurrences(trace, "\"ph\":\"X\""), 0u);
+    EXPECT_EQ(trace.substr(trace.size() - 4), "\n]}\n");
+}
+
+TEST_F(ChromeTraceTest, ExportsCompleteEventsPerThread) {
+    // The worker stays alive until the export, so it keeps its own buffer and name
+    std::promise<void> recorded;
+    std::promise<void> exported;
+    std::thread worker([&] {
+        profiler.SetThreadName("Recalc \"worker\"");
+        {
+            EXCEL_PROFILE_SCOPE("ChromeTraceTest.Outer");
+            EXCEL_PROFILE_SCOPE("ChromeTraceTest.Inner");
+        }
+        recorded.set_value();
+        exported.get_future().wait();
+    });
+    recorded.get_future().wait();
+    {
+        EXCEL_PROFILE_SCOPE("ChromeTraceTest.Main");
+    }
+
+    const std::string trace = Export();
+    exported.set_value();
+    worker.join();
+
+    EXPECT_EQ(CountOccurrences(trace, "\"ph\":\"X\""), 3u);
+    EXPECT_EQ(CountOccurrences(trace, "\"name\":\"ChromeTraceTest.Outer\",\"cat\":\"excel\",\"ph\":\"X\""), 1u);
+    EXPECT_NE(trace.find("\"name\":\"ChromeTraceTest.Inner\""), std::string::npos);
+    EXPECT_NE(trace.find("\"args\":{\"depth\":1}"), std::string::npos);
+
+    // Thread names are metadata events, escaped as JSON strings
+    EXPECT_GE(CountOccurrences(trace, "\"ph\":\"M\""), 2u);
+    EXPECT_NE(trace.find("\"args\":{\"name\":\"Recalc \\\"worker\\\"\"}"), std::string::npos);
+
+    // Timestamps are rebased so the earliest span starts at zero
+    EXPECT_NE(trace.find("\"ts\":0.000,"), std::string::npos);
+    EXPECT_EQ(trace.find("\"ts\":-"), std::string::npos);
+}
+
+TEST_F(ChromeTraceTest, SpanNamesAreEscaped) {
+    const SpanId id = profiler.InternSpan("Load \"C:\\book.xlsx\"\n");
+    {
+        ProfileScope scope(id);
+    }
+    EXPECT_NE(Export().find("\"name\":\"Load \\\"C:\\\\book.xlsx\\\"\\n\""), std::string::npos);
+}
+
+TEST_F(ChromeTraceTest, CaptureWritesOnlyItsOwnSpansAndRestoresSettings) {
+    profiler.SetSampleRate(0.25);
+    profiler.EnableProfiling(false);
+    {
+        // Recorded before the capture, so left out of it
+        profiler.EnableProfiling(true);
+        EXCEL_PROFILE_SCOPE("ChromeTraceTest.Before");
+    }
+    profiler.EnableProfiling(false);
+
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "excel_chrome_trace_test.json";
+    std::filesystem::remove(path);
+    {
+        TraceCapture capture(path.string());
+        EXPECT_TRUE(profiler.IsEnabled());
+        EXPECT_EQ(profiler.GetSampleRate(), 1.0);
+        for (int i = 0; i < 10; ++i) {
+            EXCEL_PROFILE_SCOPE("ChromeTraceTest.Captured");
+        }
+    }
+    EXPECT_FALSE(profiler.IsEnabled());
+    EXPECT_NEAR(profiler.GetSampleRate(), 0.25, 1e-6);
+
+    const std::string trace = ReadFile(path);
+    EXPECT_EQ(CountOccurrences(trace, "\"name\":\"ChromeTraceTest.Captured\""), 10u);
+    EXPECT_EQ(trace.find("ChromeTraceTest.Before"), std::string::npos);
+    std::filesystem::remove(path);
+}
+
+TEST_F(ChromeTraceTest, UnwritablePathThrows) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "no-such-directory" / "trace.json";
+    EXPECT_THROW(profiler.WriteChromeTrace(path.string()), CoreEngine::Utils::ExcelException);
+
+    TraceCapture capture(path.string());
+    EXPECT_THROW(capture.Finish(), CoreEngine::Utils::ExcelException);
+}
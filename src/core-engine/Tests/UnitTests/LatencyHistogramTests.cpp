@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../../Performance/LatencyHistogram.h"
+
+using namespace excel::core_engine::performance;
+
+TEST(LatencyHistogramTest, SmallValuesHaveExactBuckets) {
+    for (std::uint64_t value = 0; value < LatencyHistogram::SUB_BUCKETS; ++value) {
+        EXPECT_EQ(LatencyHistogram::BucketIndex(value), value);
+        EXPECT_EQ(LatencyHistogram::BucketUpperBound(value), value);
+    }
+}
+
+TEST(LatencyHistogramTest, BucketsAreOrderedAndWithinOneEighth) {
+    std::size_t previous = 0;
+    for (std::uint64_t value = 1; value < (std::uint64_t{1} << 53); value += value / 7 + 1) {
+        const std::size_t index = LatencyHistogram::BucketIndex(value);
+        ASSERT_LT(index, LatencyHistogram::BUCKET_COUNT);
+        EXPECT_GE(index, previous) << value;
+        previous = index;
+
+        const std::uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(static_cast<double>(upper - value), static_cast<double>(value) * 0.125) << value;
+        if (index > 0) {
+            EXPECT_LT(LatencyHistogram::BucketUpperBound(index - 1), value) << value;
+        }
+    }
+    // Anything too large for the table lands in the last bucket
+    EXPECT_EQ(LatencyHistogram::BucketIndex(UINT64_MAX), LatencyHistogram::BUCKET_COUNT - 1);
+}
+
+TEST(LatencyHistogramTest, SnapshotPercentiles) {
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.Snapshot().Percentile(50.0), 0u);
+
+    for (std::uint64_t value = 1; value <= 1000; ++value) {
+        histogram.Record(value * 1000);
+    }
+    const HistogramSnapshot snapshot = histogram.Snapshot();
+    EXPECT_EQ(snapshot.count, 1000u);
+    EXPECT_EQ(snapshot.sum, 500500u * 1000u);
+    EXPECT_EQ(snapshot.max, 1000000u);
+
+    // Bucket upper bounds: never below the exact percentile, at most one bucket above
+    for (double percentile : {1.0, 50.0, 90.0, 99.0}) {
+        const double exact = percentile * 10.0 * 1000.0;
+        const double estimate = static_cast<double>(snapshot.Percentile(percentile));
+        EXPECT_GE(estimate, exact) << percentile;
+        EXPECT_LE(estimate, exact * 1.125) << percentile;
+    }
+    // The top bucket is clamped to the recorded maximum
+    EXPECT_EQ(snapshot.Percentile(100.0), 1000000u);
+    EXPECT_EQ(snapshot.Percentile(0.0), snapshot.Percentile(0.1));
+}
+
+TEST(LatencyHistogramTest, MergeAddsSnapshots) {
+    LatencyHistogram even;
+    LatencyHistogram odd;
+    for (std::uint64_t value = 1; value <= 100; ++value) {
+        (value % 2 == 0 ? even : odd).Record(value);
+    }
+
+    HistogramSnapshot merged;
+    merged.Merge(even.Snapshot());
+    merged.Merge(odd.Snapshot());
+    EXPECT_EQ(merged.count, 100u);
+    EXPECT_EQ(merged.sum, 5050u);
+    EXPECT_EQ(merged.max, 100u);
+    EXPECT_EQ(merged.buckets.size(), LatencyHistogram::BUCKET_COUNT);
+    EXPECT_EQ(merged.Percentile(100.0), 100u);
+    EXPECT_GE(merged.Percentile(50.0), 50u);
+    EXPECT_LE(merged.Percentile(50.0), 56u);
+}
+
+TEST(LatencyHistogramTest, ResetClearsEverything) {
+    LatencyHistogram histogram;
+    histogram.Record(12345);
+    histogram.Reset();
+    const HistogramSnapshot snapshot = histogram.Snapshot();
+    EXPECT_EQ(snapshot.count, 0u);
+    EXPECT_EQ(snapshot.sum, 0u);
+    EXPECT_EQ(snapshot.max, 0u);
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecordsAreNotLost) {
+    LatencyHistogram histogram;
+    constexpr int THREADS = 4;
+    constexpr int SAMPLES = 100000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&histogram, t] {
+            for (int i = 0; i < SAMPLES; ++i) {
+                histogram.Record(static_cast<std::uint64_t>(t * SAMPLES + i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const HistogramSnapshot snapshot = histogram.Snapshot();
+    const std::uint64_t total = static_cast<std::uint64_t>(THREADS) * SAMPLES;
+    EXPECT_EQ(snapshot.count, total);
+    EXPECT_EQ(snapshot.sum, total * (total - 1) / 2);
+    EXPECT_EQ(snapshot.max, total - 1);
+}
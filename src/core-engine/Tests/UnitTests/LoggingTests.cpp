@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../Utils/Logging.h"
+
+using namespace CoreEngine::Utils;
+
+namespace {
+
+// Each test logs to its own file through the process-wide writer
+class LoggingTest : public ::testing::Test {
+protected:
+    std::filesystem::path path;
+    LogLevel previousLevel = LogLevel::INFO;
+
+    void SetUp() override {
+        previousLevel = LOG_LEVEL.load();
+        LOG_LEVEL.store(LogLevel::DEBUG);
+        path = std::filesystem::temp_directory_path() /
+               ("excel_logging_" + std::string(::testing::UnitTest::GetInstance()->current_test_info()->name()) + ".log");
+        std::filesystem::remove(path);
+    }
+
+    void TearDown() override {
+        LOG_LEVEL.store(previousLevel);
+        // Point the writer away from the file before deleting it
+        ConfigureLogging(AsyncLogConfig{});
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+
+    void Configure(LogOverflowPolicy policy, std::chrono::milliseconds flushInterval = std::chrono::milliseconds(50)) {
+        AsyncLogConfig config;
+        config.filePath = path.string();
+        config.overflowPolicy = policy;
+        config.flushInterval = flushInterval;
+        ConfigureLogging(config);
+    }
+
+    std::vector<std::string> ReadLines() const {
+        std::vector<std::string> lines;
+        std::ifstream file(path);
+        for (std::string line; std::getline(file, line);) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    std::size_t CountLines(const std::string& text) const {
+        std::size_t count = 0;
+        for (const std::string& line : ReadLines()) {
+            count += line.find(text) != std::string::npos;
+        }
+        return count;
+    }
+};
+
+void LogFromThreads(int threadCount, int messagesPerThread, const std::string& prefix) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([=] {
+            for (int i = 0; i < messagesPerThread; ++i) {
+                Log(LogLevel::INFO, prefix + std::to_string(t) + "/" + std::to_string(i));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace
+
+TEST_F(LoggingTest, FlushWritesQueuedMessages) {
+    // The writer would otherwise sleep for a minute before writing
+    Configure(LogOverflowPolicy::DropNewest, std::chrono::minutes(1));
+    Log(LogLevel::WARNING, "LoggingTest flushed message");
+    FlushLog();
+
+    const auto lines = ReadLines();
+    ASSERT_EQ(lines.size(), 1u);
+    EXPECT_TRUE(std::regex_match(lines[0], std::regex(
+        R"(\[\d{4}-\d{2}-\d{2} \d{2}:\d{2}:\d{2}\.\d{3}\] \[WARNING\] LoggingTest flushed message)"))) << lines[0];
+}
+
+TEST_F(LoggingTest, BlockPolicyLosesNothing) {
+    Configure(LogOverflowPolicy::Block);
+    const std::uint64_t droppedBefore = GetDroppedLogCount();
+    LogFromThreads(4, 20000, "LoggingTest block ");
+    FlushLog();
+
+    EXPECT_EQ(CountLines("LoggingTest block "), 80000u);
+    EXPECT_EQ(GetDroppedLogCount(), droppedBefore);
+}
+
+TEST_F(LoggingTest, DropNewestAccountsForEveryMessage) {
+    Configure(LogOverflowPolicy::DropNewest);
+    const std::uint64_t droppedBefore = GetDroppedLogCount();
+    LogFromThreads(4, 50000, "LoggingTest drop ");
+    FlushLog();
+
+    // Each message is either written or counted as dropped, and drops are reported in the log
+    const std::uint64_t dropped = GetDroppedLogCount() - droppedBefore;
+    EXPECT_EQ(CountLines("LoggingTest drop ") + dropped, 200000u);
+    if (dropped > 0) {
+        EXPECT_GE(CountLines("log messages dropped: queue full"), 1u);
+    }
+}
+
+TEST_F(LoggingTest, FiltersByLevel) {
+    Configure(LogOverflowPolicy::Block);
+    LOG_LEVEL.store(LogLevel::WARNING);
+    int evaluated = 0;
+    auto message = [&evaluated](const char* text) {
+        ++evaluated;
+        return std::string(text);
+    };
+    EXCEL_LOG(INFO, message("LoggingTest filtered"));
+    EXCEL_LOG(ERROR, message("LoggingTest kept"));
+    Log(LogLevel::DEBUG, "LoggingTest filtered");
+    FlushLog();
+
+    EXPECT_EQ(evaluated, 1); // The filtered message was never built
+    EXPECT_EQ(CountLines("LoggingTest filtered"), 0u);
+    EXPECT_EQ(CountLines("[ERROR] LoggingTest kept"), 1u);
+}
+
+TEST_F(LoggingTest, LongMessagesAreTruncatedToOneRecord) {
+    Configure(LogOverflowPolicy::Block);
+    const std::string message = "LoggingTest long " + std::string(1000, 'x');
+    Log(LogLevel::INFO, message);
+    FlushLog();
+
+    const auto lines = ReadLines();
+    ASSERT_EQ(lines.size(), 1u);
+    const std::string text = lines[0].substr(lines[0].find("] [INFO] ") + 9);
+    EXPECT_LT(text.size(), message.size());
+    EXPECT_GT(text.size(), 100u);
+    EXPECT_EQ(message.compare(0, text.size(), text), 0);
+}
+
+TEST_F(LoggingTest, ShutdownDrainsTheQueueAndLaterMessagesAreWrittenDirectly) {
+    Configure(LogOverflowPolicy::Block, std::chrono::minutes(1));
+    for (int i = 0; i < 1000; ++i) {
+        Log(LogLevel::INFO, "LoggingTest queued " + std::to_string(i));
+    }
+    ShutdownLogging();
+    EXPECT_EQ(CountLines("LoggingTest queued "), 1000u);
+
+    // No writer thread is left; the message is on disk when Log returns
+    Log(LogLevel::INFO, "LoggingTest after shutdown");
+    EXPECT_EQ(CountLines("LoggingTest after shutdown"), 1u);
+    FlushLog(); // Returns at once with nothing to wait for
+}
+
+TEST_F(LoggingTest, MessagesLoggedDuringShutdownAreWritten) {
+    // Enough producers to keep the ring full, so some are blocked waiting
+    // for room when the writer stops
+    Configure(LogOverflowPolicy::Block, std::chrono::minutes(1));
+    std::atomic<int> started{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t, &started] {
+            started.fetch_add(1);
+            for (int i = 0; i < 20000; ++i) {
+                Log(LogLevel::INFO, "LoggingTest shutdown " + std::to_string(t) + "/" + std::to_string(i));
+            }
+        });
+    }
+    while (started.load() < 4) {
+        std::this_thread::yield();
+    }
+    ShutdownLogging();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(CountLines("LoggingTest shutdown "), 80000u);
+}
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../Performance/Metrics.h"
+
+using namespace excel::core_engine::performance;
+
+namespace {
+
+const MetricSample* FindSample(const std::vector<MetricSample>& samples, const std::string& name,
+                               const std::string& labels = std::string()) {
+    for (const MetricSample& sample : samples) {
+        if (sample.name == name && sample.labels == labels) {
+            return &sample;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+TEST(MetricsRegistryTest, CountersAreSharedByNameAndLabels) {
+    Counter& counter = GetMetrics().GetCounter("metrics_test_events_total", "Events.");
+    EXPECT_EQ(&GetMetrics().GetCounter("metrics_test_events_total", "Events."), &counter);
+
+    Counter& labelled = GetMetrics().GetCounter("metrics_test_events_total", "Events.", "kind=\"a\"");
+    EXPECT_NE(&labelled, &counter);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t) {
+        threads.emplace_back([&counter] {
+            for (int i = 0; i < 10000; ++i) {
+                counter.Increment();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    labelled.Increment(5);
+    EXPECT_EQ(counter.Value(), 80000u);
+    EXPECT_EQ(labelled.Value(), 5u);
+
+    const MetricsSnapshot snapshot = GetMetrics().Snapshot();
+    ASSERT_NE(FindSample(snapshot.counters, "metrics_test_events_total"), nullptr);
+    EXPECT_EQ(FindSample(snapshot.counters, "metrics_test_events_total")->value, 80000.0);
+    ASSERT_NE(FindSample(snapshot.counters, "metrics_test_events_total", "kind=\"a\""), nullptr);
+    EXPECT_EQ(FindSample(snapshot.counters, "metrics_test_events_total", "kind=\"a\"")->value, 5.0);
+}
+
+TEST(MetricsRegistryTest, GaugesAndComputedGauges) {
+    Gauge& gauge = GetMetrics().GetGauge("metrics_test_bytes", "Bytes in use.");
+    gauge.Set(100);
+    gauge.Add(-30);
+    EXPECT_EQ(gauge.Value(), 70);
+
+    double source = 0.25;
+    GetMetrics().RegisterComputedGauge("metrics_test_ratio", "A ratio.", [&source] { return source; });
+    EXPECT_EQ(FindSample(GetMetrics().Snapshot().gauges, "metrics_test_ratio")->value, 0.25);
+
+    // Computed when the snapshot is taken; re-registering replaces the callback
+    source = 0.5;
+    EXPECT_EQ(FindSample(GetMetrics().Snapshot().gauges, "metrics_test_ratio")->value, 0.5);
+    GetMetrics().RegisterComputedGauge("metrics_test_ratio", "A ratio.", [] { return 1.0; });
+    const MetricsSnapshot snapshot = GetMetrics().Snapshot();
+    EXPECT_EQ(FindSample(snapshot.gauges, "metrics_test_ratio")->value, 1.0);
+    EXPECT_EQ(FindSample(snapshot.gauges, "metrics_test_bytes")->value, 70.0);
+}
+
+TEST(MetricsRegistryTest, HistogramsSummariseInSeconds) {
+    Histogram& histogram = GetMetrics().GetHistogram("metrics_test_duration_seconds", "Durations.");
+    for (std::uint64_t ms = 1; ms <= 100; ++ms) {
+        histogram.Observe(ms * 1000000);
+    }
+    {
+        ScopedTimer timer(histogram);
+    }
+
+    for (const HistogramSample& sample : GetMetrics().Snapshot().histograms) {
+        if (sample.name != "metrics_test_duration_seconds") {
+            continue;
+        }
+        EXPECT_EQ(sample.count, 101u);
+        EXPECT_NEAR(sample.sumSeconds, 5.05, 0.01);
+        EXPECT_GE(sample.p50Seconds, 0.050);
+        EXPECT_LE(sample.p50Seconds, 0.050 * 1.125);
+        EXPECT_GE(sample.p99Seconds, 0.099);
+        EXPECT_LE(sample.p90Seconds, sample.p99Seconds);
+        EXPECT_EQ(sample.maxSeconds, 0.1);
+        return;
+    }
+    FAIL() << "histogram missing from the snapshot";
+}
+
+TEST(MetricsRegistryTest, SnapshotIsSortedByName) {
+    GetMetrics().GetCounter("metrics_test_b_total", "B.");
+    GetMetrics().GetCounter("metrics_test_a_total", "A.");
+    const auto counters = GetMetrics().Snapshot().counters;
+    for (std::size_t i = 1; i < counters.size(); ++i) {
+        EXPECT_LE(counters[i - 1].name, counters[i].name);
+    }
+}
+
+TEST(MetricsRegistryTest, FormatTextWritesPrometheusExposition) {
+    MetricsSnapshot snapshot;
+    snapshot.counters = {
+        {"excel_requests_total", "subsystem=\"calc\"", "Requests served.", 3.0},
+        {"excel_requests_total", "subsystem=\"io\"", "Requests served.", 12.0},
+    };
+    snapshot.gauges = {
+        {"excel_open_workbooks", "", "", 2.0},
+        {"excel_cache_hit_ratio", "", "Hits / lookups.", 0.875},
+    };
+    HistogramSample latency;
+    latency.name = "excel_recalc_seconds";
+    latency.labels = "sheet=\"1\"";
+    latency.help = "Recalc time.";
+    latency.count = 4;
+    latency.sumSeconds = 0.5;
+    latency.p50Seconds = 0.125;
+    latency.p90Seconds = 0.25;
+    latency.p99Seconds = 1.5e-05;
+    snapshot.histograms = {latency};
+
+    EXPECT_EQ(MetricsRegistry::FormatText(snapshot),
+              "# HELP excel_requests_total Requests served.\n"
+              "# TYPE excel_requests_total counter\n"
+              "excel_requests_total{subsystem=\"calc\"} 3\n"
+              "excel_requests_total{subsystem=\"io\"} 12\n"
+              "# TYPE excel_open_workbooks gauge\n"
+              "excel_open_workbooks 2\n"
+              "# HELP excel_cache_hit_ratio Hits / lookups.\n"
+              "# TYPE excel_cache_hit_ratio gauge\n"
+              "excel_cache_hit_ratio 0.875\n"
+              "# HELP excel_recalc_seconds Recalc time.\n"
+              "# TYPE excel_recalc_seconds summary\n"
+              "excel_recalc_seconds{sheet=\"1\",quantile=\"0.5\"} 0.125\n"
+              "excel_recalc_seconds{sheet=\"1\",quantile=\"0.9\"} 0.25\n"
+              "excel_recalc_seconds{sheet=\"1\",quantile=\"0.99\"} 1.5e-05\n"
+              "excel_recalc_seconds_sum{sheet=\"1\"} 0.5\n"
+              "excel_recalc_seconds_count{sheet=\"1\"} 4\n");
+
+    EXPECT_EQ(MetricsRegistry::FormatText(MetricsSnapshot{}), "");
+}
+
+TEST(MetricsRegistryTest, ExportTextIncludesRegisteredMetrics) {
+    GetMetrics().GetCounter("metrics_test_exported_total", "Exported.").Increment(7);
+    const std::string text = GetMetrics().ExportText();
+    EXPECT_NE(text.find("# TYPE metrics_test_exported_total counter\n"), std::string::npos);
+    EXPECT_NE(text.find("\nmetrics_test_exported_total 7\n"), std::string::npos);
+}
@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../../Performance/Profiler.h"
+
+using namespace excel::core_engine::performance;
+
+namespace {
+
+void Outer() {
+    EXCEL_PROFILE_SCOPE("ProfilerTest.Outer");
+    EXCEL_PROFILE_SCOPE("ProfilerTest.Inner");
+}
+
+const SpanStatistics* FindSpan(const std::vector<SpanStatistics>& statistics, const std::string& name) {
+    auto it = std::find_if(statistics.begin(), statistics.end(),
+                           [&name](const SpanStatistics& entry) { return entry.name == name; });
+    return it != statistics.end() ? &*it : nullptr;
+}
+
+// Profiling on, every span recorded and nothing left over from other tests
+class ProfilerTest : public ::testing::Test {
+protected:
+    Profiler& profiler = Profiler::GetInstance();
+
+    void SetUp() override {
+        profiler.SetSampleRate(1.0);
+        profiler.EnableProfiling(true);
+        profiler.Reset();
+    }
+
+    void TearDown() override {
+        profiler.EnableProfiling(false);
+        profiler.Reset();
+    }
+};
+
+} // namespace
+
+TEST_F(ProfilerTest, InternReturnsStableIds) {
+    const SpanId id = profiler.InternSpan("ProfilerTest.Interned");
+    EXPECT_NE(id, Profiler::OVERFLOW_SPAN_ID);
+    EXPECT_EQ(profiler.InternSpan("ProfilerTest.Interned"), id);
+    EXPECT_EQ(profiler.GetSpanName(id), "ProfilerTest.Interned");
+}
+
+TEST_F(ProfilerTest, MergesSpansAcrossThreads) {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; ++i) {
+                Outer();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    const auto statistics = profiler.GetStatistics();
+    const SpanStatistics* outer = FindSpan(statistics, "ProfilerTest.Outer");
+    const SpanStatistics* inner = FindSpan(statistics, "ProfilerTest.Inner");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    EXPECT_EQ(outer->count, 4000u);
+    EXPECT_EQ(inner->count, 4000u);
+    EXPECT_LE(outer->p50Ns, outer->p99Ns);
+    EXPECT_LE(outer->p99Ns, outer->maxNs);
+    EXPECT_LE(outer->maxNs, outer->totalNs);
+
+    // Nested spans record their depth
+    bool sawInner = false;
+    for (const SpanRecord& record : profiler.GetRecentSpans()) {
+        if (record.spanId == inner->spanId) {
+            EXPECT_EQ(record.depth, 1u);
+            sawInner = true;
+        } else if (record.spanId == outer->spanId) {
+            EXPECT_EQ(record.depth, 0u);
+        }
+    }
+    EXPECT_TRUE(sawInner);
+    EXPECT_NE(profiler.GetProfileReport().find("ProfilerTest.Outer: count=4000"), std::string::npos);
+}
+
+TEST_F(ProfilerTest, SamplingKeepsCallTreesWhole) {
+    profiler.SetSampleRate(0.1);
+    EXPECT_NEAR(profiler.GetSampleRate(), 0.1, 1e-6);
+    for (int i = 0; i < 20000; ++i) {
+        Outer();
+    }
+
+    const auto statistics = profiler.GetStatistics();
+    const SpanStatistics* outer = FindSpan(statistics, "ProfilerTest.Outer");
+    const SpanStatistics* inner = FindSpan(statistics, "ProfilerTest.Inner");
+    ASSERT_NE(outer, nullptr);
+    ASSERT_NE(inner, nullptr);
+    // The outermost span decides for everything nested in it
+    EXPECT_EQ(inner->count, outer->count);
+    EXPECT_GT(outer->count, 1500u);
+    EXPECT_LT(outer->count, 2500u);
+}
+
+TEST_F(ProfilerTest, DisabledProfilerRecordsNothing) {
+    profiler.EnableProfiling(false);
+    for (int i = 0; i < 100; ++i) {
+        Outer();
+    }
+    profiler.StartProfile("ProfilerTest.Manual");
+    profiler.EndProfile("ProfilerTest.Manual");
+    EXPECT_TRUE(profiler.GetStatistics().empty());
+    EXPECT_TRUE(profiler.GetRecentSpans().empty());
+}
+
+TEST_F(ProfilerTest, ManualSpansPairWithTheInnermostOpenName) {
+    profiler.StartProfile("ProfilerTest.Manual");
+    profiler.StartProfile("ProfilerTest.Other");
+    profiler.StartProfile("ProfilerTest.Manual");
+    profiler.EndProfile("ProfilerTest.Manual");
+    profiler.EndProfile("ProfilerTest.Other");
+    profiler.EndProfile("ProfilerTest.Manual");
+    profiler.EndProfile("ProfilerTest.Manual"); // Unmatched; ignored
+
+    const auto statistics = profiler.GetStatistics();
+    const SpanStatistics* manual = FindSpan(statistics, "ProfilerTest.Manual");
+    const SpanStatistics* other = FindSpan(statistics, "ProfilerTest.Other");
+    ASSERT_NE(manual, nullptr);
+    ASSERT_NE(other, nullptr);
+    EXPECT_EQ(manual->count, 2u);
+    EXPECT_EQ(other->count, 1u);
+    EXPECT_GE(manual->maxNs, other->maxNs); // The outer Manual span encloses Other
+}
+
+TEST_F(ProfilerTest, ResetAndClearRecentSpans) {
+    Outer();
+    profiler.ClearRecentSpans();
+    EXPECT_TRUE(profiler.GetRecentSpans().empty());
+    EXPECT_FALSE(profiler.GetStatistics().empty());
+
+    Outer();
+    EXPECT_EQ(profiler.GetRecentSpans().size(), 2u);
+    profiler.Reset();
+    EXPECT_TRUE(profiler.GetRecentSpans().empty());
+    EXPECT_TRUE(profiler.GetStatistics().empty());
+}
+
+TEST_F(ProfilerTest, RingKeepsTheNewestSpans) {
+    std::thread([] {
+        for (std::size_t i = 0; i < Profiler::RING_CAPACITY + 100; ++i) {
+            EXCEL_PROFILE_SCOPE("ProfilerTest.Flood");
+        }
+    }).join();
+    EXPECT_EQ(profiler.GetRecentSpans().size(), Profiler::RING_CAPACITY);
+    const auto statistics = profiler.GetStatistics();
+    const SpanStatistics* flood = FindSpan(statistics, "ProfilerTest.Flood");
+    ASSERT_NE(flood, nullptr);
+    EXPECT_EQ(flood->count, Profiler::RING_CAPACITY + 100);
+}
+
+TEST_F(ProfilerTest, ExitedThreadsHandTheirBuffersOn) {
+    std::thread(Outer).join();
+    const std::size_t buffers = profiler.GetThreadBufferCount();
+
+    // Short-lived threads one after another reuse one buffer instead of leaking one each
+    for (int i = 0; i < 50; ++i) {
+        std::thread(Outer).join();
+    }
+    EXPECT_EQ(profiler.GetThreadBufferCount(), buffers);
+
+    // What the exited threads recorded is still counted
+    auto statistics = profiler.GetStatistics();
+    const SpanStatistics* outer = FindSpan(statistics, "ProfilerTest.Outer");
+    ASSERT_NE(outer, nullptr);
+    EXPECT_EQ(outer->count, 51u);
+
+    // Threads alive at the same time still get a buffer each
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back(Outer);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_LE(profiler.GetThreadBufferCount(), buffers + 2);
+    statistics = profiler.GetStatistics();
+    outer = FindSpan(statistics, "ProfilerTest.Outer");
+    ASSERT_NE(outer, nullptr);
+    EXPECT_EQ(outer->count, 54u);
+}
@@ -1,23 +1,23 @@
 #include "Logging.h"
 #include "ErrorHandling.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <iostream>
-#include <fstream>
-#include <chrono>
-#include <mutex>
-#include <sstream>
-#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <thread>
 
 namespace CoreEngine {
 namespace Utils {
 
-// Global mutex for thread-safe logging
-std::mutex logMutex;
-
 // Global log level
-LogLevel LOG_LEVEL = LogLevel::INFO;
+std::atomic<LogLevel> LOG_LEVEL{LogLevel::INFO};
 
 // Helper function to convert LogLevel to string
-std::string logLevelToString(LogLevel level) {
+std::string LogLevelToString(LogLevel level) {
     switch (level) {
         case LogLevel::DEBUG: return "DEBUG";
         case LogLevel::INFO: return "INFO";
@@ -27,80 +27,434 @@ std::string logLevelToString(LogLevel level) {
     }
 }
 
-// Helper function to generate timestamp
-std::string generateTimestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time), "%Y-%m-%d %H:%M:%S");
-    return ss.str();
+namespace {
+
+std::int64_t NowSinceEpochNs() noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
 }
 
-void Log(LogLevel level, const std::string& message) {
-    if (level >= LOG_LEVEL) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        
-        std::string timestamp = generateTimestamp();
-        std::string logLevelStr = logLevelToString(level);
-        
-        std::stringstream logStream;
-        logStream << "[" << timestamp << "] [" << logLevelStr << "] " << message;
-        
-        // Write to log file
-        std::ofstream logFile("excel_core_engine.log", std::ios::app);
-        if (logFile.is_open()) {
-            logFile << logStream.str() << std::endl;
-            logFile.close();
-        } else {
-            std::cerr << "Failed to open log file." << std::endl;
-        }
-        
-        // Also print to console for immediate visibility
-        std::cout << logStream.str() << std::endl;
-        
-        // If log level is ERROR, integrate with ErrorHandling
-        if (level == LogLevel::ERROR) {
-            ErrorHandling::ReportError("Logging", message);
+/**
+ * @brief Formats "[YYYY-MM-DD HH:MM:SS.mmm] [LEVEL] " prefixes, reusing the
+ *        date/time text while records stay within the same second.
+ */
+class TimestampFormatter {
+public:
+    void Append(std::string& out, std::int64_t timestampNs, LogLevel level) {
+        const std::int64_t seconds = timestampNs / 1000000000;
+        if (seconds != m_cachedSecond) {
+            std::time_t time = static_cast<std::time_t>(seconds);
+            std::tm local{};
+#if defined(_WIN32)
+            localtime_s(&local, &time);
+#else
+            localtime_r(&time, &local);
+#endif
+            m_cachedLength = std::strftime(m_cached, sizeof(m_cached), "%Y-%m-%d %H:%M:%S", &local);
+            m_cachedSecond = seconds;
+        }
+
+        char millis[8];
+        std::snprintf(millis, sizeof(millis), ".%03d", static_cast<int>((timestampNs / 1000000) % 1000));
+
+        out += '[';
+        out.append(m_cached, m_cachedLength);
+        out += millis;
+        out += "] [";
+        out += LogLevelToString(level);
+        out += "] ";
+    }
+
+private:
+    std::int64_t m_cachedSecond{-1};
+    char m_cached[32]{};
+    std::size_t m_cachedLength{0};
+};
+
+/**
+ * @brief Bounded multi-producer ring of preformatted records drained by one writer thread.
+ *
+ * Producers claim a slot with a CAS on the enqueue position, copy their
+ * message in and publish it through the slot's sequence number (Vyukov's
+ * bounded queue). The writer batches everything available into one buffer
+ * and writes it to a file that stays open for the logger's lifetime.
+ */
+class AsyncLogWriter {
+public:
+    static constexpr std::size_t RECORD_SIZE = 256;
+
+    static AsyncLogWriter& Instance() {
+        // Never destroyed, so logging from other static destructors stays safe;
+        // the atexit hook drains the queue instead.
+        static AsyncLogWriter* instance = [] {
+            auto* writer = new AsyncLogWriter();
+            std::atexit([] { AsyncLogWriter::Instance().Shutdown(); });
+            return writer;
+        }();
+        return *instance;
+    }
+
+    bool Enqueue(LogLevel level, std::string_view message) noexcept {
+        if (!m_running.load(std::memory_order_acquire)) {
+            if (!EnsureStarted()) {
+                WriteDirect(level, message);
+                return true;
+            }
+        }
+
+        // Registering before re-checking m_running pairs with StopWorker,
+        // which clears m_running before waiting for m_producers to reach
+        // zero: either the writer is still running, or StopWorker will drain
+        // this record after the writer has exited.
+        m_producers.fetch_add(1, std::memory_order_seq_cst);
+        if (!m_running.load(std::memory_order_seq_cst)) {
+            m_producers.fetch_sub(1, std::memory_order_release);
+            WriteDirect(level, message);
+            return true;
+        }
+
+        const std::int64_t timestamp = NowSinceEpochNs();
+        std::uint64_t position = m_enqueuePos.load(std::memory_order_relaxed);
+        Record* record = nullptr;
+        for (;;) {
+            record = &m_records[position & m_mask];
+            const std::uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+            const std::int64_t diff = static_cast<std::int64_t>(sequence) - static_cast<std::int64_t>(position);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                // Queue full.
+                if (m_policy.load(std::memory_order_relaxed) == LogOverflowPolicy::DropNewest) {
+                    m_producers.fetch_sub(1, std::memory_order_release);
+                    m_dropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                if (!m_running.load(std::memory_order_acquire)) {
+                    // The writer has stopped and will not make room.
+                    m_producers.fetch_sub(1, std::memory_order_release);
+                    WriteDirect(level, message);
+                    return true;
+                }
+                WakeWriter();
+                std::this_thread::yield();
+                position = m_enqueuePos.load(std::memory_order_relaxed);
+            } else {
+                position = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        const std::size_t length = std::min(message.size(), MAX_MESSAGE_LENGTH);
+        std::memcpy(record->text, message.data(), length);
+        record->timestampNs = timestamp;
+        record->length = static_cast<std::uint16_t>(length);
+        record->level = static_cast<std::uint8_t>(level);
+        record->sequence.store(position + 1, std::memory_order_release);
+        m_producers.fetch_sub(1, std::memory_order_release);
+
+        // The writer polls on flushInterval. Wake it early only for errors and
+        // each time another half of the ring has been claimed, so the
+        // common path never makes a system call.
+        if (level == LogLevel::ERROR || (position & (m_mask >> 1)) == 0) {
+            WakeWriter();
+        }
+        return true;
+    }
+
+    void Configure(const AsyncLogConfig& config) {
+        std::lock_guard<std::mutex> control(m_controlMutex);
+        StopWorker();
+        m_config = config;
+        m_policy.store(config.overflowPolicy, std::memory_order_relaxed);
+        if (!m_records) {
+            Allocate(config.queueCapacity);
+        }
+        OpenFile();
+        StartWorker();
+    }
+
+    void Flush() {
+        const std::uint64_t target = m_enqueuePos.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(m_wakeMutex);
+        while (m_running.load(std::memory_order_acquire) &&
+               m_consumed.load(std::memory_order_acquire) < target) {
+            m_wake.notify_one();
+            m_drained.wait_for(lock, std::chrono::milliseconds(10));
+        }
+    }
+
+    void Shutdown() {
+        std::lock_guard<std::mutex> control(m_controlMutex);
+        StopWorker();
+        m_shutDown = true;
+    }
+
+    std::uint64_t DroppedCount() const noexcept {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::size_t MAX_MESSAGE_LENGTH = RECORD_SIZE - 24;
+
+    struct Record {
+        std::atomic<std::uint64_t> sequence;
+        std::int64_t timestampNs;
+        std::uint16_t length;
+        std::uint8_t level;
+        char text[MAX_MESSAGE_LENGTH];
+    };
+    static_assert(sizeof(Record) <= RECORD_SIZE, "log record must fit in RECORD_SIZE bytes");
+
+    AsyncLogWriter() = default;
+
+    bool EnsureStarted() noexcept {
+        try {
+            std::lock_guard<std::mutex> control(m_controlMutex);
+            if (m_running.load(std::memory_order_acquire)) {
+                return true;
+            }
+            if (m_shutDown) {
+                return false;
+            }
+            if (!m_records) {
+                Allocate(m_config.queueCapacity);
+            }
+            OpenFile();
+            StartWorker();
+            return true;
+        } catch (...) {
+            return false;
         }
     }
+
+    void Allocate(std::size_t capacity) {
+        std::size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        m_records.reset(new Record[rounded]);
+        for (std::size_t i = 0; i < rounded; ++i) {
+            m_records[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_mask = rounded - 1;
+    }
+
+    void OpenFile() {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        if (m_file != nullptr) {
+            std::fclose(m_file);
+        }
+        m_file = std::fopen(m_config.filePath.c_str(), "a");
+        if (m_file == nullptr) {
+            std::cerr << "Failed to open log file: " << m_config.filePath << std::endl;
+        }
+    }
+
+    void StartWorker() {
+        m_running.store(true, std::memory_order_release);
+        m_worker = std::thread([this] { WorkerLoop(); });
+    }
+
+    void StopWorker() {
+        if (!m_worker.joinable()) {
+            return;
+        }
+        m_running.store(false, std::memory_order_seq_cst);
+        WakeWriter();
+        m_worker.join();
+
+        // Producers that saw the writer running may still be filling a slot;
+        // wait for them and write what the writer did not get to.
+        while (m_producers.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+        std::string batch;
+        TimestampFormatter formatter;
+        while (Drain(batch, formatter)) {
+        }
+        if (!batch.empty()) {
+            WriteBatch(batch);
+        }
+        m_consumed.store(m_dequeuePos, std::memory_order_release);
+        m_drained.notify_all();
+    }
+
+    void WakeWriter() {
+        m_wake.notify_one();
+    }
+
+    void WorkerLoop() {
+        std::string batch;
+        batch.reserve(64 * 1024);
+        std::uint64_t reportedDrops = m_dropped.load(std::memory_order_relaxed);
+
+        for (;;) {
+            const bool drained = Drain(batch, m_formatter);
+
+            const std::uint64_t dropped = m_dropped.load(std::memory_order_relaxed);
+            if (dropped != reportedDrops) {
+                m_formatter.Append(batch, NowSinceEpochNs(), LogLevel::WARNING);
+                batch += std::to_string(dropped - reportedDrops);
+                batch += " log messages dropped: queue full\n";
+                reportedDrops = dropped;
+            }
+
+            if (!batch.empty()) {
+                WriteBatch(batch);
+                batch.clear();
+            }
+            m_consumed.store(m_dequeuePos, std::memory_order_release);
+            m_drained.notify_all();
+
+            if (drained) {
+                continue;
+            }
+            if (!m_running.load(std::memory_order_acquire)) {
+                break;
+            }
+
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            if (!HasPending() && m_running.load(std::memory_order_acquire)) {
+                m_wake.wait_for(lock, m_config.flushInterval);
+            }
+        }
+    }
+
+    bool HasPending() const noexcept {
+        const Record& record = m_records[m_dequeuePos & m_mask];
+        return record.sequence.load(std::memory_order_acquire) == m_dequeuePos + 1;
+    }
+
+    // Formats up to one queue's worth of records; returns true if any were read.
+    bool Drain(std::string& batch, TimestampFormatter& formatter) {
+        std::size_t count = 0;
+        while (count <= m_mask && HasPending()) {
+            Record& record = m_records[m_dequeuePos & m_mask];
+            formatter.Append(batch, record.timestampNs, static_cast<LogLevel>(record.level));
+            batch.append(record.text, record.length);
+            batch += '\n';
+            record.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+            ++m_dequeuePos;
+            ++count;
+        }
+        return count > 0;
+    }
+
+    void WriteBatch(const std::string& batch) {
+        std::lock_guard<std::mutex> lock(m_fileMutex);
+        if (m_file != nullptr) {
+            std::fwrite(batch.data(), 1, batch.size(), m_file);
+            std::fflush(m_file);
+        }
+        if (m_config.echoToConsole) {
+            std::cout.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+            std::cout.flush();
+        }
+    }
+
+    // Used when the writer thread is stopping or gone.
+    void WriteDirect(LogLevel level, std::string_view message) noexcept {
+        try {
+            std::string line;
+            TimestampFormatter formatter;
+            formatter.Append(line, NowSinceEpochNs(), level);
+            std::lock_guard<std::mutex> lock(m_fileMutex);
+            line.append(message.data(), message.size());
+            line += '\n';
+            if (m_file != nullptr) {
+                std::fwrite(line.data(), 1, line.size(), m_file);
+                std::fflush(m_file);
+            } else {
+                std::cerr << line;
+            }
+        } catch (...) {
+        }
+    }
+
+    std::unique_ptr<Record[]> m_records;
+    std::size_t m_mask{0};
+    alignas(64) std::atomic<std::uint64_t> m_enqueuePos{0};
+    alignas(64) std::uint64_t m_dequeuePos{0}; ///< Writer thread, or StopWorker once it has joined.
+    std::atomic<std::uint64_t> m_consumed{0};  ///< Records written so far, for Flush.
+    std::atomic<std::uint64_t> m_dropped{0};
+    std::atomic<std::uint32_t> m_producers{0}; ///< Enqueue calls between their m_running check and publishing.
+    std::atomic<bool> m_running{false};
+    std::atomic<LogOverflowPolicy> m_policy{LogOverflowPolicy::DropNewest};
+
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_drained;
+
+    std::mutex m_controlMutex; ///< Serialises Configure, start-up and Shutdown.
+    AsyncLogConfig m_config;
+    bool m_shutDown{false};
+    std::thread m_worker;
+
+    std::mutex m_fileMutex;
+    std::FILE* m_file{nullptr};
+    TimestampFormatter m_formatter; ///< Writer thread only.
+};
+
+} // namespace
+
+void Log(LogLevel level, std::string_view message) {
+    if (!IsLogEnabled(level)) {
+        return;
+    }
+    AsyncLogWriter::Instance().Enqueue(level, message);
+}
+
+void ConfigureLogging(const AsyncLogConfig& config) {
+    AsyncLogWriter::Instance().Configure(config);
+}
+
+void FlushLog() {
+    AsyncLogWriter::Instance().Flush();
+}
+
+void ShutdownLogging() {
+    AsyncLogWriter::Instance().Shutdown();
+}
+
+std::uint64_t GetDroppedLogCount() {
+    return AsyncLogWriter::Instance().DroppedCount();
 }
 
 void SetLogLevel(LogLevel level) {
-    std::lock_guard<std::mutex> lock(logMutex);
-    LOG_LEVEL = level;
-    Log(LogLevel::INFO, "Log level set to: " + logLevelToString(level));
+    LOG_LEVEL.store(level, std::memory_order_relaxed);
+    Log(LogLevel::INFO, "Log level set to: " + LogLevelToString(level));
 }
 
 void LogPerformanceMetric(const std::string& metricName, double value) {
-    std::stringstream ss;
-    ss << "Performance Metric - " << metricName << ": " << value;
-    Log(LogLevel::INFO, ss.str());
+    if (!IsLogEnabled(LogLevel::INFO)) {
+        return;
+    }
+    Log(LogLevel::INFO, "Performance Metric - " + metricName + ": " + std::to_string(value));
 }
 
-Logger::Logger(const std::string& logFilePath) : logFile(logFilePath, std::ios::app), currentLogLevel(LogLevel::INFO) {
+Logger::Logger(const std::string& logFilePath) : currentLogLevel(LogLevel::INFO), logFile(logFilePath, std::ios::app) {
     if (!logFile.is_open()) {
         throw std::runtime_error("Failed to open log file: " + logFilePath);
     }
     Log(LogLevel::INFO, "Logger initialized with file: " + logFilePath);
 }
 
+Logger::~Logger() = default;
+
 void Logger::LogMessage(LogLevel level, const std::string& message) {
     if (level >= currentLogLevel) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        
-        std::string timestamp = generateTimestamp();
-        std::string logLevelStr = logLevelToString(level);
-        
-        std::stringstream logStream;
-        logStream << "[" << timestamp << "] [" << logLevelStr << "] " << message;
-        
-        logFile << logStream.str() << std::endl;
+        std::string line;
+        TimestampFormatter formatter;
+        formatter.Append(line, NowSinceEpochNs(), level);
+        line += message;
+        line += '\n';
+
+        std::lock_guard<std::mutex> lock(fileMutex);
+        logFile << line;
         logFile.flush();
-        
-        // Also print to console for immediate visibility
-        std::cout << logStream.str() << std::endl;
     }
 }
 
 } // namespace Utils
-} // namespace CoreEngine
\ No newline at end of file
+} // namespace CoreEngine
@@ -1,11 +1,22 @@
 #ifndef CORE_ENGINE_UTILS_LOGGING_H
 #define CORE_ENGINE_UTILS_LOGGING_H
 
-#include <string>
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include "ErrorHandling.h" // Assuming this file will be created later
 
+// Messages below this level (0 = DEBUG ... 3 = ERROR) are compiled out of
+// EXCEL_LOG call sites entirely.
+#ifndef EXCEL_LOG_MIN_LEVEL
+#define EXCEL_LOG_MIN_LEVEL 0
+#endif
+
 namespace CoreEngine {
 namespace Utils {
 
@@ -18,7 +29,26 @@ enum class LogLevel {
 };
 
 // Global log level variable
-extern LogLevel LOG_LEVEL;
+extern std::atomic<LogLevel> LOG_LEVEL;
+
+/**
+ * @brief What a producer does when the log queue is full.
+ */
+enum class LogOverflowPolicy {
+    DropNewest, ///< Discard the new record and count it; never blocks the caller.
+    Block       ///< Wait for the writer thread to make room; never loses records.
+};
+
+/**
+ * @brief Settings for the asynchronous log writer.
+ */
+struct AsyncLogConfig {
+    std::string filePath = "excel_core_engine.log";
+    std::size_t queueCapacity = 8192; ///< Records; rounded up to a power of two. Fixed once logging starts.
+    LogOverflowPolicy overflowPolicy = LogOverflowPolicy::DropNewest;
+    bool echoToConsole = false;
+    std::chrono::milliseconds flushInterval{50}; ///< Longest time a record waits before it is written.
+};
 
 class Logger {
 public:
@@ -30,10 +60,49 @@ public:
 private:
     LogLevel currentLogLevel;
     std::ofstream logFile;
+    std::mutex fileMutex;
 };
 
+/**
+ * @brief Returns true if a message at this level would be logged.
+ *
+ * Folds to false at compile time for levels below EXCEL_LOG_MIN_LEVEL.
+ */
+inline bool IsLogEnabled(LogLevel level) noexcept {
+    return static_cast<int>(level) >= EXCEL_LOG_MIN_LEVEL &&
+           level >= LOG_LEVEL.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Queues a message for the background writer.
+ *
+ * The caller copies the message into a fixed-size record of a lock-free
+ * ring and returns; timestamp formatting and file I/O happen on the writer
+ * thread. Messages longer than a record are truncated.
+ */
+void Log(LogLevel level, std::string_view message);
+
+/**
+ * @brief Applies writer settings. The file is reopened and the writer restarted.
+ */
+void ConfigureLogging(const AsyncLogConfig& config);
+
+/**
+ * @brief Blocks until every message logged before the call has been written.
+ */
+void FlushLog();
+
+/**
+ * @brief Drains the queue and stops the writer thread. Later messages are written synchronously.
+ */
+void ShutdownLogging();
+
+/**
+ * @brief Number of messages discarded under LogOverflowPolicy::DropNewest.
+ */
+std::uint64_t GetDroppedLogCount();
+
 // Function declarations
-void Log(LogLevel level, const std::string& message);
 void SetLogLevel(LogLevel level);
 void LogPerformanceMetric(const std::string& metricName, double value);
 
@@ -43,4 +112,14 @@ std::string LogLevelToString(LogLevel level);
 } // namespace Utils
 } // namespace CoreEngine
 
-#endif // CORE_ENGINE_UTILS_LOGGING_H
\ No newline at end of file
+// Logs through CoreEngine::Utils::Log, skipping evaluation of the message
+// when the level is filtered at compile time or run time:
+//     EXCEL_LOG(DEBUG, "Cell updated: " + reference);
+#define EXCEL_LOG(level, message)                                                      \
+    do {                                                                               \
+        if (::CoreEngine::Utils::IsLogEnabled(::CoreEngine::Utils::LogLevel::level)) { \
+            ::CoreEngine::Utils::Log(::CoreEngine::Utils::LogLevel::level, (message)); \
+        }                                                                              \
+    } while (0)
+
+#endif // CORE_ENGINE_UTILS_LOGGING_H
@@ -0,0 +1,77 @@
+#include "ColumnarTableBuilder.h"
+#include <utility>
+
+namespace Microsoft::Excel::DataAnalysisEngine {
+
+ColumnarTableBuilder::ColumnarTableBuilder(const ParseLocale& locale, std::size_t sampleRows)
+    : m_locale(locale), m_sampleRows(sampleRows == 0 ? 1 : sampleRows) {}
+
+void ColumnarTableBuilder::BeginTable(const std::vector<std::string>& columnNames) {
+    m_columnNames = columnNames;
+    m_columns.clear();
+    m_rowCount = 0;
+    m_typesInferred = false;
+    m_sampleBuffer.assign(columnNames.size(), {});
+    for (auto& column : m_sampleBuffer) {
+        column.reserve(m_sampleRows);
+    }
+}
+
+void ColumnarTableBuilder::AppendRow(const std::vector<std::string_view>& fields) {
+    const std::size_t columnCount = m_columnNames.size();
+
+    if (!m_typesInferred) {
+        for (std::size_t col = 0; col < columnCount; ++col) {
+            m_sampleBuffer[col].emplace_back(col < fields.size() ? fields[col] : std::string_view());
+        }
+        ++m_rowCount;
+        if (m_rowCount == m_sampleRows) {
+            InferTypesAndFlush();
+        }
+        return;
+    }
+
+    // Missing trailing fields become nulls; fields beyond the header are ignored.
+    for (std::size_t col = 0; col < columnCount; ++col) {
+        if (col < fields.size()) {
+            m_columns[col].AppendRaw(fields[col], m_locale);
+        } else {
+            m_columns[col].AppendNull();
+        }
+    }
+    ++m_rowCount;
+}
+
+void ColumnarTableBuilder::EndTable() {
+    if (!m_typesInferred) {
+        InferTypesAndFlush();
+    }
+}
+
+std::vector<TypedColumn> ColumnarTableBuilder::TakeColumns() {
+    std::vector<TypedColumn> columns = std::move(m_columns);
+    m_columns.clear();
+    return columns;
+}
+
+void ColumnarTableBuilder::InferTypesAndFlush() {
+    m_columns.clear();
+    m_columns.reserve(m_columnNames.size());
+
+    std::vector<std::string_view> sample;
+    for (std::size_t col = 0; col < m_columnNames.size(); ++col) {
+        const auto& buffered = m_sampleBuffer[col];
+        sample.assign(buffered.begin(), buffered.end());
+
+        m_columns.emplace_back(m_columnNames[col], ColumnTypeInference::InferType(sample, m_locale));
+        for (const auto& raw : buffered) {
+            m_columns.back().AppendRaw(raw, m_locale);
+        }
+    }
+
+    m_sampleBuffer.clear();
+    m_sampleBuffer.shrink_to_fit();
+    m_typesInferred = true;
+}
+
+} // namespace Microsoft::Excel::DataAnalysisEngine
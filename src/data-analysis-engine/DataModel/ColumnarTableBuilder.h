@@ -0,0 +1,68 @@
+#ifndef COLUMNAR_TABLE_BUILDER_H
+#define COLUMNAR_TABLE_BUILDER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../core-engine/FileIO/ColumnSink.h"
+#include "../Utils/ValueParser.h"
+#include "TypedColumn.h"
+
+namespace Microsoft::Excel::DataAnalysisEngine {
+
+/**
+ * @class ColumnarTableBuilder
+ * @brief Column sink that converts streamed records straight into typed columns.
+ *
+ * The first sampleRows records are buffered to infer each column's type;
+ * after that, every field is parsed directly into its TypedColumn and no
+ * row-oriented copy of the data is kept.
+ */
+class ColumnarTableBuilder : public CoreEngine::FileIO::IColumnSink {
+public:
+    /**
+     * @brief Constructs a builder.
+     * @param locale The locale used to interpret numbers and dates.
+     * @param sampleRows The number of leading records used for type inference.
+     */
+    explicit ColumnarTableBuilder(const ParseLocale& locale,
+                                  std::size_t sampleRows = ColumnTypeInference::DEFAULT_SAMPLE_SIZE);
+
+    void BeginTable(const std::vector<std::string>& columnNames) override;
+    void AppendRow(const std::vector<std::string_view>& fields) override;
+    void EndTable() override;
+
+    /**
+     * @brief Returns the built columns, leaving the builder empty.
+     */
+    std::vector<TypedColumn> TakeColumns();
+
+    /**
+     * @brief Returns the column names received in BeginTable.
+     */
+    const std::vector<std::string>& GetColumnNames() const { return m_columnNames; }
+
+    /**
+     * @brief Returns the number of records appended so far.
+     */
+    std::size_t RowCount() const { return m_rowCount; }
+
+private:
+    ParseLocale m_locale;
+    std::size_t m_sampleRows;
+    std::size_t m_rowCount = 0;
+    bool m_typesInferred = false;
+    std::vector<std::string> m_columnNames;
+    std::vector<TypedColumn> m_columns;
+    std::vector<std::vector<std::string>> m_sampleBuffer; ///< Column-major buffered sample.
+
+    /**
+     * @brief Infers column types from the buffered sample and flushes it into typed columns.
+     */
+    void InferTypesAndFlush();
+};
+
+} // namespace Microsoft::Excel::DataAnalysisEngine
+
+#endif // COLUMNAR_TABLE_BUILDER_H
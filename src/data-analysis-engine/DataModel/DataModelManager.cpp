@@ -1,7 +1,10 @@
 #include "DataModelManager.h"
 #include "../Utils/DataAnalysisUtils.h"
+#include "ColumnarTableBuilder.h"
+#include "../../core-engine/FileIO/FileReader.h"
 #include <algorithm>
 #include <stdexcept>
+#include <string_view>
 
 DataModelManager::DataModelManager() {}
 
@@ -14,12 +17,73 @@ void DataModelManager::LoadData(const std::vector<std::vector<std::string>>& dat
         throw std::invalid_argument("Number of columns in data does not match the number of column names");
     }
 
-    m_data = data;
+    for (const auto& row : data) {
+        if (row.size() != columnNames.size()) {
+            throw std::invalid_argument("Number of columns in data does not match the number of column names");
+        }
+    }
+
+    // Infer column types once on load so that analysis never reparses numeric text.
+    // The rows are read in place; like LoadColumns, only the typed columns are kept.
+    std::vector<TypedColumn> columns;
+    columns.reserve(columnNames.size());
+    for (size_t col = 0; col < columnNames.size(); ++col) {
+        columns.push_back(BuildTypedColumn(columnNames[col], data.size(),
+            [&data, col](size_t row) { return std::string_view(data[row][col]); }));
+    }
+    LoadColumns(columnNames, std::move(columns));
+}
+
+std::size_t DataModelManager::ImportColumnar(const std::string& filePath, const CoreEngine::FileIO::ColumnarImportOptions& options) {
+    ColumnarTableBuilder builder(m_parseLocale);
+    CoreEngine::FileIO::FileReader reader;
+    reader.ImportColumns(filePath, builder, options);
+
+    LoadColumns(builder.GetColumnNames(), builder.TakeColumns());
+    return RowCount();
+}
+
+void DataModelManager::LoadColumns(const std::vector<std::string>& columnNames, std::vector<TypedColumn> columns) {
+    if (columnNames.empty() || columnNames.size() != columns.size()) {
+        throw std::invalid_argument("Number of columns does not match the number of column names");
+    }
+
     m_columnNames = columnNames;
+    m_typedColumns = std::move(columns);
 }
 
-const std::vector<std::vector<std::string>>& DataModelManager::GetData() const {
-    return m_data;
+std::size_t DataModelManager::RowCount() const {
+    return m_typedColumns.empty() ? 0 : m_typedColumns.front().Size();
+}
+
+std::string DataModelManager::GetCellText(std::size_t row, std::size_t col) const {
+    return m_typedColumns[col].ToString(row);
+}
+
+template <typename RawAccessor>
+TypedColumn DataModelManager::BuildTypedColumn(const std::string& columnName, std::size_t rowCount, RawAccessor rawValue) const {
+    std::vector<std::string_view> sample;
+    for (size_t row : ColumnTypeInference::SampleRows(rowCount)) {
+        sample.push_back(rawValue(row));
+    }
+
+    TypedColumn column(columnName, ColumnTypeInference::InferType(sample, m_parseLocale));
+    column.Reserve(rowCount);
+    for (size_t row = 0; row < rowCount; ++row) {
+        column.AppendRaw(rawValue(row), m_parseLocale);
+    }
+    return column;
+}
+
+std::vector<std::vector<std::string>> DataModelManager::GetData() const {
+    std::vector<std::vector<std::string>> data(RowCount());
+    for (size_t row = 0; row < data.size(); ++row) {
+        data[row].reserve(m_typedColumns.size());
+        for (size_t col = 0; col < m_typedColumns.size(); ++col) {
+            data[row].push_back(GetCellText(row, col));
+        }
+    }
+    return data;
 }
 
 const std::vector<std::string>& DataModelManager::GetColumnNames() const {
@@ -27,14 +91,13 @@ const std::vector<std::string>& DataModelManager::GetColumnNames() const {
 }
 
 void DataModelManager::AddColumn(const std::string& columnName, const std::vector<std::string>& columnData) {
-    if (columnData.size() != m_data.size()) {
+    if (columnData.size() != RowCount()) {
         throw std::invalid_argument("Column data size does not match existing data size");
     }
 
     m_columnNames.push_back(columnName);
-    for (size_t i = 0; i < m_data.size(); ++i) {
-        m_data[i].push_back(columnData[i]);
-    }
+    m_typedColumns.push_back(BuildTypedColumn(columnName, columnData.size(),
+        [&columnData](size_t row) { return std::string_view(columnData[row]); }));
 }
 
 void DataModelManager::RemoveColumn(const std::string& columnName) {
@@ -45,10 +108,7 @@ void DataModelManager::RemoveColumn(const std::string& columnName) {
 
     int index = std::distance(m_columnNames.begin(), it);
     m_columnNames.erase(it);
-
-    for (auto& row : m_data) {
-        row.erase(row.begin() + index);
-    }
+    m_typedColumns.erase(m_typedColumns.begin() + index);
 }
 
 int DataModelManager::GetColumnIndex(const std::string& columnName) const {
@@ -65,34 +125,51 @@ std::vector<std::string> DataModelManager::GetColumnData(const std::string& colu
         throw std::invalid_argument("Column not found");
     }
 
+    const TypedColumn& column = m_typedColumns[index];
     std::vector<std::string> columnData;
-    for (const auto& row : m_data) {
-        columnData.push_back(row[index]);
+    columnData.reserve(column.Size());
+    for (size_t row = 0; row < column.Size(); ++row) {
+        columnData.push_back(column.ToString(row));
     }
     return columnData;
 }
 
 void DataModelManager::UpdateCell(int row, int col, const std::string& value) {
-    if (row < 0 || row >= static_cast<int>(m_data.size()) || col < 0 || col >= static_cast<int>(m_columnNames.size())) {
+    if (row < 0 || row >= static_cast<int>(RowCount()) || col < 0 || col >= static_cast<int>(m_columnNames.size())) {
         throw std::out_of_range("Invalid row or column index");
     }
 
-    m_data[row][col] = value;
+    m_typedColumns[col].SetRaw(static_cast<size_t>(row), value, m_parseLocale);
+}
+
+void DataModelManager::SetParseLocale(const ParseLocale& locale) {
+    m_parseLocale = locale;
+}
+
+ColumnDataType DataModelManager::GetColumnType(const std::string& columnName) const {
+    return GetTypedColumn(columnName).GetType();
+}
+
+const TypedColumn& DataModelManager::GetTypedColumn(const std::string& columnName) const {
+    int index = GetColumnIndex(columnName);
+    if (index == -1) {
+        throw std::invalid_argument("Column not found");
+    }
+    return m_typedColumns[index];
 }
 
 // Additional helper functions
 
 bool DataModelManager::IsNumericColumn(const std::string& columnName) const {
-    std::vector<std::string> columnData = GetColumnData(columnName);
-    return DataAnalysisUtils::IsNumericVector(columnData);
+    return GetTypedColumn(columnName).IsNumeric();
 }
 
 std::vector<double> DataModelManager::GetNumericColumnData(const std::string& columnName) const {
-    std::vector<std::string> columnData = GetColumnData(columnName);
-    if (!DataAnalysisUtils::IsNumericVector(columnData)) {
+    const TypedColumn& column = GetTypedColumn(columnName);
+    if (!column.IsNumeric()) {
         throw std::invalid_argument("Column is not numeric");
     }
-    return DataAnalysisUtils::ConvertToNumeric(columnData);
+    return column.GetNumericValues();
 }
 
 void DataModelManager::SortByColumn(const std::string& columnName, bool ascending) {
@@ -101,10 +178,37 @@ void DataModelManager::SortByColumn(const std::string& columnName, bool ascendin
         throw std::invalid_argument("Column not found");
     }
 
-    std::sort(m_data.begin(), m_data.end(),
-        [index, ascending](const std::vector<std::string>& a, const std::vector<std::string>& b) {
-            return ascending ? a[index] < b[index] : a[index] > b[index];
+    // Sort a row permutation so typed columns compare by value and are
+    // reordered without reparsing.
+    const TypedColumn& key = m_typedColumns[index];
+    std::vector<size_t> order(RowCount());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    if (key.IsNumeric()) {
+        std::stable_sort(order.begin(), order.end(), [&key, ascending](size_t a, size_t b) {
+            bool aNull = key.IsNull(a);
+            bool bNull = key.IsNull(b);
+            if (aNull || bNull) {
+                return !aNull && bNull;
+            }
+            return ascending ? key.GetValue(a) < key.GetValue(b) : key.GetValue(a) > key.GetValue(b);
+        });
+    } else {
+        std::vector<std::string> keys;
+        keys.reserve(order.size());
+        for (size_t row = 0; row < order.size(); ++row) {
+            keys.push_back(GetCellText(row, index));
+        }
+        std::stable_sort(order.begin(), order.end(), [&keys, ascending](size_t a, size_t b) {
+            return ascending ? keys[a] < keys[b] : keys[a] > keys[b];
         });
+    }
+
+    for (auto& column : m_typedColumns) {
+        column = column.Reordered(order);
+    }
 }
 
 std::vector<std::vector<std::string>> DataModelManager::FilterData(
@@ -116,10 +220,16 @@ std::vector<std::vector<std::string>> DataModelManager::FilterData(
     }
 
     std::vector<std::vector<std::string>> filteredData;
-    for (const auto& row : m_data) {
-        if (predicate(row[index])) {
-            filteredData.push_back(row);
+    for (size_t row = 0; row < RowCount(); ++row) {
+        if (!predicate(GetCellText(row, index))) {
+            continue;
+        }
+        std::vector<std::string> values;
+        values.reserve(m_typedColumns.size());
+        for (size_t col = 0; col < m_typedColumns.size(); ++col) {
+            values.push_back(GetCellText(row, col));
         }
+        filteredData.push_back(std::move(values));
     }
     return filteredData;
 }
\ No newline at end of file
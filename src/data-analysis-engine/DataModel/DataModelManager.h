@@ -6,6 +6,9 @@
 #include <map>
 #include "../Interfaces/IDataAnalysisEngine.h"
 #include "../Utils/DataAnalysisUtils.h"
+#include "../Utils/ValueParser.h"
+#include "TypedColumn.h"
+#include "../../core-engine/FileIO/ColumnSink.h"
 
 namespace Microsoft::Excel::DataAnalysisEngine {
 
@@ -26,16 +29,47 @@ public:
 
     /**
      * @brief Loads data into the data model.
+     *
+     * Each column's type is inferred and its values converted to typed
+     * storage. Source text is kept only for values whose formatted form would
+     * differ from it, so GetData returns the text that was loaded.
+     *
      * @param data The data to be loaded into the model.
      * @param columnNames The names of the columns in the data.
      */
     void LoadData(const std::vector<std::vector<std::string>>& data, const std::vector<std::string>& columnNames);
 
     /**
-     * @brief Retrieves the current data model.
-     * @return A const reference to the current data model.
+     * @brief Imports a file straight into typed columns, bypassing the worksheet cell grid.
+     *
+     * Records are streamed from FileReader into a ColumnarTableBuilder; no
+     * row-oriented string copy is made at any point.
+     *
+     * @param filePath The path of the file to import.
+     * @param options Delimiter and header settings.
+     * @return The number of imported rows.
      */
-    const std::vector<std::vector<std::string>>& GetData() const;
+    std::size_t ImportColumnar(const std::string& filePath,
+                               const CoreEngine::FileIO::ColumnarImportOptions& options = CoreEngine::FileIO::ColumnarImportOptions());
+
+    /**
+     * @brief Replaces the data model with prebuilt typed columns.
+     * @param columnNames The names of the columns.
+     * @param columns The typed columns, all of the same length.
+     */
+    void LoadColumns(const std::vector<std::string>& columnNames, std::vector<TypedColumn> columns);
+
+    /**
+     * @brief Retrieves the number of rows in the data model.
+     * @return The row count.
+     */
+    std::size_t RowCount() const;
+
+    /**
+     * @brief Retrieves the current data model as rows of text.
+     * @return A row-oriented copy built from the typed columns on each call.
+     */
+    std::vector<std::vector<std::string>> GetData() const;
 
     /**
      * @brief Retrieves the column names of the data model.
@@ -78,9 +112,59 @@ public:
      */
     void UpdateCell(int row, int col, const std::string& value);
 
+    /**
+     * @brief Sets the locale used to interpret numbers and dates on load.
+     * @param locale The locale settings.
+     */
+    void SetParseLocale(const ParseLocale& locale);
+
+    /**
+     * @brief Retrieves the inferred storage type of a column.
+     * @param columnName The name of the column.
+     * @return The column's inferred type.
+     */
+    ColumnDataType GetColumnType(const std::string& columnName) const;
+
+    /**
+     * @brief Retrieves the typed, columnar storage of a column.
+     * @param columnName The name of the column.
+     * @return A const reference to the typed column.
+     */
+    const TypedColumn& GetTypedColumn(const std::string& columnName) const;
+
+    /**
+     * @brief Checks whether every non-empty value of a column is numeric.
+     * @param columnName The name of the column.
+     * @return True if the column holds only typed values.
+     */
+    bool IsNumericColumn(const std::string& columnName) const;
+
+    /**
+     * @brief Retrieves the numeric values of a column without reparsing text.
+     * @param columnName The name of the column.
+     * @return The column's typed values.
+     */
+    std::vector<double> GetNumericColumnData(const std::string& columnName) const;
+
 private:
-    std::vector<std::vector<std::string>> m_dataModel; ///< The main data storage for the model.
     std::vector<std::string> m_columnNames; ///< The names of the columns in the data model.
+    std::vector<TypedColumn> m_typedColumns; ///< The model's data, one typed column per name.
+    ParseLocale m_parseLocale; ///< Locale used to interpret imported text.
+
+    /**
+     * @brief Retrieves the text of a cell from its typed column.
+     */
+    std::string GetCellText(std::size_t row, std::size_t col) const;
+
+    /**
+     * @brief Infers the type of a column from a sample and converts it to typed storage.
+     * @param columnName The name of the column.
+     * @param rowCount The number of rows in the column.
+     * @param rawValue Accessor returning the raw text of a row.
+     * @return The typed column.
+     */
+    template <typename RawAccessor>
+    TypedColumn BuildTypedColumn(const std::string& columnName, std::size_t rowCount, RawAccessor rawValue) const;
 
     /**
      * @brief Validates the input data before loading it into the model.
@@ -0,0 +1,326 @@
+#include "TypedColumn.h"
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace Microsoft::Excel::DataAnalysisEngine {
+
+namespace {
+
+/// Formats a number with 15 significant digits, the precision Excel displays.
+std::string_view FormatNumber(double value, char (&buffer)[32]) {
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::general, 15);
+    return std::string_view(buffer, static_cast<std::size_t>(result.ptr - buffer));
+}
+
+} // namespace
+
+TypedColumn::TypedColumn(std::string name, ColumnDataType type)
+    : m_name(std::move(name)), m_type(type) {}
+
+void TypedColumn::Reserve(std::size_t rows) {
+    m_segments.reserve((rows + SEGMENT_ROWS - 1) / SEGMENT_ROWS);
+    if (m_type == ColumnDataType::Text) {
+        m_text.reserve(rows);
+    }
+}
+
+ColumnSegment& TypedColumn::SegmentForAppend() {
+    if (m_segments.empty() || m_segments.back().states.size() == SEGMENT_ROWS) {
+        m_segments.emplace_back();
+        ColumnSegment& segment = m_segments.back();
+        segment.states.reserve(SEGMENT_ROWS);
+        if (m_type != ColumnDataType::Text) {
+            segment.values.reserve(SEGMENT_ROWS);
+        }
+    }
+    return m_segments.back();
+}
+
+bool TypedColumn::TryParseTyped(std::string_view raw, const ParseLocale& locale, double& value) const {
+    switch (m_type) {
+        case ColumnDataType::Number:
+            return ValueParser::TryParseNumber(raw, locale, value);
+        case ColumnDataType::Date:
+            return ValueParser::TryParseDate(raw, locale, value) ||
+                   ValueParser::TryParseNumber(raw, locale, value);
+        case ColumnDataType::Boolean: {
+            bool flag = false;
+            if (!ValueParser::TryParseBoolean(raw, flag)) {
+                return false;
+            }
+            value = flag ? 1.0 : 0.0;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool TypedColumn::RoundTrips(std::string_view raw, double value) const {
+    if (m_type == ColumnDataType::Boolean) {
+        return raw == (value != 0.0 ? "TRUE" : "FALSE");
+    }
+    char buffer[32];
+    return raw == FormatNumber(value, buffer);
+}
+
+void TypedColumn::SetSourceText(std::size_t row, std::string_view raw, double value) {
+    if (RoundTrips(raw, value)) {
+        m_sourceText.erase(row);
+    } else {
+        m_sourceText[row] = std::string(raw);
+    }
+}
+
+void TypedColumn::AppendRaw(std::string_view raw, const ParseLocale& locale) {
+    if (ValueParser::Trim(raw).empty()) {
+        AppendNull();
+        return;
+    }
+    if (m_type == ColumnDataType::Text) {
+        AppendText(raw);
+        return;
+    }
+    double value = 0.0;
+    if (TryParseTyped(raw, locale, value)) {
+        AppendValue(value);
+        SetSourceText(m_size - 1, raw, value);
+    } else {
+        AppendText(raw);
+    }
+}
+
+void TypedColumn::AppendNull() {
+    ColumnSegment& segment = SegmentForAppend();
+    segment.states.push_back(CellState::Null);
+    if (m_type == ColumnDataType::Text) {
+        m_text.emplace_back();
+    } else {
+        segment.values.push_back(0.0);
+    }
+    ++m_size;
+}
+
+void TypedColumn::AppendValue(double value) {
+    if (m_type == ColumnDataType::Text) {
+        throw std::logic_error("Cannot append a typed value to a text column");
+    }
+    ColumnSegment& segment = SegmentForAppend();
+    segment.states.push_back(CellState::Value);
+    segment.values.push_back(value);
+    ++m_size;
+}
+
+void TypedColumn::AppendText(std::string_view text) {
+    ColumnSegment& segment = SegmentForAppend();
+    segment.states.push_back(CellState::Text);
+    if (m_type == ColumnDataType::Text) {
+        m_text.emplace_back(text);
+    } else {
+        segment.values.push_back(0.0);
+        m_textFallback.emplace(m_size, std::string(text));
+        ++m_textFallbackCount;
+    }
+    ++m_size;
+}
+
+void TypedColumn::SetRaw(std::size_t row, std::string_view raw, const ParseLocale& locale) {
+    if (row >= m_size) {
+        throw std::out_of_range("Row index out of range");
+    }
+    ColumnSegment& segment = m_segments[row / SEGMENT_ROWS];
+    std::size_t offset = row % SEGMENT_ROWS;
+
+    if (segment.states[offset] == CellState::Text && m_type != ColumnDataType::Text) {
+        m_textFallback.erase(row);
+        --m_textFallbackCount;
+    }
+    m_sourceText.erase(row);
+
+    if (ValueParser::Trim(raw).empty()) {
+        segment.states[offset] = CellState::Null;
+        if (m_type == ColumnDataType::Text) {
+            m_text[row].clear();
+        }
+        return;
+    }
+
+    double value = 0.0;
+    if (m_type != ColumnDataType::Text && TryParseTyped(raw, locale, value)) {
+        segment.states[offset] = CellState::Value;
+        segment.values[offset] = value;
+        SetSourceText(row, raw, value);
+        return;
+    }
+
+    segment.states[offset] = CellState::Text;
+    SetText(row, raw);
+}
+
+void TypedColumn::SetText(std::size_t row, std::string_view text) {
+    if (m_type == ColumnDataType::Text) {
+        m_text[row].assign(text.data(), text.size());
+    } else {
+        m_textFallback[row] = std::string(text);
+        ++m_textFallbackCount;
+    }
+}
+
+CellState TypedColumn::GetState(std::size_t row) const {
+    if (row >= m_size) {
+        throw std::out_of_range("Row index out of range");
+    }
+    return m_segments[row / SEGMENT_ROWS].states[row % SEGMENT_ROWS];
+}
+
+double TypedColumn::GetValue(std::size_t row) const {
+    if (m_type == ColumnDataType::Text || GetState(row) != CellState::Value) {
+        return 0.0;
+    }
+    return m_segments[row / SEGMENT_ROWS].values[row % SEGMENT_ROWS];
+}
+
+std::string_view TypedColumn::GetText(std::size_t row) const {
+    if (GetState(row) != CellState::Text) {
+        return {};
+    }
+    if (m_type == ColumnDataType::Text) {
+        return m_text[row];
+    }
+    auto it = m_textFallback.find(row);
+    return it != m_textFallback.end() ? std::string_view(it->second) : std::string_view();
+}
+
+std::string TypedColumn::ToString(std::size_t row) const {
+    switch (GetState(row)) {
+        case CellState::Null:
+            return std::string();
+        case CellState::Text:
+            return std::string(GetText(row));
+        case CellState::Value:
+            break;
+    }
+
+    auto source = m_sourceText.find(row);
+    if (source != m_sourceText.end()) {
+        return source->second;
+    }
+    double value = GetValue(row);
+    if (m_type == ColumnDataType::Boolean) {
+        return value != 0.0 ? "TRUE" : "FALSE";
+    }
+    char buffer[32];
+    return std::string(FormatNumber(value, buffer));
+}
+
+bool TypedColumn::IsNumeric() const {
+    return m_type != ColumnDataType::Text && m_textFallbackCount == 0;
+}
+
+std::vector<double> TypedColumn::GetNumericValues() const {
+    std::vector<double> result;
+    if (m_type == ColumnDataType::Text) {
+        return result;
+    }
+    result.reserve(m_size);
+    for (const ColumnSegment& segment : m_segments) {
+        for (std::size_t i = 0; i < segment.states.size(); ++i) {
+            if (segment.states[i] == CellState::Value) {
+                result.push_back(segment.values[i]);
+            }
+        }
+    }
+    return result;
+}
+
+TypedColumn TypedColumn::Reordered(const std::vector<std::size_t>& order) const {
+    TypedColumn result(m_name, m_type);
+    result.Reserve(order.size());
+    for (std::size_t row : order) {
+        switch (GetState(row)) {
+            case CellState::Null:
+                result.AppendNull();
+                break;
+            case CellState::Value: {
+                result.AppendValue(GetValue(row));
+                auto source = m_sourceText.find(row);
+                if (source != m_sourceText.end()) {
+                    result.m_sourceText.emplace(result.m_size - 1, source->second);
+                }
+                break;
+            }
+            case CellState::Text:
+                result.AppendText(GetText(row));
+                break;
+        }
+    }
+    return result;
+}
+
+ColumnDataType ColumnTypeInference::InferType(const std::vector<std::string_view>& sample, const ParseLocale& locale) {
+    std::size_t nonEmpty = 0;
+    std::size_t booleans = 0;
+    std::size_t numbers = 0;
+    std::size_t dates = 0;
+
+    for (std::string_view raw : sample) {
+        if (ValueParser::Trim(raw).empty()) {
+            continue;
+        }
+        ++nonEmpty;
+
+        bool flag = false;
+        double value = 0.0;
+        if (ValueParser::TryParseBoolean(raw, flag)) {
+            ++booleans;
+        } else if (ValueParser::TryParseNumber(raw, locale, value)) {
+            ++numbers;
+        } else if (ValueParser::TryParseDate(raw, locale, value)) {
+            ++dates;
+        }
+    }
+
+    if (nonEmpty == 0) {
+        return ColumnDataType::Empty;
+    }
+
+    const double required = DEFAULT_MATCH_RATIO * static_cast<double>(nonEmpty);
+    if (static_cast<double>(booleans) >= required) {
+        return ColumnDataType::Boolean;
+    }
+    if (static_cast<double>(numbers) >= required) {
+        return ColumnDataType::Number;
+    }
+    if (dates > 0 && static_cast<double>(dates + numbers) >= required) {
+        return ColumnDataType::Date;
+    }
+    return ColumnDataType::Text;
+}
+
+std::vector<std::size_t> ColumnTypeInference::SampleRows(std::size_t rowCount) {
+    std::vector<std::size_t> rows;
+    if (rowCount <= DEFAULT_SAMPLE_SIZE) {
+        rows.reserve(rowCount);
+        for (std::size_t i = 0; i < rowCount; ++i) {
+            rows.push_back(i);
+        }
+        return rows;
+    }
+
+    // Half of the sample comes from the head of the data (where headers and
+    // sparse leading rows live), the rest is spread evenly over the remainder.
+    const std::size_t head = DEFAULT_SAMPLE_SIZE / 2;
+    rows.reserve(DEFAULT_SAMPLE_SIZE);
+    for (std::size_t i = 0; i < head; ++i) {
+        rows.push_back(i);
+    }
+    const std::size_t remaining = DEFAULT_SAMPLE_SIZE - head;
+    const double stride = static_cast<double>(rowCount - head) / static_cast<double>(remaining);
+    for (std::size_t i = 0; i < remaining; ++i) {
+        rows.push_back(head + static_cast<std::size_t>(static_cast<double>(i) * stride));
+    }
+    return rows;
+}
+
+} // namespace Microsoft::Excel::DataAnalysisEngine
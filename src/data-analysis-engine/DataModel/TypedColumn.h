@@ -0,0 +1,183 @@
+#ifndef TYPED_COLUMN_H
+#define TYPED_COLUMN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "../Utils/ValueParser.h"
+
+namespace Microsoft::Excel::DataAnalysisEngine {
+
+/**
+ * @brief Storage type inferred for a data model column.
+ */
+enum class ColumnDataType : std::uint8_t {
+    Empty,
+    Number,
+    Date,
+    Boolean,
+    Text
+};
+
+/**
+ * @brief State of a single row within a typed column.
+ */
+enum class CellState : std::uint8_t {
+    Null,
+    Value,
+    Text
+};
+
+/**
+ * @brief A fixed-size block of rows within a typed column.
+ *
+ * Numbers, dates (as serials) and booleans (as 0/1) are stored unboxed in
+ * @c values; @c states tells whether each row holds a value, is empty, or
+ * fell back to text.
+ */
+struct ColumnSegment {
+    std::vector<double> values;
+    std::vector<CellState> states;
+};
+
+/**
+ * @class TypedColumn
+ * @brief Columnar, typed storage for one data model column.
+ *
+ * Rows are stored in segments of SEGMENT_ROWS so that very large imports grow
+ * without reallocating the whole column. Strings are only kept for Text
+ * columns, for the rare rows of a typed column that did not parse, and for
+ * typed rows whose source text would not be reproduced by formatting the
+ * value (dates, "007", "1,000", "true").
+ */
+class TypedColumn {
+public:
+    static constexpr std::size_t SEGMENT_ROWS = 65536;
+
+    TypedColumn() = default;
+
+    /**
+     * @brief Constructs an empty column of the given type.
+     * @param name The column name.
+     * @param type The storage type of the column.
+     */
+    TypedColumn(std::string name, ColumnDataType type);
+
+    const std::string& GetName() const { return m_name; }
+    ColumnDataType GetType() const { return m_type; }
+    std::size_t Size() const { return m_size; }
+
+    /**
+     * @brief Reserves capacity for the given number of rows.
+     */
+    void Reserve(std::size_t rows);
+
+    /**
+     * @brief Parses raw text according to the column type and appends it.
+     *
+     * Text that does not match the column type is kept as a text fallback.
+     *
+     * @param raw The raw field text.
+     * @param locale The locale used to interpret numbers and dates.
+     */
+    void AppendRaw(std::string_view raw, const ParseLocale& locale);
+
+    void AppendNull();
+    void AppendValue(double value);
+    void AppendText(std::string_view text);
+
+    /**
+     * @brief Replaces the value of an existing row by parsing raw text.
+     * @throws std::out_of_range if the row does not exist.
+     */
+    void SetRaw(std::size_t row, std::string_view raw, const ParseLocale& locale);
+
+    CellState GetState(std::size_t row) const;
+    bool IsNull(std::size_t row) const { return GetState(row) == CellState::Null; }
+
+    /**
+     * @brief Returns the unboxed value of a row. Only meaningful for CellState::Value.
+     */
+    double GetValue(std::size_t row) const;
+
+    /**
+     * @brief Returns the text of a row. Only meaningful for CellState::Text.
+     */
+    std::string_view GetText(std::size_t row) const;
+
+    /**
+     * @brief Formats a row as a string, for callers of the string-based API.
+     *
+     * Typed rows return the text they were parsed from.
+     */
+    std::string ToString(std::size_t row) const;
+
+    /**
+     * @brief Returns true if every non-empty row holds a typed value.
+     */
+    bool IsNumeric() const;
+
+    /**
+     * @brief Copies all typed values, skipping empty and text rows.
+     */
+    std::vector<double> GetNumericValues() const;
+
+    /**
+     * @brief Returns a copy of the column with rows rearranged.
+     * @param order For each output row, the index of the source row.
+     */
+    TypedColumn Reordered(const std::vector<std::size_t>& order) const;
+
+    std::size_t SegmentCount() const { return m_segments.size(); }
+    const ColumnSegment& GetSegment(std::size_t index) const { return m_segments[index]; }
+
+private:
+    std::string m_name;
+    ColumnDataType m_type = ColumnDataType::Empty;
+    std::size_t m_size = 0;
+    std::size_t m_textFallbackCount = 0;
+    std::vector<ColumnSegment> m_segments;
+    std::vector<std::string> m_text; ///< Row-indexed strings for Text columns.
+    std::unordered_map<std::size_t, std::string> m_textFallback; ///< Unparsed rows of typed columns.
+    std::unordered_map<std::size_t, std::string> m_sourceText; ///< Source text of typed rows that formatting would not reproduce.
+
+    ColumnSegment& SegmentForAppend();
+    bool TryParseTyped(std::string_view raw, const ParseLocale& locale, double& value) const;
+    bool RoundTrips(std::string_view raw, double value) const;
+    void SetSourceText(std::size_t row, std::string_view raw, double value);
+    void SetText(std::size_t row, std::string_view text);
+};
+
+/**
+ * @class ColumnTypeInference
+ * @brief Infers column types from a sample of raw import values.
+ */
+class ColumnTypeInference {
+public:
+    /// Maximum number of rows sampled per column.
+    static constexpr std::size_t DEFAULT_SAMPLE_SIZE = 1000;
+    /// Minimum fraction of sampled non-empty values that must parse for a typed column.
+    static constexpr double DEFAULT_MATCH_RATIO = 0.98;
+
+    /**
+     * @brief Infers the type of a column from sampled raw values.
+     * @param sample Raw text of sampled rows.
+     * @param locale The locale used to interpret numbers and dates.
+     * @return The inferred column type.
+     */
+    static ColumnDataType InferType(const std::vector<std::string_view>& sample, const ParseLocale& locale);
+
+    /**
+     * @brief Picks up to DEFAULT_SAMPLE_SIZE row indices spread across the rows.
+     * @param rowCount The total number of rows.
+     * @return Row indices to sample, in ascending order.
+     */
+    static std::vector<std::size_t> SampleRows(std::size_t rowCount);
+};
+
+} // namespace Microsoft::Excel::DataAnalysisEngine
+
+#endif // TYPED_COLUMN_H
@@ -1,5 +1,6 @@
 #include "PivotTableGenerator.h"
 #include "../Utils/DataAnalysisUtils.h"
+#include "../../core-engine/Performance/Profiler.h"
 #include <algorithm>
 #include <unordered_map>
 #include <stdexcept>
@@ -43,6 +44,7 @@ void PivotTableGenerator::ClearConfiguration() {
 }
 
 std::vector<std::vector<std::string>> PivotTableGenerator::GeneratePivotTable() {
+    EXCEL_PROFILE_SCOPE("PivotTableGenerator::GeneratePivotTable");
     ValidateConfiguration();
 
     // Group data based on row and column fields
@@ -78,6 +80,7 @@ void PivotTableGenerator::ValidateConfiguration() const {
 }
 
 std::unordered_map<std::vector<std::string>, std::vector<std::vector<std::string>>, DataAnalysisUtils::VectorHash> PivotTableGenerator::GroupData() const {
+    EXCEL_PROFILE_SCOPE("PivotTableGenerator::GroupData");
     std::unordered_map<std::vector<std::string>, std::vector<std::vector<std::string>>, DataAnalysisUtils::VectorHash> groupedData;
 
     for (size_t i = 1; i < m_sourceData.size(); ++i) {
@@ -96,6 +99,7 @@ std::unordered_map<std::vector<std::string>, std::vector<std::vector<std::string
 
 std::unordered_map<std::vector<std::string>, std::vector<double>, DataAnalysisUtils::VectorHash> PivotTableGenerator::AggregateData(
     const std::unordered_map<std::vector<std::string>, std::vector<std::vector<std::string>>, DataAnalysisUtils::VectorHash>& groupedData) const {
+    EXCEL_PROFILE_SCOPE("PivotTableGenerator::AggregateData");
     std::unordered_map<std::vector<std::string>, std::vector<double>, DataAnalysisUtils::VectorHash> aggregatedData;
 
     // Use parallel processing for large datasets
@@ -154,6 +158,7 @@ double PivotTableGenerator::ApplyAggregationFunction(const std::vector<std::vect
 
 std::vector<std::vector<std::string>> PivotTableGenerator::FormatPivotTable(
     const std::unordered_map<std::vector<std::string>, std::vector<double>, DataAnalysisUtils::VectorHash>& aggregatedData) const {
+    EXCEL_PROFILE_SCOPE("PivotTableGenerator::FormatPivotTable");
     std::vector<std::vector<std::string>> pivotTable;
 
     // Generate header row
@@ -0,0 +1,172 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../../Utils/ValueParser.h"
+#include "../../DataModel/TypedColumn.h"
+#include "../../DataModel/ColumnarTableBuilder.h"
+#include "../../../core-engine/FileIO/CsvRecordReader.h"
+
+using namespace Microsoft::Excel::DataAnalysisEngine;
+
+class DataModelTests : public ::testing::Test {
+protected:
+    ParseLocale invariant;
+    ParseLocale german{',', '.', DateOrder::DayMonthYear};
+};
+
+TEST_F(DataModelTests, ParsesNumbersWithLocaleSeparators) {
+    double value = 0.0;
+    EXPECT_TRUE(ValueParser::TryParseNumber("1,234.5", invariant, value));
+    EXPECT_DOUBLE_EQ(value, 1234.5);
+    EXPECT_TRUE(ValueParser::TryParseNumber(" -2.5e3 ", invariant, value));
+    EXPECT_DOUBLE_EQ(value, -2500.0);
+    EXPECT_TRUE(ValueParser::TryParseNumber("12.5%", invariant, value));
+    EXPECT_DOUBLE_EQ(value, 0.125);
+    EXPECT_TRUE(ValueParser::TryParseNumber("1.234,5", german, value));
+    EXPECT_DOUBLE_EQ(value, 1234.5);
+
+    EXPECT_FALSE(ValueParser::TryParseNumber("", invariant, value));
+    EXPECT_FALSE(ValueParser::TryParseNumber("12abc", invariant, value));
+    EXPECT_FALSE(ValueParser::TryParseNumber("2024-01-05", invariant, value));
+    EXPECT_FALSE(ValueParser::TryParseNumber("1e", invariant, value));
+}
+
+TEST_F(DataModelTests, ParsesDatesToExcelSerials) {
+    double serial = 0.0;
+    EXPECT_TRUE(ValueParser::TryParseDate("2024-01-05", invariant, serial));
+    EXPECT_DOUBLE_EQ(serial, 45296.0);
+    EXPECT_TRUE(ValueParser::TryParseDate("01/05/2024", invariant, serial));
+    EXPECT_DOUBLE_EQ(serial, 45296.0);
+    EXPECT_TRUE(ValueParser::TryParseDate("05.01.2024", german, serial));
+    EXPECT_DOUBLE_EQ(serial, 45296.0);
+    EXPECT_TRUE(ValueParser::TryParseDate("1900-03-01", invariant, serial));
+    EXPECT_DOUBLE_EQ(serial, 61.0);
+    EXPECT_TRUE(ValueParser::TryParseDate("2024-01-05 12:00", invariant, serial));
+    EXPECT_DOUBLE_EQ(serial, 45296.5);
+
+    EXPECT_FALSE(ValueParser::TryParseDate("2023-02-29", invariant, serial));
+    EXPECT_FALSE(ValueParser::TryParseDate("13/01/2024", invariant, serial));
+}
+
+TEST_F(DataModelTests, InfersColumnTypesFromSample) {
+    std::vector<std::string_view> numbers = {"1", "2.5", "", "-3"};
+    std::vector<std::string_view> booleans = {"TRUE", "false", "True"};
+    std::vector<std::string_view> dates = {"2024-01-05", "2024-02-01"};
+    std::vector<std::string_view> text = {"north", "12", "south"};
+
+    EXPECT_EQ(ColumnTypeInference::InferType(numbers, invariant), ColumnDataType::Number);
+    EXPECT_EQ(ColumnTypeInference::InferType(booleans, invariant), ColumnDataType::Boolean);
+    EXPECT_EQ(ColumnTypeInference::InferType(dates, invariant), ColumnDataType::Date);
+    EXPECT_EQ(ColumnTypeInference::InferType(text, invariant), ColumnDataType::Text);
+    EXPECT_EQ(ColumnTypeInference::InferType({"", " "}, invariant), ColumnDataType::Empty);
+}
+
+TEST_F(DataModelTests, TypedColumnKeepsTextOnlyForUnparsedRows) {
+    TypedColumn column("Amount", ColumnDataType::Number);
+    column.AppendRaw("10", invariant);
+    column.AppendRaw("", invariant);
+    column.AppendRaw("n/a", invariant);
+    column.AppendRaw("2.5", invariant);
+
+    ASSERT_EQ(column.Size(), 4u);
+    EXPECT_EQ(column.GetState(0), CellState::Value);
+    EXPECT_EQ(column.GetState(1), CellState::Null);
+    EXPECT_EQ(column.GetState(2), CellState::Text);
+    EXPECT_EQ(column.GetText(2), "n/a");
+    EXPECT_FALSE(column.IsNumeric());
+
+    column.SetRaw(2, "7", invariant);
+    EXPECT_TRUE(column.IsNumeric());
+    EXPECT_EQ(column.GetNumericValues(), (std::vector<double>{10.0, 7.0, 2.5}));
+}
+
+TEST_F(DataModelTests, TypedColumnSpansMultipleSegments) {
+    TypedColumn column("Index", ColumnDataType::Number);
+    const std::size_t rows = TypedColumn::SEGMENT_ROWS + 10;
+    for (std::size_t i = 0; i < rows; ++i) {
+        column.AppendValue(static_cast<double>(i));
+    }
+
+    EXPECT_EQ(column.SegmentCount(), 2u);
+    EXPECT_DOUBLE_EQ(column.GetValue(rows - 1), static_cast<double>(rows - 1));
+
+    TypedColumn reversed = column.Reordered({rows - 1, 0});
+    EXPECT_EQ(reversed.Size(), 2u);
+    EXPECT_DOUBLE_EQ(reversed.GetValue(0), static_cast<double>(rows - 1));
+}
+
+TEST_F(DataModelTests, CsvReaderHandlesQuotesAcrossBlockBoundaries) {
+    std::istringstream input("name,note\r\n\"Smith, J\",\"said \"\"hi\"\"\"\n\nlast,\n");
+    CoreEngine::FileIO::CsvRecordReader reader(input, ',', 4);
+    std::vector<std::string_view> fields;
+
+    ASSERT_TRUE(reader.ReadRecord(fields));
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"name", "note"}));
+    ASSERT_TRUE(reader.ReadRecord(fields));
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"Smith, J", "said \"hi\""}));
+    ASSERT_TRUE(reader.ReadRecord(fields));
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"last", ""}));
+    EXPECT_FALSE(reader.ReadRecord(fields));
+}
+
+TEST_F(DataModelTests, CsvReaderTreatsQuotesInsideUnquotedFieldsAsText) {
+    std::istringstream input("5\" bolt,1\n\"a \"\"b\"\"\"x,2\n6\" nut,3");
+    CoreEngine::FileIO::CsvRecordReader reader(input, ',', 4);
+    std::vector<std::string_view> fields;
+
+    ASSERT_TRUE(reader.ReadRecord(fields));
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"5\" bolt", "1"}));
+    ASSERT_TRUE(reader.ReadRecord(fields));
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"a \"b\"x", "2"}));
+    ASSERT_TRUE(reader.ReadRecord(fields));
+    EXPECT_EQ(fields, (std::vector<std::string_view>{"6\" nut", "3"}));
+    EXPECT_FALSE(reader.ReadRecord(fields));
+}
+
+TEST_F(DataModelTests, ColumnarBuilderInfersTypesFromLeadingRows) {
+    ColumnarTableBuilder builder(invariant, 2);
+    builder.BeginTable({"Region", "Sales"});
+    builder.AppendRow({"North", "10"});
+    builder.AppendRow({"South", "12.5"});
+    builder.AppendRow({"East"});
+    builder.AppendRow({"West", "7", "ignored"});
+    builder.EndTable();
+
+    std::vector<TypedColumn> columns = builder.TakeColumns();
+    ASSERT_EQ(columns.size(), 2u);
+    EXPECT_EQ(columns[0].GetType(), ColumnDataType::Text);
+    EXPECT_EQ(columns[1].GetType(), ColumnDataType::Number);
+    EXPECT_EQ(columns[1].Size(), 4u);
+    EXPECT_TRUE(columns[1].IsNull(2));
+    EXPECT_EQ(columns[1].GetNumericValues(), (std::vector<double>{10.0, 12.5, 7.0}));
+}
+
+TEST_F(DataModelTests, TypedColumnFormatsRowsAsTheirSourceText) {
+    TypedColumn amounts("Amount", ColumnDataType::Number);
+    amounts.AppendRaw("007", invariant);
+    amounts.AppendRaw("1,000", invariant);
+    amounts.AppendRaw("2.5", invariant);
+    TypedColumn dates("Date", ColumnDataType::Date);
+    dates.AppendRaw("2024-01-05", invariant);
+    TypedColumn flags("Flag", ColumnDataType::Boolean);
+    flags.AppendRaw("true", invariant);
+    flags.AppendRaw("FALSE", invariant);
+
+    EXPECT_EQ(amounts.ToString(0), "007");
+    EXPECT_EQ(amounts.ToString(1), "1,000");
+    EXPECT_EQ(amounts.ToString(2), "2.5");
+    EXPECT_DOUBLE_EQ(amounts.GetValue(0), 7.0);
+    EXPECT_EQ(dates.ToString(0), "2024-01-05");
+    EXPECT_DOUBLE_EQ(dates.GetValue(0), 45296.0);
+    EXPECT_EQ(flags.ToString(0), "true");
+    EXPECT_EQ(flags.ToString(1), "FALSE");
+
+    TypedColumn reversed = amounts.Reordered({1, 0});
+    EXPECT_EQ(reversed.ToString(0), "1,000");
+    EXPECT_EQ(reversed.ToString(1), "007");
+
+    amounts.SetRaw(0, "8", invariant);
+    EXPECT_EQ(amounts.ToString(0), "8");
+}
@@ -0,0 +1,279 @@
+#include "ValueParser.h"
+#include <charconv>
+#include <cstdint>
+
+namespace Microsoft::Excel::DataAnalysisEngine {
+
+namespace {
+
+// Longest numeric literal accepted by the fast path; longer text is treated as non-numeric.
+constexpr std::size_t MAX_NUMBER_LENGTH = 64;
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+char ToUpper(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+bool EqualsIgnoreCase(std::string_view text, std::string_view upper) {
+    if (text.size() != upper.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (ToUpper(text[i]) != upper[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reads an unsigned integer of at most maxDigits digits starting at pos.
+bool ReadInteger(std::string_view text, std::size_t& pos, int maxDigits, int& value, int& digits) {
+    value = 0;
+    digits = 0;
+    while (pos < text.size() && IsDigit(text[pos]) && digits < maxDigits) {
+        value = value * 10 + (text[pos] - '0');
+        ++pos;
+        ++digits;
+    }
+    return digits > 0;
+}
+
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's algorithm).
+std::int64_t DaysFromCivil(int year, int month, int day) {
+    year -= month <= 2 ? 1 : 0;
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * static_cast<unsigned>(month + (month > 2 ? -3 : 9)) + 2) / 5 + static_cast<unsigned>(day) - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+int DaysInMonth(int year, int month) {
+    static const int days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2) {
+        bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+        return leap ? 29 : 28;
+    }
+    return days[month - 1];
+}
+
+bool ParseTimeOfDay(std::string_view text, std::size_t pos, double& fraction) {
+    int hour = 0, minute = 0, second = 0, digits = 0;
+    if (!ReadInteger(text, pos, 2, hour, digits) || pos >= text.size() || text[pos] != ':') {
+        return false;
+    }
+    ++pos;
+    if (!ReadInteger(text, pos, 2, minute, digits) || digits != 2) {
+        return false;
+    }
+    if (pos < text.size() && text[pos] == ':') {
+        ++pos;
+        if (!ReadInteger(text, pos, 2, second, digits) || digits != 2) {
+            return false;
+        }
+    }
+    if (pos != text.size() || hour > 23 || minute > 59 || second > 59) {
+        return false;
+    }
+    fraction = (hour * 3600.0 + minute * 60.0 + second) / 86400.0;
+    return true;
+}
+
+} // namespace
+
+std::string_view ValueParser::Trim(std::string_view text) {
+    std::size_t begin = 0;
+    std::size_t end = text.size();
+    while (begin < end && IsSpace(text[begin])) {
+        ++begin;
+    }
+    while (end > begin && IsSpace(text[end - 1])) {
+        --end;
+    }
+    return text.substr(begin, end - begin);
+}
+
+bool ValueParser::TryParseNumber(std::string_view text, const ParseLocale& locale, double& value) {
+    text = Trim(text);
+    if (text.empty() || text.size() > MAX_NUMBER_LENGTH) {
+        return false;
+    }
+
+    bool percent = false;
+    if (text.back() == '%') {
+        percent = true;
+        text = Trim(text.substr(0, text.size() - 1));
+        if (text.empty()) {
+            return false;
+        }
+    }
+
+    // Normalise into a stack buffer: drop group separators and map the
+    // locale decimal separator to '.', so std::from_chars can do the rest.
+    char buffer[MAX_NUMBER_LENGTH];
+    std::size_t length = 0;
+    std::size_t pos = 0;
+
+    if (text[pos] == '-' || text[pos] == '+') {
+        if (text[pos] == '-') {
+            buffer[length++] = '-';
+        }
+        ++pos;
+    }
+
+    bool sawDigit = false;
+    bool sawDecimal = false;
+    bool sawExponent = false;
+    for (; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (IsDigit(c)) {
+            buffer[length++] = c;
+            sawDigit = true;
+        } else if (c == locale.decimalSeparator && !sawDecimal && !sawExponent) {
+            buffer[length++] = '.';
+            sawDecimal = true;
+        } else if (c == locale.groupSeparator && sawDigit && !sawDecimal && !sawExponent &&
+                   pos + 1 < text.size() && IsDigit(text[pos + 1])) {
+            continue;
+        } else if ((c == 'e' || c == 'E') && sawDigit && !sawExponent) {
+            buffer[length++] = 'e';
+            sawExponent = true;
+            if (pos + 1 < text.size() && (text[pos + 1] == '-' || text[pos + 1] == '+')) {
+                buffer[length++] = text[++pos];
+            }
+            if (pos + 1 >= text.size() || !IsDigit(text[pos + 1])) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+
+    if (!sawDigit) {
+        return false;
+    }
+
+    double parsed = 0.0;
+    auto result = std::from_chars(buffer, buffer + length, parsed);
+    if (result.ec != std::errc() || result.ptr != buffer + length) {
+        return false;
+    }
+
+    value = percent ? parsed / 100.0 : parsed;
+    return true;
+}
+
+bool ValueParser::TryParseBoolean(std::string_view text, bool& value) {
+    text = Trim(text);
+    if (EqualsIgnoreCase(text, "TRUE")) {
+        value = true;
+        return true;
+    }
+    if (EqualsIgnoreCase(text, "FALSE")) {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+bool ValueParser::TryParseDate(std::string_view text, const ParseLocale& locale, double& serial) {
+    text = Trim(text);
+    if (text.size() < 6) {
+        return false;
+    }
+
+    std::size_t pos = 0;
+    int parts[3] = {0, 0, 0};
+    int digits[3] = {0, 0, 0};
+    char separator = 0;
+
+    for (int i = 0; i < 3; ++i) {
+        if (!ReadInteger(text, pos, 4, parts[i], digits[i])) {
+            return false;
+        }
+        if (i < 2) {
+            if (pos >= text.size()) {
+                return false;
+            }
+            char c = text[pos];
+            if (c != '/' && c != '-' && c != '.') {
+                return false;
+            }
+            if (separator == 0) {
+                separator = c;
+            } else if (c != separator) {
+                return false;
+            }
+            ++pos;
+        }
+    }
+
+    int year = 0, month = 0, day = 0, yearDigits = 0;
+    if (digits[0] == 4) {
+        year = parts[0]; month = parts[1]; day = parts[2]; yearDigits = 4;
+    } else {
+        switch (locale.dateOrder) {
+            case DateOrder::DayMonthYear:
+                day = parts[0]; month = parts[1]; year = parts[2]; yearDigits = digits[2];
+                break;
+            case DateOrder::MonthDayYear:
+                month = parts[0]; day = parts[1]; year = parts[2]; yearDigits = digits[2];
+                break;
+            case DateOrder::YearMonthDay:
+                year = parts[0]; month = parts[1]; day = parts[2]; yearDigits = digits[0];
+                break;
+        }
+    }
+
+    if (yearDigits == 2) {
+        // Excel's two-digit year window: 00-29 => 20xx, 30-99 => 19xx.
+        year += year < 30 ? 2000 : 1900;
+    } else if (yearDigits != 4) {
+        return false;
+    }
+
+    if (month < 1 || month > 12 || day < 1 || day > DaysInMonth(year, month)) {
+        return false;
+    }
+
+    double result = ToExcelSerial(year, month, day);
+    if (result < 0) {
+        return false;
+    }
+
+    if (pos < text.size()) {
+        if (text[pos] != ' ' && text[pos] != 'T') {
+            return false;
+        }
+        double fraction = 0.0;
+        if (!ParseTimeOfDay(text, pos + 1, fraction)) {
+            return false;
+        }
+        result += fraction;
+    }
+
+    serial = result;
+    return true;
+}
+
+double ValueParser::ToExcelSerial(int year, int month, int day) {
+    if (year < 1900 || year > 9999) {
+        return -1.0;
+    }
+    static const std::int64_t epoch = DaysFromCivil(1899, 12, 30);
+    std::int64_t days = DaysFromCivil(year, month, day) - epoch;
+    // Excel treats 1900 as a leap year, so serials before 1900-03-01 are one lower.
+    if (days < 61) {
+        --days;
+    }
+    return static_cast<double>(days);
+}
+
+} // namespace Microsoft::Excel::DataAnalysisEngine
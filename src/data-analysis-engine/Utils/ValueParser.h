@@ -0,0 +1,91 @@
+#ifndef VALUE_PARSER_H
+#define VALUE_PARSER_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace Microsoft::Excel::DataAnalysisEngine {
+
+/**
+ * @brief Order of the day, month and year components in locale-specific dates.
+ */
+enum class DateOrder {
+    DayMonthYear,
+    MonthDayYear,
+    YearMonthDay
+};
+
+/**
+ * @brief Locale settings used when converting imported text into typed values.
+ *
+ * ISO-8601 dates (YYYY-MM-DD) and the invariant boolean literals are always
+ * accepted; the settings below only affect the locale-dependent forms.
+ */
+struct ParseLocale {
+    char decimalSeparator = '.';
+    char groupSeparator = ',';
+    DateOrder dateOrder = DateOrder::MonthDayYear;
+};
+
+/**
+ * @brief Allocation-free parsers that convert raw import text into typed values.
+ *
+ * All functions operate on std::string_view and never allocate, so they can be
+ * called once per imported field on the hot path of CSV and XLSX import.
+ */
+class ValueParser {
+public:
+    /**
+     * @brief Parses a number, honouring the locale's decimal and group separators.
+     *
+     * Accepts optional surrounding whitespace, a leading sign, an exponent and a
+     * trailing percent sign (which divides the value by 100).
+     *
+     * @param text The text to parse.
+     * @param locale The locale used to interpret separators.
+     * @param value Receives the parsed value on success.
+     * @return True if the whole text is a number, false otherwise.
+     */
+    static bool TryParseNumber(std::string_view text, const ParseLocale& locale, double& value);
+
+    /**
+     * @brief Parses TRUE/FALSE (case-insensitive).
+     * @param text The text to parse.
+     * @param value Receives the parsed value on success.
+     * @return True if the text is a boolean literal, false otherwise.
+     */
+    static bool TryParseBoolean(std::string_view text, bool& value);
+
+    /**
+     * @brief Parses a date with an optional HH:MM[:SS] time part into an Excel serial number.
+     *
+     * ISO dates are accepted regardless of locale; other dates use the locale's
+     * component order with '/', '-' or '.' separators.
+     *
+     * @param text The text to parse.
+     * @param locale The locale used to interpret component order.
+     * @param serial Receives the 1900-system serial date on success.
+     * @return True if the text is a valid date, false otherwise.
+     */
+    static bool TryParseDate(std::string_view text, const ParseLocale& locale, double& serial);
+
+    /**
+     * @brief Returns the text with leading and trailing whitespace removed.
+     * @param text The text to trim.
+     * @return A view into the original text.
+     */
+    static std::string_view Trim(std::string_view text);
+
+    /**
+     * @brief Converts a civil date to an Excel 1900-system serial number.
+     * @return The serial number, or a negative value if the date is invalid.
+     */
+    static double ToExcelSerial(int year, int month, int day);
+
+private:
+    ValueParser() = delete;
+};
+
+} // namespace Microsoft::Excel::DataAnalysisEngine
+
+#endif // VALUE_PARSER_H